@@ -45,6 +45,10 @@
 #include <stdint.h>
 
 extern uint32_t SystemCoreClock;
+extern void configureRunTimeStatsTimer(void);
+extern uint32_t readRunTimeStatsTimer(void);
+extern void traceTaskSwitched(uint8_t event, uint32_t taskNumber);
+extern void traceQueueEvent(uint8_t event, void *queue);
 #endif
 
 /* Constants that describe the hardware and memory usage. */
@@ -84,8 +88,22 @@ extern uint32_t SystemCoreClock;
 /* Constants provided for debugging and optimisation assistance. */
 #define configCHECK_FOR_STACK_OVERFLOW        0
 #define configQUEUE_REGISTRY_SIZE             0
+#define configGENERATE_RUN_TIME_STATS         1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()  configureRunTimeStatsTimer()
+#define portGET_RUN_TIME_COUNTER_VALUE()      readRunTimeStatsTimer()
 #define configASSERT( x )                     if( ( x ) == 0 ) { taskDISABLE_INTERRUPTS(); for( ;; ); }
 
+/* Scheduler trace into a RAM ring buffer, see trace.h. The event numbers are TraceEventType */
+#define TRACE_ENABLED                         1
+#if TRACE_ENABLED
+#define traceTASK_SWITCHED_IN()               traceTaskSwitched(0, pxCurrentTCB->uxTaskNumber)
+#define traceTASK_SWITCHED_OUT()              traceTaskSwitched(1, pxCurrentTCB->uxTaskNumber)
+#define traceQUEUE_SEND(pxQueue)              traceQueueEvent(2, (void *)(pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue)           traceQueueEvent(3, (void *)(pxQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)  traceQueueEvent(4, (void *)(pxQueue))
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) traceQueueEvent(5, (void *)(pxQueue))
+#endif
+
 /* Constants that define which hook (callback) functions should be used. */
 #define configUSE_IDLE_HOOK                   0
 #define configUSE_TICK_HOOK                   0
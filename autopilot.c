@@ -0,0 +1,245 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "autopilot.h"
+#include "bitboard.h"
+#include "replay.h"
+#include "entity.h"
+
+/* The cycle runs through every row from column 1 to the last one and back,
+ * going right on even rows and left on odd ones, then up column 0 to the
+ * start. The snake starts on row ENV_HEIGHT / 2 heading right, so when that
+ * row is odd the whole cycle is mirrored and column ENV_WIDTH - 1 is the way
+ * back. The table is worked out by the compiler from these macros and ends
+ * up in flash, it does not depend on anything but the board size. */
+#if ENV_HEIGHT % 2 != 0 || ENV_WIDTH < 2
+#error "the autopilot cycle needs an even ENV_HEIGHT and at least two columns"
+#endif
+#if AUTOPILOT_TABLE_SIZE >= 2048
+#error "the autopilot cycle table holds at most 8188 cells"
+#endif
+
+#define CYCLE_MIRRORED			((ENV_HEIGHT / 2) % 2)
+#define CYCLE_COLUMN(x)			(CYCLE_MIRRORED ? ENV_WIDTH - 1 - (x) : (x))
+#define CYCLE_TURN(direction)	(CYCLE_MIRRORED && (direction) >= RIGHT ? (direction) ^ 1 : (direction))
+#define CYCLE_UNMIRRORED(x, y)	((x) == 0 ? ((y) == 0 ? RIGHT : UP) : \
+								 (y) % 2 == 0 ? ((x) == ENV_WIDTH - 1 ? DOWN : RIGHT) : \
+								 (x) == 1 ? ((y) == ENV_HEIGHT - 1 ? LEFT : DOWN) : LEFT)
+#define CYCLE_DIRECTION(x, y)	CYCLE_TURN(CYCLE_UNMIRRORED(CYCLE_COLUMN(x), (y)))
+#define CYCLE_CELL(n)			((n) < AUTOPILOT_CELLS ? CYCLE_DIRECTION((n) % ENV_WIDTH, (n) / ENV_WIDTH) : 0)
+#define CYCLE_BYTE(i)			(CYCLE_CELL(4 * (i)) | CYCLE_CELL(4 * (i) + 1) << 2 | CYCLE_CELL(4 * (i) + 2) << 4 | CYCLE_CELL(4 * (i) + 3) << 6)
+#define CYCLE_BYTES_1(i)		CYCLE_BYTE(i),
+#define CYCLE_BYTES_2(i)		CYCLE_BYTES_1(i) CYCLE_BYTES_1((i) + 1)
+#define CYCLE_BYTES_4(i)		CYCLE_BYTES_2(i) CYCLE_BYTES_2((i) + 2)
+#define CYCLE_BYTES_8(i)		CYCLE_BYTES_4(i) CYCLE_BYTES_4((i) + 4)
+#define CYCLE_BYTES_16(i)		CYCLE_BYTES_8(i) CYCLE_BYTES_8((i) + 8)
+#define CYCLE_BYTES_32(i)		CYCLE_BYTES_16(i) CYCLE_BYTES_16((i) + 16)
+#define CYCLE_BYTES_64(i)		CYCLE_BYTES_32(i) CYCLE_BYTES_32((i) + 32)
+#define CYCLE_BYTES_128(i)		CYCLE_BYTES_64(i) CYCLE_BYTES_64((i) + 64)
+#define CYCLE_BYTES_256(i)		CYCLE_BYTES_128(i) CYCLE_BYTES_128((i) + 128)
+#define CYCLE_BYTES_512(i)		CYCLE_BYTES_256(i) CYCLE_BYTES_256((i) + 256)
+#define CYCLE_BYTES_1024(i)		CYCLE_BYTES_512(i) CYCLE_BYTES_512((i) + 512)
+
+/* Global Variables */
+bool AutopilotMode = false;
+
+/* The direction of the cycle out of every cell, cell y * ENV_WIDTH + x in bits 2 * (x % 4) of byte (y * ENV_WIDTH + x) / 4 */
+const uint8_t AutopilotCycle[AUTOPILOT_TABLE_SIZE] =
+{
+#if AUTOPILOT_TABLE_SIZE & 1024
+	CYCLE_BYTES_1024(0)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 512
+	CYCLE_BYTES_512(AUTOPILOT_TABLE_SIZE & 1024)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 256
+	CYCLE_BYTES_256(AUTOPILOT_TABLE_SIZE & 1536)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 128
+	CYCLE_BYTES_128(AUTOPILOT_TABLE_SIZE & 1792)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 64
+	CYCLE_BYTES_64(AUTOPILOT_TABLE_SIZE & 1920)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 32
+	CYCLE_BYTES_32(AUTOPILOT_TABLE_SIZE & 1984)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 16
+	CYCLE_BYTES_16(AUTOPILOT_TABLE_SIZE & 2016)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 8
+	CYCLE_BYTES_8(AUTOPILOT_TABLE_SIZE & 2032)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 4
+	CYCLE_BYTES_4(AUTOPILOT_TABLE_SIZE & 2040)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 2
+	CYCLE_BYTES_2(AUTOPILOT_TABLE_SIZE & 2044)
+#endif
+#if AUTOPILOT_TABLE_SIZE & 1
+	CYCLE_BYTES_1(AUTOPILOT_TABLE_SIZE & 2046)
+#endif
+};
+
+int cycleDistance(int from, int to);
+Direction rejoinCycle();
+bool isBodyAlongCycle();
+int measureCycleRun(PointType position);
+
+Direction readCycleDirection(PointType position)
+{
+	int cell = position.y * ENV_WIDTH + position.x;
+	return (Direction)((AutopilotCycle[cell >> 2] >> ((cell & 3) * 2)) & 3);
+}
+
+/* Place of a cell along the cycle, 0 for the top left corner of the unmirrored cycle */
+int readCycleOrder(PointType position)
+{
+	int x = CYCLE_COLUMN(position.x);
+	if (x == 0) return position.y == 0 ? 0 : AUTOPILOT_CELLS - position.y;
+	if (position.y % 2 == 0) return position.y * (ENV_WIDTH - 1) + x;
+	return position.y * (ENV_WIDTH - 1) + ENV_WIDTH - x;
+}
+
+/* While the body lies between the tail and the head along the cycle, every
+ * cell after the head and before the tail is free. Following the cycle keeps
+ * it that way and so does a shortcut to a neighbour further along, as long
+ * as it lands short of the tail with AUTOPILOT_MARGIN cells to spare for the
+ * tail staying put while the snake grows. An enemy on the next two rows of
+ * the cycle is jumped over by the shortest shortcut past it. Otherwise
+ * shortcuts do not go past the normal power-up, and are only taken while the
+ * snake fills less than half of the board. When nothing along the cycle is
+ * left, or the body is out of order after such a move, rejoinCycle steers
+ * until the body is back in order. Called with GameStateLock held */
+Direction chooseAutopilotDirection()
+{
+	PointType head = GameState.snakePositions[0];
+	PointType enemy = findEntityPosition(ENTITY_ENEMY);
+	PointType normal = findEntityPosition(ENTITY_NORMAL_POWERUP);
+	PointType next;
+	Direction best = readCycleDirection(head);
+	Direction past = best;
+	int headOrder = readCycleOrder(head);
+	int room = cycleDistance(headOrder, readCycleOrder(GameState.snakePositions[GameState.snakeLength - 1])) - AUTOPILOT_MARGIN;
+	int enemyDistance = AUTOPILOT_CELLS;
+	int limit = 1;
+	int bestDistance = 1;
+	int pastDistance = AUTOPILOT_CELLS;
+	int distance;
+	int direction;
+	if (!isBodyAlongCycle()) return rejoinCycle();
+	if (enemy.x >= 0) enemyDistance = cycleDistance(headOrder, readCycleOrder(enemy));
+	if (GameState.snakeLength * 2 < AUTOPILOT_CELLS && normal.x >= 0)
+	{
+		limit = cycleDistance(headOrder, readCycleOrder(normal));
+	}
+	if (limit > room) limit = room;
+	for (direction = UP; direction <= LEFT; direction++)
+	{
+		next = calculateNewHeadPosition(head, (Direction)direction);
+		distance = cycleDistance(headOrder, readCycleOrder(next));
+		if (distance == enemyDistance || distance > room) continue;
+		if (distance > enemyDistance && distance < pastDistance && enemyDistance < 2 * ENV_WIDTH)
+		{
+			past = (Direction)direction;
+			pastDistance = distance;
+		}
+		if (distance > bestDistance && distance <= limit)
+		{
+			best = (Direction)direction;
+			bestDistance = distance;
+		}
+	}
+	if (pastDistance < AUTOPILOT_CELLS) return past;
+	next = calculateNewHeadPosition(head, best);
+	if (!isSnakeCollision(next) && entityKindAt(next) != ENTITY_ENEMY) return best;
+	return rejoinCycle();
+}
+
+/* Off the cycle, the move with the longest free run along the cycle ahead of
+ * it, the cycle's own move when that is as long as any. Moves that leave the
+ * snake no room for its body are taken last. Once the snake has followed the
+ * cycle for its whole length the body is in order again */
+Direction rejoinCycle()
+{
+	PointType head = GameState.snakePositions[0];
+	PointType next;
+	Direction cycle = readCycleDirection(head);
+	Direction best = cycle;
+	int bestRun = -1;
+	int run;
+	int direction;
+	int i;
+	for (i = 0; i < 4; i++)
+	{
+		/* The cycle's move first, so it wins a tie */
+		direction = (cycle + i) % 4;
+		next = calculateNewHeadPosition(head, (Direction)direction);
+		if (isSnakeCollision(next) || entityKindAt(next) == ENTITY_ENEMY) continue;
+		run = measureCycleRun(next);
+		if (!isTrapMove((Direction)direction)) run += AUTOPILOT_CELLS;
+		if (run > bestRun)
+		{
+			best = (Direction)direction;
+			bestRun = run;
+		}
+	}
+	return best;
+}
+
+/* Whether every step from the tail to the head goes forward along the cycle,
+ * less than once round in all */
+bool isBodyAlongCycle()
+{
+	int total = 0;
+	int i;
+	for (i = GameState.snakeLength - 1; i > 0; i--)
+	{
+		total += cycleDistance(readCycleOrder(GameState.snakePositions[i]), readCycleOrder(GameState.snakePositions[i - 1]));
+	}
+	return total < AUTOPILOT_CELLS;
+}
+
+/* Cells along the cycle from a new head to the first one taken by the body
+ * that stays, or by the enemy */
+int measureCycleRun(PointType position)
+{
+	PointType enemy = findEntityPosition(ENTITY_ENEMY);
+	int order = readCycleOrder(position);
+	int run = AUTOPILOT_CELLS;
+	int distance;
+	int i;
+	for (i = 0; i < GameState.snakeLength - 1; i++)
+	{
+		distance = cycleDistance(order, readCycleOrder(GameState.snakePositions[i]));
+		if (distance < run) run = distance;
+	}
+	if (enemy.x >= 0)
+	{
+		distance = cycleDistance(order, readCycleOrder(enemy));
+		if (distance < run) run = distance;
+	}
+	return run;
+}
+
+/* The autopilot in place of the keys, its turns are recorded like the player's */
+void steerAutopilot()
+{
+	Direction direction = chooseAutopilotDirection();
+	if (direction != LastDirection)
+	{
+		LastDirection = direction;
+		recordDirection(direction);
+	}
+}
+
+int cycleDistance(int from, int to)
+{
+	return (to - from + AUTOPILOT_CELLS) % AUTOPILOT_CELLS;
+}
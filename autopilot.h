@@ -0,0 +1,21 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "game.h"
+
+/* Autopilot Configuration Parameters */
+#define AUTOPILOT_CELLS			(ENV_WIDTH * ENV_HEIGHT)
+#define AUTOPILOT_TABLE_SIZE	((AUTOPILOT_CELLS + 3) / 4)		/* Two bits per cell */
+#define AUTOPILOT_MARGIN		4		/* Cells kept free between the head and the tail after a shortcut */
+
+/* Global Variables */
+extern bool AutopilotMode;
+extern const uint8_t AutopilotCycle[AUTOPILOT_TABLE_SIZE];
+
+/* Autopilot Functions */
+Direction readCycleDirection(PointType position);
+int readCycleOrder(PointType position);
+Direction chooseAutopilotDirection();
+void steerAutopilot();
+
+#endif /* AUTOPILOT_H */
@@ -0,0 +1,181 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitboard.h"
+#include "shard.h"
+#include "entity.h"
+
+#if ENV_WIDTH == BITBOARD_ROW_BITS
+#define BITBOARD_ROW_MASK		(~(BitboardRowType)0)
+#else
+#define BITBOARD_ROW_MASK		((((BitboardRowType)1) << ENV_WIDTH) - 1)
+#endif
+
+BitboardRowType rotateEast(BitboardRowType row, int distance);
+BitboardRowType rotateWest(BitboardRowType row, int distance);
+BitboardRowType fillBitboardRow(BitboardRowType seeds, BitboardRowType free);
+
+void clearBitboard(BitboardType *board)
+{
+	memset(board, 0, sizeof(*board));
+}
+
+void setBitboardCell(BitboardType *board, PointType position)
+{
+	board->rows[position.y] |= (BitboardRowType)1 << position.x;
+}
+
+bool isBitboardCell(const BitboardType *board, PointType position)
+{
+	return (board->rows[position.y] >> position.x) & 1;
+}
+
+int countBitboard(const BitboardType *board)
+{
+	int count = 0;
+	int y;
+	for (y = 0; y < ENV_HEIGHT; y++)
+	{
+#if BITBOARD_ROW_BITS == 32
+		count += __builtin_popcount(board->rows[y]);
+#else
+		count += __builtin_popcountll(board->rows[y]);
+#endif
+	}
+	return count;
+}
+
+/* Every cell moved one step the way calculateNewHeadPosition moves the head */
+void shiftBitboard(const BitboardType *from, BitboardType *to, Direction direction)
+{
+	int y;
+	for (y = 0; y < ENV_HEIGHT; y++)
+	{
+		switch (direction)
+		{
+			case UP:
+				to->rows[y] = from->rows[(y + 1) % ENV_HEIGHT];
+				break;
+			case DOWN:
+				to->rows[y] = from->rows[(y + ENV_HEIGHT - 1) % ENV_HEIGHT];
+				break;
+			case RIGHT:
+				to->rows[y] = rotateEast(from->rows[y], 1);
+				break;
+			case LEFT:
+				to->rows[y] = rotateWest(from->rows[y], 1);
+				break;
+		}
+	}
+}
+
+/* The snake, all of it or without the tail that moves away on the next tick, and the enemy.
+ * Called with GameStateLock held */
+void buildObstacleBitboard(BitboardType *board, bool withTail)
+{
+	int length = withTail ? GameState.snakeLength : GameState.snakeLength - 1;
+	int i;
+	clearBitboard(board);
+	for (i = 0; i < length; i++)
+	{
+		/* On a sharded world cells off this board are not in it */
+		if (GameState.snakePositions[i].x >= 0 && GameState.snakePositions[i].x < ENV_WIDTH) setBitboardCell(board, GameState.snakePositions[i]);
+	}
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		if (EntityPool[i].kind == ENTITY_ENEMY) setBitboardCell(board, EntityPool[i].position);
+	}
+}
+
+/* Cells reachable from start without crossing blocked ones. Runs of free
+ * cells are filled a whole row at a time, then rows take what the rows
+ * above and below reached, sweeping down and up until nothing changes */
+int floodFillBitboard(const BitboardType *blocked, PointType start, BitboardType *reached)
+{
+	BitboardRowType free[ENV_HEIGHT];
+	BitboardRowType seeds;
+	bool changed = true;
+	bool down = true;
+	int y;
+	int i;
+	clearBitboard(reached);
+	if (isBitboardCell(blocked, start)) return 0;
+	for (y = 0; y < ENV_HEIGHT; y++) free[y] = ~blocked->rows[y] & BITBOARD_ROW_MASK;
+	reached->rows[start.y] = fillBitboardRow((BitboardRowType)1 << start.x, free[start.y]);
+	while (changed)
+	{
+		changed = false;
+		for (i = 0; i < ENV_HEIGHT; i++)
+		{
+			y = down ? i : ENV_HEIGHT - 1 - i;
+			seeds = (reached->rows[(y + ENV_HEIGHT - 1) % ENV_HEIGHT] | reached->rows[(y + 1) % ENV_HEIGHT]) & free[y] & ~reached->rows[y];
+			if (seeds == 0) continue;
+			reached->rows[y] = fillBitboardRow(seeds | reached->rows[y], free[y]);
+			changed = true;
+		}
+		down = !down;
+	}
+	return countBitboard(reached);
+}
+
+/* Free cells the head could still reach after moving this way, -1 when
+ * the move leaves this board of a sharded world. Called with GameStateLock held */
+int measureMoveRoom(Direction direction)
+{
+	BitboardType blocked;
+	BitboardType reached;
+	PointType next = calculateNewHeadPosition(GameState.snakePositions[0], direction);
+	EntityKind kind;
+	if (next.x < 0 || next.x >= ENV_WIDTH) return -1;
+	/* The tail only stays when the move eats a power-up */
+	kind = entityKindAt(next);
+	buildObstacleBitboard(&blocked, kind == ENTITY_NORMAL_POWERUP || kind == ENTITY_SPECIAL_POWERUP);
+	return floodFillBitboard(&blocked, next, &reached);
+}
+
+/* A move into an area smaller than the snake, which cannot get its body out of it again */
+bool isTrapMove(Direction direction)
+{
+	int room = measureMoveRoom(direction);
+	return room >= 0 && room < GameState.snakeLength;
+}
+
+/* Towards higher columns, round the row unless the columns go on to another board */
+BitboardRowType rotateEast(BitboardRowType row, int distance)
+{
+	if (ShardCount > 1) return (row << distance) & BITBOARD_ROW_MASK;
+	return ((row << distance) | (row >> (ENV_WIDTH - distance))) & BITBOARD_ROW_MASK;
+}
+
+BitboardRowType rotateWest(BitboardRowType row, int distance)
+{
+	if (ShardCount > 1) return row >> distance;
+	return ((row >> distance) | (row << (ENV_WIDTH - distance))) & BITBOARD_ROW_MASK;
+}
+
+/* The runs of free cells holding a seed, both ways at once in log2(ENV_WIDTH)
+ * doubling steps: each step carries the fill over twice the distance of the
+ * one before, through cells that are free that whole distance */
+BitboardRowType fillBitboardRow(BitboardRowType seeds, BitboardRowType free)
+{
+	BitboardRowType east = seeds & free;
+	BitboardRowType west = east;
+	BitboardRowType eastFree = free;
+	BitboardRowType westFree = free;
+	int distance;
+	for (distance = 1; distance < ENV_WIDTH; distance <<= 1)
+	{
+		east |= eastFree & rotateEast(east, distance);
+		eastFree &= rotateEast(eastFree, distance);
+		west |= westFree & rotateWest(west, distance);
+		westFree &= rotateWest(westFree, distance);
+	}
+	return east | west;
+}
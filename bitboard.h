@@ -0,0 +1,39 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include "game.h"
+
+/* Bitboard Configuration Parameters */
+/* One word per row, bit x for column x. 32 bit words up to 32 columns, 64 bit ones up to 64 */
+#if ENV_WIDTH <= 32
+#define BITBOARD_ROW_BITS		32
+#elif ENV_WIDTH <= 64
+#define BITBOARD_ROW_BITS		64
+#else
+#error "bitboard rows hold at most 64 columns"
+#endif
+
+/* Type Definitions */
+#if BITBOARD_ROW_BITS == 32
+typedef uint32_t BitboardRowType;
+#else
+typedef uint64_t BitboardRowType;
+#endif
+
+typedef struct Bitboard
+{
+	BitboardRowType rows[ENV_HEIGHT];
+} BitboardType;
+
+/* Bitboard Functions */
+void clearBitboard(BitboardType *board);
+void setBitboardCell(BitboardType *board, PointType position);
+bool isBitboardCell(const BitboardType *board, PointType position);
+int countBitboard(const BitboardType *board);
+void shiftBitboard(const BitboardType *from, BitboardType *to, Direction direction);
+void buildObstacleBitboard(BitboardType *board, bool withTail);
+int floodFillBitboard(const BitboardType *blocked, PointType start, BitboardType *reached);
+int measureMoveRoom(Direction direction);
+bool isTrapMove(Direction direction);
+
+#endif /* BITBOARD_H */
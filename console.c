@@ -0,0 +1,599 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inc/hw_ints.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/gpio.h>
+#include <driverlib/pin_map.h>
+#include <driverlib/uart.h>
+#include <driverlib/interrupt.h>
+
+#include "console.h"
+#include "gameTick.h"
+#include "cpuStats.h"
+#include "highScore.h"
+#include "trace.h"
+#include "spectator.h"
+#include "palette.h"
+#include "netplay.h"
+#include "shard.h"
+#include "stress.h"
+#include "profile.h"
+#include "entity.h"
+
+/* Global Variables */
+xQueueHandle ConsoleRxQueue = NULL;
+xTaskHandle ConsoleTaskHandle;
+char ConsoleLine[CONSOLE_LINE_LENGTH];
+int ConsoleLineLength = 0;
+TaskStatus_t ConsoleTaskStatus[CONSOLE_MAX_TASKS];
+
+void consolePutString(const char *string);
+void consolePutNumber(long value);
+void consolePutMicroseconds(uint64_t timestamps);
+void consolePutPoint(PointType point);
+void consolePutQueue(const char *name, xQueueHandle queue);
+void consolePutLockHolder(const char *name, const char *holder);
+void copyLockHolder(char *holder, xSemaphoreHandle lock);
+void printConsoleHelp();
+void printConsoleState();
+void printConsoleTasks();
+void printConsoleQueues();
+void printConsoleSpectators();
+void changePalette(bool color, bool unicode, bool halfBlock);
+void printConsoleNetplay();
+void printConsoleShard();
+void printConsoleStress();
+void printConsoleTicks();
+void printConsoleCpu();
+
+/* UART1 on PB0 and PB1, kept apart from the game on UART0 so diagnostics never touch the screen */
+void initializeConsole()
+{
+	ConsoleRxQueue = xQueueCreate(CONSOLE_RX_QUEUE_LENGTH, sizeof(char));
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_GPIOB));
+	GPIOPinTypeUART(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+	GPIOPinConfigure(GPIO_PB0_U1RX);
+	GPIOPinConfigure(GPIO_PB1_U1TX);
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_UART1);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_UART1));
+	UARTConfigSetExpClk(CONSOLE_UART_BASE, SysCtlClockGet(), CONSOLE_BAUD_RATE, UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
+	UARTFIFODisable(CONSOLE_UART_BASE);
+	UARTIntEnable(CONSOLE_UART_BASE, UART_INT_RX);
+	IntPrioritySet(INT_UART1, configKERNEL_INTERRUPT_PRIORITY);
+	IntEnable(INT_UART1);
+}
+
+void UART1_Handler(void)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	char c;
+	UARTIntClear(CONSOLE_UART_BASE, UARTIntStatus(CONSOLE_UART_BASE, true));
+	while (UARTCharsAvail(CONSOLE_UART_BASE))
+	{
+		c = (char)UARTCharGetNonBlocking(CONSOLE_UART_BASE);
+		/* Dropped when the console is behind, the user just retypes */
+		xQueueSendFromISR(ConsoleRxQueue, (const void *)&c, &higherPriorityTaskWoken);
+	}
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+/* Runs below every game task, so the game only ever waits for it while a snapshot is copied */
+void ConsoleTask(void *vpParameters)
+{
+	char c;
+	consolePutString("\r\nSnake console, type help\r\n> ");
+	for ( ;; )
+	{
+		xQueueReceive(ConsoleRxQueue, (void *)&c, portMAX_DELAY);
+		processConsoleChar(c);
+	}
+}
+
+void processConsoleChar(char c)
+{
+	if (c == '\r' || c == '\n')
+	{
+		consolePutString("\r\n");
+		ConsoleLine[ConsoleLineLength] = 0;
+		if (ConsoleLineLength > 0) runConsoleCommand(ConsoleLine);
+		ConsoleLineLength = 0;
+		consolePutString("> ");
+	}
+	else if (c == '\b' || c == 0x7F)
+	{
+		if (ConsoleLineLength == 0) return;
+		ConsoleLineLength--;
+		consolePutString("\b \b");
+	}
+	else if (c >= ' ' && ConsoleLineLength < CONSOLE_LINE_LENGTH - 1)
+	{
+		ConsoleLine[ConsoleLineLength++] = c;
+		UARTCharPut(CONSOLE_UART_BASE, c);
+	}
+}
+
+void runConsoleCommand(char *line)
+{
+	char *command = strtok(line, " ");
+	char *argument = strtok(NULL, " ");
+	char *value = strtok(NULL, " ");
+	long number = argument != NULL ? strtol(argument, NULL, 10) : 0;
+	
+	if (command == NULL) return;
+	if (strcmp(command, "help") == 0) printConsoleHelp();
+	else if (strcmp(command, "state") == 0) printConsoleState();
+	else if (strcmp(command, "tasks") == 0) printConsoleTasks();
+	else if (strcmp(command, "queues") == 0) printConsoleQueues();
+	else if (strcmp(command, "speed") == 0)
+	{
+		if (number < 1 || number > CONSOLE_MAX_SNAKE_SPEED) consolePutString("speed must be 1 to 1200\r\n");
+		else if (!inGame) consolePutString("no game running\r\n");
+		else setGameTickSpeed((int)number);
+	}
+	else if (strcmp(command, "period") == 0)
+	{
+		number = value != NULL ? strtol(value, NULL, 10) : 0;
+		if (argument == NULL || number < 1) consolePutString("usage: period special|enemy <ms>\r\n");
+		else if (strcmp(argument, "special") == 0) SpecialPowerUpPeriod = (int)number;
+		else if (strcmp(argument, "enemy") == 0) EnemyPeriod = (int)number;
+		else consolePutString("usage: period special|enemy <ms>\r\n");
+	}
+	else if (strcmp(command, "pause") == 0)
+	{
+		GameTickSteps = 0;
+		GameTickPaused = true;
+	}
+	else if (strcmp(command, "resume") == 0) GameTickPaused = false;
+	else if (strcmp(command, "step") == 0)
+	{
+		GameTickPaused = true;
+		addGameTickSteps(number > 0 ? (unsigned int)number : 1);
+	}
+	else if (strcmp(command, "trace") == 0) dumpTrace(CONSOLE_UART_BASE);
+	else if (strcmp(command, "profile") == 0) dumpProfile(CONSOLE_UART_BASE);
+	else if (strcmp(command, "color") == 0)
+	{
+		if (argument != NULL && strcmp(argument, "on") == 0) changePalette(true, PaletteUnicode, PaletteHalfBlock);
+		else if (argument != NULL && strcmp(argument, "off") == 0) changePalette(false, PaletteUnicode, PaletteHalfBlock);
+		else consolePutString("usage: color on|off\r\n");
+	}
+	else if (strcmp(command, "glyphs") == 0)
+	{
+		if (argument != NULL && strcmp(argument, "unicode") == 0) changePalette(PaletteColor, true, false);
+		else if (argument != NULL && strcmp(argument, "ascii") == 0) changePalette(PaletteColor, false, false);
+		else if (argument != NULL && strcmp(argument, "halfblock") == 0) changePalette(PaletteColor, PaletteUnicode, true);
+		else consolePutString("usage: glyphs ascii|unicode|halfblock\r\n");
+	}
+	else if (strcmp(command, "spectators") == 0) printConsoleSpectators();
+	else if (strcmp(command, "netplay") == 0) printConsoleNetplay();
+	else if (strcmp(command, "stress") == 0) printConsoleStress();
+	else if (strcmp(command, "ticks") == 0) printConsoleTicks();
+	else if (strcmp(command, "cpu") == 0) printConsoleCpu();
+	else if (strcmp(command, "shard") == 0)
+	{
+		number = value != NULL ? strtol(value, NULL, 10) : 0;
+		if (argument == NULL) printConsoleShard();
+		else if (inGame) consolePutString("not during a game\r\n");
+		else if (number < 1 || number > SHARD_MAX_COUNT || strtol(argument, NULL, 10) < 0 || strtol(argument, NULL, 10) >= number) consolePutString("usage: shard [<index> <count>]\r\n");
+		else
+		{
+			ShardIndex = (int)strtol(argument, NULL, 10);
+			ShardCount = (int)number;
+		}
+	}
+	else if (strcmp(command, "spectate") == 0)
+	{
+		if (argument == NULL || value == NULL || number < 0 || number >= SPECTATOR_PORTS) consolePutString("usage: spectate <port> on|off\r\n");
+		else if (strcmp(value, "on") == 0) startSpectator((int)number);
+		else if (strcmp(value, "off") == 0) stopSpectator((int)number);
+		else consolePutString("usage: spectate <port> on|off\r\n");
+	}
+	else consolePutString("unknown command, type help\r\n");
+}
+
+void printConsoleHelp()
+{
+	consolePutString("state                   game state\r\n");
+	consolePutString("tasks                   task states, priorities and free stack\r\n");
+	consolePutString("queues                  queue fill and lock holders\r\n");
+	consolePutString("speed <moves/min>       change the speed of the running game\r\n");
+	consolePutString("period special|enemy <ms>\r\n");
+	consolePutString("pause, resume, step [n] hold the snake tick or run n ticks\r\n");
+	consolePutString("trace                   dump the scheduler trace\r\n");
+	consolePutString("profile                 time spent in the profiled code, per zone\r\n");
+	consolePutString("color on|off            coloured cells\r\n");
+	consolePutString("glyphs ascii|unicode|halfblock\r\n");
+	consolePutString("spectators              spectator ports and what they were sent\r\n");
+	consolePutString("spectate <port> on|off  start or stop mirroring the game to a port\r\n");
+	consolePutString("netplay                 link ticks, packets and rollbacks\r\n");
+	consolePutString("shard [<index> <count>] handoffs, or this board's place in the ring\r\n");
+	consolePutString("stress                  steps of the last stress run, x in the menu\r\n");
+	consolePutString("ticks                   snake tick period, work and deadlines, per speed\r\n");
+	consolePutString("cpu                     run time of every task in the last game\r\n");
+}
+
+void printConsoleState()
+{
+	static const char *directionNames[] = {"up", "down", "right", "left"};
+	GameStateType state;
+	bool running;
+	int currentScore;
+	int currentTime;
+	int speed;
+	Direction direction;
+	unsigned long tick;
+	PointType normal;
+	PointType special;
+	PointType enemy;
+	
+	/* Copied with the scheduler suspended instead of taking GameStateLock, which would make the snake wait on this task */
+	vTaskSuspendAll();
+	state = GameState;
+	running = inGame;
+	currentScore = score;
+	currentTime = gameTime;
+	speed = SnakeSpeed;
+	tick = GameTickIndex;
+	direction = LastDirection;
+	normal = findEntityPosition(ENTITY_NORMAL_POWERUP);
+	special = findEntityPosition(ENTITY_SPECIAL_POWERUP);
+	enemy = findEntityPosition(ENTITY_ENEMY);
+	xTaskResumeAll();
+	
+	consolePutString(running ? "in game" : "main menu");
+	consolePutString(GameTickPaused ? " (paused)" : "");
+	consolePutString(" score ");
+	consolePutNumber(currentScore);
+	consolePutString(" time ");
+	consolePutNumber(currentTime);
+	consolePutString(" speed ");
+	consolePutNumber(speed);
+	consolePutString(" tick ");
+	consolePutNumber((long)tick);
+	consolePutString("\r\nsnake length ");
+	consolePutNumber(state.snakeLength);
+	consolePutString(" moving ");
+	consolePutString(directionNames[direction]);
+	consolePutString(" head ");
+	consolePutPoint(state.snakePositions[0]);
+	consolePutString("\r\nnormal ");
+	consolePutPoint(normal);
+	consolePutString(" special ");
+	consolePutPoint(special);
+	consolePutString(" enemy ");
+	consolePutPoint(enemy);
+	consolePutString("\r\nperiods special ");
+	consolePutNumber(SpecialPowerUpPeriod);
+	consolePutString(" ms enemy ");
+	consolePutNumber(EnemyPeriod);
+	consolePutString(" ms\r\n");
+}
+
+void printConsoleTasks()
+{
+	static const char stateNames[] = "XRBSD?";
+	UBaseType_t count;
+	UBaseType_t i;
+	size_t j;
+	count = uxTaskGetSystemState(ConsoleTaskStatus, CONSOLE_MAX_TASKS, NULL);
+	consolePutString("name       state prio stack\r\n");
+	for (i = 0; i < count; i++)
+	{
+		consolePutString(ConsoleTaskStatus[i].pcTaskName);
+		for (j = strlen(ConsoleTaskStatus[i].pcTaskName); j < 11; j++) UARTCharPut(CONSOLE_UART_BASE, ' ');
+		UARTCharPut(CONSOLE_UART_BASE, stateNames[ConsoleTaskStatus[i].eCurrentState]);
+		consolePutString("     ");
+		consolePutNumber((long)ConsoleTaskStatus[i].uxCurrentPriority);
+		consolePutString("    ");
+		consolePutNumber((long)ConsoleTaskStatus[i].usStackHighWaterMark);
+		consolePutString("\r\n");
+	}
+}
+
+void printConsoleQueues()
+{
+	char gameStateHolder[configMAX_TASK_NAME_LEN];
+	char randomNumberHolder[configMAX_TASK_NAME_LEN];
+	bool running;
+	consolePutQueue("RenderQueue", RenderQueue);
+	consolePutQueue("HighScoreQueue", HighScoreQueue);
+	consolePutQueue("ConsoleRxQueue", ConsoleRxQueue);
+	/* The locks only exist while a game is running, endGame cannot delete them with the scheduler suspended */
+	vTaskSuspendAll();
+	running = inGame;
+	if (running)
+	{
+		copyLockHolder(gameStateHolder, GameStateLock);
+		copyLockHolder(randomNumberHolder, GenerateRandomNumberLock);
+	}
+	xTaskResumeAll();
+	if (!running) return;
+	consolePutLockHolder("GameStateLock", gameStateHolder);
+	consolePutLockHolder("GenerateRandomNumberLock", randomNumberHolder);
+}
+
+/* The screen is repainted by the render task, so the change shows at once and spectators follow */
+void changePalette(bool color, bool unicode, bool halfBlock)
+{
+	const RenderRequestType repaintRenderRequest = RENDER_REQUEST(REPAINT);
+	PaletteColor = color;
+	PaletteUnicode = unicode;
+	PaletteHalfBlock = halfBlock;
+	xQueueSend(RenderQueue, (const void *)&repaintRenderRequest, portMAX_DELAY);
+}
+
+void printConsoleSpectators()
+{
+	static const char *stateNames[] = {"idle", "joining", "watching"};
+	int i;
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		consolePutNumber(i);
+		consolePutString(" ");
+		consolePutString(stateNames[SpectatorPorts[i].state]);
+		consolePutString(" sent ");
+		consolePutNumber((long)SpectatorPorts[i].bytesSent);
+		consolePutString(" keyframes ");
+		consolePutNumber((long)SpectatorPorts[i].keyframes);
+		consolePutString(" resyncs ");
+		consolePutNumber((long)SpectatorPorts[i].resyncs);
+		consolePutString("\r\n");
+	}
+	consolePutString("encoded ");
+	consolePutNumber((long)SpectatorBytesEncoded);
+	consolePutString("\r\n");
+}
+
+void printConsoleNetplay()
+{
+	if (!NetplayActive) consolePutString("no netplay game, the last one:\r\n");
+	consolePutString("player ");
+	consolePutNumber(NetplayPlayer);
+	consolePutString(" tick ");
+	consolePutNumber((long)NetplayTick);
+	consolePutString(" remote ");
+	consolePutNumber((long)NetplayRemoteTick);
+	consolePutString(" acked ");
+	consolePutNumber((long)NetplayAckedTick);
+	consolePutString("\r\nsent ");
+	consolePutNumber((long)NetplayStats.packetsSent);
+	consolePutString(" received ");
+	consolePutNumber((long)NetplayStats.packetsReceived);
+	consolePutString(" bad bytes ");
+	consolePutNumber((long)NetplayStats.badBytes);
+	consolePutString("\r\npredicted ");
+	consolePutNumber((long)NetplayStats.predictions);
+	consolePutString(" rollbacks ");
+	consolePutNumber((long)NetplayStats.rollbacks);
+	consolePutString(" resimulated ");
+	consolePutNumber((long)NetplayStats.resimulatedTicks);
+	consolePutString(" deepest ");
+	consolePutNumber((long)NetplayStats.maxRollback);
+	consolePutString(" stalls ");
+	consolePutNumber((long)NetplayStats.stalls);
+	consolePutString("\r\n");
+}
+
+void printConsoleShard()
+{
+	consolePutString("board ");
+	consolePutNumber(ShardIndex);
+	consolePutString(" of ");
+	consolePutNumber(ShardCount);
+	consolePutString(ShardOwner ? " has the snake" : "");
+	consolePutString("\r\nhandoffs sent ");
+	consolePutNumber((long)ShardStats.handoffsSent);
+	consolePutString(" received ");
+	consolePutNumber((long)ShardStats.handoffsReceived);
+	consolePutString(" retries ");
+	consolePutNumber((long)ShardStats.handoffRetries);
+	if (ShardStats.handoffsSent > 0)
+	{
+		consolePutString(" avg ");
+		consolePutNumber((long)((uint64_t)ShardStats.totalHandoffTime * 1000 / TimestampsPerMs / ShardStats.handoffsSent));
+		consolePutString("us max ");
+		consolePutNumber((long)((uint64_t)ShardStats.maxHandoffTime * 1000 / TimestampsPerMs));
+		consolePutString("us");
+	}
+	consolePutString("\r\ncells sent ");
+	consolePutNumber((long)ShardStats.cellsSent);
+	consolePutString(" forwarded ");
+	consolePutNumber((long)ShardStats.forwarded);
+	consolePutString(" bad bytes ");
+	consolePutNumber((long)ShardStats.badBytes);
+	consolePutString("\r\n");
+}
+
+void printConsoleStress()
+{
+	const StressStepType *step;
+	int i;
+	if (StressStepCount == 0)
+	{
+		consolePutString("no stress run, press x in the menu\r\n");
+		return;
+	}
+	consolePutString("speed achieved missed overruns backlog dropped restarts\r\n");
+	for (i = 0; i < StressStepCount; i++)
+	{
+		step = &StressSteps[i];
+		consolePutNumber(step->speed);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber((long)measureStressRate(step));
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber(step->missedDeadlines);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber(step->renderOverruns);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber(step->maxBacklog);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber(step->droppedInputs);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber(step->restarts);
+		consolePutString(isStressStepMet(step) ? "\r\n" : " late\r\n");
+	}
+	consolePutString("highest speed kept up with ");
+	consolePutNumber(findStressLimit());
+	consolePutString("\r\n");
+}
+
+/* One line per speed played since reset, times in microseconds */
+void printConsoleTicks()
+{
+	TickStatsType stats;
+	unsigned int periods;
+	int i;
+	consolePutString("speed ticks missed skipped overruns period min/avg/max jitter work avg/max slack min/avg\r\n");
+	for (i = 0; i < TICK_STATS_LEVELS; i++)
+	{
+		/* Copied with the scheduler suspended, the snake task updates the entry every tick */
+		vTaskSuspendAll();
+		stats = TickStats[i];
+		xTaskResumeAll();
+		if (stats.snakeSpeed == 0) break;
+		periods = stats.ticks > 1 ? stats.ticks - 1 : 1;
+		consolePutNumber(stats.snakeSpeed);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber((long)stats.ticks);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber((long)stats.missedDeadlines);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber((long)stats.skippedTicks);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber((long)stats.renderOverruns);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutMicroseconds(stats.ticks > 1 ? stats.minPeriod : 0);
+		UARTCharPut(CONSOLE_UART_BASE, '/');
+		consolePutMicroseconds(stats.totalPeriod / periods);
+		UARTCharPut(CONSOLE_UART_BASE, '/');
+		consolePutMicroseconds(stats.maxPeriod);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutMicroseconds(stats.maxJitter);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutMicroseconds(stats.ticks > 0 ? stats.totalWork / stats.ticks : 0);
+		UARTCharPut(CONSOLE_UART_BASE, '/');
+		consolePutMicroseconds(stats.maxWork);
+		UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutMicroseconds(stats.slackTicks > 0 ? stats.minSlack : 0);
+		UARTCharPut(CONSOLE_UART_BASE, '/');
+		consolePutMicroseconds(stats.slackTicks > 0 ? stats.totalSlack / stats.slackTicks : 0);
+		consolePutString("\r\n");
+	}
+	if (i == 0) consolePutString("no game played yet\r\n");
+}
+
+/* What endCpuStatsSession kept of the last game, in tenths of a percent */
+void printConsoleCpu()
+{
+	CpuTaskStatsType task;
+	unsigned int count;
+	uint32_t total;
+	uint32_t idle;
+	unsigned int i;
+	size_t j;
+	vTaskSuspendAll();
+	count = CpuSessionStats.taskCount;
+	total = CpuSessionStats.totalRunTime;
+	idle = CpuSessionStats.idleRunTime;
+	xTaskResumeAll();
+	if (total == 0)
+	{
+		consolePutString("no game played yet\r\n");
+		return;
+	}
+	consolePutString("name       permille\r\n");
+	for (i = 0; i < count; i++)
+	{
+		vTaskSuspendAll();
+		task = CpuSessionStats.tasks[i];
+		xTaskResumeAll();
+		consolePutString(task.name);
+		for (j = strlen(task.name); j < 11; j++) UARTCharPut(CONSOLE_UART_BASE, ' ');
+		consolePutNumber(task.permille);
+		consolePutString("\r\n");
+	}
+	consolePutString("idle ");
+	consolePutNumber((long)((uint64_t)idle * 1000 / total));
+	consolePutString(" permille of ");
+	consolePutNumber((long)((uint64_t)total * 1000 / RUN_TIME_STATS_HZ));
+	consolePutString(" ms\r\n");
+}
+
+void copyLockHolder(char *holder, xSemaphoreHandle lock)
+{
+	xTaskHandle task = xSemaphoreGetMutexHolder(lock);
+	holder[0] = 0;
+	if (task != NULL) strncpy(holder, pcTaskGetName(task), configMAX_TASK_NAME_LEN);
+	holder[configMAX_TASK_NAME_LEN - 1] = 0;
+}
+
+void consolePutQueue(const char *name, xQueueHandle queue)
+{
+	if (queue == NULL) return;
+	consolePutString(name);
+	consolePutString(" ");
+	consolePutNumber((long)uxQueueMessagesWaiting(queue));
+	consolePutString("/");
+	consolePutNumber((long)(uxQueueMessagesWaiting(queue) + uxQueueSpacesAvailable(queue)));
+	consolePutString("\r\n");
+}
+
+void consolePutLockHolder(const char *name, const char *holder)
+{
+	consolePutString(name);
+	consolePutString(holder[0] != 0 ? " held by " : " free");
+	consolePutString(holder);
+	consolePutString("\r\n");
+}
+
+void consolePutString(const char *string)
+{
+	while (*string != 0) UARTCharPut(CONSOLE_UART_BASE, *string++);
+}
+
+void consolePutNumber(long value)
+{
+	char digits[12];
+	int i = 0;
+	if (value < 0)
+	{
+		UARTCharPut(CONSOLE_UART_BASE, '-');
+		value = -value;
+	}
+	do
+	{
+		digits[i++] = (char)(value % 10) + 48;
+		value /= 10;
+	} while (value != 0);
+	while (i > 0) UARTCharPut(CONSOLE_UART_BASE, digits[--i]);
+}
+
+void consolePutMicroseconds(uint64_t timestamps)
+{
+	consolePutNumber((long)(timestamps * 1000 / TimestampsPerMs));
+}
+
+void consolePutPoint(PointType point)
+{
+	if (point.x < 0)
+	{
+		consolePutString("none");
+		return;
+	}
+	UARTCharPut(CONSOLE_UART_BASE, '(');
+	consolePutNumber(point.x);
+	UARTCharPut(CONSOLE_UART_BASE, ',');
+	consolePutNumber(point.y);
+	UARTCharPut(CONSOLE_UART_BASE, ')');
+}
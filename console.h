@@ -0,0 +1,27 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "game.h"
+
+/* Console Configuration Parameters */
+#define CONSOLE_UART_BASE		UART1_BASE
+#define CONSOLE_BAUD_RATE		115200
+#define CONSOLE_LINE_LENGTH		40
+#define CONSOLE_RX_QUEUE_LENGTH	16
+#define CONSOLE_MAX_TASKS		12
+#define CONSOLE_MAX_SNAKE_SPEED	1200	/* Above the normal curve on purpose, for stress testing */
+
+/* Global Variables */
+extern xQueueHandle ConsoleRxQueue;
+
+/* Tasks */
+void ConsoleTask(void *vpParameters);
+extern xTaskHandle ConsoleTaskHandle;
+
+/* Console Functions */
+void initializeConsole();
+void processConsoleChar(char c);
+void runConsoleCommand(char *line);
+void UART1_Handler(void);
+
+#endif /* CONSOLE_H */
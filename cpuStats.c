@@ -0,0 +1,105 @@
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/timer.h>
+
+#include "cpuStats.h"
+
+/* Global Variables */
+CpuSessionStatsType CpuSessionStats;
+int cpuLoad = 0;
+int cpuIdle = 100;
+TaskStatus_t CpuTaskStatus[CPU_STATS_MAX_TASKS];
+uint32_t CpuSessionStartRunTime;
+uint32_t CpuSessionStartTaskNumbers[CPU_STATS_MAX_TASKS];
+uint32_t CpuSessionStartTaskRunTimes[CPU_STATS_MAX_TASKS];
+unsigned int CpuSessionStartTaskCount = 0;
+uint32_t CpuSampleRunTime = 0;
+uint32_t CpuSampleIdleRunTime = 0;
+
+void configureRunTimeStatsTimer(void)
+{
+	/* Wide Timer 0A counts down from the top of its 32 bits, prescaled so it wraps only every few hours */
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_WTIMER0);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_WTIMER0));
+	TimerConfigure(WTIMER0_BASE, TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_PERIODIC);
+	TimerPrescaleSet(WTIMER0_BASE, TIMER_A, SysCtlClockGet() / RUN_TIME_STATS_HZ - 1);
+	TimerLoadSet(WTIMER0_BASE, TIMER_A, 0xFFFFFFFF);
+	TimerEnable(WTIMER0_BASE, TIMER_A);
+}
+
+uint32_t readRunTimeStatsTimer(void)
+{
+	return 0xFFFFFFFF - TimerValueGet(WTIMER0_BASE, TIMER_A);
+}
+
+void startCpuStatsSession()
+{
+	unsigned int i;
+	CpuSessionStartTaskCount = uxTaskGetSystemState(CpuTaskStatus, CPU_STATS_MAX_TASKS, &CpuSessionStartRunTime);
+	for (i = 0; i < CpuSessionStartTaskCount; i++)
+	{
+		CpuSessionStartTaskNumbers[i] = CpuTaskStatus[i].xTaskNumber;
+		CpuSessionStartTaskRunTimes[i] = CpuTaskStatus[i].ulRunTimeCounter;
+	}
+	CpuSampleRunTime = CpuSessionStartRunTime;
+	CpuSampleIdleRunTime = ulTaskGetIdleRunTimeCounter();
+}
+
+void endCpuStatsSession()
+{
+	unsigned int i;
+	unsigned int j;
+	uint32_t totalRunTime;
+	uint32_t runTime;
+	CpuTaskStatsType *task;
+	unsigned int taskCount = uxTaskGetSystemState(CpuTaskStatus, CPU_STATS_MAX_TASKS, &totalRunTime);
+	
+	CpuSessionStats.totalRunTime = totalRunTime - CpuSessionStartRunTime;
+	CpuSessionStats.idleRunTime = 0;
+	CpuSessionStats.taskCount = 0;
+	for (i = 0; i < taskCount; i++)
+	{
+		/* The previous game's tasks, deleted but not yet freed by idle */
+		if (CpuTaskStatus[i].eCurrentState == eDeleted) continue;
+		/* Tasks created for this game have no start snapshot and count from zero */
+		runTime = CpuTaskStatus[i].ulRunTimeCounter;
+		for (j = 0; j < CpuSessionStartTaskCount; j++)
+		{
+			if (CpuSessionStartTaskNumbers[j] == CpuTaskStatus[i].xTaskNumber)
+			{
+				runTime -= CpuSessionStartTaskRunTimes[j];
+				break;
+			}
+		}
+		task = &CpuSessionStats.tasks[CpuSessionStats.taskCount++];
+		strncpy(task->name, CpuTaskStatus[i].pcTaskName, configMAX_TASK_NAME_LEN - 1);
+		task->name[configMAX_TASK_NAME_LEN - 1] = 0;
+		task->runTime = runTime;
+		task->permille = CpuSessionStats.totalRunTime > 0 ? (uint16_t)(((uint64_t)runTime * 1000) / CpuSessionStats.totalRunTime) : 0;
+		if (CpuTaskStatus[i].xHandle == xTaskGetIdleTaskHandle()) CpuSessionStats.idleRunTime = runTime;
+	}
+}
+
+void sampleCpuLoad()
+{
+	uint32_t runTime = readRunTimeStatsTimer();
+	uint32_t idleRunTime = ulTaskGetIdleRunTimeCounter();
+	uint32_t elapsed = runTime - CpuSampleRunTime;
+	
+	if (elapsed > 0)
+	{
+		cpuIdle = (int)(((uint64_t)(idleRunTime - CpuSampleIdleRunTime) * 100) / elapsed);
+		if (cpuIdle > 100) cpuIdle = 100;
+		cpuLoad = 100 - cpuIdle;
+	}
+	CpuSampleRunTime = runTime;
+	CpuSampleIdleRunTime = idleRunTime;
+}
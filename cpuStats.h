@@ -0,0 +1,43 @@
+#ifndef CPU_STATS_H
+#define CPU_STATS_H
+
+#include "game.h"
+
+/* CPU Statistics Configuration Parameters */
+#ifndef SHOW_CPU_LOAD
+#define SHOW_CPU_LOAD			0		/* 1: draw CPU load and idle percentages next to the score */
+#endif
+#define CPU_LOAD_PERIOD			2		/* Seconds between two load readouts */
+#define CPU_STATS_MAX_TASKS		16		/* Idle, five always there, three per game and three more deleted ones idle has not freed yet */
+#define RUN_TIME_STATS_HZ		100000
+
+/* Type Definitions */
+typedef struct CpuTaskStats
+{
+	char name[configMAX_TASK_NAME_LEN];
+	uint32_t runTime;
+	uint16_t permille;
+} CpuTaskStatsType;
+
+/* Run time of every task between the start and the end of one game, in RUN_TIME_STATS_HZ counts */
+typedef struct CpuSessionStats
+{
+	uint32_t totalRunTime;
+	uint32_t idleRunTime;
+	unsigned int taskCount;
+	CpuTaskStatsType tasks[CPU_STATS_MAX_TASKS];
+} CpuSessionStatsType;
+
+/* Global Variables */
+extern CpuSessionStatsType CpuSessionStats;
+extern int cpuLoad;
+extern int cpuIdle;
+
+/* CPU Statistics Functions */
+void configureRunTimeStatsTimer(void);
+uint32_t readRunTimeStatsTimer(void);
+void startCpuStatsSession();
+void endCpuStatsSession();
+void sampleCpuLoad();
+
+#endif /* CPU_STATS_H */
@@ -0,0 +1,224 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "entity.h"
+
+/* Global Variables */
+EntityType EntityPool[ENTITY_POOL_SIZE];
+EntityIndexType EntityBuckets[ENTITY_HASH_SIZE];
+EntityIndexType FreeEntities = ENTITY_NONE;
+EntityIndexType EntityOfKind[ENTITY_KINDS];		/* One entity of each kind, for findEntityOfKind */
+int EntityCount = 0;
+uint32_t EntityChanges = 0;		/* Counts every add and remove, a tick plan made before one is stale */
+portTickType EntitySpecialRoll = 0;		/* The next roll for a special power-up while there is none */
+
+/* Tasks */
+xTaskHandle EntityTaskHandle;
+
+unsigned int hashEntityCell(PointType position);
+EntityIndexType findExpiredEntity(portTickType now);
+void setEntityExpiry(EntityKind kind, portTickType expiry);
+portTickType entityLifetime(EntityKind kind);
+
+/* The spawners on the schedule of runEntitySchedule, woken early when the
+ * snake eats the normal power-up */
+void EntityTask(void *vpParameters)
+{
+	portTickType wait;
+	resetEntitySchedule(xTaskGetTickCount());
+	for ( ;; )
+	{
+		xSemaphoreTake(GameStateLock, portMAX_DELAY);
+		wait = runEntitySchedule(xTaskGetTickCount());
+		xSemaphoreGive(GameStateLock);
+		if (xSemaphoreTake(NormalPowerUpSemaphore, wait) == pdTRUE)
+		{
+			xSemaphoreTake(GameStateLock, portMAX_DELAY);
+			spawnNormalPowerUp();
+			xSemaphoreGive(GameStateLock);
+		}
+	}
+}
+
+void resetEntities()
+{
+	int i;
+	for (i = 0; i < ENTITY_HASH_SIZE; i++) EntityBuckets[i] = ENTITY_NONE;
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		EntityPool[i].kind = ENTITY_FREE;
+		EntityPool[i].next = i + 1 < ENTITY_POOL_SIZE ? (EntityIndexType)(i + 1) : ENTITY_NONE;
+	}
+	for (i = 0; i < ENTITY_KINDS; i++) EntityOfKind[i] = ENTITY_NONE;
+	FreeEntities = 0;
+	EntityCount = 0;
+	EntityChanges++;
+}
+
+/* ENTITY_NONE when the pool is full. Called with GameStateLock held, like the rest */
+EntityIndexType addEntity(EntityKind kind, PointType position, portTickType expiry)
+{
+	EntityIndexType index = FreeEntities;
+	unsigned int bucket = hashEntityCell(position);
+	if (index == ENTITY_NONE) return ENTITY_NONE;
+	FreeEntities = EntityPool[index].next;
+	EntityPool[index].position = position;
+	EntityPool[index].kind = kind;
+	EntityPool[index].expiry = expiry;
+	EntityPool[index].next = EntityBuckets[bucket];
+	EntityBuckets[bucket] = index;
+	EntityOfKind[kind] = index;
+	EntityCount++;
+	EntityChanges++;
+	return index;
+}
+
+/* Taking away the entity findEntityOfKind gives looks through the pool for another of its kind */
+void removeEntity(EntityIndexType index)
+{
+	EntityIndexType *link;
+	EntityKind kind;
+	int i;
+	if (index == ENTITY_NONE || EntityPool[index].kind == ENTITY_FREE) return;
+	link = &EntityBuckets[hashEntityCell(EntityPool[index].position)];
+	while (*link != index) link = &EntityPool[*link].next;
+	*link = EntityPool[index].next;
+	kind = (EntityKind)EntityPool[index].kind;
+	EntityPool[index].kind = ENTITY_FREE;
+	if (EntityOfKind[kind] == index)
+	{
+		EntityOfKind[kind] = ENTITY_NONE;
+		for (i = 0; i < ENTITY_POOL_SIZE && EntityOfKind[kind] == ENTITY_NONE; i++)
+		{
+			if (EntityPool[i].kind == kind) EntityOfKind[kind] = (EntityIndexType)i;
+		}
+	}
+	EntityPool[index].next = FreeEntities;
+	FreeEntities = index;
+	EntityCount--;
+	EntityChanges++;
+}
+
+/* The entity on a cell, only the few sharing its bucket are looked at */
+EntityIndexType findEntity(PointType position)
+{
+	EntityIndexType index = EntityBuckets[hashEntityCell(position)];
+	while (index != ENTITY_NONE)
+	{
+		if (EntityPool[index].position.x == position.x && EntityPool[index].position.y == position.y) return index;
+		index = EntityPool[index].next;
+	}
+	return ENTITY_NONE;
+}
+
+EntityKind entityKindAt(PointType position)
+{
+	EntityIndexType index = findEntity(position);
+	return index == ENTITY_NONE ? ENTITY_FREE : (EntityKind)EntityPool[index].kind;
+}
+
+EntityIndexType findEntityOfKind(EntityKind kind)
+{
+	return EntityOfKind[kind];
+}
+
+/* Where the entity of a kind is, -1, -1 when there is none */
+PointType findEntityPosition(EntityKind kind)
+{
+	PointType none = {-1, -1};
+	EntityIndexType index = EntityOfKind[kind];
+	return index == ENTITY_NONE ? none : EntityPool[index].position;
+}
+
+void resetEntitySchedule(portTickType now)
+{
+	EntitySpecialRoll = now;
+}
+
+/* One round of the spawners at now, with GameStateLock held. An enemy that
+ * expires moves, a special power-up that expires is taken away and rolled
+ * for again, each due a period after the one before. One the place
+ * functions put down without an expiry, as a rewind does, gets a whole
+ * period from now. The enemy is always somewhere. Returns the ticks until
+ * the next expiry or roll */
+portTickType runEntitySchedule(portTickType now)
+{
+	EntityIndexType index;
+	portTickType due;
+	portTickType wait = ENTITY_NO_EXPIRY;
+	int i;
+	if (findEntityOfKind(ENTITY_ENEMY) == ENTITY_NONE) respawnEnemy();
+	while ((index = findExpiredEntity(now)) != ENTITY_NONE)
+	{
+		due = EntityPool[index].expiry;
+		if (EntityPool[index].kind == ENTITY_ENEMY)
+		{
+			respawnEnemy();
+			setEntityExpiry(ENTITY_ENEMY, due + entityLifetime(ENTITY_ENEMY));
+		}
+		else
+		{
+			removeSpecialPowerUp();
+			EntitySpecialRoll = due;
+		}
+	}
+	if (findEntityOfKind(ENTITY_SPECIAL_POWERUP) == ENTITY_NONE && (int32_t)(now - EntitySpecialRoll) >= 0)
+	{
+		due = EntitySpecialRoll;
+		cycleSpecialPowerUp();
+		EntitySpecialRoll = due + entityLifetime(ENTITY_SPECIAL_POWERUP);
+		setEntityExpiry(ENTITY_SPECIAL_POWERUP, EntitySpecialRoll);
+	}
+	setEntityExpiry(ENTITY_ENEMY, now + entityLifetime(ENTITY_ENEMY));
+	setEntityExpiry(ENTITY_SPECIAL_POWERUP, now + entityLifetime(ENTITY_SPECIAL_POWERUP));
+	if (findEntityOfKind(ENTITY_SPECIAL_POWERUP) == ENTITY_NONE) wait = EntitySpecialRoll - now;
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		if (EntityPool[i].kind == ENTITY_FREE || EntityPool[i].expiry == ENTITY_NO_EXPIRY) continue;
+		if (EntityPool[i].expiry - now < wait) wait = EntityPool[i].expiry - now;
+	}
+	return wait;
+}
+
+/* The first entity whose expiry has come */
+EntityIndexType findExpiredEntity(portTickType now)
+{
+	int i;
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		if (EntityPool[i].kind == ENTITY_FREE || EntityPool[i].expiry == ENTITY_NO_EXPIRY) continue;
+		if ((int32_t)(now - EntityPool[i].expiry) >= 0) return (EntityIndexType)i;
+	}
+	return ENTITY_NONE;
+}
+
+/* Gives the entities of a kind that have none yet an expiry */
+void setEntityExpiry(EntityKind kind, portTickType expiry)
+{
+	int i;
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		if (EntityPool[i].kind == kind && EntityPool[i].expiry == ENTITY_NO_EXPIRY) EntityPool[i].expiry = expiry;
+	}
+}
+
+/* Ticks an entity of a kind stays, ENTITY_NO_EXPIRY for the normal power-up */
+portTickType entityLifetime(EntityKind kind)
+{
+	if (kind == ENTITY_ENEMY) return EnemyPeriod / portTICK_RATE_MS;
+	if (kind == ENTITY_SPECIAL_POWERUP) return SpecialPowerUpPeriod / portTICK_RATE_MS;
+	return ENTITY_NO_EXPIRY;
+}
+
+/* Fibonacci hashing of the cell index, neighbouring cells land far apart */
+unsigned int hashEntityCell(PointType position)
+{
+	uint32_t cell = (uint32_t)(position.y * ENV_WIDTH + position.x);
+	return (unsigned int)((cell * 2654435761u) >> (32 - ENTITY_HASH_BITS));
+}
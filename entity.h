@@ -0,0 +1,85 @@
+#ifndef ENTITY_H
+#define ENTITY_H
+
+#include "game.h"
+
+/* Entity Configuration Parameters */
+/* Room for an entity in every 16 cells, never less than the one of each kind the game keeps */
+#ifndef ENTITY_POOL_SIZE
+#define ENTITY_POOL_SIZE		(ENV_WIDTH * ENV_HEIGHT / 16 > 4 ? ENV_WIDTH * ENV_HEIGHT / 16 : 4)
+#endif
+/* Buckets of the cell hash, the power of two at or above the pool size */
+#if ENTITY_POOL_SIZE <= 8
+#define ENTITY_HASH_BITS		3
+#elif ENTITY_POOL_SIZE <= 16
+#define ENTITY_HASH_BITS		4
+#elif ENTITY_POOL_SIZE <= 32
+#define ENTITY_HASH_BITS		5
+#elif ENTITY_POOL_SIZE <= 64
+#define ENTITY_HASH_BITS		6
+#elif ENTITY_POOL_SIZE <= 128
+#define ENTITY_HASH_BITS		7
+#elif ENTITY_POOL_SIZE <= 256
+#define ENTITY_HASH_BITS		8
+#elif ENTITY_POOL_SIZE <= 512
+#define ENTITY_HASH_BITS		9
+#elif ENTITY_POOL_SIZE <= 1024
+#define ENTITY_HASH_BITS		10
+#else
+#error "the entity pool holds at most 1024 entities"
+#endif
+#define ENTITY_HASH_SIZE		(1 << ENTITY_HASH_BITS)
+#define ENTITY_NO_EXPIRY		portMAX_DELAY
+
+/* Type Definitions */
+#if ENTITY_POOL_SIZE < 255
+typedef uint8_t EntityIndexType;
+#define ENTITY_NONE				((EntityIndexType)0xff)
+#else
+typedef uint16_t EntityIndexType;
+#define ENTITY_NONE				((EntityIndexType)0xffff)
+#endif
+
+typedef enum
+{
+	ENTITY_FREE,
+	ENTITY_NORMAL_POWERUP,
+	ENTITY_SPECIAL_POWERUP,
+	ENTITY_ENEMY,
+	ENTITY_KINDS
+} EntityKind;
+
+/* Everything on the board besides the snake. next chains the entities of
+ * one hash bucket, or the free ones. The special power-up and the enemy
+ * last until expiry, the tick the EntityTask takes them away or moves them */
+typedef struct Entity
+{
+	PointType position;
+	uint8_t kind;
+	EntityIndexType next;
+	portTickType expiry;
+} EntityType;
+
+/* Global Variables */
+extern EntityType EntityPool[ENTITY_POOL_SIZE];
+extern EntityIndexType EntityBuckets[ENTITY_HASH_SIZE];
+extern int EntityCount;
+extern uint32_t EntityChanges;
+extern portTickType EntitySpecialRoll;
+
+/* Tasks */
+void EntityTask(void *vpParameters);
+extern xTaskHandle EntityTaskHandle;
+
+/* Entity Functions */
+void resetEntities();
+EntityIndexType addEntity(EntityKind kind, PointType position, portTickType expiry);
+void removeEntity(EntityIndexType index);
+EntityIndexType findEntity(PointType position);
+EntityKind entityKindAt(PointType position);
+EntityIndexType findEntityOfKind(EntityKind kind);
+PointType findEntityPosition(EntityKind kind);
+void resetEntitySchedule(portTickType now);
+portTickType runEntitySchedule(portTickType now);
+
+#endif /* ENTITY_H */
@@ -0,0 +1,204 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Game Configuration Parameters */
+#ifndef ENV_WIDTH
+#define ENV_WIDTH 				12
+#endif
+#ifndef ENV_HEIGHT
+#define ENV_HEIGHT				12
+#endif
+/* Part of the world shown on the terminal, the camera follows the snake head when the world is larger */
+#ifndef VIEWPORT_WIDTH
+#define VIEWPORT_WIDTH			(ENV_WIDTH < 32 ? ENV_WIDTH : 32)
+#endif
+#ifndef VIEWPORT_HEIGHT
+#define VIEWPORT_HEIGHT			(ENV_HEIGHT < 16 ? ENV_HEIGHT : 16)
+#endif
+#define INITIAL_SNAKE_LENGTH	4
+#ifndef MAX_SNAKE_LENGTH
+#define MAX_SNAKE_LENGTH 		50
+#endif
+#define INITIAL_SNAKE_SPEED		60
+#define MAXIMUM_SNAKE_SPEED		135
+#define SPECIAL_POWERUP_PERIOD	5000
+#ifndef SPECIAL_POWERUP_FREQ
+#define SPECIAL_POWERUP_FREQ	10
+#endif
+#define ENEMY_PERIOD			5000
+#define END_MESSAGE_DELAY		5000
+#define MENU_KEY_POLL			10		/* ms between looks for a menu key, the idle task runs in between */
+#define RENDER_QUEUE_LENGTH		8		/* Requests, more than a tick sends so the snake task never waits on the UART */
+
+/* Render Request Layout */
+#define RENDER_CELL_BITS		12
+#define RENDER_TAIL_REMOVED		(1u << 6)
+#define RENDER_HEAD_SHIFT		7
+#define RENDER_TAIL_SHIFT		(RENDER_HEAD_SHIFT + RENDER_CELL_BITS)
+#define RENDER_CELL_MASK		((1u << RENDER_CELL_BITS) - 1)
+#define RENDER_REQUEST(category)	((RenderRequestType)(category))
+#if ENV_WIDTH * ENV_HEIGHT > (1 << RENDER_CELL_BITS)
+#error "render requests hold cells of worlds up to 4096 cells"
+#endif
+
+/* Type Definitions */
+/* A byte per coordinate while a sharded world of SHARD_MAX_COUNT boards, whose
+ * columns go on past this board, still fits in one */
+#if ENV_WIDTH <= 16 && ENV_HEIGHT <= 127
+typedef int8_t CoordinateType;
+#else
+typedef int16_t CoordinateType;
+#endif
+
+typedef struct 
+{
+	CoordinateType x;
+	CoordinateType y;
+} PointType;
+
+typedef enum
+{
+	UP,
+	DOWN,
+	RIGHT,
+	LEFT
+} Direction;
+
+/* The power-ups and the enemy are kept in the entity table of entity.c */
+typedef struct GameStateType 
+{
+	PointType snakePositions[MAX_SNAKE_LENGTH];
+	int snakeLength;
+} GameStateType;
+
+typedef enum
+{
+	MAIN_MENU,
+	START_GAME,
+	SNAKE_POSITION_UPDATE,
+	NORMAL_POWERUP_POSITION_UPDATE,
+	REMOVE_NORMAL_POWERUP,
+	SPECIAL_POWERUP_POSITION_UPDATE,
+	REMOVE_SPECIAL_POWERUP,
+	ENEMY_POSITION_UPDATE,
+	REMOVE_ENEMY,
+	LOSS_MESSAGE,
+	WIN_MESSAGE,
+	SCORE_UPDATE,
+	TIME_UPDATE,
+	CPU_LOAD_UPDATE,
+	SPECTATOR_KEYFRAME,
+	REPAINT,
+	NETPLAY_START,
+	NETPLAY_FRAME,
+	SHARD_HEAD_LEAVE,
+	SHARD_TAIL_REMOVE,
+	REWIND_REDRAW
+} RenderRequestCategory;
+
+typedef enum
+{
+	GAME_RUNNING,
+	GAME_LOST,
+	GAME_WON
+} GameOutcomeType;
+
+/* Tick N + 1 as worked out while RenderTask still sends tick N, applied at
+ * the deadline unless a late key, a spawn or a handover changed what it
+ * was worked out from */
+typedef struct TickPlan
+{
+	PointType head;
+	PointType newHead;
+	Direction direction;
+	int snakeLength;
+	uint32_t entityChanges;
+	uint8_t entity;
+	bool leaves;
+	bool collision;
+	bool valid;
+} TickPlanType;
+
+/* One word per request: the category in bits 0 to 5, whether the tail is
+ * removed in bit 6, then the head and the tail cells as y * ENV_WIDTH + x
+ * in RENDER_CELL_BITS each. Requests without cells are just the category */
+typedef uint32_t RenderRequestType;
+
+/* Global Variables */
+extern GameStateType GameState;
+extern int SnakeSpeed;
+extern Direction LastDirection;
+extern bool inGame;
+extern bool wonLast;
+extern int score;
+extern int gameTime;
+extern unsigned long GameTickIndex;
+extern int RandomState;
+extern int SpecialPowerUpPeriod;
+extern int EnemyPeriod;
+extern RenderRequestCategory RenderScreen;		/* Last full screen drawn, what a keyframe redraws */
+extern PointType DrawnHeadPosition;
+extern TickPlanType TickPlan;
+
+/* Tasks */
+void MainMenuTask(void *vpParameters);
+extern xTaskHandle MainMenuTaskHandle;
+void RenderTask(void *vpParameters);
+extern xTaskHandle RenderTaskHandle;
+void SnakePositionUpdateTask(void *vpParameters);
+extern xTaskHandle SnakePositionUpdateTaskHandle;
+void TimeUpdateTask(void* vpParameters);
+extern xTaskHandle TimeUpdateTaskHandle;
+
+/* Mutexes, Semaphores and Queues */
+extern xSemaphoreHandle GameStateLock;
+extern xSemaphoreHandle GenerateRandomNumberLock;
+extern xSemaphoreHandle NormalPowerUpSemaphore;
+extern xQueueHandle RenderQueue;
+
+/* Util Functions */
+void initializeHardware();
+char waitForMenuKey();
+void resetGameState();
+void clearScreen();
+void moveCursorToPosition(int line, int column);
+void moveCursorToBottom();
+void seedRandomNumber(int seed);
+int generateRandomNumber();
+PointType generateRandomPosition();
+PointType calculateNewHeadPosition(PointType head, Direction direction);
+bool isSnakeCollision(PointType position);
+bool isPositionFree(PointType position);
+PointType generateFreePosition();
+GameOutcomeType snakeTick();
+Direction turnDirection(Direction direction, char key);
+void changeDirection(char key);
+void planSnakeTick(TickPlanType *plan);
+bool isTickPlanCurrent(const TickPlanType *plan);
+GameOutcomeType advanceSnake();
+void spawnNormalPowerUp();
+void cycleSpecialPowerUp();
+void respawnEnemy();
+void placeNormalPowerUp(PointType position);
+void placeSpecialPowerUp(PointType position);
+void removeSpecialPowerUp();
+void placeEnemy(PointType position);
+void endGame(bool won);
+RenderRequestType packRenderRequest(RenderRequestCategory category, PointType head, bool removeTail, PointType tail);
+RenderRequestCategory renderCategory(RenderRequestType request);
+PointType renderHead(RenderRequestType request);
+PointType renderTail(RenderRequestType request);
+void renderRequest(const RenderRequestType *request);
+void drawGameFrame();
+void drawEndMessage(bool won);
+void renderKeyframe();
+
+#endif /* GAME_H */
@@ -0,0 +1,292 @@
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <inc/hw_ints.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/timer.h>
+#include <driverlib/interrupt.h>
+
+#include "gameTick.h"
+
+/* Global Variables */
+TickOverrunPolicyType TickOverrunPolicy = TICK_POLICY_CATCH_UP;
+TickStatsType TickStats[TICK_STATS_LEVELS];
+GameTickPhaseType GameTickPhase;
+volatile uint32_t GameTickTimestamp = 0;
+uint32_t TimestampsPerMs = 1;
+volatile bool GameTickPaused = false;
+volatile unsigned int GameTickSteps = 0;
+volatile bool RenderIdle = true;
+volatile uint32_t RenderIdleTimestamp = 0;
+#if !GAME_TICK_USE_TIMER
+portTickType GameTickLastWokenTime;
+#endif
+
+void initializeGameTick()
+{
+	/* Timer 1 free runs over its full 32 bits as the timestamp source */
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_TIMER1));
+	TimerConfigure(TIMER1_BASE, TIMER_CFG_PERIODIC);
+	TimerLoadSet(TIMER1_BASE, TIMER_A, 0xFFFFFFFF);
+	TimerEnable(TIMER1_BASE, TIMER_A);
+	TimestampsPerMs = SysCtlClockGet() / 1000;
+	
+	/* Timer 0A generates the game tick, a new period is loaded at every timeout */
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_TIMER0));
+	TimerConfigure(TIMER0_BASE, TIMER_CFG_PERIODIC);
+	TimerUpdateMode(TIMER0_BASE, TIMER_A, TIMER_UP_LOAD_TIMEOUT);
+	TimerIntEnable(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+	IntPrioritySet(INT_TIMER0A, configMAX_SYSCALL_INTERRUPT_PRIORITY);
+	IntEnable(INT_TIMER0A);
+}
+
+void startGameTick(int speed)
+{
+	setGameTickPhase(&GameTickPhase, SysCtlClockGet(), speed);
+#if GAME_TICK_USE_TIMER
+	/* Drop any notification left over from the previous game */
+	ulTaskNotifyTake(pdTRUE, 0);
+	TimerLoadSet(TIMER0_BASE, TIMER_A, advanceGameTickPhase(&GameTickPhase) - 1);
+	TimerEnable(TIMER0_BASE, TIMER_A);
+	/* The counter already holds the first period, this one is picked up at its timeout */
+	TimerLoadSet(TIMER0_BASE, TIMER_A, advanceGameTickPhase(&GameTickPhase) - 1);
+#else
+	GameTickLastWokenTime = xTaskGetTickCount();
+#endif
+}
+
+void stopGameTick()
+{
+	TimerDisable(TIMER0_BASE, TIMER_A);
+	TimerIntClear(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+}
+
+/* Returns true if the tick was held by a pause, so the time since the last
+ * tick says nothing about the scheduling */
+bool waitForGameTick()
+{
+	bool held = false;
+#if GAME_TICK_USE_TIMER
+	uint32_t pending;
+#else
+	portTickType tickPeriod;
+#endif
+	for ( ;; )
+	{
+#if GAME_TICK_USE_TIMER
+		/* Every timeout adds one notification, taking them all at once skips the ones that are overdue */
+		pending = ulTaskNotifyTake(TickOverrunPolicy == TICK_POLICY_SKIP ? pdTRUE : pdFALSE, portMAX_DELAY);
+		if (TickOverrunPolicy == TICK_POLICY_SKIP && pending > 1) getTickStats(SnakeSpeed)->skippedTicks += pending - 1;
+#else
+		tickPeriod = (60000/SnakeSpeed) / portTICK_RATE_MS;
+		if (TickOverrunPolicy == TICK_POLICY_SKIP)
+		{
+			/* Drop the ticks that are already due so vTaskDelayUntil does not run them back to back */
+			while ((portTickType)(xTaskGetTickCount() - (GameTickLastWokenTime + tickPeriod)) < portMAX_DELAY / 2)
+			{
+				GameTickLastWokenTime += tickPeriod;
+				getTickStats(SnakeSpeed)->skippedTicks++;
+			}
+		}
+		vTaskDelayUntil(&GameTickLastWokenTime, tickPeriod);
+#endif
+		/* While paused the timer keeps running and every tick is dropped unless a step was requested */
+		if (!GameTickPaused || takeGameTickStep()) return held;
+		held = true;
+	}
+}
+
+/* Changes the speed of a running game, the period already being counted is kept */
+void setGameTickSpeed(int speed)
+{
+	taskENTER_CRITICAL();
+	SnakeSpeed = speed;
+	setGameTickPhase(&GameTickPhase, SysCtlClockGet(), speed);
+#if GAME_TICK_USE_TIMER
+	TimerLoadSet(TIMER0_BASE, TIMER_A, advanceGameTickPhase(&GameTickPhase) - 1);
+#endif
+	taskEXIT_CRITICAL();
+}
+
+/* The console adds steps while the tick may be taking one, both change the count inside a critical section */
+void addGameTickSteps(unsigned int steps)
+{
+	taskENTER_CRITICAL();
+	GameTickSteps += steps;
+	taskEXIT_CRITICAL();
+}
+
+bool takeGameTickStep()
+{
+	bool step = false;
+	taskENTER_CRITICAL();
+	if (GameTickSteps > 0)
+	{
+		GameTickSteps--;
+		step = true;
+	}
+	taskEXIT_CRITICAL();
+	return step;
+}
+
+uint32_t readTimestamp()
+{
+	/* Timer 1 counts down, flip it so timestamps increase */
+	return 0xFFFFFFFF - TimerValueGet(TIMER1_BASE, TIMER_A);
+}
+
+int nextSnakeSpeed(int speed, bool won)
+{
+	if (!won) return INITIAL_SNAKE_SPEED;
+	speed = (speed * 3) / 2;
+	if (speed > MAXIMUM_SNAKE_SPEED) speed = MAXIMUM_SNAKE_SPEED;
+	return speed;
+}
+
+void setGameTickPhase(GameTickPhaseType *phase, uint32_t clock, int speed)
+{
+	uint64_t cyclesPerMinute = (uint64_t)clock * 60;
+	phase->load = (uint32_t)(cyclesPerMinute / speed);
+	phase->remainder = (uint32_t)(cyclesPerMinute % speed);
+	phase->speed = speed;
+	phase->phase = 0;
+}
+
+uint32_t advanceGameTickPhase(GameTickPhaseType *phase)
+{
+	phase->phase += phase->remainder;
+	if (phase->phase >= phase->speed)
+	{
+		phase->phase -= phase->speed;
+		return phase->load + 1;
+	}
+	return phase->load;
+}
+
+TickStatsType *getTickStats(int speed)
+{
+	int i;
+	for (i = 0; i < TICK_STATS_LEVELS - 1; i++)
+	{
+		if (TickStats[i].snakeSpeed == speed || TickStats[i].snakeSpeed == 0) break;
+	}
+	/* Speeds beyond the table size share the last entry */
+	if (TickStats[i].snakeSpeed != speed)
+	{
+		TickStats[i].snakeSpeed = speed;
+		TickStats[i].idealPeriod = (uint32_t)(((uint64_t)TimestampsPerMs * 60000) / speed);
+		TickStats[i].ticks = 0;
+		TickStats[i].missedDeadlines = 0;
+		TickStats[i].skippedTicks = 0;
+		TickStats[i].minPeriod = 0xFFFFFFFF;
+		TickStats[i].maxPeriod = 0;
+		TickStats[i].totalPeriod = 0;
+		TickStats[i].maxJitter = 0;
+		TickStats[i].maxWork = 0;
+		TickStats[i].totalWork = 0;
+		TickStats[i].maxLateness = 0;
+		TickStats[i].minSlack = 0xFFFFFFFF;
+		TickStats[i].totalSlack = 0;
+		TickStats[i].slackTicks = 0;
+		TickStats[i].renderOverruns = 0;
+	}
+	return &TickStats[i];
+}
+
+/* Returns true if the tick ran past the start of the next one */
+bool updateTickStats(bool firstTick, uint32_t tickStart, uint32_t tickEnd)
+{
+	static uint32_t lastTickStart;
+	TickStatsType *stats = getTickStats(SnakeSpeed);
+	uint32_t period = tickStart - lastTickStart;
+	uint32_t work = tickEnd - tickStart;
+	uint32_t jitter;
+	uint32_t lateness = 0;
+	bool missed;
+#if GAME_TICK_USE_TIMER
+	uint32_t pending;
+#else
+	portTickType deadline;
+	portTickType now;
+#endif
+	
+	/* The first tick of a game has no previous start to measure against */
+	if (!firstTick)
+	{
+		if (period < stats->minPeriod) stats->minPeriod = period;
+		if (period > stats->maxPeriod) stats->maxPeriod = period;
+		stats->totalPeriod += period;
+		jitter = period > stats->idealPeriod ? period - stats->idealPeriod : stats->idealPeriod - period;
+		if (jitter > stats->maxJitter) stats->maxJitter = jitter;
+	}
+	lastTickStart = tickStart;
+	stats->ticks++;
+	if (work > stats->maxWork) stats->maxWork = work;
+	stats->totalWork += work;
+	
+	/* The deadline of this tick is the start of the next one */
+#if GAME_TICK_USE_TIMER
+	pending = ulTaskNotifyValueClear(NULL, 0);
+	missed = pending > 0;
+	if (missed) lateness = (tickEnd - GameTickTimestamp) + (pending - 1) * GameTickPhase.load;
+#else
+	now = xTaskGetTickCount();
+	deadline = GameTickLastWokenTime + (60000/SnakeSpeed) / portTICK_RATE_MS;
+	missed = (portTickType)(now - deadline) < portMAX_DELAY / 2 && now != deadline;
+	if (missed) lateness = (now - deadline) * TimestampsPerMs;
+#endif
+	if (missed)
+	{
+		stats->missedDeadlines++;
+		if (lateness > stats->maxLateness) stats->maxLateness = lateness;
+	}
+	return missed;
+}
+
+/* Called by RenderTask around every request, idle once the queue is empty */
+void markRenderBusy()
+{
+	RenderIdle = false;
+}
+
+void markRenderIdle()
+{
+	RenderIdleTimestamp = readTimestamp();
+	RenderIdle = true;
+}
+
+/* How long before this deadline the last tick was on the wire. Returns true
+ * for an overrun, when RenderTask is still sending it */
+bool updateRenderSlack(bool firstTick, uint32_t tickStart)
+{
+	TickStatsType *stats = getTickStats(SnakeSpeed);
+	uint32_t slack;
+	if (firstTick) return false;
+	if (!RenderIdle)
+	{
+		stats->renderOverruns++;
+		return true;
+	}
+	slack = tickStart - RenderIdleTimestamp;
+	if (slack < stats->minSlack) stats->minSlack = slack;
+	stats->totalSlack += slack;
+	stats->slackTicks++;
+	return false;
+}
+
+void TIMER0A_Handler(void)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	TimerIntClear(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+	TimerLoadSet(TIMER0_BASE, TIMER_A, advanceGameTickPhase(&GameTickPhase) - 1);
+	GameTickTimestamp = readTimestamp();
+	vTaskNotifyGiveFromISR(SnakePositionUpdateTaskHandle, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
@@ -0,0 +1,75 @@
+#ifndef GAME_TICK_H
+#define GAME_TICK_H
+
+#include "game.h"
+
+/* Game Tick Configuration Parameters */
+#define GAME_TICK_USE_TIMER		1		/* 1: Timer 0A interrupt with a phase accumulator, 0: vTaskDelayUntil */
+#define TICK_STATS_LEVELS		8
+
+/* Type Definitions */
+typedef enum
+{
+	TICK_POLICY_CATCH_UP,
+	TICK_POLICY_SKIP
+} TickOverrunPolicyType;
+
+/* All times are in timestamp timer cycles, see readTimestamp */
+typedef struct TickStats
+{
+	int snakeSpeed;
+	uint32_t idealPeriod;
+	unsigned int ticks;
+	unsigned int missedDeadlines;
+	unsigned int skippedTicks;
+	uint32_t minPeriod;
+	uint32_t maxPeriod;
+	uint64_t totalPeriod;
+	uint32_t maxJitter;
+	uint32_t maxWork;
+	uint64_t totalWork;
+	uint32_t maxLateness;
+	uint32_t minSlack;				/* From RenderTask sending the last byte of a tick to the next deadline */
+	uint64_t totalSlack;
+	unsigned int slackTicks;
+	unsigned int renderOverruns;	/* Deadlines reached with RenderTask still sending */
+} TickStatsType;
+
+/* Splits 60 s / speed into whole timer cycles plus a remainder that is carried
+ * from tick to tick, so the average period is exact even though every single
+ * period is a whole number of cycles */
+typedef struct GameTickPhase
+{
+	uint32_t load;
+	uint32_t remainder;
+	uint32_t speed;
+	uint32_t phase;
+} GameTickPhaseType;
+
+/* Global Variables */
+extern TickOverrunPolicyType TickOverrunPolicy;
+extern TickStatsType TickStats[TICK_STATS_LEVELS];
+extern uint32_t TimestampsPerMs;
+extern volatile bool GameTickPaused;
+extern volatile unsigned int GameTickSteps;
+
+/* Game Tick Functions */
+void initializeGameTick();
+void startGameTick(int speed);
+void stopGameTick();
+bool waitForGameTick();
+void setGameTickSpeed(int speed);
+void addGameTickSteps(unsigned int steps);
+bool takeGameTickStep();
+uint32_t readTimestamp();
+int nextSnakeSpeed(int speed, bool won);
+void setGameTickPhase(GameTickPhaseType *phase, uint32_t clock, int speed);
+uint32_t advanceGameTickPhase(GameTickPhaseType *phase);
+TickStatsType *getTickStats(int speed);
+bool updateTickStats(bool firstTick, uint32_t tickStart, uint32_t tickEnd);
+void markRenderBusy();
+void markRenderIdle();
+bool updateRenderSlack(bool firstTick, uint32_t tickStart);
+void TIMER0A_Handler(void);
+
+#endif /* GAME_TICK_H */
@@ -0,0 +1,52 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "geometry.h"
+#include "spectator.h"
+
+/* The cursor tables are written out by the preprocessor and live in flash,
+ * when GEOMETRY_TABLES is on. GEOMETRY_REPEAT_n(m, c) expands to
+ * m(c) m(c + 1) ... m(c + n - 1) */
+#define GEOMETRY_REPEAT_1(m, c)		m(c)
+#define GEOMETRY_REPEAT_2(m, c)		GEOMETRY_REPEAT_1(m, c) GEOMETRY_REPEAT_1(m, (c) + 1)
+#define GEOMETRY_REPEAT_4(m, c)		GEOMETRY_REPEAT_2(m, c) GEOMETRY_REPEAT_2(m, (c) + 2)
+#define GEOMETRY_REPEAT_8(m, c)		GEOMETRY_REPEAT_4(m, c) GEOMETRY_REPEAT_4(m, (c) + 4)
+#define GEOMETRY_REPEAT_16(m, c)	GEOMETRY_REPEAT_8(m, c) GEOMETRY_REPEAT_8(m, (c) + 8)
+#define GEOMETRY_REPEAT_32(m, c)	GEOMETRY_REPEAT_16(m, c) GEOMETRY_REPEAT_16(m, (c) + 16)
+#define GEOMETRY_REPEAT_64(m, c)	GEOMETRY_REPEAT_32(m, c) GEOMETRY_REPEAT_32(m, (c) + 32)
+
+/* "\033[H\033[<n>B" and "\033[<n>C", n in one or two digits */
+#define GEOMETRY_DIGITS(n, letter)	(n) < 10 ? '0' + (n) : '0' + (n) / 10, (n) < 10 ? (letter) : '0' + (n) % 10, (n) < 10 ? 0 : (letter)
+#define GEOMETRY_LINE(n)			{(n) < 10 ? 7 : 8, {'\033', '[', 'H', '\033', '[', GEOMETRY_DIGITS(n, 'B')}},
+#define GEOMETRY_COLUMN(n)			{(n) < 10 ? 4 : 5, {'\033', '[', GEOMETRY_DIGITS(n, 'C')}},
+
+/* Global Variables */
+const int8_t DirectionSteps[4][2] = {{0, -1}, {0, 1}, {1, 0}, {-1, 0}};		/* x and y, in the order of Direction */
+
+#if GEOMETRY_TABLES
+const CursorFragmentType CursorLineFragments[GEOMETRY_CURSOR_STEPS] =
+{
+	GEOMETRY_REPEAT_64(GEOMETRY_LINE, 0)
+	GEOMETRY_REPEAT_32(GEOMETRY_LINE, 64)
+	GEOMETRY_REPEAT_4(GEOMETRY_LINE, 96)
+};
+
+const CursorFragmentType CursorColumnFragments[GEOMETRY_CURSOR_STEPS] =
+{
+	GEOMETRY_REPEAT_64(GEOMETRY_COLUMN, 0)
+	GEOMETRY_REPEAT_32(GEOMETRY_COLUMN, 64)
+	GEOMETRY_REPEAT_4(GEOMETRY_COLUMN, 96)
+};
+
+void putCursorFragment(const CursorFragmentType *fragment)
+{
+	int i;
+	for (i = 0; i < fragment->length; i++) putRenderChar(fragment->text[i]);
+}
+#endif /* GEOMETRY_TABLES */
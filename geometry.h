@@ -0,0 +1,43 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "game.h"
+
+/* Geometry Configuration Parameters */
+/* 1: cursor moves from tables in flash in place of divisions. Off until the
+ * profile zones measured on the board show the tables pay for their flash,
+ * host/bench only times them on the host */
+#ifndef GEOMETRY_TABLES
+#define GEOMETRY_TABLES			0
+#endif
+#define GEOMETRY_POW2			((ENV_WIDTH & (ENV_WIDTH - 1)) == 0 && (ENV_HEIGHT & (ENV_HEIGHT - 1)) == 0)
+#define GEOMETRY_CURSOR_STEPS	100		/* Lines and columns with a fragment, moveCursorToPosition writes two digits */
+
+/* The lowest line the cursor goes to is the one below the board and the HUD, viewportLines() + 3 */
+#if VIEWPORT_HEIGHT + 3 >= GEOMETRY_CURSOR_STEPS || VIEWPORT_WIDTH >= GEOMETRY_CURSOR_STEPS
+#error "the viewport needs cursor moves of more than two digits"
+#endif
+
+/* A coordinate one step past the board, -1 or size, brought back onto it without a branch */
+#define GEOMETRY_WRAP(value, size)	((value) + (((value) >> 31) & (size)) - ((((size) - 1 - (value)) >> 31) & (size)))
+
+/* Type Definitions */
+/* The bytes of a cursor move to a line, from the top left corner, or on by a number of columns */
+typedef struct CursorFragment
+{
+	uint8_t length;
+	char text[8];
+} CursorFragmentType;
+
+/* Global Variables */
+extern const int8_t DirectionSteps[4][2];
+
+#if GEOMETRY_TABLES
+extern const CursorFragmentType CursorLineFragments[GEOMETRY_CURSOR_STEPS];
+extern const CursorFragmentType CursorColumnFragments[GEOMETRY_CURSOR_STEPS];
+
+/* Geometry Functions */
+void putCursorFragment(const CursorFragmentType *fragment);
+#endif
+
+#endif /* GEOMETRY_H */
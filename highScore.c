@@ -0,0 +1,196 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/eeprom.h>
+
+#include "highScore.h"
+
+/* Global Variables */
+HighScoreRecordType HighScoreTable[HIGH_SCORE_ENTRIES];
+int HighScoreSlots[HIGH_SCORE_ENTRIES];
+int HighScoreCount = 0;
+uint32_t HighScoreSequence = 0;
+int HighScoreNextSlot = 0;
+xQueueHandle HighScoreQueue = NULL;
+xTaskHandle HighScoreTaskHandle;
+
+void insertHighScore(const HighScoreRecordType *record, int slot);
+bool isBetterHighScore(const HighScoreRecordType *a, const HighScoreRecordType *b);
+bool isHighScoreSlotLive(int slot);
+
+void initializeHighScores()
+{
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0));
+	/* Without a working EEPROM there is no queue, nothing is submitted and HighScoreTask ends itself */
+	if (EEPROMInit() != EEPROM_INIT_OK) return;
+	loadHighScores();
+	HighScoreQueue = xQueueCreate(HIGH_SCORE_QUEUE_LENGTH, sizeof(HighScoreRecordType));
+}
+
+/* Rebuilds the table from the log in a single pass over every slot, so boot
+ * time does not depend on how many games were ever played */
+void loadHighScores()
+{
+	uint32_t words[HIGH_SCORE_RECORD_WORDS];
+	HighScoreRecordType record;
+	int lastSlot = -1;
+	int slot;
+	
+	HighScoreCount = 0;
+	HighScoreSequence = 0;
+	for (slot = 0; slot < HIGH_SCORE_SLOTS; slot++)
+	{
+		EEPROMRead(words, HIGH_SCORE_EEPROM_BASE + slot * HIGH_SCORE_RECORD_WORDS * 4, sizeof(words));
+		record.sequence = words[0];
+		record.score = (uint16_t)(words[1] & 0xFFFF);
+		record.time = (uint16_t)(words[1] >> 16);
+		record.speed = (uint8_t)(words[2] & 0xFF);
+		record.length = (uint8_t)((words[2] >> 8) & 0xFF);
+		record.crc = (uint16_t)(words[2] >> 16);
+		/* Erased words read as all ones */
+		if (record.sequence == 0xFFFFFFFF || record.crc != calculateHighScoreCrc(&record)) continue;
+		if (lastSlot < 0 || record.sequence > HighScoreSequence)
+		{
+			HighScoreSequence = record.sequence;
+			lastSlot = slot;
+		}
+		insertHighScore(&record, slot);
+	}
+	HighScoreNextSlot = (lastSlot + 1) % HIGH_SCORE_SLOTS;
+}
+
+void submitHighScore(int score, int time, int speed, int length)
+{
+	HighScoreRecordType record;
+	record.sequence = 0;
+	record.score = (uint16_t)score;
+	record.time = (uint16_t)time;
+	record.speed = (uint8_t)speed;
+	record.length = (uint8_t)length;
+	record.crc = 0;
+	/* Never wait here, the caller is ending the game */
+	if (HighScoreQueue != NULL) xQueueSend(HighScoreQueue, (const void *)&record, 0);
+}
+
+void HighScoreTask(void *vpParameters)
+{
+	HighScoreRecordType record;
+	/* Created before initializeHighScores ran, the queue is only known once the scheduler starts */
+	if (HighScoreQueue == NULL) vTaskDelete(NULL);
+	for ( ;; )
+	{
+		xQueueReceive(HighScoreQueue, (void *)&record, portMAX_DELAY);
+		storeHighScore(&record);
+	}
+}
+
+/* Appends the record to the log if it makes the table. Returns false if it
+ * did not qualify or the EEPROM reported an error */
+bool storeHighScore(HighScoreRecordType *record)
+{
+	uint32_t words[HIGH_SCORE_RECORD_WORDS];
+	uint32_t address;
+	int slot;
+	int i;
+	
+	if (!isHighScore(record)) return false;
+	/* Slots holding a table entry are skipped, there is always a free one since the log is much larger than the table */
+	slot = HighScoreNextSlot;
+	while (isHighScoreSlotLive(slot)) slot = (slot + 1) % HIGH_SCORE_SLOTS;
+	record->sequence = HighScoreSequence + 1;
+	record->crc = calculateHighScoreCrc(record);
+	words[0] = record->sequence;
+	words[1] = record->score | ((uint32_t)record->time << 16);
+	words[2] = record->speed | ((uint32_t)record->length << 8) | ((uint32_t)record->crc << 16);
+	address = HIGH_SCORE_EEPROM_BASE + slot * HIGH_SCORE_RECORD_WORDS * 4;
+	
+	/* The sequence goes last, one word at a time, letting other tasks run while the EEPROM is busy */
+	for (i = HIGH_SCORE_RECORD_WORDS - 1; i >= 0; i--)
+	{
+		if (EEPROMProgramNonBlocking(words[i], address + i * 4) & ~EEPROM_RC_WORKING) return false;
+		while (EEPROMStatusGet() & EEPROM_RC_WORKING) vTaskDelay(1);
+		if (EEPROMStatusGet() != 0) return false;
+	}
+	
+	HighScoreSequence = record->sequence;
+	HighScoreNextSlot = (slot + 1) % HIGH_SCORE_SLOTS;
+	vTaskSuspendAll();
+	insertHighScore(record, slot);
+	xTaskResumeAll();
+	return true;
+}
+
+bool isHighScore(const HighScoreRecordType *record)
+{
+	if (record->score == 0) return false;
+	return HighScoreCount < HIGH_SCORE_ENTRIES || isBetterHighScore(record, &HighScoreTable[HighScoreCount - 1]);
+}
+
+/* Higher score first, then the faster game, then the older one */
+bool isBetterHighScore(const HighScoreRecordType *a, const HighScoreRecordType *b)
+{
+	if (a->score != b->score) return a->score > b->score;
+	if (a->time != b->time) return a->time < b->time;
+	return a->sequence < b->sequence;
+}
+
+void insertHighScore(const HighScoreRecordType *record, int slot)
+{
+	int i;
+	if (HighScoreCount == HIGH_SCORE_ENTRIES)
+	{
+		if (!isBetterHighScore(record, &HighScoreTable[HIGH_SCORE_ENTRIES - 1])) return;
+		HighScoreCount--;
+	}
+	for (i = HighScoreCount; i > 0 && isBetterHighScore(record, &HighScoreTable[i - 1]); i--)
+	{
+		HighScoreTable[i] = HighScoreTable[i - 1];
+		HighScoreSlots[i] = HighScoreSlots[i - 1];
+	}
+	HighScoreTable[i] = *record;
+	HighScoreSlots[i] = slot;
+	HighScoreCount++;
+}
+
+bool isHighScoreSlotLive(int slot)
+{
+	int i;
+	for (i = 0; i < HighScoreCount; i++)
+	{
+		if (HighScoreSlots[i] == slot) return true;
+	}
+	return false;
+}
+
+/* CRC-16/CCITT over everything but the CRC itself */
+uint16_t calculateHighScoreCrc(const HighScoreRecordType *record)
+{
+	uint8_t bytes[10];
+	uint16_t crc = 0xFFFF;
+	int i;
+	int bit;
+	bytes[0] = (uint8_t)record->sequence;
+	bytes[1] = (uint8_t)(record->sequence >> 8);
+	bytes[2] = (uint8_t)(record->sequence >> 16);
+	bytes[3] = (uint8_t)(record->sequence >> 24);
+	bytes[4] = (uint8_t)record->score;
+	bytes[5] = (uint8_t)(record->score >> 8);
+	bytes[6] = (uint8_t)record->time;
+	bytes[7] = (uint8_t)(record->time >> 8);
+	bytes[8] = record->speed;
+	bytes[9] = record->length;
+	for (i = 0; i < 10; i++)
+	{
+		crc ^= (uint16_t)bytes[i] << 8;
+		for (bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+	}
+	return crc;
+}
@@ -0,0 +1,48 @@
+#ifndef HIGH_SCORE_H
+#define HIGH_SCORE_H
+
+#include "game.h"
+
+/* High Score Configuration Parameters */
+#define HIGH_SCORE_ENTRIES		10
+#define HIGH_SCORE_SHOWN		5		/* Entries listed in the main menu */
+#define HIGH_SCORE_EEPROM_BASE	0
+#define HIGH_SCORE_EEPROM_SIZE	2048
+#define HIGH_SCORE_RECORD_WORDS	3
+#define HIGH_SCORE_SLOTS		(HIGH_SCORE_EEPROM_SIZE / (HIGH_SCORE_RECORD_WORDS * 4))
+#define HIGH_SCORE_QUEUE_LENGTH	2
+
+/* Type Definitions */
+/* One finished game as stored in EEPROM. The log is append only: every
+ * qualifying game goes to the next slot that does not hold a current table
+ * entry, so writes rotate over all the other slots and never touch a record
+ * that is still needed. The sequence word is programmed last and the CRC
+ * covers the whole record, so a write torn by a reset reads back as invalid */
+typedef struct HighScoreRecord
+{
+	uint32_t sequence;
+	uint16_t score;
+	uint16_t time;
+	uint8_t speed;
+	uint8_t length;
+	uint16_t crc;
+} HighScoreRecordType;
+
+/* Global Variables */
+extern HighScoreRecordType HighScoreTable[HIGH_SCORE_ENTRIES];
+extern int HighScoreCount;
+extern xQueueHandle HighScoreQueue;
+
+/* Tasks */
+void HighScoreTask(void *vpParameters);
+extern xTaskHandle HighScoreTaskHandle;
+
+/* High Score Functions */
+void initializeHighScores();
+void loadHighScores();
+void submitHighScore(int score, int time, int speed, int length);
+bool storeHighScore(HighScoreRecordType *record);
+bool isHighScore(const HighScoreRecordType *record);
+uint16_t calculateHighScoreCrc(const HighScoreRecordType *record);
+
+#endif /* HIGH_SCORE_H */
@@ -0,0 +1,168 @@
+/* Host check and benchmark of the autopilot.
+ *
+ * The cycle table the compiler built is walked from the top left corner: it
+ * has to step to a neighbour every time, pass through every cell once, come
+ * back to the start and agree with readCycleOrder all the way round. Then
+ * games are played by the autopilot from a run of seeds, following the bare
+ * cycle and with shortcuts, once with only normal power-ups and once with
+ * all the spawners on their usual schedule. With only normal power-ups
+ * nothing can get in the way and every game has to be won. The enemy lands
+ * on any free cell, right in front of the head too, and the bare cycle never
+ * turns away from it; how the shortcuts fare against it is reported as it
+ * is, losses and all. MAX_SNAKE_LENGTH
+ * can be raised to the number of cells to play until the board is full, the
+ * spawners are left out then as they would find no free cell.
+ *
+ * Build and run from the repository root:
+ *   make -C host autopilot
+ *   host/autopilot [games]
+ * and for whole boards, for example
+ *   make -C host -B autopilot DEFINES=-DMAX_SNAKE_LENGTH=144
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "../autopilot.h"
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+
+#define AUTOPILOT_TEST_GAMES	200
+#define AUTOPILOT_TEST_SPEED	INITIAL_SNAKE_SPEED
+
+typedef struct AutopilotResults
+{
+	unsigned long won;
+	unsigned long lostSelf;
+	unsigned long lostEnemy;
+	unsigned long timedOut;
+	unsigned long long winTicks;
+	unsigned long long decisions;
+	unsigned long long decisionNs;
+} AutopilotResultsType;
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/* Walks the table once round, the number of faults found */
+static unsigned long checkCycle(void)
+{
+	static bool visited[ENV_HEIGHT][ENV_WIDTH];
+	PointType cell = {0, 0};
+	PointType next;
+	unsigned long faults = 0;
+	int order = readCycleOrder(cell);
+	int dx;
+	int dy;
+	int step;
+	memset(visited, 0, sizeof(visited));
+	for (step = 0; step < AUTOPILOT_CELLS; step++)
+	{
+		if (visited[cell.y][cell.x]) faults++;
+		visited[cell.y][cell.x] = true;
+		next = calculateNewHeadPosition(cell, readCycleDirection(cell));
+		/* A plain step, never one round the edge of the board */
+		dx = abs(next.x - cell.x);
+		dy = abs(next.y - cell.y);
+		if (dx + dy != 1) faults++;
+		if (readCycleOrder(next) != (order + 1) % AUTOPILOT_CELLS) faults++;
+		order = readCycleOrder(next);
+		cell = next;
+	}
+	if (cell.x != 0 || cell.y != 0) faults++;
+	return faults;
+}
+
+static void playAutopilotGame(uint32_t seed, bool shortcuts, bool enemy, AutopilotResultsType *results)
+{
+	HostSpawnersType spawners;
+	GameOutcomeType outcome = GAME_RUNNING;
+	unsigned long period = (60000 / AUTOPILOT_TEST_SPEED) / portTICK_RATE_MS;
+	unsigned long long start;
+	PointType next;
+	Direction direction;
+	SnakeSpeed = AUTOPILOT_TEST_SPEED;
+	resetGameState();
+	resetHostSpawners(&spawners);
+	seedRandomNumber((int)seed);
+	if (enemy) runHostSpawners(&spawners, period);
+	else spawnNormalPowerUp();
+	while (GameTickIndex < (unsigned long)AUTOPILOT_CELLS * MAX_SNAKE_LENGTH * 4)
+	{
+		start = nowNs();
+		direction = shortcuts ? chooseAutopilotDirection() : readCycleDirection(GameState.snakePositions[0]);
+		results->decisionNs += nowNs() - start;
+		results->decisions++;
+		LastDirection = direction;
+		outcome = advanceSnake();
+		if (outcome != GAME_RUNNING) break;
+		if (enemy) runHostSpawners(&spawners, period);
+		else if (findEntityOfKind(ENTITY_NORMAL_POWERUP) == ENTITY_NONE) spawnNormalPowerUp();
+	}
+	if (outcome == GAME_WON)
+	{
+		results->won++;
+		results->winTicks += GameTickIndex;
+		return;
+	}
+	next = calculateNewHeadPosition(GameState.snakePositions[0], LastDirection);
+	if (outcome == GAME_RUNNING) results->timedOut++;
+	else if (entityKindAt(next) == ENTITY_ENEMY) results->lostEnemy++;
+	else results->lostSelf++;
+}
+
+int main(int argc, char **argv)
+{
+	int games = argc > 1 ? atoi(argv[1]) : AUTOPILOT_TEST_GAMES;
+	AutopilotResultsType results;
+	AutopilotResultsType enemyResults;
+	unsigned long faults;
+	unsigned long failures = 0;
+	int mode;
+	int game;
+	bool shortcuts;
+	bool enemy;
+	if (games < 1) games = AUTOPILOT_TEST_GAMES;
+	memset(&enemyResults, 0, sizeof(enemyResults));
+	faults = checkCycle();
+	printf("%dx%d board, cycle table %d bytes of flash, %lu faults round the cycle, win at length %d\n",
+		ENV_WIDTH, ENV_HEIGHT, (int)sizeof(AutopilotCycle), faults, MAX_SNAKE_LENGTH);
+	failures += faults;
+	printf("%-22s %8s %8s %8s %8s %12s %12s\n", "mode", "won", "self", "enemy", "timeout", "ticks to win", "ns per move");
+	for (mode = 0; mode < 4; mode++)
+	{
+		shortcuts = (mode & 1) != 0;
+		enemy = (mode & 2) != 0;
+		if (enemy && MAX_SNAKE_LENGTH + 3 > AUTOPILOT_CELLS) break;
+		memset(&results, 0, sizeof(results));
+		for (game = 0; game < games; game++) playAutopilotGame(0x9E3779B9u * (uint32_t)(game + 1), shortcuts, enemy, &results);
+		printf("%-22s %8lu %8lu %8lu %8lu %12.0f %12.1f\n", shortcuts ? (enemy ? "shortcuts, enemy" : "shortcuts") : (enemy ? "cycle, enemy" : "cycle"),
+			results.won, results.lostSelf, results.lostEnemy, results.timedOut,
+			results.won > 0 ? (double)results.winTicks / results.won : 0.0, (double)results.decisionNs / results.decisions);
+		if (!enemy) failures += games - results.won;
+		else if (shortcuts) enemyResults = results;
+	}
+	if (failures != 0)
+	{
+		printf("autopilot check FAILED\n");
+		return 1;
+	}
+	printf("the autopilot won every game without an enemy\n");
+	if (enemyResults.decisions > 0)
+	{
+		printf("with the enemy it won %lu of %d games, ran into itself in %lu and into the enemy in %lu\n",
+			enemyResults.won, games, enemyResults.lostSelf, enemyResults.lostEnemy);
+	}
+	return 0;
+}
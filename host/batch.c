@@ -0,0 +1,530 @@
+/* Host batch runner for large numbers of headless games.
+ *
+ * The game functions of main.c keep their state in globals, as the firmware
+ * plays one game at a time, so the workers are forked processes rather than
+ * threads. The work is split into chunks of sessions, dealt out evenly to
+ * one deque per worker in shared memory. A worker takes chunks from the
+ * bottom of its own deque and, once that is empty, steals from the top of
+ * the others', so a worker that drew long games does not hold up the rest.
+ *
+ * A session is a run of games at the speeds the menu would pick, starting
+ * at INITIAL_SNAKE_SPEED and going up with every win. Every game has its own
+ * seed, so the results do not depend on which worker played it. They are
+ * kept as columns, one array per field indexed by game, and can be written
+ * out with --out:
+ *   "SNKB", uint32 games, uint32 seed, then the columns in this order
+ *   uint16 score, uint16 time (s), uint8 length, uint8 cause, uint16 speed,
+ *   uint32 ticks
+ * all little endian, 12 bytes per game. The causes are those of BatchCause.
+ *
+ * The safe bot is the ai bot with the bitboard trap check on top: it does
+ * not take a move into an area smaller than the snake while another move
+ * that survives has room. The autopilot bot leaves the moves to the
+ * firmware's autopilot, as the p key on the menu does.
+ *
+ * With --scaling the batch is played again with 1, 2, 4 and so on workers up
+ * to --workers, and the columns have to come out the same every time.
+ *
+ * SPECIAL_POWERUP_FREQ is a build option, DEFINES=-DSPECIAL_POWERUP_FREQ=5, the
+ * spawner periods are run time options.
+ *
+ * Build and run from the repository root:
+ *   make -C host batch
+ *   host/batch [--games n] [--workers n] [--session n] [--bot ai|safe|autopilot|random] [--seed n]
+ *           [--special ms] [--enemy ms] [--max-ticks n] [--out file] [--scaling]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "../bitboard.h"
+#include "../autopilot.h"
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+
+#define BATCH_GAMES				10000
+#define BATCH_SESSION			1		/* Games per session */
+#define BATCH_CHUNK				16		/* Sessions per stolen piece of work */
+#define BATCH_MAX_WORKERS		64
+#define BATCH_MAX_TICKS			20000
+#define BATCH_SPEEDS			8
+
+typedef enum
+{
+	BATCH_CAUSE_SELF,
+	BATCH_CAUSE_ENEMY,
+	BATCH_CAUSE_WON,
+	BATCH_CAUSE_TIMEOUT
+} BatchCause;
+
+typedef enum
+{
+	BATCH_BOT_AI,
+	BATCH_BOT_SAFE,
+	BATCH_BOT_AUTOPILOT,
+	BATCH_BOT_RANDOM
+} BatchBot;
+
+/* Chunks are first session numbers. The deques are only ever taken from,
+ * the owner at the bottom and thieves at the top, after Chase and Lev */
+typedef struct BatchDeque
+{
+	volatile long top;
+	volatile long bottom;
+	unsigned long stolen;
+	unsigned long games;
+	unsigned long long busyNs;
+	char padding[24];			/* One cache line per worker */
+} BatchDequeType;
+
+typedef struct BatchColumns
+{
+	uint16_t *score;
+	uint16_t *time;
+	uint8_t *length;
+	uint8_t *cause;
+	uint16_t *speed;
+	uint32_t *ticks;
+} BatchColumnsType;
+
+typedef struct BatchOptions
+{
+	unsigned long games;
+	int workers;
+	int session;
+	BatchBot bot;
+	uint32_t seed;
+	int specialPeriod;
+	int enemyPeriod;
+	unsigned long maxTicks;
+	const char *out;
+	bool scaling;
+} BatchOptionsType;
+
+BatchOptionsType Options = {BATCH_GAMES, 1, BATCH_SESSION, BATCH_BOT_AI, 1, SPECIAL_POWERUP_PERIOD, ENEMY_PERIOD, BATCH_MAX_TICKS, NULL, false};
+BatchDequeType *Deques;
+long *Chunks;					/* One row of chunk slots per worker */
+long ChunksPerWorker;
+BatchColumnsType Columns;
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void *mapShared(size_t size)
+{
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+	{
+		perror("mmap");
+		exit(2);
+	}
+	return memory;
+}
+
+static uint32_t xorshift(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Turns about every fourth tick, whatever is in the way */
+static char chooseRandomKey(uint32_t *botState)
+{
+	static const char keys[] = {'w', 's', 'd', 'a'};
+	uint32_t draw = xorshift(botState);
+	return draw % 4 == 0 ? keys[(draw >> 8) % 4] : 0;
+}
+
+/* The ai bot's move, unless it shuts the snake into an area smaller than
+ * itself and another move that survives does not */
+static char chooseSafeKey(uint32_t *botState)
+{
+	static const char keys[] = {'w', 's', 'd', 'a'};
+	char key = chooseBotKey(botState);
+	PointType next;
+	int direction;
+	for (direction = UP; direction <= LEFT && key != 0; direction++)
+	{
+		if (keys[direction] == key && !isTrapMove((Direction)direction)) return key;
+	}
+	for (direction = UP; direction <= LEFT; direction++)
+	{
+		next = calculateNewHeadPosition(GameState.snakePositions[0], (Direction)direction);
+		if (isSnakeCollision(next) || entityKindAt(next) == ENTITY_ENEMY) continue;
+		if (!isTrapMove((Direction)direction)) return keys[direction];
+	}
+	return key;
+}
+
+/* One game from the seed, with the spawners on the schedule they keep at this speed */
+static void playBatchGame(unsigned long game, int speed)
+{
+	HostSpawnersType spawners;
+	GameOutcomeType outcome = GAME_RUNNING;
+	unsigned long period = (60000 / speed) / portTICK_RATE_MS;
+	uint32_t seed = Options.seed * 2654435761u + (uint32_t)game;
+	uint32_t botState = seed * 2246822519u + 1;
+	PointType next;
+	uint8_t cause;
+	char key;
+	SnakeSpeed = speed;
+	resetGameState();
+	resetHostSpawners(&spawners);
+	seedRandomNumber((int)seed);
+	while (outcome == GAME_RUNNING && GameTickIndex < Options.maxTicks)
+	{
+		if (Options.bot == BATCH_BOT_AI) key = chooseBotKey(&botState);
+		else if (Options.bot == BATCH_BOT_SAFE) key = chooseSafeKey(&botState);
+		else if (Options.bot == BATCH_BOT_AUTOPILOT) key = 0;
+		else key = chooseRandomKey(&botState);
+		if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		outcome = snakeTick();
+		if (outcome != GAME_RUNNING) break;
+		runHostSpawners(&spawners, period);
+	}
+	/* The snake did not move on the tick it lost, so the move can be looked at again */
+	next = calculateNewHeadPosition(GameState.snakePositions[0], LastDirection);
+	if (outcome == GAME_WON) cause = BATCH_CAUSE_WON;
+	else if (outcome == GAME_RUNNING) cause = BATCH_CAUSE_TIMEOUT;
+	else cause = isSnakeCollision(next) ? BATCH_CAUSE_SELF : BATCH_CAUSE_ENEMY;
+	while (UARTCharsAvail(UART0_BASE)) UARTCharGet(UART0_BASE);
+	Columns.score[game] = (uint16_t)score;
+	Columns.time[game] = (uint16_t)(spawners.elapsed / 1000);
+	Columns.length[game] = (uint8_t)GameState.snakeLength;
+	Columns.cause[game] = cause;
+	Columns.speed[game] = (uint16_t)speed;
+	Columns.ticks[game] = (uint32_t)GameTickIndex;
+}
+
+static void playChunk(long chunk, BatchDequeType *deque)
+{
+	unsigned long sessions = (Options.games + Options.session - 1) / Options.session;
+	unsigned long session;
+	unsigned long game;
+	int speed;
+	bool won;
+	int i;
+	for (session = (unsigned long)chunk * BATCH_CHUNK; session < sessions && session < (unsigned long)(chunk + 1) * BATCH_CHUNK; session++)
+	{
+		/* What MainMenuTask picks for each game of a sitting */
+		speed = INITIAL_SNAKE_SPEED;
+		won = false;
+		for (i = 0; i < Options.session; i++)
+		{
+			game = session * Options.session + i;
+			if (game >= Options.games) break;
+			speed = nextSnakeSpeed(speed, won);
+			playBatchGame(game, speed);
+			won = Columns.cause[game] == BATCH_CAUSE_WON;
+			deque->games++;
+		}
+	}
+}
+
+static bool popChunk(int worker, long *chunk)
+{
+	BatchDequeType *deque = &Deques[worker];
+	long bottom = deque->bottom - 1;
+	long top;
+	bool taken = true;
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+	if (top > bottom)
+	{
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_SEQ_CST);
+		return false;
+	}
+	*chunk = Chunks[worker * ChunksPerWorker + bottom];
+	if (top == bottom)
+	{
+		/* The last one, a thief may be after it too */
+		taken = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_SEQ_CST);
+	}
+	return taken;
+}
+
+static bool stealChunk(int victim, long *chunk, bool *empty)
+{
+	BatchDequeType *deque = &Deques[victim];
+	long top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+	long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+	*empty = top >= bottom;
+	if (*empty) return false;
+	*chunk = Chunks[victim * ChunksPerWorker + top];
+	return __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/* Nothing is added once the workers start, so a sweep that finds every deque empty is the end */
+static void runWorker(int worker, int workers)
+{
+	BatchDequeType *deque = &Deques[worker];
+	unsigned long long start = nowNs();
+	uint32_t random = 0x9E3779B9u * (uint32_t)(worker + 1);
+	bool allEmpty;
+	bool empty;
+	long chunk;
+	int victim;
+	int i;
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	SpecialPowerUpPeriod = Options.specialPeriod;
+	EnemyPeriod = Options.enemyPeriod;
+	for ( ;; )
+	{
+		if (popChunk(worker, &chunk))
+		{
+			playChunk(chunk, deque);
+			continue;
+		}
+		allEmpty = true;
+		victim = (int)(xorshift(&random) % (uint32_t)workers);
+		for (i = 0; i < workers; i++, victim = (victim + 1) % workers)
+		{
+			if (victim == worker) continue;
+			if (stealChunk(victim, &chunk, &empty))
+			{
+				deque->stolen++;
+				playChunk(chunk, deque);
+				allEmpty = false;
+				break;
+			}
+			if (!empty) allEmpty = false;
+		}
+		if (allEmpty) break;
+	}
+	deque->busyNs = nowNs() - start;
+}
+
+/* Chunk k goes to worker k % workers, so every deque starts with an even share */
+static double runBatch(int workers, bool quiet)
+{
+	unsigned long sessions = (Options.games + Options.session - 1) / Options.session;
+	long chunks = (long)((sessions + BATCH_CHUNK - 1) / BATCH_CHUNK);
+	unsigned long long start;
+	unsigned long long elapsed;
+	unsigned long stolen = 0;
+	double busiest = 0.0;
+	pid_t child;
+	long chunk;
+	int worker;
+	ChunksPerWorker = (chunks + workers - 1) / workers;
+	Chunks = mapShared(sizeof(long) * (size_t)ChunksPerWorker * (size_t)workers);
+	memset(Deques, 0, sizeof(BatchDequeType) * BATCH_MAX_WORKERS);
+	for (chunk = 0; chunk < chunks; chunk++)
+	{
+		worker = (int)(chunk % workers);
+		Chunks[worker * ChunksPerWorker + Deques[worker].bottom++] = chunk;
+	}
+	start = nowNs();
+	for (worker = 0; worker < workers; worker++)
+	{
+		child = fork();
+		if (child == 0)
+		{
+			runWorker(worker, workers);
+			_exit(0);
+		}
+		if (child < 0)
+		{
+			perror("fork");
+			exit(2);
+		}
+	}
+	while (wait(NULL) > 0);
+	elapsed = nowNs() - start;
+	munmap(Chunks, sizeof(long) * (size_t)ChunksPerWorker * (size_t)workers);
+	for (worker = 0; worker < workers; worker++)
+	{
+		stolen += Deques[worker].stolen;
+		if (Deques[worker].busyNs / 1e9 > busiest) busiest = Deques[worker].busyNs / 1e9;
+	}
+	if (!quiet)
+	{
+		printf("%d workers: %lu games in %.3f s, %.0f games/s, %lu of %ld chunks stolen, slowest worker %.3f s\n", workers,
+			Options.games, elapsed / 1e9, Options.games / (elapsed / 1e9), stolen, chunks, busiest);
+	}
+	return Options.games / (elapsed / 1e9);
+}
+
+static uint32_t hashColumns(void)
+{
+	uint32_t hash = 2166136261u;
+	unsigned long game;
+	for (game = 0; game < Options.games; game++)
+	{
+		hash = (hash ^ Columns.score[game]) * 16777619u;
+		hash = (hash ^ Columns.time[game]) * 16777619u;
+		hash = (hash ^ Columns.length[game]) * 16777619u;
+		hash = (hash ^ Columns.cause[game]) * 16777619u;
+		hash = (hash ^ Columns.speed[game]) * 16777619u;
+		hash = (hash ^ Columns.ticks[game]) * 16777619u;
+	}
+	return hash;
+}
+
+static int compareScores(const void *a, const void *b)
+{
+	return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+/* Read column by column, one pass per speed */
+static void printSummary(void)
+{
+	static const char *causeNames[] = {"self", "enemy", "won", "timeout"};
+	uint16_t *scores = malloc(sizeof(uint16_t) * Options.games);
+	unsigned long causes[4];
+	unsigned long long totalScore;
+	unsigned long long totalTime;
+	unsigned long long totalLength;
+	unsigned long count;
+	unsigned long game;
+	int speeds[BATCH_SPEEDS];
+	int speedCount = 0;
+	int speed;
+	int cause;
+	int i;
+	for (game = 0; game < Options.games; game++)
+	{
+		for (i = 0; i < speedCount && speeds[i] != Columns.speed[game]; i++);
+		if (i == speedCount && speedCount < BATCH_SPEEDS) speeds[speedCount++] = Columns.speed[game];
+	}
+	printf("speed   games  score avg  p50  p90  max   time avg  length avg");
+	for (cause = 0; cause < 4; cause++) printf("  %7s", causeNames[cause]);
+	printf("\n");
+	for (i = 0; i < speedCount; i++)
+	{
+		speed = speeds[i];
+		count = 0;
+		totalScore = 0;
+		totalTime = 0;
+		totalLength = 0;
+		memset(causes, 0, sizeof(causes));
+		for (game = 0; game < Options.games; game++)
+		{
+			if (Columns.speed[game] != speed) continue;
+			scores[count++] = Columns.score[game];
+			totalScore += Columns.score[game];
+			totalTime += Columns.time[game];
+			totalLength += Columns.length[game];
+			causes[Columns.cause[game]]++;
+		}
+		qsort(scores, count, sizeof(uint16_t), compareScores);
+		printf("%5d  %6lu  %9.2f  %3u  %3u  %3u  %9.1f  %10.2f", speed, count, (double)totalScore / count, scores[count / 2],
+			scores[count * 9 / 10], scores[count - 1], (double)totalTime / count, (double)totalLength / count);
+		for (cause = 0; cause < 4; cause++) printf("  %6.1f%%", 100.0 * causes[cause] / count);
+		printf("\n");
+	}
+	free(scores);
+}
+
+static bool writeColumns(const char *path)
+{
+	FILE *file = fopen(path, "wb");
+	uint32_t games = (uint32_t)Options.games;
+	bool written;
+	if (file == NULL) return false;
+	written = fwrite("SNKB", 1, 4, file) == 4 && fwrite(&games, sizeof(games), 1, file) == 1 && fwrite(&Options.seed, sizeof(Options.seed), 1, file) == 1 &&
+		fwrite(Columns.score, sizeof(uint16_t), games, file) == games && fwrite(Columns.time, sizeof(uint16_t), games, file) == games &&
+		fwrite(Columns.length, sizeof(uint8_t), games, file) == games && fwrite(Columns.cause, sizeof(uint8_t), games, file) == games &&
+		fwrite(Columns.speed, sizeof(uint16_t), games, file) == games && fwrite(Columns.ticks, sizeof(uint32_t), games, file) == games;
+	return fclose(file) == 0 && written;
+}
+
+static bool parseOptions(int argc, char **argv)
+{
+	int i;
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--scaling") == 0) Options.scaling = true;
+		else if (i + 1 == argc) return false;
+		else if (strcmp(argv[i], "--games") == 0) Options.games = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--workers") == 0) Options.workers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--session") == 0) Options.session = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0) Options.seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "--special") == 0) Options.specialPeriod = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--enemy") == 0) Options.enemyPeriod = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-ticks") == 0) Options.maxTicks = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--out") == 0) Options.out = argv[++i];
+		else if (strcmp(argv[i], "--bot") == 0)
+		{
+			i++;
+			if (strcmp(argv[i], "ai") == 0) Options.bot = BATCH_BOT_AI;
+			else if (strcmp(argv[i], "safe") == 0) Options.bot = BATCH_BOT_SAFE;
+			else if (strcmp(argv[i], "autopilot") == 0) Options.bot = BATCH_BOT_AUTOPILOT;
+			else if (strcmp(argv[i], "random") == 0) Options.bot = BATCH_BOT_RANDOM;
+			else return false;
+		}
+		else return false;
+	}
+	return Options.games > 0 && Options.workers >= 1 && Options.workers <= BATCH_MAX_WORKERS && Options.session >= 1 &&
+		Options.specialPeriod > 0 && Options.enemyPeriod > 0;
+}
+
+int main(int argc, char **argv)
+{
+	double single = 0.0;
+	double rate;
+	uint32_t hash = 0;
+	bool passed = true;
+	int workers;
+	Options.workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (!parseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: %s [--games n] [--workers n] [--session n] [--bot ai|safe|autopilot|random] [--seed n]\n"
+			"       [--special ms] [--enemy ms] [--max-ticks n] [--out file] [--scaling]\n", argv[0]);
+		return 2;
+	}
+	setvbuf(stdout, NULL, _IONBF, 0);
+	AutopilotMode = Options.bot == BATCH_BOT_AUTOPILOT;
+	Deques = mapShared(sizeof(BatchDequeType) * BATCH_MAX_WORKERS);
+	Columns.score = mapShared(sizeof(uint16_t) * Options.games);
+	Columns.time = mapShared(sizeof(uint16_t) * Options.games);
+	Columns.length = mapShared(sizeof(uint8_t) * Options.games);
+	Columns.cause = mapShared(sizeof(uint8_t) * Options.games);
+	Columns.speed = mapShared(sizeof(uint16_t) * Options.games);
+	Columns.ticks = mapShared(sizeof(uint32_t) * Options.games);
+	printf("%lu games, %s bot, sessions of %d, special every %d ms (1 in %d), enemy every %d ms, %d online cores\n", Options.games,
+		Options.bot == BATCH_BOT_AI ? "ai" : Options.bot == BATCH_BOT_SAFE ? "safe" :
+		Options.bot == BATCH_BOT_AUTOPILOT ? "autopilot" : "random", Options.session, Options.specialPeriod, SPECIAL_POWERUP_FREQ, Options.enemyPeriod,
+		(int)sysconf(_SC_NPROCESSORS_ONLN));
+	if (Options.scaling)
+	{
+		/* The same games at every worker count, only faster */
+		for (workers = 1; workers <= Options.workers; workers = workers < Options.workers && workers * 2 > Options.workers ? Options.workers : workers * 2)
+		{
+			rate = runBatch(workers, true);
+			if (workers == 1)
+			{
+				single = rate;
+				hash = hashColumns();
+			}
+			else if (hashColumns() != hash) passed = false;
+			printf("%3d workers  %9.0f games/s  speedup %5.2f  efficiency %5.1f%%\n", workers, rate, rate / single, 100.0 * rate / single / workers);
+		}
+	}
+	else runBatch(Options.workers, false);
+	printSummary();
+	if (Options.out != NULL && !writeColumns(Options.out))
+	{
+		perror(Options.out);
+		return 1;
+	}
+	if (Options.scaling) printf(passed ? "every worker count played the same games\n" : "results depend on the worker count\n");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,345 @@
+/* Host microbenchmarks for the hot paths of main.c.
+ *
+ * The firmware is compiled unchanged against the stand-ins in host/stubs, so
+ * the numbers track the real code. Every benchmark is run until it takes at
+ * least BENCH_MIN_NS and the best of BENCH_REPEATS runs is reported, bytes/op
+ * counts what the case wrote to UART0.
+ *
+ * Build and run from the repository root:
+ *   make -C host bench
+ *   host/bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "../gameTick.h"
+
+#define BENCH_REPEATS		7
+#define BENCH_MIN_NS		20000000ULL
+
+typedef void (*BenchFunction)(unsigned long iterations);
+
+volatile int BenchSink;
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/* Lays the snake out as a serpentine through the top rows, the longest body
+ * the game allows, with the head on the last laid cell */
+static void setupLongSnake(void)
+{
+	PointType normal;
+	PointType enemy;
+	int i;
+	resetGameState();
+	GameState.snakeLength = MAX_SNAKE_LENGTH - 1;
+	for (i = 0; i < GameState.snakeLength; i++)
+	{
+		int index = GameState.snakeLength - 1 - i;
+		int row = index / ENV_WIDTH;
+		int column = index % ENV_WIDTH;
+		GameState.snakePositions[i].y = row;
+		GameState.snakePositions[i].x = (row % 2 == 0) ? column : ENV_WIDTH - 1 - column;
+	}
+	normal.x = ENV_WIDTH - 1;
+	normal.y = ENV_HEIGHT - 1;
+	enemy.x = 0;
+	enemy.y = ENV_HEIGHT - 1;
+	addEntity(ENTITY_NORMAL_POWERUP, normal, ENTITY_NO_EXPIRY);
+	addEntity(ENTITY_ENEMY, enemy, ENTITY_NO_EXPIRY);
+}
+
+static void benchNewHeadAndCollision(unsigned long iterations)
+{
+	unsigned long n;
+	int hits = 0;
+	PointType head;
+	for (n = 0; n < iterations; n++)
+	{
+		head = calculateNewHeadPosition(GameState.snakePositions[0], (Direction)(n & 3));
+		if (isSnakeCollision(head)) hits++;
+		if (entityKindAt(head) != ENTITY_FREE) hits++;
+	}
+	BenchSink = hits;
+}
+
+/* Rows of moves to the right with a step down after each, over every edge of the board */
+static void benchNewHead(unsigned long iterations)
+{
+	unsigned long n;
+	PointType head = GameState.snakePositions[0];
+	for (n = 0; n < iterations; n++) head = calculateNewHeadPosition(head, n % (ENV_WIDTH + 1) == 0 ? DOWN : RIGHT);
+	BenchSink = head.x + head.y;
+}
+
+static void benchSpawnRejection(unsigned long iterations)
+{
+	unsigned long n;
+	int sum = 0;
+	for (n = 0; n < iterations; n++) sum += generateFreePosition().x;
+	BenchSink = sum;
+}
+
+static void benchRandomPosition(unsigned long iterations)
+{
+	unsigned long n;
+	int sum = 0;
+	for (n = 0; n < iterations; n++) sum += generateRandomPosition().y;
+	BenchSink = sum;
+}
+
+static void benchMoveCursor(unsigned long iterations)
+{
+	unsigned long n;
+	for (n = 0; n < iterations; n++) moveCursorToPosition((int)(n % ENV_HEIGHT) + 1, (int)((n / ENV_HEIGHT) % ENV_WIDTH) + 1);
+}
+
+static void benchClearScreen(unsigned long iterations)
+{
+	unsigned long n;
+	for (n = 0; n < iterations; n++) clearScreen();
+}
+
+static GameStateType BenchSnapshot;
+static bool BenchPlanned;
+
+/* The work left at the deadline, with the plan made after the last tick or
+ * made again because a late key turned the snake. The long snake heads down
+ * into the free rows every time */
+static void benchTick(unsigned long iterations)
+{
+	unsigned long n;
+	int lost = 0;
+	LastDirection = DOWN;
+	BenchSnapshot = GameState;
+	planSnakeTick(&TickPlan);
+	for (n = 0; n < iterations; n++)
+	{
+		GameState = BenchSnapshot;
+		TickPlan.valid = BenchPlanned;
+		if (advanceSnake() != GAME_RUNNING) lost++;
+	}
+	GameState = BenchSnapshot;
+	BenchSink = lost;
+}
+
+static void benchPlanTick(unsigned long iterations)
+{
+	unsigned long n;
+	LastDirection = DOWN;
+	for (n = 0; n < iterations; n++) planSnakeTick(&TickPlan);
+	BenchSink = TickPlan.collision;
+}
+
+static RenderRequestCategory BenchCategory;
+static bool BenchRemoveTail;
+
+/* Packed each time the way the game tasks pack them */
+static void benchRender(unsigned long iterations)
+{
+	RenderRequestType request;
+	PointType head = {0, ENV_HEIGHT / 2};
+	PointType tail = {ENV_WIDTH - 1, 0};
+	unsigned long n;
+	for (n = 0; n < iterations; n++)
+	{
+		head.x = (CoordinateType)(n % ENV_WIDTH);
+		tail.y = (CoordinateType)(n % ENV_HEIGHT);
+		request = packRenderRequest(BenchCategory, head, BenchRemoveTail, tail);
+		renderRequest(&request);
+	}
+}
+
+static void benchTraceTaskSwitch(unsigned long iterations)
+{
+	unsigned long n;
+	for (n = 0; n < iterations; n++) traceTaskSwitched(TRACE_TASK_SWITCHED_IN, TRACE_TASK_SNAKE);
+}
+
+static void benchTraceRenderQueue(unsigned long iterations)
+{
+	unsigned long n;
+	for (n = 0; n < iterations; n++) traceQueueEvent(TRACE_QUEUE_SEND, RenderQueue);
+}
+
+static void benchTraceUntracedQueue(unsigned long iterations)
+{
+	unsigned long n;
+	for (n = 0; n < iterations; n++) traceQueueEvent(TRACE_QUEUE_SEND, NormalPowerUpSemaphore);
+}
+
+/* What a zone left enabled costs, an empty one */
+static void benchProfileZone(unsigned long iterations)
+{
+	unsigned long n;
+	uint32_t profileStart;
+	for (n = 0; n < iterations; n++)
+	{
+		PROFILE_START(profileStart);
+		PROFILE_END(PROFILE_SNAKE_SHIFT, profileStart);
+	}
+}
+
+static void runBench(const char *name, BenchFunction function)
+{
+	unsigned long iterations = 1;
+	unsigned long long elapsed;
+	unsigned long long best = 0;
+	unsigned long bytes;
+	int repeat;
+
+	/* Calibrate */
+	for ( ;; )
+	{
+		elapsed = nowNs();
+		function(iterations);
+		elapsed = nowNs() - elapsed;
+		if (elapsed >= BENCH_MIN_NS || iterations >= (1UL << 30)) break;
+		iterations *= 2;
+	}
+	for (repeat = 0; repeat < BENCH_REPEATS; repeat++)
+	{
+		bytes = HostUartTxCount[0];
+		elapsed = nowNs();
+		function(iterations);
+		elapsed = nowNs() - elapsed;
+		bytes = HostUartTxCount[0] - bytes;
+		if (repeat == 0 || elapsed < best) best = elapsed;
+	}
+	printf("%-32s %12lu %10.2f %10.2f\n", name, iterations, (double)best / iterations, (double)bytes / iterations);
+}
+
+static void runTickBench(const char *name, bool planned)
+{
+	BenchPlanned = planned;
+	runBench(name, benchTick);
+}
+
+static void runRenderBench(const char *name, RenderRequestCategory category, bool removeTail)
+{
+	BenchCategory = category;
+	BenchRemoveTail = removeTail;
+	runBench(name, benchRender);
+}
+
+/* Bytes UART0 gets for one request */
+static unsigned long measureRenderBytes(RenderRequestCategory category, bool removeTail)
+{
+	unsigned long bytes = HostUartTxCount[0];
+	PointType head = {ENV_WIDTH / 2, ENV_HEIGHT / 2};
+	PointType tail = {0, ENV_HEIGHT / 2};
+	RenderRequestType request = packRenderRequest(category, head, removeTail, tail);
+	renderRequest(&request);
+	return HostUartTxCount[0] - bytes;
+}
+
+/* Render-to-deadline slack at every speed of the curve: the time left in the
+ * tick period once a plain move, and a move that eats a power-up, are on the
+ * wire at 128000 baud with 10 bits a byte */
+static void printRenderSlack(void)
+{
+	unsigned long move = measureRenderBytes(SNAKE_POSITION_UPDATE, true);
+	unsigned long eat = measureRenderBytes(REMOVE_NORMAL_POWERUP, false) + measureRenderBytes(SCORE_UPDATE, false) +
+		measureRenderBytes(SNAKE_POSITION_UPDATE, false);
+	double byteUs = 10.0 * 1e6 / 128000;
+	double period;
+	int speed = INITIAL_SNAKE_SPEED;
+	int previous = 0;
+
+	printf("\n%-8s %12s %12s %14s %12s %14s\n", "speed", "period_us", "move_bytes", "move_slack_us", "eat_bytes", "eat_slack_us");
+	while (speed != previous)
+	{
+		period = 60e6 / speed;
+		printf("%-8d %12.1f %12lu %14.1f %12lu %14.1f\n", speed, period, move, period - move * byteUs, eat, period - eat * byteUs);
+		previous = speed;
+		speed = nextSnakeSpeed(speed, true);
+	}
+}
+
+/* Compares the game tick period programmed by the whole millisecond
+ * vTaskDelayUntil path with the timer phase accumulator, over one minute of
+ * ticks at every speed of the curve */
+static void printTickPeriodError(void)
+{
+	uint32_t clock = SysCtlClockGet();
+	GameTickPhaseType phase;
+	double ideal;
+	double delayUntil;
+	double deviation;
+	double maxDeviation;
+	uint64_t total;
+	uint32_t load;
+	int speed = INITIAL_SNAKE_SPEED;
+	int previous = 0;
+	int n;
+
+	printf("\n%-8s %12s %14s %12s %14s %12s\n", "speed", "ideal_us", "delay_until_us", "drift_ms/min", "timer_max_dev", "timer_drift");
+	while (speed != previous)
+	{
+		ideal = (double)clock * 60 / speed;
+		delayUntil = (double)((60000 / speed) / portTICK_RATE_MS) * clock / 1000;
+		setGameTickPhase(&phase, clock, speed);
+		total = 0;
+		maxDeviation = 0;
+		for (n = 0; n < speed; n++)
+		{
+			load = advanceGameTickPhase(&phase);
+			total += load;
+			deviation = load > ideal ? load - ideal : ideal - load;
+			if (deviation > maxDeviation) maxDeviation = deviation;
+		}
+		printf("%-8d %12.3f %14.3f %12.3f %12.3fcy %10lldcy\n", speed, ideal * 1e6 / clock, delayUntil * 1e6 / clock,
+			(ideal - delayUntil) * speed * 1e3 / clock, maxDeviation, (long long)total - (long long)clock * 60);
+		previous = speed;
+		speed = nextSnakeSpeed(speed, true);
+	}
+}
+
+int main(void)
+{
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	NormalPowerUpSemaphore = xSemaphoreCreateBinary();
+	RenderQueue = xQueueCreate(RENDER_QUEUE_LENGTH, sizeof(RenderRequestType));
+	setupLongSnake();
+
+	printf("%-32s %12s %10s %10s\n", "benchmark", "iterations", "ns/op", "bytes/op");
+	runBench("snake/new_head", benchNewHead);
+	runBench("snake/new_head_collision", benchNewHeadAndCollision);
+	runBench("snake/plan_tick", benchPlanTick);
+	runTickBench("snake/tick_from_plan", true);
+	runTickBench("snake/tick_replanned", false);
+	runBench("spawn/rejection_loop", benchSpawnRejection);
+	runBench("rng/generate_random_position", benchRandomPosition);
+	runBench("uart/move_cursor_to_position", benchMoveCursor);
+	runBench("uart/clear_screen", benchClearScreen);
+	runRenderBench("render/snake_position_update", SNAKE_POSITION_UPDATE, true);
+	runRenderBench("render/snake_grow", SNAKE_POSITION_UPDATE, false);
+	runRenderBench("render/normal_powerup_update", NORMAL_POWERUP_POSITION_UPDATE, false);
+	runRenderBench("render/remove_special_powerup", REMOVE_SPECIAL_POWERUP, false);
+	runRenderBench("render/enemy_update", ENEMY_POSITION_UPDATE, false);
+	runRenderBench("render/score_update", SCORE_UPDATE, false);
+	runRenderBench("render/time_update", TIME_UPDATE, false);
+	runRenderBench("render/cpu_load_update", CPU_LOAD_UPDATE, false);
+	runRenderBench("render/start_game", START_GAME, false);
+	runRenderBench("render/main_menu", MAIN_MENU, false);
+	runBench("trace/task_switch", benchTraceTaskSwitch);
+	runBench("trace/render_queue_send", benchTraceRenderQueue);
+	runBench("trace/untraced_queue", benchTraceUntracedQueue);
+	runBench("profile/empty_zone", benchProfileZone);
+	printTickPeriodError();
+	printRenderSlack();
+	return 0;
+}
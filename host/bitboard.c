@@ -0,0 +1,332 @@
+/* Host check and benchmark of the bitboard flood fill.
+ *
+ * First every single cell is moved every way with shiftBitboard and has to
+ * land where calculateNewHeadPosition puts the head, on a whole board with
+ * the columns wrapping and on a board of a sharded world where they do not.
+ * Then random boards are filled from random free cells, with the bitboard
+ * and with a breadth first search that visits one cell at a time through
+ * calculateNewHeadPosition, and the two have to reach the same cells. The
+ * boards are scattered obstacles at a few densities and long snakes laid
+ * as random walks, the shape the autopilot checks actually see. Both fills
+ * are timed over the same boards and starts.
+ *
+ * Build with a large world and run from the repository root:
+ *   make -C host bitboard
+ *   host/bitboard [boards]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "../bitboard.h"
+#include "stubs/host_stubs.h"
+
+#define BITBOARD_TEST_BOARDS	2000
+#define BITBOARD_TEST_STARTS	8		/* Fills per board */
+#define BITBOARD_TEST_WALK		(ENV_WIDTH * ENV_HEIGHT / 3)
+
+typedef struct BoardCase
+{
+	BitboardType blocked;
+	PointType starts[BITBOARD_TEST_STARTS];
+} BoardCaseType;
+
+static const struct
+{
+	const char *name;
+	int density;		/* Obstacles per hundred cells, 0 for a snake */
+} Shapes[] =
+{
+	{"scattered 10%", 10},
+	{"scattered 30%", 30},
+	{"scattered 45%", 45},
+	{"snake walk", 0}
+};
+
+uint32_t Random = 0x2545F491u;
+BoardCaseType *Cases;
+volatile int BitboardSink;
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static uint32_t xorshift(void)
+{
+	Random ^= Random << 13;
+	Random ^= Random >> 17;
+	Random ^= Random << 5;
+	return Random;
+}
+
+static PointType randomPoint(void)
+{
+	PointType point;
+	point.x = (int)(xorshift() % ENV_WIDTH);
+	point.y = (int)(xorshift() % ENV_HEIGHT);
+	return point;
+}
+
+/* The reference: one cell at a time, the neighbours as the game moves the head */
+static int fillCells(const BitboardType *blocked, PointType start, bool reached[ENV_HEIGHT][ENV_WIDTH])
+{
+	static PointType queue[ENV_WIDTH * ENV_HEIGHT];
+	PointType next;
+	int head = 0;
+	int tail = 0;
+	int direction;
+	memset(reached, 0, sizeof(bool) * ENV_WIDTH * ENV_HEIGHT);
+	if (isBitboardCell(blocked, start)) return 0;
+	reached[start.y][start.x] = true;
+	queue[tail++] = start;
+	while (head < tail)
+	{
+		for (direction = UP; direction <= LEFT; direction++)
+		{
+			next = calculateNewHeadPosition(queue[head], (Direction)direction);
+			if (next.x < 0 || next.x >= ENV_WIDTH) continue;
+			if (reached[next.y][next.x] || isBitboardCell(blocked, next)) continue;
+			reached[next.y][next.x] = true;
+			queue[tail++] = next;
+		}
+		head++;
+	}
+	return tail;
+}
+
+static unsigned long checkShifts(void)
+{
+	BitboardType single;
+	BitboardType shifted;
+	BitboardType expected;
+	PointType cell;
+	PointType next;
+	unsigned long mismatched = 0;
+	int direction;
+	for (cell.y = 0; cell.y < ENV_HEIGHT; cell.y++)
+	{
+		for (cell.x = 0; cell.x < ENV_WIDTH; cell.x++)
+		{
+			for (direction = UP; direction <= LEFT; direction++)
+			{
+				clearBitboard(&single);
+				setBitboardCell(&single, cell);
+				shiftBitboard(&single, &shifted, (Direction)direction);
+				clearBitboard(&expected);
+				next = calculateNewHeadPosition(cell, (Direction)direction);
+				/* Off a sharded board, the cell is gone */
+				if (next.x >= 0 && next.x < ENV_WIDTH) setBitboardCell(&expected, next);
+				if (memcmp(&shifted, &expected, sizeof(expected)) != 0) mismatched++;
+			}
+		}
+	}
+	return mismatched;
+}
+
+static void buildCases(int count, int density)
+{
+	PointType walk;
+	PointType next;
+	int boardIndex;
+	int i;
+	int tries;
+	for (boardIndex = 0; boardIndex < count; boardIndex++)
+	{
+		BoardCaseType *board = &Cases[boardIndex];
+		clearBitboard(&board->blocked);
+		if (density > 0)
+		{
+			for (walk.y = 0; walk.y < ENV_HEIGHT; walk.y++)
+			{
+				for (walk.x = 0; walk.x < ENV_WIDTH; walk.x++)
+				{
+					if (xorshift() % 100 < (uint32_t)density) setBitboardCell(&board->blocked, walk);
+				}
+			}
+		}
+		else
+		{
+			/* A self avoiding walk that keeps its heading for a while, like a long snake */
+			walk = randomPoint();
+			setBitboardCell(&board->blocked, walk);
+			for (i = 1, tries = 0; i < BITBOARD_TEST_WALK && tries < BITBOARD_TEST_WALK * 8; tries++)
+			{
+				next = calculateNewHeadPosition(walk, (Direction)((xorshift() % 4 == 0 ? xorshift() : (uint32_t)i / 8) % 4));
+				if (next.x < 0 || next.x >= ENV_WIDTH || isBitboardCell(&board->blocked, next)) continue;
+				setBitboardCell(&board->blocked, next);
+				walk = next;
+				i++;
+			}
+		}
+		for (i = 0; i < BITBOARD_TEST_STARTS; i++)
+		{
+			do board->starts[i] = randomPoint(); while (isBitboardCell(&board->blocked, board->starts[i]) && density < 100);
+		}
+	}
+}
+
+static unsigned long checkFills(int count)
+{
+	static bool cells[ENV_HEIGHT][ENV_WIDTH];
+	BitboardType reached;
+	PointType cell;
+	unsigned long mismatched = 0;
+	int boardIndex;
+	int i;
+	for (boardIndex = 0; boardIndex < count; boardIndex++)
+	{
+		for (i = 0; i < BITBOARD_TEST_STARTS; i++)
+		{
+			if (floodFillBitboard(&Cases[boardIndex].blocked, Cases[boardIndex].starts[i], &reached) != fillCells(&Cases[boardIndex].blocked, Cases[boardIndex].starts[i], cells)) mismatched++;
+			for (cell.y = 0; cell.y < ENV_HEIGHT; cell.y++)
+			{
+				for (cell.x = 0; cell.x < ENV_WIDTH; cell.x++)
+				{
+					if (isBitboardCell(&reached, cell) != cells[cell.y][cell.x]) mismatched++;
+				}
+			}
+		}
+	}
+	return mismatched;
+}
+
+/* Best of three over the same boards and starts */
+static double timeFills(int count, bool bitboard, double *area)
+{
+	static bool cells[ENV_HEIGHT][ENV_WIDTH];
+	BitboardType reached;
+	unsigned long long best = 0;
+	unsigned long long start;
+	unsigned long long elapsed;
+	long total;
+	int boardIndex;
+	int repeat;
+	int i;
+	for (repeat = 0; repeat < 3; repeat++)
+	{
+		total = 0;
+		start = nowNs();
+		for (boardIndex = 0; boardIndex < count; boardIndex++)
+		{
+			for (i = 0; i < BITBOARD_TEST_STARTS; i++)
+			{
+				if (bitboard) total += floodFillBitboard(&Cases[boardIndex].blocked, Cases[boardIndex].starts[i], &reached);
+				else total += fillCells(&Cases[boardIndex].blocked, Cases[boardIndex].starts[i], cells);
+			}
+		}
+		elapsed = nowNs() - start;
+		if (repeat == 0 || elapsed < best) best = elapsed;
+		BitboardSink = (int)total;
+		*area = (double)total / count / BITBOARD_TEST_STARTS;
+	}
+	return (double)best / count / BITBOARD_TEST_STARTS;
+}
+
+/* Trap checks on positions of a long snake across the board, against one done cell by cell */
+static void timeTrapChecks(int count)
+{
+	static bool cells[ENV_HEIGHT][ENV_WIDTH];
+	BitboardType blocked;
+	unsigned long long start;
+	unsigned long long bitboardNs = 0;
+	unsigned long long cellNs = 0;
+	unsigned long traps = 0;
+	unsigned long disagreements = 0;
+	PointType next;
+	bool trap;
+	int boardIndex;
+	int direction;
+	int length;
+	int turn;
+	int i;
+	buildCases(count, 0);
+	for (boardIndex = 0; boardIndex < count; boardIndex++)
+	{
+		/* A winding snake from the board's first start, as GameState */
+		resetGameState();
+		length = 0;
+		GameState.snakePositions[length++] = Cases[boardIndex].starts[0];
+		for (i = 1; i < MAX_SNAKE_LENGTH - 1; i++)
+		{
+			turn = (int)(xorshift() % 3 == 0 ? xorshift() % 4 : (uint32_t)i / 6);
+			for (direction = UP; direction <= LEFT; direction++)
+			{
+				next = calculateNewHeadPosition(GameState.snakePositions[length - 1], (Direction)((direction + turn) % 4));
+				if (next.x < 0 || next.x >= ENV_WIDTH) continue;
+				GameState.snakeLength = length;
+				if (!isPositionFree(next)) continue;
+				GameState.snakePositions[length++] = next;
+				break;
+			}
+		}
+		GameState.snakeLength = length;
+		for (direction = UP; direction <= LEFT; direction++)
+		{
+			start = nowNs();
+			trap = isTrapMove((Direction)direction);
+			bitboardNs += nowNs() - start;
+			start = nowNs();
+			next = calculateNewHeadPosition(GameState.snakePositions[0], (Direction)direction);
+			buildObstacleBitboard(&blocked, false);
+			i = next.x >= 0 && next.x < ENV_WIDTH ? fillCells(&blocked, next, cells) : -1;
+			cellNs += nowNs() - start;
+			if (trap) traps++;
+			if (trap != (i >= 0 && i < GameState.snakeLength)) disagreements++;
+		}
+	}
+	printf("trap check, %d-cell snakes: bitboard %.0f ns, cell by cell %.0f ns per move, %lu of %d moves into the body or a trap, %lu disagreements\n",
+		MAX_SNAKE_LENGTH - 2, (double)bitboardNs / count / 4, (double)cellNs / count / 4, traps, count * 4, disagreements);
+}
+
+int main(int argc, char **argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : BITBOARD_TEST_BOARDS;
+	unsigned long mismatched = 0;
+	unsigned long failures;
+	double bitboardArea;
+	double cellArea;
+	double bitboardNs;
+	double cellNs;
+	unsigned int i;
+	int shards;
+	if (count < 1) count = BITBOARD_TEST_BOARDS;
+	Cases = malloc(sizeof(BoardCaseType) * (size_t)count);
+	printf("%dx%d world, %d bit rows, %d boards x %d fills per shape\n", ENV_WIDTH, ENV_HEIGHT, BITBOARD_ROW_BITS, count, BITBOARD_TEST_STARTS);
+	for (shards = 1; shards <= 2; shards++)
+	{
+		ShardCount = shards;
+		failures = checkShifts();
+		printf("%s columns: %lu of %d shifted cells off\n", shards == 1 ? "wrapping" : "sharded", failures, ENV_WIDTH * ENV_HEIGHT * 4);
+		mismatched += failures;
+		for (i = 0; i < sizeof(Shapes) / sizeof(Shapes[0]); i++)
+		{
+			buildCases(count, Shapes[i].density);
+			failures = checkFills(count);
+			mismatched += failures;
+			if (shards > 1)
+			{
+				if (failures > 0) printf("  %-14s %lu cells differ\n", Shapes[i].name, failures);
+				continue;
+			}
+			bitboardNs = timeFills(count, true, &bitboardArea);
+			cellNs = timeFills(count, false, &cellArea);
+			if (i == 0) printf("  %-14s %10s %12s %14s %8s %10s\n", "shape", "area", "bitboard ns", "cell by cell ns", "speedup", "mismatch");
+			printf("  %-14s %10.1f %12.0f %14.0f %7.1fx %10lu\n", Shapes[i].name, bitboardArea, bitboardNs, cellNs, cellNs / bitboardNs, failures);
+		}
+	}
+	ShardCount = 1;
+	timeTrapChecks(count);
+	printf(mismatched == 0 ? "bitboard fills reach the same cells as the search\n" : "bitboard check FAILED\n");
+	free(Cases);
+	return mismatched == 0 ? 0 : 1;
+}
@@ -0,0 +1,535 @@
+/* Host bot interface over shared memory rings.
+ *
+ * Every game is a forked process running the tick functions of main.c, as
+ * in batch, and talks to the bot processes through one channel in a shared
+ * mapping. A channel holds three single producer, single consumer rings:
+ *   inputs        the bot's key for the next tick, 'w' 's' 'd' 'a' or 0
+ *   observations  the state after every tick, written in place by the game
+ *                 and read in place by the bot
+ *   events        the rewards of a tick, before its observation
+ * The indices are free running, each on a cache line of its own, and only
+ * ever stored by one side with release and loaded by the other with
+ * acquire. Nothing is copied or serialized on the way and the hot path makes
+ * no system calls: a side that finds its ring empty polls BOT_SPIN times
+ * before it gives up the processor, which is only needed when there are
+ * more processes than cores.
+ *
+ * An observation is the board packed two cells a byte, the lower nibble
+ * first, row by row, with the values of BotCell, and a header with the step,
+ * episode, score, length, direction, head and normal power-up. A lost or
+ * won game is an event and the next observation is the start of the next
+ * episode, on a seed of its own.
+ *
+ * The bot is chooseBotKey's, worked out from the observation alone. Every
+ * game is first played in one process through a private channel, the game
+ * and the bot taking turns, and then through the shared rings with 1, 2, 4
+ * and so on games at once. Every game has to read the same observations and
+ * events both ways. Steps per second count the ticks of all games.
+ *
+ * Build and run from the repository root:
+ *   make -C host botring
+ *   host/botring [--games n] [--bots n] [--steps n]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+
+#define BOT_MAX_GAMES			64
+#define BOT_GAMES				8
+#define BOT_STEPS				100000	/* Ticks per game */
+#define BOT_RING_SLOTS			8		/* Per ring, a power of two */
+#define BOT_SPIN				256		/* Empty polls before a side yields */
+#define BOT_GRID_BYTES			((ENV_WIDTH * ENV_HEIGHT + 1) / 2)
+#define BOT_REWARD_LOST			-10
+#define BOT_REWARD_WON			10
+
+/* The entity kinds, then the snake */
+typedef enum
+{
+	BOT_CELL_FREE = ENTITY_FREE,
+	BOT_CELL_NORMAL_POWERUP = ENTITY_NORMAL_POWERUP,
+	BOT_CELL_SPECIAL_POWERUP = ENTITY_SPECIAL_POWERUP,
+	BOT_CELL_ENEMY = ENTITY_ENEMY,
+	BOT_CELL_SNAKE,
+	BOT_CELL_HEAD
+} BotCell;
+
+typedef enum
+{
+	BOT_EVENT_NORMAL_POWERUP,
+	BOT_EVENT_SPECIAL_POWERUP,
+	BOT_EVENT_LOST,
+	BOT_EVENT_WON
+} BotEventKind;
+
+typedef struct BotObservation
+{
+	uint32_t step;
+	uint16_t episode;
+	uint16_t score;
+	uint16_t length;
+	uint8_t direction;
+	uint8_t headX;
+	uint8_t headY;
+	int8_t normalX;				/* -1 when there is none */
+	int8_t normalY;
+	uint8_t cells[BOT_GRID_BYTES];
+} BotObservationType;
+
+typedef struct BotEvent
+{
+	uint32_t step;
+	uint16_t episode;
+	uint8_t kind;
+	int8_t reward;
+} BotEventType;
+
+typedef struct BotIndex
+{
+	uint32_t value;
+	char padding[60];
+} BotIndexType;
+
+typedef struct BotChannel
+{
+	BotIndexType inputHead;				/* Stored by the bot */
+	BotIndexType inputTail;				/* Stored by the game */
+	BotIndexType observationHead;		/* Stored by the game */
+	BotIndexType observationTail;		/* Stored by the bot */
+	BotIndexType eventHead;				/* Stored by the game */
+	BotIndexType eventTail;				/* Stored by the bot */
+	char inputs[BOT_RING_SLOTS];
+	BotObservationType observations[BOT_RING_SLOTS];
+	BotEventType events[BOT_RING_SLOTS];
+	/* Read by the parent once both sides are done */
+	uint32_t hash;						/* What the bot read */
+	uint32_t episodes;
+	long reward;
+	unsigned long gameYields;
+	unsigned long botYields;
+} __attribute__((aligned(64))) BotChannelType;
+
+/* The bot's side of a channel */
+typedef struct BotPlayer
+{
+	uint32_t state;
+	uint32_t hash;
+	long reward;
+	bool done;
+} BotPlayerType;
+
+typedef struct BotOptions
+{
+	int games;
+	int bots;
+	unsigned long steps;
+} BotOptionsType;
+
+BotOptionsType Options = {BOT_GAMES, 1, BOT_STEPS};
+uint32_t Hashes[BOT_MAX_GAMES];			/* Of the games played in one process */
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void *mapShared(size_t size)
+{
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+	{
+		perror("mmap");
+		exit(2);
+	}
+	return memory;
+}
+
+static uint32_t loadIndex(const BotIndexType *index)
+{
+	return __atomic_load_n(&index->value, __ATOMIC_ACQUIRE);
+}
+
+static void storeIndex(BotIndexType *index, uint32_t value)
+{
+	__atomic_store_n(&index->value, value, __ATOMIC_RELEASE);
+}
+
+/* Until the other side moves the index on from value */
+static void waitForIndex(const BotIndexType *index, uint32_t value, unsigned long *yields)
+{
+	int polls = 0;
+	while (loadIndex(index) == value)
+	{
+		if (++polls < BOT_SPIN) continue;
+		sched_yield();
+		(*yields)++;
+		polls = 0;
+	}
+}
+
+static void setObservationCell(BotObservationType *observation, PointType position, BotCell cell)
+{
+	int index = position.y * ENV_WIDTH + position.x;
+	int shift = (index & 1) * 4;
+	observation->cells[index >> 1] = (uint8_t)((observation->cells[index >> 1] & ~(0xF << shift)) | (cell << shift));
+}
+
+static BotCell observationCell(const BotObservationType *observation, PointType position)
+{
+	int index = position.y * ENV_WIDTH + position.x;
+	return (BotCell)((observation->cells[index >> 1] >> ((index & 1) * 4)) & 0xF);
+}
+
+/* Game side. The globals of main.c are this process's game */
+
+static uint32_t episodeSeed(int game, uint32_t episode)
+{
+	return (uint32_t)game * 2654435761u + episode * 40503u + 1;
+}
+
+static void startEpisode(int game, uint32_t episode, HostSpawnersType *spawners)
+{
+	resetGameState();
+	SnakeSpeed = INITIAL_SNAKE_SPEED;
+	seedRandomNumber((int)episodeSeed(game, episode));
+	resetHostSpawners(spawners);
+	runHostSpawners(spawners, (60000 / SnakeSpeed) / portTICK_RATE_MS);
+}
+
+/* The state packed straight into the next slot, snake over entities */
+static void publishObservation(BotChannelType *channel, uint32_t step, uint32_t episode, unsigned long *yields)
+{
+	uint32_t head = channel->observationHead.value;
+	BotObservationType *observation = &channel->observations[head & (BOT_RING_SLOTS - 1)];
+	PointType normal = findEntityPosition(ENTITY_NORMAL_POWERUP);
+	PointType special = findEntityPosition(ENTITY_SPECIAL_POWERUP);
+	PointType enemy = findEntityPosition(ENTITY_ENEMY);
+	int i;
+	if (head - loadIndex(&channel->observationTail) == BOT_RING_SLOTS) waitForIndex(&channel->observationTail, head - BOT_RING_SLOTS, yields);
+	memset(observation->cells, 0, BOT_GRID_BYTES);
+	if (normal.x >= 0) setObservationCell(observation, normal, BOT_CELL_NORMAL_POWERUP);
+	if (special.x >= 0) setObservationCell(observation, special, BOT_CELL_SPECIAL_POWERUP);
+	if (enemy.x >= 0) setObservationCell(observation, enemy, BOT_CELL_ENEMY);
+	for (i = GameState.snakeLength - 1; i >= 0; i--) setObservationCell(observation, GameState.snakePositions[i], i == 0 ? BOT_CELL_HEAD : BOT_CELL_SNAKE);
+	observation->step = step;
+	observation->episode = (uint16_t)episode;
+	observation->score = (uint16_t)score;
+	observation->length = (uint16_t)GameState.snakeLength;
+	observation->direction = (uint8_t)LastDirection;
+	observation->headX = (uint8_t)GameState.snakePositions[0].x;
+	observation->headY = (uint8_t)GameState.snakePositions[0].y;
+	observation->normalX = (int8_t)normal.x;
+	observation->normalY = (int8_t)normal.y;
+	storeIndex(&channel->observationHead, head + 1);
+}
+
+static void publishEvent(BotChannelType *channel, uint32_t step, uint32_t episode, BotEventKind kind, int reward, unsigned long *yields)
+{
+	uint32_t head = channel->eventHead.value;
+	BotEventType *event = &channel->events[head & (BOT_RING_SLOTS - 1)];
+	if (head - loadIndex(&channel->eventTail) == BOT_RING_SLOTS) waitForIndex(&channel->eventTail, head - BOT_RING_SLOTS, yields);
+	event->step = step;
+	event->episode = (uint16_t)episode;
+	event->kind = (uint8_t)kind;
+	event->reward = (int8_t)reward;
+	storeIndex(&channel->eventHead, head + 1);
+}
+
+/* One tick on the next key, false when the bot has none yet */
+static bool playStep(BotChannelType *channel, int game, uint32_t step, uint32_t *episode, HostSpawnersType *spawners, unsigned long *yields)
+{
+	uint32_t tail = channel->inputTail.value;
+	GameOutcomeType outcome;
+	int before = score;
+	char key;
+	if (loadIndex(&channel->inputHead) == tail) return false;
+	key = channel->inputs[tail & (BOT_RING_SLOTS - 1)];
+	storeIndex(&channel->inputTail, tail + 1);
+	if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+	outcome = snakeTick();
+	if (score - before >= 5) publishEvent(channel, step, *episode, BOT_EVENT_SPECIAL_POWERUP, score - before, yields);
+	else if (score > before) publishEvent(channel, step, *episode, BOT_EVENT_NORMAL_POWERUP, score - before, yields);
+	if (outcome != GAME_RUNNING)
+	{
+		publishEvent(channel, step, *episode, outcome == GAME_WON ? BOT_EVENT_WON : BOT_EVENT_LOST,
+			outcome == GAME_WON ? BOT_REWARD_WON : BOT_REWARD_LOST, yields);
+		while (UARTCharsAvail(UART0_BASE)) UARTCharGet(UART0_BASE);
+		startEpisode(game, ++*episode, spawners);
+	}
+	else runHostSpawners(spawners, (60000 / SnakeSpeed) / portTICK_RATE_MS);
+	publishObservation(channel, step, *episode, yields);
+	return true;
+}
+
+static void runGame(BotChannelType *channel, int game)
+{
+	HostSpawnersType spawners;
+	uint32_t episode = 0;
+	uint32_t step;
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	startEpisode(game, episode, &spawners);
+	publishObservation(channel, 0, episode, &channel->gameYields);
+	for (step = 1; step <= Options.steps; step++)
+	{
+		while (!playStep(channel, game, step, &episode, &spawners, &channel->gameYields))
+		{
+			waitForIndex(&channel->inputHead, channel->inputTail.value, &channel->gameYields);
+		}
+	}
+	channel->episodes = episode;
+}
+
+/* Bot side, reading nothing but the rings */
+
+static uint32_t hashWord(uint32_t hash, uint32_t word)
+{
+	return (hash ^ word) * 16777619u;
+}
+
+/* chooseBotKey on the observation: a random move onto a cell without the
+ * snake or the enemy, preferring ones that close in on the normal power-up */
+static char chooseRingKey(const BotObservationType *observation, uint32_t *botState)
+{
+	static const char keys[] = {'w', 's', 'd', 'a'};
+	PointType head;
+	PointType next;
+	BotCell cell;
+	int best = -1;
+	int bestScore = 0;
+	int points;
+	int direction;
+	head.x = observation->headX;
+	head.y = observation->headY;
+	for (direction = UP; direction <= LEFT; direction++)
+	{
+		next = calculateNewHeadPosition(head, (Direction)direction);
+		cell = observationCell(observation, next);
+		if (cell == BOT_CELL_SNAKE || cell == BOT_CELL_HEAD || cell == BOT_CELL_ENEMY) continue;
+		*botState ^= *botState << 13;
+		*botState ^= *botState >> 17;
+		*botState ^= *botState << 5;
+		points = (int)(*botState % 8) + 1;
+		if (observation->normalX >= 0) points += 32 - abs(next.x - observation->normalX) - abs(next.y - observation->normalY);
+		if (points > bestScore)
+		{
+			bestScore = points;
+			best = direction;
+		}
+	}
+	return best < 0 ? 0 : keys[best];
+}
+
+/* The events and the observation of a tick, answered with the next key.
+ * False when the game has not got that far yet */
+static bool answerChannel(BotChannelType *channel, BotPlayerType *player)
+{
+	uint32_t tail = channel->observationTail.value;
+	uint32_t eventTail = channel->eventTail.value;
+	uint32_t eventHead;
+	uint32_t inputHead;
+	const BotObservationType *observation;
+	const BotEventType *event;
+	if (loadIndex(&channel->observationHead) == tail) return false;
+	/* The events of a tick are published before its observation */
+	eventHead = loadIndex(&channel->eventHead);
+	for ( ; eventTail != eventHead; eventTail++)
+	{
+		event = &channel->events[eventTail & (BOT_RING_SLOTS - 1)];
+		player->reward += event->reward;
+		player->hash = hashWord(player->hash, event->step << 8 | event->kind);
+	}
+	storeIndex(&channel->eventTail, eventTail);
+	observation = &channel->observations[tail & (BOT_RING_SLOTS - 1)];
+	player->hash = hashWord(player->hash, observation->step);
+	player->hash = hashWord(player->hash, (uint32_t)observation->score << 16 | observation->length);
+	player->hash = hashWord(player->hash, (uint32_t)observation->headX << 8 | observation->headY);
+	if (observation->step == Options.steps) player->done = true;
+	else
+	{
+		inputHead = channel->inputHead.value;
+		channel->inputs[inputHead & (BOT_RING_SLOTS - 1)] = chooseRingKey(observation, &player->state);
+		storeIndex(&channel->inputHead, inputHead + 1);
+	}
+	storeIndex(&channel->observationTail, tail + 1);
+	return true;
+}
+
+static void resetPlayer(BotPlayerType *player, int game)
+{
+	player->state = (uint32_t)game * 2246822519u + 1;
+	player->hash = 2166136261u;
+	player->reward = 0;
+	player->done = false;
+}
+
+/* The games bot + k * bots, round and round until each has sent its last step */
+static void runBot(BotChannelType *channels, int bot)
+{
+	BotPlayerType players[BOT_MAX_GAMES];
+	unsigned long yields = 0;
+	int remaining = 0;
+	int idle = 0;
+	int game;
+	for (game = bot; game < Options.games; game += Options.bots)
+	{
+		resetPlayer(&players[game], game);
+		remaining++;
+	}
+	while (remaining > 0)
+	{
+		idle++;
+		for (game = bot; game < Options.games; game += Options.bots)
+		{
+			if (players[game].done || !answerChannel(&channels[game], &players[game])) continue;
+			idle = 0;
+			if (players[game].done) remaining--;
+		}
+		if (idle < BOT_SPIN) continue;
+		sched_yield();
+		yields++;
+		idle = 0;
+	}
+	for (game = bot; game < Options.games; game += Options.bots)
+	{
+		channels[game].hash = players[game].hash;
+		channels[game].reward = players[game].reward;
+	}
+	channels[bot].botYields = yields;
+}
+
+/* Each game in turn with its bot in this process, through a private channel */
+static double runInProcess(void)
+{
+	BotChannelType *channel = malloc(sizeof(BotChannelType));
+	HostSpawnersType spawners;
+	BotPlayerType player;
+	unsigned long long start = nowNs();
+	unsigned long yields = 0;
+	uint32_t episode;
+	uint32_t step;
+	int game;
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	for (game = 0; game < Options.games; game++)
+	{
+		memset(channel, 0, sizeof(BotChannelType));
+		resetPlayer(&player, game);
+		episode = 0;
+		startEpisode(game, episode, &spawners);
+		publishObservation(channel, 0, episode, &yields);
+		for (step = 1; step <= Options.steps; step++)
+		{
+			answerChannel(channel, &player);
+			playStep(channel, game, step, &episode, &spawners, &yields);
+		}
+		answerChannel(channel, &player);
+		Hashes[game] = player.hash;
+	}
+	free(channel);
+	return (double)Options.steps * Options.games / ((nowNs() - start) / 1e9);
+}
+
+/* games game processes and up to bots bot processes on one mapping, false when a game read something else */
+static bool runShared(int games, int bots)
+{
+	BotChannelType *channels = mapShared(sizeof(BotChannelType) * (size_t)games);
+	int saved[2] = {Options.games, Options.bots};
+	unsigned long long start;
+	unsigned long long elapsed;
+	unsigned long gameYields = 0;
+	unsigned long botYields = 0;
+	unsigned long episodes = 0;
+	long reward = 0;
+	bool matched = true;
+	pid_t child;
+	int process;
+	int game;
+	Options.games = games;
+	Options.bots = bots < games ? bots : games;
+	start = nowNs();
+	for (process = 0; process < games + Options.bots; process++)
+	{
+		child = fork();
+		if (child == 0)
+		{
+			if (process < games) runGame(&channels[process], process);
+			else runBot(channels, process - games);
+			_exit(0);
+		}
+		if (child < 0)
+		{
+			perror("fork");
+			exit(2);
+		}
+	}
+	while (wait(NULL) > 0);
+	elapsed = nowNs() - start;
+	for (game = 0; game < games; game++)
+	{
+		if (channels[game].hash != Hashes[game]) matched = false;
+		gameYields += channels[game].gameYields;
+		botYields += channels[game].botYields;
+		episodes += channels[game].episodes;
+		reward += channels[game].reward;
+	}
+	printf("%-10s %5d %5d %11.0f %9.1f %11.4f %9lu %10.2f\n", "rings", games, Options.bots, (double)Options.steps * games / (elapsed / 1e9),
+		elapsed / ((double)Options.steps * games), (double)(gameYields + botYields) / ((double)Options.steps * games), episodes,
+		(double)reward / (episodes + games));
+	munmap(channels, sizeof(BotChannelType) * (size_t)games);
+	Options.games = saved[0];
+	Options.bots = saved[1];
+	return matched;
+}
+
+static bool parseOptions(int argc, char **argv)
+{
+	int i;
+	for (i = 1; i < argc; i++)
+	{
+		if (i + 1 == argc) return false;
+		else if (strcmp(argv[i], "--games") == 0) Options.games = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bots") == 0) Options.bots = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--steps") == 0) Options.steps = strtoul(argv[++i], NULL, 10);
+		else return false;
+	}
+	return Options.games >= 1 && Options.games <= BOT_MAX_GAMES && Options.bots >= 1 && Options.steps > 0;
+}
+
+int main(int argc, char **argv)
+{
+	bool matched = true;
+	double rate;
+	int games;
+	if (!parseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: %s [--games n] [--bots n] [--steps n]\n", argv[0]);
+		return 2;
+	}
+	setvbuf(stdout, NULL, _IONBF, 0);
+	printf("%dx%d board, %u byte observations, %lu steps a game, %d online cores\n", ENV_WIDTH, ENV_HEIGHT,
+		(unsigned int)sizeof(BotObservationType), Options.steps, (int)sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%-10s %5s %5s %11s %9s %11s %9s %10s\n", "mode", "games", "bots", "steps/s", "ns/step", "yields/step", "episodes", "reward/ep");
+	rate = runInProcess();
+	printf("%-10s %5d %5s %11.0f %9.1f %11s %9s %10s\n", "in process", Options.games, "-", rate, 1e9 / rate, "-", "-", "-");
+	for (games = 1; games <= Options.games; games = games < Options.games && games * 2 > Options.games ? Options.games : games * 2)
+	{
+		if (!runShared(games, Options.bots)) matched = false;
+	}
+	printf("%s\n", matched ? "every game read the same observations and events through the rings" : "games went differently through the rings");
+	return matched ? 0 : 1;
+}
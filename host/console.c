@@ -0,0 +1,231 @@
+/* Host stand-in for the UART1 diagnostics console.
+ *
+ * A bot plays games in real time through the functions main.c's tasks call,
+ * while the console reads and writes a pseudo terminal in place of UART1.
+ * Attach with any terminal program, for instance screen <pty>. With --script
+ * the ';' separated commands are run every CONSOLE_SCRIPT_TICKS ticks of one
+ * game played as fast as possible and the replies go to stdout, which is what
+ * the console looks like without a board, after a check that the main menu
+ * waits for its key where the idle task can run. Either way the run fails if
+ * the console ever writes to the game UART.
+ *
+ * Build and run from the repository root:
+ *   make -C host console
+ *   host/console
+ *   host/console --script "state;pause;step 3;state;speed 200;resume;queues;tasks"
+ */
+
+/* posix_openpt and friends */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+
+#define CONSOLE_SCRIPT_TICKS	20
+#define CONSOLE_SCRIPT_MAX_TICKS	2000
+
+int ConsoleFd = -1;
+unsigned long ConsoleGameUartBytes = 0;
+uint32_t BotState = 1;
+uint32_t GameSeed = 1;
+HostSpawnersType Spawners;
+unsigned long GameClock = 0;
+int MenuPolls;
+
+static void writeConsoleOutput(uint32_t base, unsigned char data)
+{
+	if (base != CONSOLE_UART_BASE) return;
+	if (ConsoleFd >= 0)
+	{
+		if (write(ConsoleFd, &data, 1) != 1) ConsoleFd = -1;
+	}
+	else putchar(data);
+}
+
+/* RenderTask is not running, so requests are drawn as soon as they are sent */
+static void renderImmediately(QueueHandle_t queue, const void *item)
+{
+	if (queue == RenderQueue) renderRequest((const RenderRequestType *)item);
+}
+
+static void feedConsole(char c)
+{
+	unsigned long gameBytes = HostUartTxCount[0];
+	processConsoleChar(c);
+	ConsoleGameUartBytes += HostUartTxCount[0] - gameBytes;
+}
+
+static void startGame(void)
+{
+	RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	resetGameState();
+	SnakeSpeed = INITIAL_SNAKE_SPEED;
+	BotState = GameSeed * 2654435761u + 1;
+	seedRandomNumber(GameSeed++);
+	resetHostSpawners(&Spawners);
+	GameClock = 0;
+	renderRequest(&gameStartRenderRequest);
+	inGame = true;
+}
+
+/* One period of the snake task, honouring a pause or single steps like waitForGameTick */
+static void playTick(void)
+{
+	RenderRequestType timeUpdateRenderRequest = RENDER_REQUEST(TIME_UPDATE);
+	unsigned long period = (60000 / SnakeSpeed) / portTICK_RATE_MS;
+	char key;
+	HostTickCount += period;
+	if (GameTickPaused && !takeGameTickStep()) return;
+	key = chooseBotKey(&BotState);
+	if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+	if (snakeTick() != GAME_RUNNING)
+	{
+		startGame();
+		return;
+	}
+	runHostSpawners(&Spawners, period);
+	for (GameClock += period; GameClock >= 1000; GameClock -= 1000)
+	{
+		gameTime++;
+		renderRequest(&timeUpdateRenderRequest);
+	}
+}
+
+/* The main menu's key arrives on the third poll */
+static void pressMenuKeyLater(uint32_t ticks)
+{
+	(void)ticks;
+	if (++MenuPolls == 3) hostUartPushRx(UART0_BASE, "e", 1);
+}
+
+/* Whether the main menu waits for a key in vTaskDelay, where the idle task runs, rather than spinning on the UART */
+static bool isMenuKeyWaitIdle(void)
+{
+	TickType_t start = HostTickCount;
+	char key;
+	MenuPolls = 0;
+	HostDelayHook = pressMenuKeyLater;
+	key = waitForMenuKey();
+	HostDelayHook = NULL;
+	return key == 'e' && MenuPolls == 3 && HostTickCount - start == 3 * (MENU_KEY_POLL / portTICK_RATE_MS);
+}
+
+static unsigned long long nowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000ULL + (unsigned long long)ts.tv_nsec / 1000000ULL;
+}
+
+static int runScript(const char *script)
+{
+	const char *c;
+	unsigned long ticks = 0;
+	if (!isMenuKeyWaitIdle())
+	{
+		printf("the main menu did not wait for its key in vTaskDelay\n");
+		return 1;
+	}
+	startGame();
+	for (c = script; ; c++)
+	{
+		if (*c == ';' || *c == 0)
+		{
+			feedConsole('\r');
+			for (ticks = 0; ticks < CONSOLE_SCRIPT_TICKS; ticks++) playTick();
+			if (*c == 0) break;
+		}
+		else feedConsole(*c);
+	}
+	printf("\ngame UART bytes written by the console: %lu\n", ConsoleGameUartBytes);
+	return ConsoleGameUartBytes == 0 ? 0 : 1;
+}
+
+static int runPty(void)
+{
+	struct pollfd pollFd;
+	struct termios settings;
+	int slaveFd;
+	unsigned long long nextTick;
+	unsigned long long now;
+	char buffer[64];
+	ssize_t length;
+	ssize_t i;
+	
+	ConsoleFd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (ConsoleFd < 0 || grantpt(ConsoleFd) != 0 || unlockpt(ConsoleFd) != 0)
+	{
+		perror("posix_openpt");
+		return 2;
+	}
+	/* Raw, like a UART, so the line discipline does not echo the console's own output back at it.
+	 * Keeping this end open also stops reads failing before a terminal attaches */
+	slaveFd = open(ptsname(ConsoleFd), O_RDWR | O_NOCTTY);
+	if (slaveFd < 0 || tcgetattr(slaveFd, &settings) != 0)
+	{
+		perror("pty");
+		return 2;
+	}
+	cfmakeraw(&settings);
+	tcsetattr(slaveFd, TCSANOW, &settings);
+	printf("console on %s, attach with: screen %s 115200\n", ptsname(ConsoleFd), ptsname(ConsoleFd));
+	fflush(stdout);
+	startGame();
+	feedConsole('\r');
+	nextTick = nowMs();
+	for ( ;; )
+	{
+		now = nowMs();
+		pollFd.fd = ConsoleFd;
+		pollFd.events = POLLIN;
+		pollFd.revents = 0;
+		if (poll(&pollFd, 1, nextTick > now ? (int)(nextTick - now) : 0) > 0)
+		{
+			length = read(ConsoleFd, buffer, sizeof(buffer));
+			for (i = 0; i < length; i++) feedConsole(buffer[i]);
+		}
+		if (nowMs() >= nextTick)
+		{
+			playTick();
+			nextTick += (60000 / SnakeSpeed) / portTICK_RATE_MS;
+		}
+		if (ConsoleGameUartBytes != 0)
+		{
+			fprintf(stderr, "console wrote %lu bytes to the game UART\n", ConsoleGameUartBytes);
+			return 1;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	NormalPowerUpSemaphore = xSemaphoreCreateBinary();
+	ConsoleRxQueue = xQueueCreate(CONSOLE_RX_QUEUE_LENGTH, sizeof(char));
+	/* Registered so the tasks command has something to list */
+	xTaskCreate(MainMenuTask, "Main Menu", 256, NULL, 1, &MainMenuTaskHandle);
+	xTaskCreate(RenderTask, "Render", 256, NULL, 2, &RenderTaskHandle);
+	xTaskCreate(ConsoleTask, "Console", 256, NULL, 1, &ConsoleTaskHandle);
+	xTaskCreate(SnakePositionUpdateTask, "Snake", 256, NULL, 4, &SnakePositionUpdateTaskHandle);
+	HostQueueSendHook = renderImmediately;
+	HostUartTxHook = writeConsoleOutput;
+	
+	if (argc > 2 && strcmp(argv[1], "--script") == 0) return runScript(argv[2]);
+	return runPty();
+}
@@ -0,0 +1,191 @@
+/* Host endurance run for the high score log.
+ *
+ * Plays a long series of game results into storeHighScore against the host
+ * EEPROM stand-in and checks the table against a reference after every game.
+ * Power is cut part way through a write at random and the table rebuilt from
+ * EEPROM as on boot, where the game being written may or may not survive but
+ * nothing older may be lost. Reports the per word program cycles against the
+ * 500k cycle rating of the TM4C123 EEPROM and the cost of the boot scan.
+ *
+ * Two score patterns are played: "random" draws scores the way real games end
+ * up, "worst" makes every single game a new best so that every game is written.
+ *
+ * Build and run from the repository root:
+ *   make -C host endurance
+ *   host/endurance [games]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../highScore.h"
+#include "stubs/host_stubs.h"
+
+#define EEPROM_ENDURANCE		500000UL
+#define POWER_FAIL_ONE_IN		50
+#define CLEAN_BOOT_PERIOD		1000
+
+typedef struct ReferenceEntry
+{
+	uint16_t score;
+	uint16_t time;
+} ReferenceEntryType;
+
+ReferenceEntryType Reference[HIGH_SCORE_ENTRIES];
+int ReferenceCount;
+uint32_t RandomSeed = 1;
+
+static uint32_t nextRandom(void)
+{
+	RandomSeed ^= RandomSeed << 13;
+	RandomSeed ^= RandomSeed >> 17;
+	RandomSeed ^= RandomSeed << 5;
+	return RandomSeed;
+}
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/* Same ordering as the firmware, ties keep the older entry first */
+static void insertReference(ReferenceEntryType *table, int *count, uint16_t score, uint16_t time)
+{
+	int i;
+	if (score == 0) return;
+	if (*count == HIGH_SCORE_ENTRIES)
+	{
+		if (score < table[*count - 1].score || (score == table[*count - 1].score && time >= table[*count - 1].time)) return;
+		(*count)--;
+	}
+	for (i = *count; i > 0 && (score > table[i - 1].score || (score == table[i - 1].score && time < table[i - 1].time)); i--) table[i] = table[i - 1];
+	table[i].score = score;
+	table[i].time = time;
+	(*count)++;
+}
+
+static bool matchesTable(const ReferenceEntryType *table, int count)
+{
+	int i;
+	if (count != HighScoreCount) return false;
+	for (i = 0; i < count; i++)
+	{
+		if (table[i].score != HighScoreTable[i].score || table[i].time != HighScoreTable[i].time) return false;
+	}
+	return true;
+}
+
+static bool runPattern(const char *name, bool worst, unsigned long games)
+{
+	unsigned long long bootNs = 0;
+	unsigned long long maxBootNs = 0;
+	unsigned long boots = 0;
+	unsigned long bootReads = 0;
+	unsigned long powerFails = 0;
+	unsigned long tornSurvived = 0;
+	unsigned long stored = 0;
+	unsigned long totalWrites = 0;
+	unsigned long maxWrites = 0;
+	unsigned long usedWords = 0;
+	unsigned long long start;
+	unsigned long elapsed;
+	unsigned long reads;
+	unsigned long game;
+	ReferenceEntryType withGame[HIGH_SCORE_ENTRIES];
+	int withGameCount;
+	bool poweredOff;
+	HighScoreRecordType record;
+	int i;
+	
+	hostEepromErase();
+	hostEepromPowerOn();
+	initializeHighScores();
+	ReferenceCount = 0;
+	for (game = 0; game < games; game++)
+	{
+		memset(&record, 0, sizeof(record));
+		if (worst)
+		{
+			/* Every game beats the best so far, on score or on a shorter time at the same score */
+			record.score = (uint16_t)(1 + game / 2);
+			record.time = (uint16_t)(game % 2 ? 99 : 100);
+		}
+		else
+		{
+			record.score = (uint16_t)(nextRandom() % (MAX_SNAKE_LENGTH - INITIAL_SNAKE_LENGTH + 1));
+			record.time = (uint16_t)(10 + nextRandom() % 300);
+		}
+		record.speed = INITIAL_SNAKE_SPEED;
+		record.length = (uint8_t)(INITIAL_SNAKE_LENGTH + record.score);
+		memcpy(withGame, Reference, sizeof(Reference));
+		withGameCount = ReferenceCount;
+		insertReference(withGame, &withGameCount, record.score, record.time);
+		
+		if (nextRandom() % POWER_FAIL_ONE_IN == 0) HostEepromPowerFailAfter = 1 + nextRandom() % HIGH_SCORE_RECORD_WORDS;
+		if (storeHighScore(&record)) stored++;
+		
+		poweredOff = hostEepromPoweredOff();
+		if (poweredOff || game % CLEAN_BOOT_PERIOD == 0)
+		{
+			if (poweredOff) powerFails++;
+			hostEepromPowerOn();
+			reads = HostEepromReads;
+			start = nowNs();
+			loadHighScores();
+			elapsed = (unsigned long)(nowNs() - start);
+			bootNs += elapsed;
+			if (elapsed > maxBootNs) maxBootNs = elapsed;
+			bootReads = HostEepromReads - reads;
+			boots++;
+			/* The game in flight may be lost, anything already stored may not */
+			if (matchesTable(withGame, withGameCount))
+			{
+				if (poweredOff && !matchesTable(Reference, ReferenceCount)) tornSurvived++;
+				memcpy(Reference, withGame, sizeof(Reference));
+				ReferenceCount = withGameCount;
+			}
+			else if (!matchesTable(Reference, ReferenceCount))
+			{
+				printf("%s: table lost entries after reboot at game %lu\n", name, game);
+				return false;
+			}
+		}
+		else
+		{
+			/* A write still pending from a cancelled power failure does not count */
+			HostEepromPowerFailAfter = 0;
+			memcpy(Reference, withGame, sizeof(Reference));
+			ReferenceCount = withGameCount;
+			if (!matchesTable(Reference, ReferenceCount))
+			{
+				printf("%s: table differs from reference at game %lu\n", name, game);
+				return false;
+			}
+		}
+	}
+	
+	for (i = 0; i < HOST_EEPROM_WORDS; i++)
+	{
+		totalWrites += HostEepromWrites[i];
+		if (HostEepromWrites[i] > maxWrites) maxWrites = HostEepromWrites[i];
+		if (HostEepromWrites[i] != 0) usedWords++;
+	}
+	printf("%-7s games=%lu stored=%lu power_fails=%lu torn_survived=%lu boots=%lu\n", name, games, stored, powerFails, tornSurvived, boots);
+	printf("        words_written=%lu/%d max_cycles=%lu mean_cycles=%.1f rating_used=%.3f%% games_to_rating=%.0f\n",
+		usedWords, HOST_EEPROM_WORDS, maxWrites, usedWords ? (double)totalWrites / usedWords : 0.0,
+		100.0 * maxWrites / EEPROM_ENDURANCE, maxWrites ? (double)games * EEPROM_ENDURANCE / maxWrites : 0.0);
+	printf("        boot_words_read=%lu boot_ns_avg=%.0f boot_ns_max=%llu\n", bootReads, boots ? (double)bootNs / boots : 0.0, maxBootNs);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long games = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+	bool passed = runPattern("random", false, games);
+	passed = runPattern("worst", true, games) && passed;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+/* Host check and benchmark of the entity table.
+ *
+ * Entities are added and removed at random and every cell of the board is
+ * looked up after each change, findEntity has to agree with a plain grid of
+ * what was put where and findEntityOfKind with the kinds in the pool. Then
+ * the snake is run along its starting row, which is kept clear, with 1, 50
+ * and 500 entities on the rest of the board, timing whole ticks, spawns and
+ * the lookup of the new head cell against a scan of every entity in the
+ * pool, which is how the tick would grow if each one was still compared with
+ * the head on its own.
+ *
+ * Build and run from the repository root, on a board with room for them:
+ *   make -C host entity
+ *   host/entity
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+
+#define ENTITY_TEST_CHANGES		20000
+#define ENTITY_TEST_TICKS		2000000UL
+#define ENTITY_TEST_LOOKUPS		2000000UL
+
+volatile int EntitySink;
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+EntityType LiveEntities[ENTITY_POOL_SIZE];
+int LiveEntityCount;
+
+/* The entities of the pool side by side, as separate fields of the game state would be */
+static void gatherLiveEntities(void)
+{
+	int i;
+	LiveEntityCount = 0;
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		if (EntityPool[i].kind != ENTITY_FREE) LiveEntities[LiveEntityCount++] = EntityPool[i];
+	}
+}
+
+/* Every entity compared with the cell */
+static EntityKind scanEntities(PointType position)
+{
+	int i;
+	for (i = 0; i < LiveEntityCount; i++)
+	{
+		if (LiveEntities[i].position.x == position.x && LiveEntities[i].position.y == position.y) return (EntityKind)LiveEntities[i].kind;
+	}
+	return ENTITY_FREE;
+}
+
+/* findEntityOfKind gives an entity of the kind, and none only when the pool holds none */
+static bool isKindFound(EntityKind kind)
+{
+	EntityIndexType index = findEntityOfKind(kind);
+	int i;
+	if (index != ENTITY_NONE) return EntityPool[index].kind == kind;
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		if (EntityPool[i].kind == kind) return false;
+	}
+	return true;
+}
+
+/* Random changes to the table against a grid of the same entities, the number of lookups that disagreed */
+static unsigned long checkEntities(void)
+{
+	static EntityIndexType grid[ENV_HEIGHT][ENV_WIDTH];
+	unsigned long faults = 0;
+	PointType position;
+	EntityIndexType index;
+	int change;
+	int kind;
+	int x;
+	int y;
+	resetEntities();
+	for (y = 0; y < ENV_HEIGHT; y++) for (x = 0; x < ENV_WIDTH; x++) grid[y][x] = ENTITY_NONE;
+	for (change = 0; change < ENTITY_TEST_CHANGES; change++)
+	{
+		position = generateRandomPosition();
+		if (grid[position.y][position.x] != ENTITY_NONE)
+		{
+			removeEntity(grid[position.y][position.x]);
+			grid[position.y][position.x] = ENTITY_NONE;
+		}
+		else
+		{
+			index = addEntity((EntityKind)(ENTITY_NORMAL_POWERUP + change % 3), position, ENTITY_NO_EXPIRY);
+			if (index == ENTITY_NONE && EntityCount < ENTITY_POOL_SIZE) faults++;
+			grid[position.y][position.x] = index;
+		}
+		if (change % 64 != 0) continue;
+		for (y = 0; y < ENV_HEIGHT; y++)
+		{
+			for (x = 0; x < ENV_WIDTH; x++)
+			{
+				position.x = x;
+				position.y = y;
+				if (findEntity(position) != grid[y][x]) faults++;
+			}
+		}
+		for (kind = ENTITY_NORMAL_POWERUP; kind < ENTITY_KINDS; kind++)
+		{
+			if (!isKindFound((EntityKind)kind)) faults++;
+		}
+	}
+	return faults;
+}
+
+/* The normal power-up and count - 1 enemies, none of them on the row the snake runs along */
+static void placeEntities(int count)
+{
+	PointType position;
+	int i;
+	resetGameState();
+	for (i = 0; i < count; i++)
+	{
+		do
+		{
+			position = generateFreePosition();
+		} while (position.y == ENV_HEIGHT / 2);
+		addEntity(i == 0 ? ENTITY_NORMAL_POWERUP : ENTITY_ENEMY, position, ENTITY_NO_EXPIRY);
+	}
+}
+
+/* The number of faults, ticks the snake did not survive and lookups the two ways disagreed on */
+static unsigned long benchEntities(int count)
+{
+	unsigned long long start;
+	unsigned long long tickNs;
+	unsigned long long spawnNs;
+	unsigned long long findNs;
+	unsigned long long scanNs;
+	unsigned long n;
+	unsigned long lost = 0;
+	int sum = 0;
+	int findSum = 0;
+	int scanSum = 0;
+	PointType position;
+	placeEntities(count);
+	start = nowNs();
+	for (n = 0; n < ENTITY_TEST_TICKS; n++)
+	{
+		if (advanceSnake() != GAME_RUNNING) lost++;
+	}
+	tickNs = nowNs() - start;
+	start = nowNs();
+	for (n = 0; n < ENTITY_TEST_LOOKUPS / 16; n++) sum += generateFreePosition().x;
+	spawnNs = nowNs() - start;
+	start = nowNs();
+	for (n = 0; n < ENTITY_TEST_LOOKUPS; n++)
+	{
+		position.x = n % ENV_WIDTH;
+		position.y = (n / ENV_WIDTH) % ENV_HEIGHT;
+		findSum += entityKindAt(position);
+	}
+	findNs = nowNs() - start;
+	gatherLiveEntities();
+	start = nowNs();
+	for (n = 0; n < ENTITY_TEST_LOOKUPS; n++)
+	{
+		position.x = n % ENV_WIDTH;
+		position.y = (n / ENV_WIDTH) % ENV_HEIGHT;
+		scanSum += scanEntities(position);
+	}
+	scanNs = nowNs() - start;
+	EntitySink = sum;
+	printf("%8d %12.1f %12.1f %12.1f %12.1f %8lu\n", EntityCount, (double)tickNs / ENTITY_TEST_TICKS,
+		(double)spawnNs / (ENTITY_TEST_LOOKUPS / 16), (double)findNs / ENTITY_TEST_LOOKUPS, (double)scanNs / ENTITY_TEST_LOOKUPS, lost);
+	return lost + (findSum != scanSum);
+}
+
+int main(void)
+{
+	static const int counts[] = {1, 50, 500};
+	unsigned long faults;
+	int i;
+	seedRandomNumber(12345);
+	faults = checkEntities();
+	printf("%dx%d board, %d entities in %d buckets, %d bytes of table, %lu faults\n", ENV_WIDTH, ENV_HEIGHT,
+		ENTITY_POOL_SIZE, ENTITY_HASH_SIZE, (int)(sizeof(EntityPool) + sizeof(EntityBuckets)), faults);
+	printf("%8s %12s %12s %12s %12s %8s\n", "entities", "ns per tick", "ns per spawn", "ns find", "ns scan", "lost");
+	for (i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+	{
+		if (counts[i] > ENTITY_POOL_SIZE || counts[i] > ENV_WIDTH * ENV_HEIGHT / 2) continue;
+		faults += benchEntities(counts[i]);
+	}
+	printf(faults == 0 ? "every lookup found what was put there\n" : "entity check FAILED\n");
+	return faults == 0 ? 0 : 1;
+}
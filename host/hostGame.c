@@ -0,0 +1,51 @@
+/* Bot and spawner schedule for the host tools that play whole games by
+ * calling the tick functions of main.c directly. */
+
+#include <stdlib.h>
+
+#include "hostGame.h"
+#include "../entity.h"
+
+/* Picks a random move that survives the next tick, preferring ones that close in on the normal power-up */
+char chooseBotKey(uint32_t *botState)
+{
+	static const char keys[] = {'w', 's', 'd', 'a'};
+	PointType head = GameState.snakePositions[0];
+	PointType normal = findEntityPosition(ENTITY_NORMAL_POWERUP);
+	PointType next;
+	int best = -1;
+	int bestScore = 0;
+	int score;
+	int direction;
+	for (direction = UP; direction <= LEFT; direction++)
+	{
+		next = calculateNewHeadPosition(head, (Direction)direction);
+		if (isSnakeCollision(next)) continue;
+		if (entityKindAt(next) == ENTITY_ENEMY) continue;
+		*botState ^= *botState << 13;
+		*botState ^= *botState >> 17;
+		*botState ^= *botState << 5;
+		score = (int)(*botState % 8) + 1;
+		if (normal.x >= 0) score += 32 - abs(next.x - normal.x) - abs(next.y - normal.y);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = direction;
+		}
+	}
+	return best < 0 ? 0 : keys[best];
+}
+
+void resetHostSpawners(HostSpawnersType *spawners)
+{
+	spawners->elapsed = 0;
+	resetEntitySchedule(0);
+}
+
+/* The EntityTask for one tick of the given period, its schedule run at the game clock */
+void runHostSpawners(HostSpawnersType *spawners, unsigned long period)
+{
+	if (findEntityOfKind(ENTITY_NORMAL_POWERUP) == ENTITY_NONE) spawnNormalPowerUp();
+	runEntitySchedule((portTickType)(spawners->elapsed / portTICK_RATE_MS));
+	spawners->elapsed += period;
+}
@@ -0,0 +1,17 @@
+#ifndef HOST_GAME_H
+#define HOST_GAME_H
+
+#include "../game.h"
+
+/* Game clock of a headless game in milliseconds, the expiries in the entity table are on it */
+typedef struct HostSpawners
+{
+	unsigned long elapsed;
+} HostSpawnersType;
+
+/* Helpers shared by the host tools that play games without the scheduler */
+char chooseBotKey(uint32_t *botState);
+void resetHostSpawners(HostSpawnersType *spawners);
+void runHostSpawners(HostSpawnersType *spawners, unsigned long period);
+
+#endif /* HOST_GAME_H */
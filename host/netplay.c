@@ -0,0 +1,509 @@
+/* Host test of two-board netplay over a lossy link.
+ *
+ * Two boards are forked, each with its UART2 on the slave side of its own
+ * pseudo terminal and a bot on its keyboard. The parent is the cable: it
+ * relays what one master side reads to the other, holding every chunk back
+ * by the link latency plus jitter and dropping whole chunks with the loss
+ * probability, which also cuts packets in half. The boards run the netplay
+ * tick against real time, connect, play, linger and connect again for the
+ * next game. After every tick a board checks that its screen shows its
+ * state, at the end it replays the confirmed inputs from the seed. The two
+ * boards have to agree on every input, on the final state and on who won.
+ *
+ * Build and run from the repository root:
+ *   make -C host netplay
+ *   host/netplay [games] [tick ms]
+ */
+
+/* posix_openpt and friends */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "../netplay.h"
+#include "stubs/host_stubs.h"
+
+#define NETPLAY_TEST_MAX_TICKS		3000
+#define NETPLAY_TEST_GAMES			3
+#define NETPLAY_TEST_PERIOD			20		/* ms per tick, compressed from a second so a run stays short */
+#define NETPLAY_TEST_CHUNKS			4096
+#define NETPLAY_TEST_CHUNK_SIZE		256
+
+typedef struct LinkScenario
+{
+	unsigned int latency;		/* ms each way */
+	unsigned int jitter;		/* ms, added to the latency at random */
+	unsigned int loss;			/* Chunks dropped per thousand */
+} LinkScenarioType;
+
+static const LinkScenarioType Scenarios[] =
+{
+	{0, 0, 0},
+	{30, 10, 0},
+	{80, 20, 0},
+	{0, 0, 100},
+	{30, 10, 100},
+	{80, 20, 100}
+};
+
+/* What a board reports for one game */
+typedef struct BoardResult
+{
+	bool connected;
+	GameOutcomeType outcome;
+	int player;
+	unsigned long ticks;
+	uint32_t stateHash;
+	uint32_t inputHash;
+	bool replayMatches;
+	unsigned long mismatchedTicks;
+	NetplayStatsType stats;
+} BoardResultType;
+
+/* Chunks on their way through the cable in one direction */
+typedef struct LinkChunk
+{
+	unsigned long long due;
+	int length;
+	char data[NETPLAY_TEST_CHUNK_SIZE];
+} LinkChunkType;
+
+typedef struct LinkDirection
+{
+	LinkChunkType chunks[NETPLAY_TEST_CHUNKS];
+	unsigned int head;
+	unsigned int count;
+	unsigned long long lastDue;
+} LinkDirectionType;
+
+int LinkFd;
+char LinkTx[512];
+int LinkTxLength = 0;
+uint8_t ConfirmedInputs[NETPLAY_TEST_MAX_TICKS][2];
+unsigned long ConfirmedTicks;
+LinkDirectionType LinkDirections[2];
+
+static unsigned long long nowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000ULL + (unsigned long long)ts.tv_nsec / 1000000ULL;
+}
+
+static uint32_t xorshift(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static void flushLink(void)
+{
+	int written = 0;
+	ssize_t n;
+	while (written < LinkTxLength)
+	{
+		n = write(LinkFd, LinkTx + written, LinkTxLength - written);
+		if (n > 0) written += (int)n;
+	}
+	LinkTxLength = 0;
+}
+
+static void sendLinkByte(uint32_t base, unsigned char data)
+{
+	if (base != NETPLAY_UART_BASE) return;
+	LinkTx[LinkTxLength++] = (char)data;
+	if (LinkTxLength == sizeof(LinkTx)) flushLink();
+}
+
+/* The UART2 interrupt for whatever came through the cable */
+static void pumpLink(void)
+{
+	char buffer[64];
+	ssize_t n;
+	flushLink();
+	while ((n = read(LinkFd, buffer, sizeof(buffer))) > 0)
+	{
+		hostUartPushRx(NETPLAY_UART_BASE, buffer, (unsigned int)n);
+		UART2_Handler();
+	}
+}
+
+/* vTaskDelay waits for real, so hellos and lingering packets go out on time */
+static void waitTicks(uint32_t ticks)
+{
+	unsigned long long deadline = nowMs() + ticks;
+	while (nowMs() < deadline)
+	{
+		pumpLink();
+		usleep(500);
+	}
+}
+
+/* RenderTask is not running, so requests are drawn as soon as they are sent.
+ * The end message is not held on screen, on the board that is the render
+ * task's time and not the netplay task's. Bytes from the link go on to
+ * their own queue */
+static void renderImmediately(QueueHandle_t queue, const void *item)
+{
+	if (queue == RenderQueue)
+	{
+		HostDelayHook = NULL;
+		renderRequest((const RenderRequestType *)item);
+		HostDelayHook = waitTicks;
+		return;
+	}
+	HostQueueSendHook = NULL;
+	xQueueSend(queue, item, 0);
+	HostQueueSendHook = renderImmediately;
+}
+
+/* A random move for the tick the key lands on that does not run into anything now,
+ * preferring ones that close in on the power-up */
+static char chooseNetplayKey(uint32_t *botState)
+{
+	static const char keys[] = {'w', 's', 'd', 'a'};
+	const NetplaySnakeType *snake = &NetplayState.snakes[NetplayPlayer];
+	Direction current = (Direction)NetplayInputs[NetplayPlayer][(NetplayTick + NETPLAY_INPUT_DELAY - 1) % NETPLAY_HISTORY];
+	PointType head = netplayPoint(snake->cells[snake->head]);
+	PointType powerUp = netplayPoint(NetplayState.powerUp);
+	PointType next;
+	int best = -1;
+	int bestScore = 0;
+	int score;
+	int direction;
+	for (direction = UP; direction <= LEFT; direction++)
+	{
+		if (turnDirection(current, keys[direction]) != (Direction)direction) continue;
+		next = calculateNewHeadPosition(head, (Direction)direction);
+		if (isNetplayCellTaken(&NetplayState, netplayCell(next))) continue;
+		score = (int)(xorshift(botState) % 8) + 1 + 32 - abs(next.x - powerUp.x) - abs(next.y - powerUp.y);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = direction;
+		}
+	}
+	return best < 0 ? 0 : keys[best];
+}
+
+static uint32_t hashBytes(uint32_t hash, const void *data, size_t length)
+{
+	const unsigned char *bytes = data;
+	while (length-- > 0) hash = (hash ^ *bytes++) * 16777619u;
+	return hash;
+}
+
+/* Field by field, from the head, so two boards agree regardless of where their rings start */
+static uint32_t hashState(const NetplayStateType *state)
+{
+	uint32_t hash = 2166136261u;
+	const NetplaySnakeType *snake;
+	int i;
+	int j;
+	for (i = 0; i < 2; i++)
+	{
+		snake = &state->snakes[i];
+		for (j = 0; j < snake->length; j++) hash = hashBytes(hash, &snake->cells[(snake->head + j) % MAX_SNAKE_LENGTH], 2);
+		hash = hashBytes(hash, &snake->length, sizeof(snake->length));
+		hash = hashBytes(hash, &snake->score, sizeof(snake->score));
+		hash = hashBytes(hash, &snake->alive, sizeof(snake->alive));
+	}
+	hash = hashBytes(hash, &state->powerUp, sizeof(state->powerUp));
+	hash = hashBytes(hash, &state->random, sizeof(state->random));
+	hash = hashBytes(hash, &state->ticks, sizeof(state->ticks));
+	return hashBytes(hash, &state->over, sizeof(state->over));
+}
+
+/* Inputs no rollback can change any more, before the ring wraps over them */
+static void collectConfirmedInputs(void)
+{
+	unsigned long end = NetplayRemoteTick < NetplayTick ? NetplayRemoteTick : NetplayTick;
+	for ( ; ConfirmedTicks < end && ConfirmedTicks < NETPLAY_TEST_MAX_TICKS; ConfirmedTicks++)
+	{
+		ConfirmedInputs[ConfirmedTicks][0] = NetplayInputs[0][ConfirmedTicks % NETPLAY_HISTORY];
+		ConfirmedInputs[ConfirmedTicks][1] = NetplayInputs[1][ConfirmedTicks % NETPLAY_HISTORY];
+	}
+}
+
+/* The world as this board has to show it, its own snake as @ and o */
+static bool isScreenRight(void)
+{
+	static char expected[ENV_HEIGHT][ENV_WIDTH];
+	const NetplaySnakeType *snake;
+	PointType position;
+	int i;
+	int j;
+	memset(expected, ' ', sizeof(expected));
+	for (i = 0; i < 2; i++)
+	{
+		snake = &NetplayState.snakes[i];
+		for (j = 0; j < snake->length; j++)
+		{
+			position = netplayPoint(snake->cells[(snake->head + j) % MAX_SNAKE_LENGTH]);
+			expected[position.y][position.x] = i == NetplayPlayer ? (j == 0 ? '@' : 'o') : (j == 0 ? 'Q' : 'O');
+		}
+	}
+	position = netplayPoint(NetplayState.powerUp);
+	expected[position.y][position.x] = '+';
+	return memcmp(expected, WorldCells, sizeof(expected)) == 0;
+}
+
+static void playBoardGame(uint32_t *botState, unsigned int period, BoardResultType *result)
+{
+	const RenderRequestType netplayStartRenderRequest = RENDER_REQUEST(NETPLAY_START);
+	NetplayStateType replayed;
+	GameOutcomeType outcome = GAME_RUNNING;
+	unsigned long long deadline;
+	uint32_t seed;
+	unsigned long tick;
+	char key;
+	memset(result, 0, sizeof(*result));
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	NormalPowerUpSemaphore = xSemaphoreCreateBinary();
+	if (!connectNetplay(&seed)) return;
+	result->connected = true;
+	SnakeSpeed = 60000 / period;
+	resetNetplay(seed, NetplayPlayer);
+	ConfirmedTicks = 0;
+	xQueueSend(RenderQueue, (const void *)&netplayStartRenderRequest, portMAX_DELAY);
+	deadline = nowMs();
+	while (outcome == GAME_RUNNING && NetplayTick < NETPLAY_TEST_MAX_TICKS)
+	{
+		key = chooseNetplayKey(botState);
+		if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		pumpLink();
+		outcome = netplayTick();
+		flushLink();
+		collectConfirmedInputs();
+		if (!isScreenRight()) result->mismatchedTicks++;
+		/* An unread key would land on the next tick instead */
+		while (UARTCharsAvail(UART0_BASE)) UARTCharGet(UART0_BASE);
+		deadline += period;
+		while (nowMs() < deadline)
+		{
+			pumpLink();
+			usleep(500);
+		}
+	}
+	result->outcome = outcome;
+	result->player = NetplayPlayer;
+	result->ticks = NetplayState.ticks;
+	result->stateHash = hashState(&NetplayState);
+	result->inputHash = hashBytes(2166136261u, ConfirmedInputs, result->ticks * 2);
+	resetNetplayState(&replayed, seed);
+	for (tick = 0; tick < ConfirmedTicks; tick++) stepNetplayState(&replayed, ConfirmedInputs[tick]);
+	result->replayMatches = ConfirmedTicks >= result->ticks && hashState(&replayed) == result->stateHash;
+	/* Lingers, then hands the locks back like the task would */
+	if (outcome != GAME_RUNNING) endNetplay(outcome);
+	result->stats = NetplayStats;
+}
+
+static void runBoard(int fd, int resultFd, uint32_t botSeed, int games, unsigned int period)
+{
+	BoardResultType result;
+	uint32_t botState = botSeed;
+	int game;
+	LinkFd = fd;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	/* The nonce comes from the tick count, which has to differ between the boards */
+	HostTickCount = (TickType_t)getpid() * 7919u;
+	HostUartTxHook = sendLinkByte;
+	HostDelayHook = waitTicks;
+	HostQueueSendHook = renderImmediately;
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	initializeNetplay();
+	for (game = 0; game < games; game++)
+	{
+		playBoardGame(&botState, period, &result);
+		if (write(resultFd, &result, sizeof(result)) != sizeof(result)) break;
+	}
+	close(resultFd);
+}
+
+static int openLinkPty(int *slave)
+{
+	struct termios attributes;
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) return -1;
+	*slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if (*slave < 0) return -1;
+	tcgetattr(*slave, &attributes);
+	cfmakeraw(&attributes);
+	tcsetattr(*slave, TCSANOW, &attributes);
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	return master;
+}
+
+/* Reads what one board sent and queues it for the other, or loses it */
+static void carryLink(int from, LinkDirectionType *direction, const LinkScenarioType *scenario, uint32_t *random, unsigned long *dropped)
+{
+	LinkChunkType *chunk;
+	char buffer[NETPLAY_TEST_CHUNK_SIZE];
+	unsigned long long due;
+	ssize_t n;
+	while ((n = read(from, buffer, sizeof(buffer))) > 0)
+	{
+		if (xorshift(random) % 1000 < scenario->loss || direction->count == NETPLAY_TEST_CHUNKS)
+		{
+			(*dropped)++;
+			continue;
+		}
+		/* Jitter never reorders, a UART link is a FIFO */
+		due = nowMs() + scenario->latency + (scenario->jitter > 0 ? xorshift(random) % scenario->jitter : 0);
+		if (due < direction->lastDue) due = direction->lastDue;
+		direction->lastDue = due;
+		chunk = &direction->chunks[(direction->head + direction->count) % NETPLAY_TEST_CHUNKS];
+		chunk->due = due;
+		chunk->length = (int)n;
+		memcpy(chunk->data, buffer, (size_t)n);
+		direction->count++;
+	}
+}
+
+static void deliverLink(int to, LinkDirectionType *direction)
+{
+	LinkChunkType *chunk;
+	while (direction->count > 0)
+	{
+		chunk = &direction->chunks[direction->head];
+		if (chunk->due > nowMs()) break;
+		if (write(to, chunk->data, (size_t)chunk->length) < 0) break;
+		direction->head = (direction->head + 1) % NETPLAY_TEST_CHUNKS;
+		direction->count--;
+	}
+}
+
+static bool runScenario(const LinkScenarioType *scenario, int games, unsigned int period)
+{
+	static const char *outcomeNames[] = {"running", "lost", "won"};
+	BoardResultType results[2];
+	int masters[2];
+	int slaves[2];
+	int pipes[2][2];
+	pid_t children[2];
+	uint32_t random = 0x2545F491u ^ scenario->latency * 131u ^ scenario->loss;
+	unsigned long dropped = 0;
+	unsigned long rollbacks = 0;
+	unsigned long resimulated = 0;
+	unsigned long maxRollback = 0;
+	unsigned long stalls = 0;
+	unsigned long badBytes = 0;
+	unsigned long ticks = 0;
+	unsigned long mismatched = 0;
+	int disagreements = 0;
+	int exited = 0;
+	int status;
+	int board;
+	int game;
+	for (board = 0; board < 2; board++)
+	{
+		masters[board] = openLinkPty(&slaves[board]);
+		if (masters[board] < 0 || pipe(pipes[board]) < 0)
+		{
+			perror("pty");
+			return false;
+		}
+	}
+	memset(LinkDirections, 0, sizeof(LinkDirections));
+	for (board = 0; board < 2; board++)
+	{
+		children[board] = fork();
+		if (children[board] == 0)
+		{
+			close(masters[0]);
+			close(masters[1]);
+			close(pipes[board][0]);
+			close(slaves[1 - board]);
+			runBoard(slaves[board], pipes[board][1], 0x9E3779B9u * (board + 1) ^ scenario->latency, games, period);
+			_exit(0);
+		}
+		close(slaves[board]);
+		close(pipes[board][1]);
+	}
+	while (exited < 2)
+	{
+		carryLink(masters[0], &LinkDirections[0], scenario, &random, &dropped);
+		carryLink(masters[1], &LinkDirections[1], scenario, &random, &dropped);
+		deliverLink(masters[1], &LinkDirections[0]);
+		deliverLink(masters[0], &LinkDirections[1]);
+		if (waitpid(-1, &status, WNOHANG) > 0) exited++;
+		usleep(200);
+	}
+	for (game = 0; game < games; game++)
+	{
+		for (board = 0; board < 2; board++)
+		{
+			if (read(pipes[board][0], &results[board], sizeof(results[board])) != sizeof(results[board])) memset(&results[board], 0, sizeof(results[board]));
+		}
+		if (!results[0].connected || !results[1].connected)
+		{
+			printf("  game %d: boards did not connect\n", game);
+			disagreements++;
+			continue;
+		}
+		/* A draw is a loss on both boards */
+		if (results[0].ticks != results[1].ticks || results[0].stateHash != results[1].stateHash ||
+			results[0].inputHash != results[1].inputHash || !results[0].replayMatches || !results[1].replayMatches ||
+			results[0].player == results[1].player || (results[0].outcome == GAME_WON && results[1].outcome == GAME_WON) ||
+			results[0].outcome == GAME_RUNNING)
+		{
+			printf("  game %d disagrees: ticks %lu/%lu state %08x/%08x inputs %08x/%08x replay %d/%d outcome %s/%s\n", game,
+				results[0].ticks, results[1].ticks, results[0].stateHash, results[1].stateHash, results[0].inputHash,
+				results[1].inputHash, results[0].replayMatches, results[1].replayMatches,
+				outcomeNames[results[0].outcome], outcomeNames[results[1].outcome]);
+			disagreements++;
+		}
+		for (board = 0; board < 2; board++)
+		{
+			rollbacks += results[board].stats.rollbacks;
+			resimulated += results[board].stats.resimulatedTicks;
+			if (results[board].stats.maxRollback > maxRollback) maxRollback = results[board].stats.maxRollback;
+			stalls += results[board].stats.stalls;
+			badBytes += results[board].stats.badBytes;
+			ticks += results[board].ticks;
+			mismatched += results[board].mismatchedTicks;
+		}
+	}
+	printf("%4u+%-3u %5.1f%%  %6lu  %7lu  %8.3f  %8.2f  %7lu  %6.1f%%  %7lu  %6lu  %s\n",
+		scenario->latency, scenario->jitter, scenario->loss / 10.0, ticks / 2, dropped,
+		ticks > 0 ? (double)rollbacks / ticks : 0.0, rollbacks > 0 ? (double)resimulated / rollbacks : 0.0, maxRollback,
+		ticks > 0 ? 100.0 * stalls / ticks : 0.0, badBytes, mismatched, disagreements == 0 ? "agree" : "DISAGREE");
+	for (board = 0; board < 2; board++)
+	{
+		close(masters[board]);
+		close(pipes[board][0]);
+	}
+	return disagreements == 0 && mismatched == 0;
+}
+
+int main(int argc, char **argv)
+{
+	int games = argc > 1 ? atoi(argv[1]) : NETPLAY_TEST_GAMES;
+	unsigned int period = argc > 2 ? (unsigned int)atoi(argv[2]) : NETPLAY_TEST_PERIOD;
+	bool passed = true;
+	unsigned int i;
+	setvbuf(stdout, NULL, _IONBF, 0);
+	printf("%d games per link, %u ms ticks, input delay %d tick, %d snapshots\n", games, period, NETPLAY_INPUT_DELAY, NETPLAY_ROLLBACK_TICKS);
+	printf("latency  loss     ticks  dropped  rb/tick  depth/rb  deepest  stalled  badbytes  screen  result\n");
+	for (i = 0; i < sizeof(Scenarios) / sizeof(Scenarios[0]); i++)
+	{
+		if (!runScenario(&Scenarios[i], games, period)) passed = false;
+	}
+	printf(passed ? "every game agreed on both boards\n" : "netplay check FAILED\n");
+	return passed ? 0 : 1;
+}
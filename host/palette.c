@@ -0,0 +1,260 @@
+/* Host byte count of the palette modes on replayed games.
+ *
+ * Every bot game is recorded once and replayed in each palette mode, with and
+ * without the colour cache. The UART0 output is fed to the terminal stand-in
+ * and the board on it, glyphs and colours, is checked against the world after
+ * every tick. In half-block mode the two cells of every character are read
+ * back from its glyph and colours.
+ *
+ * Build and run from the repository root, a tall board can be given with
+ * -DENV_WIDTH, -DENV_HEIGHT and -DVIEWPORT_HEIGHT in DEFINES:
+ *   make -C host palette
+ *   host/palette [games]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+#include "terminal.h"
+
+#define PALETTE_MAX_TICKS		5000
+#define PALETTE_EMPTY			0xFF	/* A half that shows the default background */
+
+typedef struct PaletteMode
+{
+	const char *name;
+	bool color;
+	bool unicode;
+	bool halfBlock;
+	bool cache;
+	unsigned long ticks;
+	unsigned long bytes;
+	unsigned long tickBytes;
+	unsigned long keyframeBytes;
+	unsigned long mismatches;
+} PaletteModeType;
+
+static PaletteModeType Modes[] =
+{
+	{"mono", false, false, false, true},
+	{"color", true, false, false, true},
+	{"color, no cache", true, false, false, false},
+	{"unicode", false, true, false, true},
+	{"color+unicode", true, true, false, true},
+	{"color+unicode, no cache", true, true, false, false},
+	{"half-block", false, false, true, true},
+	{"half-block, no cache", false, false, true, false}
+};
+
+HostTerminalType Terminal;
+
+static void feedOutput(uint32_t base, unsigned char data)
+{
+	if (base == UART0_BASE) feedTerminal(&Terminal, data);
+}
+
+/* RenderTask is not running, so requests are drawn as soon as they are sent */
+static void renderImmediately(QueueHandle_t queue, const void *item)
+{
+	if (queue == RenderQueue) renderRequest((const RenderRequestType *)item);
+}
+
+static uint32_t decodeGlyph(const CellStyleType *style)
+{
+	const unsigned char *bytes = (const unsigned char *)style->unicode;
+	uint32_t glyph;
+	if (!PaletteUnicode || bytes == NULL) return (unsigned char)style->ascii;
+	if (bytes[0] >= 0xE0) glyph = (uint32_t)(bytes[0] & 0x0F) << 12 | (uint32_t)(bytes[1] & 0x3F) << 6 | (bytes[2] & 0x3F);
+	else glyph = (uint32_t)(bytes[0] & 0x1F) << 6 | (bytes[1] & 0x3F);
+	return glyph;
+}
+
+/* What one half of a character shows, the colour as a foreground code */
+static uint8_t foregroundHalf(uint8_t foreground)
+{
+	return foreground != TERMINAL_DEFAULT_FOREGROUND ? foreground : PALETTE_DEFAULT;
+}
+
+static uint8_t backgroundHalf(uint8_t background)
+{
+	return background != TERMINAL_DEFAULT_BACKGROUND ? background - 10 : PALETTE_EMPTY;
+}
+
+static uint8_t expectedHalf(int row, int column)
+{
+	char cell = getViewportCell(row, column);
+	return cell != ' ' ? findCellStyle(cell)->color : PALETTE_EMPTY;
+}
+
+static bool halfBlocksMatch(void)
+{
+	HostTerminalCellType cell;
+	uint8_t top;
+	uint8_t bottom;
+	int line;
+	int column;
+	for (line = 0; line < viewportLines(); line++)
+	{
+		for (column = 0; column < VIEWPORT_WIDTH; column++)
+		{
+			cell = terminalCellAttributes(&Terminal, line + 2, column + 2);
+			switch (cell.glyph)
+			{
+				case ' ':
+					top = bottom = backgroundHalf(cell.background);
+					break;
+				case 0x2580:
+					top = foregroundHalf(cell.foreground);
+					bottom = backgroundHalf(cell.background);
+					break;
+				case 0x2584:
+					top = backgroundHalf(cell.background);
+					bottom = foregroundHalf(cell.foreground);
+					break;
+				case 0x2588:
+					top = bottom = foregroundHalf(cell.foreground);
+					break;
+				default:
+					return false;
+			}
+			if (top != expectedHalf(line * 2, column) || bottom != expectedHalf(line * 2 + 1, column)) return false;
+		}
+	}
+	return true;
+}
+
+/* The board is on terminal rows and columns 2 to VIEWPORT + 1, a blank can be in any colour */
+static bool boardMatches(void)
+{
+	const CellStyleType *style;
+	HostTerminalCellType cell;
+	uint8_t color;
+	int row;
+	int column;
+	if (PaletteHalfBlock) return halfBlocksMatch();
+	for (row = 0; row < VIEWPORT_HEIGHT; row++)
+	{
+		for (column = 0; column < VIEWPORT_WIDTH; column++)
+		{
+			style = findCellStyle(WorldCells[Camera.y + row][Camera.x + column]);
+			cell = terminalCellAttributes(&Terminal, row + 2, column + 2);
+			color = PaletteColor && style->color != PALETTE_DEFAULT ? style->color : TERMINAL_DEFAULT_FOREGROUND;
+			if (cell.glyph != decodeGlyph(style)) return false;
+			if (style->cell != ' ' && cell.foreground != color) return false;
+		}
+	}
+	return true;
+}
+
+static void recordGame(uint32_t seed)
+{
+	RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	uint32_t botState = seed * 2654435761u + 1;
+	HostSpawnersType spawners;
+	unsigned long period;
+	GameOutcomeType outcome = GAME_RUNNING;
+	char key;
+
+	PaletteColor = false;
+	PaletteUnicode = false;
+	PaletteHalfBlock = false;
+	resetGameState();
+	SnakeSpeed = INITIAL_SNAKE_SPEED;
+	period = (60000 / SnakeSpeed) / portTICK_RATE_MS;
+	resetHostSpawners(&spawners);
+	renderRequest(&gameStartRenderRequest);
+	startRecording(seed, SnakeSpeed);
+	seedRandomNumber(seed);
+	while (GameTickIndex < PALETTE_MAX_TICKS)
+	{
+		key = chooseBotKey(&botState);
+		if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		outcome = snakeTick();
+		if (outcome != GAME_RUNNING) break;
+		runHostSpawners(&spawners, period);
+	}
+	stopRecording(outcome == GAME_WON);
+}
+
+static void replayGame(PaletteModeType *mode)
+{
+	RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	unsigned long bytes;
+	uint32_t seed;
+
+	PaletteColor = mode->color;
+	PaletteUnicode = mode->unicode;
+	PaletteHalfBlock = mode->halfBlock;
+	PaletteCache = mode->cache;
+	CellColor = PALETTE_DEFAULT;
+	CellBackground = PALETTE_DEFAULT;
+	resetTerminal(&Terminal);
+	resetGameState();
+	bytes = HostUartTxCount[0];
+	renderRequest(&gameStartRenderRequest);
+	if (!startReplay(&seed, &SnakeSpeed)) return;
+	seedRandomNumber(seed);
+	for ( ;; )
+	{
+		if (!boardMatches()) mode->mismatches++;
+		mode->bytes += HostUartTxCount[0] - bytes;
+		bytes = HostUartTxCount[0];
+		if (GameTickIndex >= PALETTE_MAX_TICKS || snakeTick() != GAME_RUNNING) break;
+		mode->ticks++;
+		mode->tickBytes += HostUartTxCount[0] - bytes;
+	}
+	mode->bytes += HostUartTxCount[0] - bytes;
+	stopReplay();
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long games = argc > 1 ? strtoul(argv[1], NULL, 0) : 50;
+	PaletteModeType *mode;
+	unsigned long mismatches = 0;
+	unsigned long bytes;
+	unsigned int i;
+	uint32_t seed;
+
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	HostQueueSendHook = renderImmediately;
+	for (seed = 1; seed <= games; seed++)
+	{
+		HostUartTxHook = NULL;
+		recordGame(seed);
+		HostUartTxHook = feedOutput;
+		for (i = 0; i < sizeof(Modes) / sizeof(Modes[0]); i++) replayGame(&Modes[i]);
+	}
+
+	printf("world %dx%d viewport %dx%d, %lu replayed games, %lu ticks each mode\n", ENV_WIDTH, ENV_HEIGHT, VIEWPORT_WIDTH, VIEWPORT_HEIGHT, games, Modes[0].ticks);
+	/* A repaint of the last board, what a joining spectator is sent */
+	RenderScreen = START_GAME;
+	for (i = 0; i < sizeof(Modes) / sizeof(Modes[0]); i++)
+	{
+		mode = &Modes[i];
+		PaletteColor = mode->color;
+		PaletteUnicode = mode->unicode;
+		PaletteHalfBlock = mode->halfBlock;
+		PaletteCache = mode->cache;
+		bytes = HostUartTxCount[0];
+		renderKeyframe();
+		mode->keyframeBytes = HostUartTxCount[0] - bytes;
+	}
+	printf("%-24s %12s %10s %12s %10s %10s\n", "mode", "total bytes", "vs mono", "bytes/tick", "repaint", "mismatched");
+	for (i = 0; i < sizeof(Modes) / sizeof(Modes[0]); i++)
+	{
+		mode = &Modes[i];
+		printf("%-24s %12lu %9.1f%% %12.2f %10lu %10lu\n", mode->name, mode->bytes, 100.0 * mode->bytes / Modes[0].bytes,
+			mode->ticks ? (double)mode->tickBytes / mode->ticks : 0.0, mode->keyframeBytes, mode->mismatches);
+		mismatches += mode->mismatches;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
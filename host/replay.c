@@ -0,0 +1,214 @@
+/* Host recorder and replayer for input logs.
+ *
+ * Without arguments a scripted game is recorded through the same functions the
+ * tasks call, then the log is replayed and the UART output of both runs is
+ * compared byte for byte. With --log the given hex dump of InputLog.data, for
+ * instance copied from the debugger, is replayed and the final state printed.
+ * Replays are timed so recorded games double as benchmark workloads.
+ *
+ * Build and run from the repository root:
+ *   make -C host replay
+ *   host/replay [seed]
+ *   host/replay --log <hex>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+
+#define REPLAY_MAX_TICKS		100000
+
+uint32_t OutputHash;
+unsigned long OutputBytes;
+uint32_t BotState = 1;
+
+static void hashOutput(uint32_t base, unsigned char data)
+{
+	if (base != UART0_BASE) return;
+	OutputHash = (OutputHash ^ data) * 16777619u;
+	OutputBytes++;
+}
+
+/* RenderTask is not running, so requests are drawn as soon as they are sent */
+static void renderImmediately(QueueHandle_t queue, const void *item)
+{
+	if (queue == RenderQueue) renderRequest((const RenderRequestType *)item);
+}
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void startGame(void)
+{
+	RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	OutputHash = 2166136261u;
+	OutputBytes = 0;
+	resetGameState();
+	renderRequest(&gameStartRenderRequest);
+}
+
+static GameOutcomeType recordGame(uint32_t seed)
+{
+	HostSpawnersType spawners;
+	unsigned long period;
+	GameOutcomeType outcome = GAME_RUNNING;
+	char key;
+
+	SnakeSpeed = INITIAL_SNAKE_SPEED;
+	period = (60000 / SnakeSpeed) / portTICK_RATE_MS;
+	BotState = seed * 2654435761u + 1;
+	resetHostSpawners(&spawners);
+	startGame();
+	startRecording(seed, SnakeSpeed);
+	seedRandomNumber(seed);
+	while (outcome == GAME_RUNNING && GameTickIndex < REPLAY_MAX_TICKS)
+	{
+		key = chooseBotKey(&BotState);
+		if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		outcome = snakeTick();
+		if (outcome != GAME_RUNNING) break;
+		runHostSpawners(&spawners, period);
+	}
+	stopRecording(outcome == GAME_WON);
+	return outcome;
+}
+
+static GameOutcomeType replayGame(unsigned long long *elapsedNs)
+{
+	GameOutcomeType outcome = GAME_RUNNING;
+	uint32_t seed;
+	unsigned long long start;
+
+	startGame();
+	if (!startReplay(&seed, &SnakeSpeed)) return GAME_LOST;
+	seedRandomNumber(seed);
+	start = nowNs();
+	while (outcome == GAME_RUNNING && GameTickIndex < REPLAY_MAX_TICKS) outcome = snakeTick();
+	*elapsedNs = nowNs() - start;
+	stopReplay();
+	return outcome;
+}
+
+/* A key stops a replay, a log that runs out ends it and a truncated one is not offered */
+static bool checkReplayEnds(void)
+{
+	InputLogType recorded = InputLog;
+	unsigned long long elapsed;
+	GameOutcomeType outcome = GAME_RUNNING;
+	uint32_t seed;
+	char key = 'w';
+	startGame();
+	startReplay(&seed, &SnakeSpeed);
+	seedRandomNumber(seed);
+	while (outcome == GAME_RUNNING && GameTickIndex < 10)
+	{
+		if (GameTickIndex == 5) hostUartPushRx(UART0_BASE, &key, 1);
+		outcome = snakeTick();
+	}
+	stopReplay();
+	if (outcome != GAME_LOST || GameTickIndex != 5)
+	{
+		printf("a key did not stop the replay\n");
+		return false;
+	}
+	/* With its end entry cut short the log stops at its last event */
+	InputLog.length = recorded.length - 2;
+	if (replayGame(&elapsed) == GAME_RUNNING)
+	{
+		printf("a replay ran on past the end of its log\n");
+		return false;
+	}
+	InputLog = recorded;
+	InputLog.truncated = true;
+	if (isReplayAvailable())
+	{
+		printf("a truncated log was offered for replay\n");
+		return false;
+	}
+	InputLog = recorded;
+	return true;
+}
+
+static const char *outcomeName(GameOutcomeType outcome)
+{
+	return outcome == GAME_WON ? "won" : outcome == GAME_LOST ? "lost" : "running";
+}
+
+static bool loadHexLog(const char *hex)
+{
+	unsigned int byte;
+	InputLog.length = 0;
+	InputLog.truncated = false;
+	while (hex[0] != 0 && hex[1] != 0 && InputLog.length < REPLAY_LOG_SIZE)
+	{
+		if (sscanf(hex, "%2x", &byte) != 1) return false;
+		InputLog.data[InputLog.length++] = (uint8_t)byte;
+		hex += 2;
+	}
+	return InputLog.length > 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t seed = 1;
+	uint32_t recordedHash = 0;
+	unsigned long recordedBytes = 0;
+	unsigned long recordedTicks = 0;
+	unsigned long long elapsed = 0;
+	GameOutcomeType recorded = GAME_RUNNING;
+	GameOutcomeType replayed;
+	bool fromLog = argc > 2 && strcmp(argv[1], "--log") == 0;
+	uint16_t i;
+
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	HostQueueSendHook = renderImmediately;
+	HostUartTxHook = hashOutput;
+
+	if (fromLog)
+	{
+		if (!loadHexLog(argv[2]))
+		{
+			fprintf(stderr, "invalid log\n");
+			return 2;
+		}
+	}
+	else
+	{
+		if (argc > 1) seed = (uint32_t)strtoul(argv[1], NULL, 0);
+		recorded = recordGame(seed);
+		recordedHash = OutputHash;
+		recordedBytes = OutputBytes;
+		recordedTicks = GameTickIndex;
+		printf("recorded seed=%u outcome=%s ticks=%lu score=%d length=%d log=%u bytes%s\n", seed, outcomeName(recorded),
+			recordedTicks, score, GameState.snakeLength, InputLog.length, InputLog.truncated ? " (truncated)" : "");
+		printf("log ");
+		for (i = 0; i < InputLog.length; i++) printf("%02x", InputLog.data[i]);
+		printf("\n");
+	}
+
+	replayed = replayGame(&elapsed);
+	printf("replayed outcome=%s ticks=%lu score=%d length=%d output=%lu bytes %.1f ns/tick\n", outcomeName(replayed),
+		GameTickIndex, score, GameState.snakeLength, OutputBytes, GameTickIndex > 0 ? (double)elapsed / GameTickIndex : 0.0);
+	if (fromLog) return 0;
+	if (replayed != recorded || GameTickIndex != recordedTicks || OutputHash != recordedHash || OutputBytes != recordedBytes)
+	{
+		printf("replay diverged from the recording\n");
+		return 1;
+	}
+	if (!checkReplayEnds()) return 1;
+	printf("replay matches the recording frame for frame\n");
+	return 0;
+}
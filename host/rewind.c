@@ -0,0 +1,232 @@
+/* Host check and measurement of the rewind ring.
+ *
+ * Bot games are played through snakeTick with every render request drawn at
+ * once onto the terminal stand-in. The state after every move is kept on a
+ * stack and now and then the bot presses the rewind key instead of turning,
+ * sometimes twice in a row. The game it comes back to has to be the one on
+ * the stack that many moves down, and the screen has to be the one a full
+ * repaint of it draws, while only the cells that differ were sent. The games
+ * are played at the first speed of the curve, at MAXIMUM_SNAKE_SPEED and at
+ * the console's top speed, and the most the ring held of REWIND_BUFFER_SIZE
+ * is set against a GameStateType copy for every tick it covered. Every game
+ * is recorded too, and one that was rewound must not be left to replay.
+ *
+ * Build and run from the repository root:
+ *   make -C host rewind
+ *   host/rewind [games]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+#include "terminal.h"
+
+#define REWIND_TEST_TICKS		3000
+#define REWIND_TEST_CHANCE		40		/* One move in this many is a rewind */
+
+/* What a tick left behind, before the spawners ran */
+typedef struct RewindSnapshot
+{
+	GameStateType state;
+	PointType entities[ENTITY_KINDS];
+	Direction direction;
+	int score;
+} RewindSnapshotType;
+
+HostTerminalType PlayerTerminal;
+HostTerminalType RepaintTerminal;
+bool Repainting = false;
+RewindSnapshotType History[REWIND_TEST_TICKS + 1];
+int HistoryLength;
+unsigned long Rewinds;
+unsigned long Mismatches;
+unsigned long RewindBytes;
+unsigned long RepaintBytes;
+int MaxRingBytes;
+int MaxRingTicks;
+
+static void feedOutput(uint32_t base, unsigned char data)
+{
+	if (base != UART0_BASE) return;
+	if (Repainting) feedTerminal(&RepaintTerminal, data);
+	else feedTerminal(&PlayerTerminal, data);
+}
+
+/* RenderTask is not running, so requests are drawn as soon as they are sent */
+static void renderImmediately(QueueHandle_t queue, const void *item)
+{
+	if (queue == RenderQueue) renderRequest((const RenderRequestType *)item);
+}
+
+static void takeSnapshot(RewindSnapshotType *snapshot)
+{
+	int kind;
+	snapshot->state = GameState;
+	for (kind = ENTITY_FREE; kind < ENTITY_KINDS; kind++) snapshot->entities[kind] = findEntityPosition((EntityKind)kind);
+	snapshot->direction = LastDirection;
+	snapshot->score = score;
+}
+
+static bool isSameSnapshot(const RewindSnapshotType *snapshot)
+{
+	const GameStateType *state = &snapshot->state;
+	PointType position;
+	int i;
+	if (state->snakeLength != GameState.snakeLength || snapshot->direction != LastDirection || snapshot->score != score) return false;
+	for (i = 0; i < state->snakeLength; i++)
+	{
+		if (state->snakePositions[i].x != GameState.snakePositions[i].x || state->snakePositions[i].y != GameState.snakePositions[i].y) return false;
+	}
+	for (i = ENTITY_NORMAL_POWERUP; i < ENTITY_KINDS; i++)
+	{
+		position = findEntityPosition((EntityKind)i);
+		if (snapshot->entities[i].x != position.x || snapshot->entities[i].y != position.y) return false;
+	}
+	return true;
+}
+
+/* The entity table rebuilt with no more than one entity of each kind, each found on its cell */
+static bool isEntityTableRebuilt(void)
+{
+	PointType position;
+	int expected = 0;
+	int kind;
+	for (kind = ENTITY_NORMAL_POWERUP; kind < ENTITY_KINDS; kind++)
+	{
+		position = findEntityPosition((EntityKind)kind);
+		if (position.x < 0) continue;
+		expected++;
+		if (entityKindAt(position) != (EntityKind)kind) return false;
+	}
+	return EntityCount == expected;
+}
+
+/* The rewound screen against a repaint of the same state on a copy of the terminal */
+static bool isScreenRepainted(void)
+{
+	const RenderRequestType repaintRenderRequest = RENDER_REQUEST(REPAINT);
+	unsigned long bytes = HostUartTxCount[0];
+	int row;
+	int column;
+	RepaintTerminal = PlayerTerminal;
+	Repainting = true;
+	renderRequest(&repaintRenderRequest);
+	Repainting = false;
+	RepaintBytes += HostUartTxCount[0] - bytes;
+	for (row = 1; row <= TERMINAL_ROWS; row++)
+	{
+		for (column = 1; column <= TERMINAL_COLUMNS; column++)
+		{
+			if (terminalCell(&PlayerTerminal, row, column) != terminalCell(&RepaintTerminal, row, column)) return false;
+		}
+	}
+	return true;
+}
+
+static void checkRewind(int before)
+{
+	int back = before - RewindTicks;
+	HistoryLength -= back;
+	Rewinds++;
+	if (back <= 0 || !isSameSnapshot(&History[HistoryLength - 1]) || !isEntityTableRebuilt() || !isScreenRepainted())
+	{
+		if (Mismatches++ < 5) printf("mismatch after rewinding %d ticks at move %d\n", back, HistoryLength);
+	}
+}
+
+static void playGame(unsigned long game, int speed)
+{
+	const RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	uint32_t botState = (uint32_t)game * 2654435761u + 7;
+	HostSpawnersType spawners;
+	unsigned long period;
+	unsigned long bytes;
+	int before;
+	int tick;
+	unsigned long rewinds = Rewinds;
+	bool rewinding = false;
+	char key;
+
+	resetGameState();
+	SnakeSpeed = speed;
+	period = 60000 / SnakeSpeed;
+	seedRandomNumber((int)game + 1);
+	resetHostSpawners(&spawners);
+	resetTerminal(&PlayerTerminal);
+	renderRequest(&gameStartRenderRequest);
+	startRewind();
+	startRecording((uint32_t)game + 1, speed);
+	HistoryLength = 0;
+	takeSnapshot(&History[HistoryLength++]);
+	for (tick = 0; tick < REWIND_TEST_TICKS; tick++)
+	{
+		/* A second press follows the first half the time */
+		botState ^= botState << 13;
+		botState ^= botState >> 17;
+		botState ^= botState << 5;
+		rewinding = (rewinding && botState % 2 == 0) || botState % REWIND_TEST_CHANCE == 0;
+		key = rewinding ? REWIND_KEY : chooseBotKey(&botState);
+		if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		before = RewindTicks;
+		bytes = HostUartTxCount[0];
+		if (snakeTick() != GAME_RUNNING) break;
+		if (rewinding && before > 0)
+		{
+			RewindBytes += HostUartTxCount[0] - bytes;
+			checkRewind(before);
+		}
+		else takeSnapshot(&History[HistoryLength++]);
+		runHostSpawners(&spawners, period);
+		if ((uint16_t)(RewindHead - RewindTail) > MaxRingBytes) MaxRingBytes = (uint16_t)(RewindHead - RewindTail);
+		if (RewindTicks > MaxRingTicks) MaxRingTicks = RewindTicks;
+	}
+	stopRecording(false);
+	stopRewind();
+	if (Rewinds != rewinds && isReplayAvailable())
+	{
+		if (Mismatches++ < 5) printf("game %lu left a replay after %lu rewinds\n", game, Rewinds - rewinds);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const int speeds[] = {INITIAL_SNAKE_SPEED, MAXIMUM_SNAKE_SPEED, CONSOLE_MAX_SNAKE_SPEED};
+	unsigned long games = argc > 1 ? strtoul(argv[1], NULL, 0) : 50;
+	unsigned long failures = 0;
+	unsigned long game;
+	unsigned int i;
+
+	RenderQueue = xQueueCreate(RENDER_QUEUE_LENGTH, sizeof(RenderRequestType));
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	NormalPowerUpSemaphore = xSemaphoreCreateBinary();
+	HostQueueSendHook = renderImmediately;
+	HostUartTxHook = feedOutput;
+
+	printf("%-8s %8s %10s %12s %12s %14s %12s %14s\n", "speed", "rewinds", "mismatched", "ring_bytes", "ring_ticks", "copies_bytes",
+		"rewind_bytes", "repaint_bytes");
+	for (i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+	{
+		Rewinds = 0;
+		Mismatches = 0;
+		RewindBytes = 0;
+		RepaintBytes = 0;
+		MaxRingBytes = 0;
+		MaxRingTicks = 0;
+		for (game = 0; game < games; game++) playGame(game, speeds[i]);
+		printf("%-8d %8lu %10lu %12d %12d %14lu %12.1f %14.1f\n", speeds[i], Rewinds, Mismatches, MaxRingBytes, MaxRingTicks,
+			(unsigned long)MaxRingTicks * sizeof(GameStateType), Rewinds > 0 ? (double)RewindBytes / Rewinds : 0.0,
+			Rewinds > 0 ? (double)RepaintBytes / Rewinds : 0.0);
+		failures += Mismatches;
+	}
+	printf("%s\n", failures == 0 ? "every rewind came back to the state and the screen it left" : "rewinds went wrong");
+	return failures == 0 ? 0 : 1;
+}
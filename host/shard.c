@@ -0,0 +1,607 @@
+/* Host test of a world sharded across a ring of boards.
+ *
+ * One process is forked per board, each with the firmware's UART6 on a
+ * pipe from its west neighbour and one to its east neighbour. The parent is
+ * the cabling: it carries each board's TX to the next board's RX, holding
+ * every chunk back by the link latency. The boards run their ticks against
+ * real time with a bot on the keyboard of whichever board has the snake,
+ * while the ShardTask's work is done between ticks as bytes come in. Board 0
+ * starts the game, the board that has the snake when the tick limit is
+ * reached ends it.
+ *
+ * Every board times its snake tick, with and without the snake, and notes
+ * the moment it hands the snake off or makes its first move after taking
+ * it. The parent pairs those up by handoff sequence for the one-way handoff
+ * latency. At the end exactly one board has to have the snake and every
+ * board has to show the part of it that is on its columns, and nothing else
+ * as snake. Before the ring starts, one board is fed noise with a frame
+ * behind it, which it has to find.
+ *
+ * Build and run from the repository root:
+ *   make -C host shard
+ *   host/shard [boards] [tick ms] [ticks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "../shard.h"
+#include "hostGame.h"
+#include "stubs/host_stubs.h"
+
+#define SHARD_TEST_BOARDS		3
+#define SHARD_TEST_PERIOD		20		/* ms per tick, compressed so a run stays short */
+#define SHARD_TEST_TICKS		1000
+#define SHARD_TEST_EVENTS		512
+#define SHARD_TEST_CHUNKS		4096
+#define SHARD_TEST_CHUNK_SIZE	256
+#define SHARD_TEST_LINGER		200		/* ms a board keeps passing bytes on after its game ended */
+
+static const unsigned int Latencies[] = {0, 5, 15};		/* ms per link */
+
+/* A handoff as one board saw it */
+typedef struct HandoffEvent
+{
+	uint8_t sequence;
+	bool taken;					/* The first move on the new board, otherwise the handoff */
+	unsigned long long time;	/* us */
+} HandoffEventType;
+
+/* What a board reports at the end */
+typedef struct BoardResult
+{
+	bool started;
+	bool owner;
+	GameOutcomeType outcome;
+	unsigned long ticks;
+	unsigned long ownerTicks;
+	unsigned long long ownerNs;
+	unsigned long long maxOwnerNs;
+	unsigned long long otherNs;
+	unsigned long long maxOtherNs;
+	ShardStatsType stats;
+	int snakeLength;
+	PointType snake[MAX_SNAKE_LENGTH];
+	char cells[ENV_HEIGHT][ENV_WIDTH];
+	int eventCount;
+	HandoffEventType events[SHARD_TEST_EVENTS];
+} BoardResultType;
+
+/* Chunks on their way through one cable */
+typedef struct LinkChunk
+{
+	unsigned long long due;
+	int length;
+	char data[SHARD_TEST_CHUNK_SIZE];
+} LinkChunkType;
+
+typedef struct LinkCable
+{
+	LinkChunkType chunks[SHARD_TEST_CHUNKS];
+	unsigned int head;
+	unsigned int count;
+} LinkCableType;
+
+int LinkRxFd;
+int LinkTxFd;
+char LinkTx[512];
+int LinkTxLength = 0;
+unsigned long long StartMs;
+LinkCableType Cables[SHARD_MAX_COUNT];
+BoardResultType Results[SHARD_MAX_COUNT];
+
+static unsigned long long nowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000ULL + (unsigned long long)ts.tv_nsec / 1000ULL;
+}
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static unsigned long long nowMs(void)
+{
+	return nowUs() / 1000ULL;
+}
+
+static void flushLink(void)
+{
+	int written = 0;
+	ssize_t n;
+	while (written < LinkTxLength)
+	{
+		n = write(LinkTxFd, LinkTx + written, LinkTxLength - written);
+		if (n > 0) written += (int)n;
+	}
+	LinkTxLength = 0;
+}
+
+static void sendLinkByte(uint32_t base, unsigned char data)
+{
+	if (base != SHARD_UART_BASE) return;
+	LinkTx[LinkTxLength++] = (char)data;
+	if (LinkTxLength == sizeof(LinkTx)) flushLink();
+}
+
+/* The UART6 interrupt and the ShardTask for whatever came from the west */
+static void pumpLink(void)
+{
+	char buffer[64];
+	uint8_t c;
+	ssize_t n;
+	flushLink();
+	while ((n = read(LinkRxFd, buffer, sizeof(buffer))) > 0)
+	{
+		hostUartPushRx(SHARD_UART_BASE, buffer, (unsigned int)n);
+		UART6_Handler();
+		while (xQueueReceive(ShardRxQueue, (void *)&c, 0) == pdPASS) receiveShardByte(c);
+	}
+	flushLink();
+}
+
+/* The menu's poll for a START waits for real */
+static void waitTicks(uint32_t ticks)
+{
+	unsigned long long deadline = nowMs() + ticks;
+	while (nowMs() < deadline)
+	{
+		pumpLink();
+		usleep(500);
+	}
+}
+
+/* RenderTask is not running, so requests are drawn as soon as they are sent.
+ * Messages for the snake task go on to their own queue */
+static void renderImmediately(QueueHandle_t queue, const void *item)
+{
+	if (queue == RenderQueue)
+	{
+		renderRequest((const RenderRequestType *)item);
+		return;
+	}
+	HostQueueSendHook = NULL;
+	xQueueSend(queue, item, 0);
+	HostQueueSendHook = renderImmediately;
+}
+
+/* Keeps going round the ring, turning now and then, so the snake crosses
+ * board edges often. Moves that run into something now are left out */
+static char chooseShardKey(uint32_t *botState)
+{
+	static const char keys[] = {'w', 's', 'd', 'a'};
+	PointType head = GameState.snakePositions[0];
+	PointType next;
+	int best = -1;
+	int bestScore = 0;
+	int score;
+	int direction;
+	for (direction = UP; direction <= LEFT; direction++)
+	{
+		if (turnDirection(LastDirection, keys[direction]) != (Direction)direction) continue;
+		next = calculateNewHeadPosition(head, (Direction)direction);
+		if (isSnakeCollision(next) || (next.x >= 0 && next.x < ENV_WIDTH && isShardTrail(next))) continue;
+		if (entityKindAt(next) == ENTITY_ENEMY) continue;
+		*botState ^= *botState << 13;
+		*botState ^= *botState >> 17;
+		*botState ^= *botState << 5;
+		score = (int)(*botState % 8) + 1 + (direction == (int)LastDirection ? 6 : 0) + (direction == RIGHT || direction == LEFT ? 2 : 0);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = direction;
+		}
+	}
+	return best < 0 ? 0 : keys[best];
+}
+
+static void noteHandoff(BoardResultType *result, bool taken)
+{
+	if (result->eventCount == SHARD_TEST_EVENTS) return;
+	result->events[result->eventCount].sequence = ShardSequence;
+	result->events[result->eventCount].taken = taken;
+	result->events[result->eventCount].time = nowUs();
+	result->eventCount++;
+}
+
+static void runBoard(int index, int count, unsigned int period, unsigned long maxTicks, BoardResultType *result)
+{
+	const RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	HostSpawnersType spawners;
+	GameOutcomeType outcome = GAME_RUNNING;
+	unsigned long long deadline;
+	unsigned long long start;
+	unsigned long long ns;
+	uint32_t botState = 0x9E3779B9u * (uint32_t)(index + 1);
+	bool wasOwner;
+	char key;
+	memset(result, 0, sizeof(*result));
+	fcntl(LinkRxFd, F_SETFL, fcntl(LinkRxFd, F_GETFL) | O_NONBLOCK);
+	ShardIndex = index;
+	ShardCount = count;
+	HostUartTxHook = sendLinkByte;
+	HostDelayHook = waitTicks;
+	HostQueueSendHook = renderImmediately;
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	NormalPowerUpSemaphore = xSemaphoreCreateBinary();
+	initializeShards();
+	resetGameState();
+	/* e is pressed on board 0, the others wait for its START in the menu */
+	SnakeSpeed = 60000 / period;
+	if (index == 0) startShardGame(&SnakeSpeed);
+	else
+	{
+		deadline = nowMs() + 2000;
+		while (!ShardStartPending && nowMs() < deadline) waitTicks(MENU_KEY_POLL);
+		if (!ShardStartPending) return;
+		startShardGame(&SnakeSpeed);
+	}
+	result->started = true;
+	inGame = true;
+	seedRandomNumber((int)(0x2545F491u * (uint32_t)(index + 1)));
+	xQueueSend(RenderQueue, (const void *)&gameStartRenderRequest, portMAX_DELAY);
+	resetHostSpawners(&spawners);
+	deadline = nowMs();
+	while (outcome == GAME_RUNNING)
+	{
+		/* readTimestamp, which times the handoffs, follows real time */
+		HostTickCount = (TickType_t)(nowMs() - StartMs + 1);
+		if (ShardOwner)
+		{
+			key = chooseShardKey(&botState);
+			if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		}
+		pumpLink();
+		wasOwner = ShardOwner;
+		start = nowNs();
+		outcome = snakeTick();
+		ns = nowNs() - start;
+		if (wasOwner)
+		{
+			result->ownerTicks++;
+			result->ownerNs += ns;
+			if (ns > result->maxOwnerNs) result->maxOwnerNs = ns;
+		}
+		else
+		{
+			result->otherNs += ns;
+			if (ns > result->maxOtherNs) result->maxOtherNs = ns;
+		}
+		if (wasOwner && !ShardOwner) noteHandoff(result, false);
+		if (!wasOwner && ShardOwner) noteHandoff(result, true);
+		result->ticks++;
+		/* What endGame does for the other boards */
+		if (outcome == GAME_RUNNING && ShardOwner && result->ticks >= maxTicks) outcome = GAME_LOST;
+		if (outcome != GAME_RUNNING && ShardOwner) endShardGame(outcome == GAME_WON);
+		flushLink();
+		runHostSpawners(&spawners, period);
+		while (UARTCharsAvail(UART0_BASE)) UARTCharGet(UART0_BASE);
+		deadline += period;
+		while (nowMs() < deadline)
+		{
+			pumpLink();
+			usleep(500);
+		}
+	}
+	inGame = false;
+	waitTicks(SHARD_TEST_LINGER);
+	result->owner = ShardOwner;
+	result->outcome = outcome;
+	result->stats = ShardStats;
+	result->snakeLength = GameState.snakeLength;
+	memcpy(result->snake, GameState.snakePositions, sizeof(result->snake));
+	memcpy(result->cells, WorldCells, sizeof(result->cells));
+}
+
+/* Reads what one board sent and queues it for its east neighbour */
+static void carryLink(int from, LinkCableType *cable, unsigned int latency)
+{
+	LinkChunkType *chunk;
+	char buffer[SHARD_TEST_CHUNK_SIZE];
+	ssize_t n;
+	while ((n = read(from, buffer, sizeof(buffer))) > 0 && cable->count < SHARD_TEST_CHUNKS)
+	{
+		chunk = &cable->chunks[(cable->head + cable->count) % SHARD_TEST_CHUNKS];
+		chunk->due = nowMs() + latency;
+		chunk->length = (int)n;
+		memcpy(chunk->data, buffer, (size_t)n);
+		cable->count++;
+	}
+}
+
+static void deliverLink(int to, LinkCableType *cable)
+{
+	LinkChunkType *chunk;
+	while (cable->count > 0)
+	{
+		chunk = &cable->chunks[cable->head];
+		if (chunk->due > nowMs()) break;
+		if (write(to, chunk->data, (size_t)chunk->length) < 0) break;
+		cable->head = (cable->head + 1) % SHARD_TEST_CHUNKS;
+		cable->count--;
+	}
+}
+
+static bool readAll(int fd, void *data, size_t length)
+{
+	char *bytes = data;
+	ssize_t n;
+	while (length > 0)
+	{
+		n = read(fd, bytes, length);
+		if (n <= 0) return false;
+		bytes += n;
+		length -= (size_t)n;
+	}
+	return true;
+}
+
+/* The owner's snake in world columns, drawn onto every board's cells */
+static unsigned long checkBoards(int count)
+{
+	static char expected[SHARD_MAX_COUNT][ENV_HEIGHT][ENV_WIDTH];
+	const BoardResultType *owner = NULL;
+	unsigned long mismatched = 0;
+	int width = count * ENV_WIDTH;
+	int board;
+	int x;
+	int y;
+	int i;
+	for (board = 0; board < count; board++)
+	{
+		if (!Results[board].owner) continue;
+		if (owner != NULL) return 1;
+		owner = &Results[board];
+	}
+	if (owner == NULL) return 1;
+	memset(expected, 0, sizeof(expected));
+	for (i = 0; i < owner->snakeLength; i++)
+	{
+		x = (((int)(owner - Results) * ENV_WIDTH + owner->snake[i].x) % width + width) % width;
+		expected[x / ENV_WIDTH][owner->snake[i].y][x % ENV_WIDTH] = 1;
+	}
+	for (board = 0; board < count; board++)
+	{
+		for (y = 0; y < ENV_HEIGHT; y++)
+		{
+			for (x = 0; x < ENV_WIDTH; x++)
+			{
+				if (expected[board][y][x] != (Results[board].cells[y][x] == 'o' || Results[board].cells[y][x] == '@')) mismatched++;
+			}
+		}
+	}
+	return mismatched;
+}
+
+static bool runLatency(int count, unsigned int period, unsigned long maxTicks, unsigned int latency)
+{
+	int links[SHARD_MAX_COUNT][2];
+	int cables[SHARD_MAX_COUNT][2];
+	int results[SHARD_MAX_COUNT][2];
+	pid_t child;
+	unsigned long handoffs = 0;
+	unsigned long retries = 0;
+	unsigned long cells = 0;
+	unsigned long forwarded = 0;
+	unsigned long badBytes = 0;
+	unsigned long late = 0;
+	unsigned long long totalLatency = 0;
+	unsigned long long maxLatency = 0;
+	unsigned long long elapsed;
+	uint64_t totalRoundTrip = 0;
+	uint32_t maxRoundTrip = 0;
+	unsigned long mismatched;
+	int exited = 0;
+	int status;
+	int board;
+	int other;
+	int i;
+	int j;
+	/* Board k writes links[k], the parent carries it to cables[k + 1], which board k + 1 reads */
+	for (board = 0; board < count; board++)
+	{
+		if (pipe(links[board]) < 0 || pipe(cables[board]) < 0 || pipe(results[board]) < 0)
+		{
+			perror("pipe");
+			return false;
+		}
+		fcntl(links[board][0], F_SETFL, fcntl(links[board][0], F_GETFL) | O_NONBLOCK);
+	}
+	memset(Cables, 0, sizeof(Cables));
+	StartMs = nowMs();
+	for (board = 0; board < count; board++)
+	{
+		child = fork();
+		if (child == 0)
+		{
+			for (i = 0; i < count; i++)
+			{
+				if (i != board)
+				{
+					close(links[i][1]);
+					close(results[i][1]);
+				}
+				if (i != (board + count - 1) % count) close(cables[i][0]);
+				close(links[i][0]);
+				close(cables[i][1]);
+				close(results[i][0]);
+			}
+			LinkTxFd = links[board][1];
+			LinkRxFd = cables[(board + count - 1) % count][0];
+			runBoard(board, count, period, maxTicks, &Results[board]);
+			if (write(results[board][1], &Results[board], sizeof(Results[board])) != sizeof(Results[board])) _exit(1);
+			_exit(0);
+		}
+	}
+	for (board = 0; board < count; board++)
+	{
+		close(links[board][1]);
+		close(cables[board][0]);
+		close(results[board][1]);
+	}
+	/* The results are read as they come, a pipe does not hold a whole one */
+	while (exited < count)
+	{
+		for (board = 0; board < count; board++)
+		{
+			carryLink(links[board][0], &Cables[board], latency);
+			deliverLink(cables[board][1], &Cables[board]);
+		}
+		for (board = 0; board < count; board++)
+		{
+			if (results[board][0] < 0) continue;
+			fcntl(results[board][0], F_SETFL, fcntl(results[board][0], F_GETFL) | O_NONBLOCK);
+			if (read(results[board][0], &Results[board], 1) != 1) continue;
+			fcntl(results[board][0], F_SETFL, fcntl(results[board][0], F_GETFL) & ~O_NONBLOCK);
+			if (!readAll(results[board][0], (char *)&Results[board] + 1, sizeof(Results[board]) - 1)) memset(&Results[board], 0, sizeof(Results[board]));
+			close(results[board][0]);
+			results[board][0] = -1;
+		}
+		if (waitpid(-1, &status, WNOHANG) > 0) exited++;
+		usleep(200);
+	}
+	for (board = 0; board < count; board++)
+	{
+		if (results[board][0] >= 0)
+		{
+			fcntl(results[board][0], F_SETFL, fcntl(results[board][0], F_GETFL) & ~O_NONBLOCK);
+			if (!readAll(results[board][0], &Results[board], sizeof(Results[board]))) memset(&Results[board], 0, sizeof(Results[board]));
+			close(results[board][0]);
+		}
+		close(links[board][0]);
+		close(cables[board][1]);
+	}
+	for (board = 0; board < count; board++)
+	{
+		if (!Results[board].started)
+		{
+			printf("board %d did not start\n", board);
+			return false;
+		}
+		retries += Results[board].stats.handoffRetries;
+		cells += Results[board].stats.cellsSent;
+		forwarded += Results[board].stats.forwarded;
+		badBytes += Results[board].stats.badBytes;
+		totalRoundTrip += Results[board].stats.totalHandoffTime;
+		if (Results[board].stats.maxHandoffTime > maxRoundTrip) maxRoundTrip = Results[board].stats.maxHandoffTime;
+		/* Each handoff sent here against the first move on whichever board took it */
+		for (i = 0; i < Results[board].eventCount; i++)
+		{
+			if (Results[board].events[i].taken) continue;
+			for (other = 0; other < count; other++)
+			{
+				for (j = 0; j < Results[other].eventCount; j++)
+				{
+					if (!Results[other].events[j].taken || Results[other].events[j].sequence != Results[board].events[i].sequence) continue;
+					if (Results[other].events[j].time < Results[board].events[i].time) continue;
+					elapsed = Results[other].events[j].time - Results[board].events[i].time;
+					/* The sequence wraps, the nearest one after is the one */
+					if (elapsed > 1000000ULL) continue;
+					handoffs++;
+					totalLatency += elapsed;
+					if (elapsed > maxLatency) maxLatency = elapsed;
+					if (elapsed > period * 1000ULL) late++;
+					other = count;
+					break;
+				}
+			}
+		}
+	}
+	mismatched = checkBoards(count);
+	printf("%5u ms  %8lu  %7.2f  %7.2f  %5lu  %7.2f  %7.2f  %7lu  %6lu  %6lu  %8lu  %s\n", latency, handoffs,
+		handoffs > 0 ? totalLatency / 1000.0 / handoffs : 0.0, maxLatency / 1000.0, late,
+		handoffs > 0 ? (double)totalRoundTrip / TimestampsPerMs / handoffs : 0.0, (double)maxRoundTrip / TimestampsPerMs,
+		retries, cells, forwarded, badBytes, mismatched == 0 ? "agree" : "MISMATCH");
+	return mismatched == 0;
+}
+
+static void printTickTimes(int count)
+{
+	int board;
+	unsigned long others;
+	printf("board  ticks  with snake  avg us  max us  without  avg us  max us\n");
+	for (board = 0; board < count; board++)
+	{
+		others = Results[board].ticks - Results[board].ownerTicks;
+		printf("%5d  %5lu  %10lu  %6.2f  %6.2f  %7lu  %6.2f  %6.2f\n", board, Results[board].ticks, Results[board].ownerTicks,
+			Results[board].ownerTicks > 0 ? Results[board].ownerNs / 1000.0 / Results[board].ownerTicks : 0.0, Results[board].maxOwnerNs / 1000.0,
+			others, others > 0 ? Results[board].otherNs / 1000.0 / others : 0.0, Results[board].maxOtherNs / 1000.0);
+	}
+}
+
+/* Noise on the link, with false sync bytes and a frame too long to be one,
+ * then a START: the ShardTask has to find the START behind the noise */
+static bool checkShardResync(void)
+{
+	uint8_t bytes[128];
+	int length = 0;
+	int start;
+	uint16_t checksum;
+	int speed = 0;
+	bool found;
+	int i;
+	for (i = 0; i < 40; i++) bytes[length++] = (uint8_t)(i % 3 == 0 ? SHARD_SYNC : i * 7);
+	bytes[length++] = SHARD_SYNC;
+	bytes[length++] = SHARD_START;
+	bytes[length++] = 1;
+	bytes[length++] = 255;
+	start = length;
+	bytes[length++] = SHARD_SYNC;
+	bytes[length++] = SHARD_START;
+	bytes[length++] = 1;
+	bytes[length++] = 2;
+	bytes[length++] = 0xD2;
+	bytes[length++] = 0x04;
+	checksum = shardChecksum(bytes + start, length - start + 2);
+	bytes[length++] = (uint8_t)checksum;
+	bytes[length++] = (uint8_t)(checksum >> 8);
+	for (i = 0; i < length; i++) receiveShardByte(bytes[i]);
+	found = takeShardStart(&speed) && speed == 1234 && ShardStats.badBytes >= 40;
+	printf("resync after %d bytes of noise: %s\n", start, found ? "found the START" : "FAILED");
+	memset(&ShardStats, 0, sizeof(ShardStats));
+	return found;
+}
+
+int main(int argc, char **argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : SHARD_TEST_BOARDS;
+	unsigned int period = argc > 2 ? (unsigned int)atoi(argv[2]) : SHARD_TEST_PERIOD;
+	unsigned long maxTicks = argc > 3 ? strtoul(argv[3], NULL, 10) : SHARD_TEST_TICKS;
+	bool passed = true;
+	unsigned int i;
+	if (count < 2 || count > SHARD_MAX_COUNT || period == 0)
+	{
+		fprintf(stderr, "usage: %s [boards 2-%d] [tick ms] [ticks]\n", argv[0], SHARD_MAX_COUNT);
+		return 2;
+	}
+	setvbuf(stdout, NULL, _IONBF, 0);
+	TimestampsPerMs = SysCtlClockGet() / 1000;
+	printf("%d boards of %dx%d, %u ms ticks, %lu ticks on the last owner, handoff retried after %d ticks\n",
+		count, ENV_WIDTH, ENV_HEIGHT, period, maxTicks, SHARD_HANDOFF_RETRY);
+	if (!checkShardResync()) passed = false;
+	printf("          one-way handoff to next move    sender's handoff to ack\n");
+	printf(" latency  handoffs   avg ms   max ms   late   avg ms   max ms  retries   cells   fwded  badbytes  screens\n");
+	for (i = 0; i < sizeof(Latencies) / sizeof(Latencies[0]); i++)
+	{
+		if (!runLatency(count, period, maxTicks, Latencies[i])) passed = false;
+		printTickTimes(count);
+	}
+	printf(passed ? "every board showed its part of the snake\n" : "shard check FAILED\n");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,307 @@
+/* Host check and measurement of the spectator broadcast.
+ *
+ * Bot games are played with the render task's loop run for every request and
+ * the spectator port interrupts serviced after it. In the check run ports join
+ * at different points, one is held back until it has to be resynchronised and
+ * one leaves and comes back. Every watching port's screen, on the terminal
+ * stand-in, has to match the player's after every tick. The timed runs then
+ * play the same games with 0 to 4 spectators watching from the start and
+ * split the time between the render task and the port interrupts.
+ *
+ * Build and run from the repository root:
+ *   make -C host spectate
+ *   host/spectate [games]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+#include "terminal.h"
+
+#define SPECTATE_MAX_TICKS		2000
+#define SPECTATE_RUNS			5
+
+typedef enum
+{
+	EVENT_JOIN,
+	EVENT_LEAVE,
+	EVENT_STALL,
+	EVENT_RELEASE
+} SpectateEventKind;
+
+/* Something a port does at a given game and tick, tick -1 is the main menu and SPECTATE_MAX_TICKS the end message */
+typedef struct SpectateEvent
+{
+	unsigned long game;
+	long tick;
+	int port;
+	SpectateEventKind kind;
+} SpectateEventType;
+
+static const SpectateEventType CheckEvents[] =
+{
+	{0, -1, 0, EVENT_JOIN},
+	{0, 30, 1, EVENT_JOIN},
+	{0, SPECTATE_MAX_TICKS, 2, EVENT_JOIN},
+	{1, 10, 1, EVENT_STALL},
+	{1, 150, 1, EVENT_RELEASE},
+	{2, -1, 3, EVENT_JOIN},
+	{3, 20, 2, EVENT_JOIN},
+	{4, 5, 3, EVENT_LEAVE},
+	{5, 40, 3, EVENT_JOIN}
+};
+
+HostTerminalType PlayerTerminal;
+HostTerminalType SpectatorTerminals[SPECTATOR_PORTS];
+bool Checking = false;
+uint8_t PendingPorts = 0;
+unsigned long long InterruptNs = 0;
+unsigned long Mismatches = 0;
+unsigned long Checks = 0;
+
+static unsigned long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void feedOutput(uint32_t base, unsigned char data)
+{
+	int i;
+	if (!Checking) return;
+	if (base == UART0_BASE) feedTerminal(&PlayerTerminal, data);
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		if (SpectatorPortConfigs[i].base == base) feedTerminal(&SpectatorTerminals[i], data);
+	}
+}
+
+static void pendInterrupt(uint32_t interrupt)
+{
+	int i;
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		if (SpectatorPortConfigs[i].interrupt == interrupt) PendingPorts |= 1 << i;
+	}
+}
+
+/* The body of RenderTask, run as soon as a request is sent */
+static void renderLikeRenderTask(QueueHandle_t queue, const void *item)
+{
+	if (queue != RenderQueue) return;
+	sendSpectatorKeyframes();
+	renderRequest((const RenderRequestType *)item);
+	flushSpectators();
+}
+
+static void servicePorts(void)
+{
+	unsigned long long start = nowNs();
+	int i;
+	while (PendingPorts != 0)
+	{
+		for (i = 0; i < SPECTATOR_PORTS; i++)
+		{
+			if ((PendingPorts & (1 << i)) == 0) continue;
+			PendingPorts &= ~(1 << i);
+			serviceSpectatorPort(i);
+		}
+	}
+	InterruptNs += nowNs() - start;
+}
+
+/* A key on the port, its receive interrupt does the rest */
+static void pressSpectatorKey(int port)
+{
+	char key = ' ';
+	hostUartPushRx(SpectatorPortConfigs[port].base, &key, 1);
+	serviceSpectatorPort(port);
+}
+
+static void runEvents(unsigned long game, long tick)
+{
+	const SpectateEventType *event;
+	unsigned int i;
+	if (!Checking) return;
+	for (i = 0; i < sizeof(CheckEvents) / sizeof(CheckEvents[0]); i++)
+	{
+		event = &CheckEvents[i];
+		if (event->game != game || event->tick != tick) continue;
+		switch (event->kind)
+		{
+			case EVENT_JOIN:
+				pressSpectatorKey(event->port);
+				break;
+			case EVENT_LEAVE:
+				stopSpectator(event->port);
+				break;
+			case EVENT_STALL:
+				HostUartTxFull[(SpectatorPortConfigs[event->port].base - UART0_BASE) >> 12] = true;
+				break;
+			case EVENT_RELEASE:
+				HostUartTxFull[(SpectatorPortConfigs[event->port].base - UART0_BASE) >> 12] = false;
+				PendingPorts |= 1 << event->port;
+				break;
+		}
+	}
+}
+
+/* A port that is watching and has sent everything must show what the player sees */
+static void checkScreens(void)
+{
+	HostTerminalCellType spectator;
+	HostTerminalCellType player;
+	SpectatorPortType *port;
+	int row;
+	int column;
+	int i;
+	servicePorts();
+	if (!Checking) return;
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		port = &SpectatorPorts[i];
+		if (port->state != SPECTATOR_WATCHING || port->head != port->tail) continue;
+		Checks++;
+		for (row = 1; row <= TERMINAL_ROWS; row++)
+		{
+			for (column = 1; column <= TERMINAL_COLUMNS; column++)
+			{
+				spectator = terminalCellAttributes(&SpectatorTerminals[i], row, column);
+				player = terminalCellAttributes(&PlayerTerminal, row, column);
+				if (spectator.glyph == player.glyph && spectator.foreground == player.foreground && spectator.background == player.background) continue;
+				Mismatches++;
+				row = TERMINAL_ROWS;
+				break;
+			}
+		}
+	}
+}
+
+static unsigned long playGame(unsigned long game)
+{
+	const RenderRequestType mainMenuRenderRequest = RENDER_REQUEST(MAIN_MENU);
+	const RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	const RenderRequestType lossMessageRenderRequest = RENDER_REQUEST(LOSS_MESSAGE);
+	uint32_t botState = (uint32_t)game * 2654435761u + 1;
+	HostSpawnersType spawners;
+	unsigned long period;
+	long tick;
+	char key;
+
+	renderLikeRenderTask(RenderQueue, &mainMenuRenderRequest);
+	runEvents(game, -1);
+	checkScreens();
+	resetGameState();
+	SnakeSpeed = INITIAL_SNAKE_SPEED;
+	period = (60000 / SnakeSpeed) / portTICK_RATE_MS;
+	seedRandomNumber((int)game + 1);
+	resetHostSpawners(&spawners);
+	renderLikeRenderTask(RenderQueue, &gameStartRenderRequest);
+	checkScreens();
+	for (tick = 0; tick < SPECTATE_MAX_TICKS; tick++)
+	{
+		key = chooseBotKey(&botState);
+		if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		if (snakeTick() != GAME_RUNNING) break;
+		runHostSpawners(&spawners, period);
+		runEvents(game, tick);
+		checkScreens();
+	}
+	renderLikeRenderTask(RenderQueue, &lossMessageRenderRequest);
+	runEvents(game, SPECTATE_MAX_TICKS);
+	checkScreens();
+	return (unsigned long)tick;
+}
+
+static void resetSpectators(void)
+{
+	int i;
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		stopSpectator(i);
+		servicePorts();
+		SpectatorPorts[i].bytesSent = 0;
+		SpectatorPorts[i].keyframes = 0;
+		SpectatorPorts[i].resyncs = 0;
+		HostUartTxFull[(SpectatorPortConfigs[i].base - UART0_BASE) >> 12] = false;
+	}
+	SpectatorBytesEncoded = 0;
+	InterruptNs = 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long games = argc > 1 ? strtoul(argv[1], NULL, 0) : 20;
+	unsigned long long start;
+	unsigned long long best;
+	unsigned long long bestInterrupt;
+	unsigned long long elapsed;
+	unsigned long ticks;
+	unsigned long sent;
+	unsigned long player;
+	unsigned long game;
+	int spectators;
+	int run;
+	int i;
+
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	HostQueueSendHook = renderLikeRenderTask;
+	HostUartTxHook = feedOutput;
+	HostIntPendHook = pendInterrupt;
+	initializeSpectators();
+
+	Checking = true;
+	resetTerminal(&PlayerTerminal);
+	for (i = 0; i < SPECTATOR_PORTS; i++) resetTerminal(&SpectatorTerminals[i]);
+	for (game = 0; game < games; game++) playGame(game);
+	printf("check: %lu screen comparisons, %lu mismatched\n", Checks, Mismatches);
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		printf("  port %d sent=%lu keyframes=%lu resyncs=%lu\n", i, SpectatorPorts[i].bytesSent, SpectatorPorts[i].keyframes, SpectatorPorts[i].resyncs);
+	}
+	Checking = false;
+
+	printf("spectators  ns/tick  render ns/tick  interrupt ns/tick  encoded bytes/tick  sent bytes/tick\n");
+	for (spectators = 0; spectators <= SPECTATOR_PORTS; spectators++)
+	{
+		best = ~0ULL;
+		bestInterrupt = 0;
+		ticks = 0;
+		sent = 0;
+		player = 0;
+		for (run = 0; run < SPECTATE_RUNS; run++)
+		{
+			resetSpectators();
+			for (i = 0; i < spectators; i++) pressSpectatorKey(i);
+			ticks = 0;
+			player = HostUartTxCount[0];
+			start = nowNs();
+			for (game = 0; game < games; game++) ticks += playGame(game);
+			elapsed = nowNs() - start;
+			player = HostUartTxCount[0] - player;
+			if (elapsed < best)
+			{
+				best = elapsed;
+				bestInterrupt = InterruptNs;
+			}
+			sent = 0;
+			for (i = 0; i < SPECTATOR_PORTS; i++) sent += SpectatorPorts[i].bytesSent;
+		}
+		printf("%10d  %7.1f  %14.1f  %17.1f  %18.1f  %15.1f\n", spectators, (double)best / ticks, (double)(best - bestInterrupt) / ticks,
+			(double)bestInterrupt / ticks, (double)SpectatorBytesEncoded / ticks, (double)sent / ticks);
+	}
+	printf("player terminal %.1f bytes/tick\n", (double)player / ticks);
+	return Mismatches == 0 && Checks > 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+/* Host run of the stress ramp against a model of the game UART.
+ *
+ * The firmware's stress code runs unchanged: the synthetic player, the spawn
+ * churn and the step bookkeeping of stress.c, with snakeTick reading its keys.
+ * What the board does in real time is modelled on a microsecond clock. Every
+ * render request is rendered at once to count its bytes, then takes its turn
+ * on a wire of the given baud rate with 10 bits a byte. RenderQueue holds
+ * RENDER_QUEUE_LENGTH requests behind the one being sent, a send to a full
+ * queue holds the snake task until the oldest is done. Ticks start at their
+ * deadline or, running late, as soon as the last one finished, as with the
+ * catch-up policy, and the player sends a key at every deadline on its own
+ * clock. The CPU time of a tick is left out, the wire is what runs out first.
+ * The profile zones of the ramp are printed at the end, with the renders timed
+ * here as RenderTask times them.
+ *
+ * Build and run from the repository root:
+ *   make -C host stress
+ *   host/stress [baud]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+
+#define STRESS_TEST_BAUD		128000
+
+double ModelNow;
+double ModelByteUs;
+double ModelFinish[RENDER_QUEUE_LENGTH + 1];		/* When each request on the wire or waiting for it is done, oldest first */
+int ModelRequests;
+unsigned long ModelBytes;
+
+/* Requests the wire is done with by now */
+static void retireRequests(void)
+{
+	int done = 0;
+	int i;
+	while (done < ModelRequests && ModelFinish[done] <= ModelNow) done++;
+	for (i = done; i < ModelRequests; i++) ModelFinish[i - done] = ModelFinish[i];
+	ModelRequests -= done;
+}
+
+static void sendModelRequest(QueueHandle_t queue, const void *item)
+{
+	unsigned long bytes = HostUartTxCount[0];
+	uint32_t profileStart;
+	double start;
+	if (queue != RenderQueue) return;
+	PROFILE_START(profileStart);
+	renderRequest((const RenderRequestType *)item);
+	PROFILE_END(PROFILE_RENDER + renderCategory(*(const RenderRequestType *)item), profileStart);
+	bytes = HostUartTxCount[0] - bytes;
+	ModelBytes += bytes;
+	retireRequests();
+	/* A full queue holds the snake task until the request on the wire is done */
+	if (ModelRequests == RENDER_QUEUE_LENGTH + 1)
+	{
+		ModelNow = ModelFinish[0];
+		retireRequests();
+	}
+	start = ModelRequests > 0 ? ModelFinish[ModelRequests - 1] : ModelNow;
+	ModelFinish[ModelRequests++] = start + bytes * ModelByteUs;
+}
+
+/* The console port to stdout, for dumpProfile */
+static void printConsoleChar(uint32_t base, unsigned char data)
+{
+	if (base == CONSOLE_UART_BASE && data != '\r') putchar(data);
+}
+
+int main(int argc, char **argv)
+{
+	const RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	long baud = argc > 1 ? atol(argv[1]) : STRESS_TEST_BAUD;
+	double deadline = 0;
+	double nextKey = 0;
+	double tickStart;
+	bool missed = false;
+	bool overrun;
+	unsigned int backlog;
+	unsigned long ticks = 0;
+	GameOutcomeType outcome = GAME_RUNNING;
+	const StressStepType *step;
+	int limit;
+	int i;
+	if (baud < 1200) baud = STRESS_TEST_BAUD;
+	ModelByteUs = 10.0 * 1e6 / baud;
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	NormalPowerUpSemaphore = xSemaphoreCreateBinary();
+	RenderQueue = xQueueCreate(RENDER_QUEUE_LENGTH, sizeof(RenderRequestType));
+	HostQueueSendHook = sendModelRequest;
+	TimestampsPerMs = 1000;
+
+	StressMode = true;
+	SnakeSpeed = STRESS_START_SPEED;
+	startStress();
+	initializeProfile();
+	seedRandomNumber(12345);
+	resetGameState();
+	xQueueSend(RenderQueue, (const void *)&gameStartRenderRequest, portMAX_DELAY);
+	while (outcome == GAME_RUNNING)
+	{
+		tickStart = deadline > ModelNow ? deadline : ModelNow;
+		ModelNow = tickStart;
+		while (nextKey <= ModelNow)
+		{
+			postStressKey(chooseStressKey());
+			nextKey += 60e6 / SnakeSpeed;
+		}
+		retireRequests();
+		overrun = ModelRequests > 0;
+		backlog = ModelRequests > 0 ? ModelRequests - 1 : 0;
+		outcome = snakeTick();
+		outcome = stressTick(outcome, (uint32_t)tickStart, missed, overrun, backlog);
+		deadline += 60e6 / SnakeSpeed;
+		missed = ModelNow > deadline;
+		ticks++;
+	}
+
+	printf("%ld baud, %d requests queued, %lu ticks, %.1f bytes a tick\n", baud, RENDER_QUEUE_LENGTH, ticks, (double)ModelBytes / ticks);
+	printf("%-8s %10s %8s %10s %8s %8s %9s\n", "speed", "achieved", "missed", "overruns", "backlog", "dropped", "restarts");
+	for (i = 0; i < StressStepCount; i++)
+	{
+		step = &StressSteps[i];
+		printf("%-8d %10lu %8u %10u %8u %8u %9u%s\n", step->speed, (unsigned long)measureStressRate(step), step->missedDeadlines,
+			step->renderOverruns, step->maxBacklog, step->droppedInputs, step->restarts, isStressStepMet(step) ? "" : "  late");
+	}
+	HostUartTxHook = printConsoleChar;
+	dumpProfile(CONSOLE_UART_BASE);
+	limit = findStressLimit();
+	printf("highest speed kept up with %d, %s MAXIMUM_SNAKE_SPEED %d\n", limit, limit >= MAXIMUM_SNAKE_SPEED ? "at or above" : "below", MAXIMUM_SNAKE_SPEED);
+	return limit > 0 ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+/* Host stand-in for the FreeRTOS kernel, just enough to compile main.c natively */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef TickType_t portTickType;
+
+#define portMAX_DELAY			((TickType_t)0xffffffffUL)
+#define portTICK_RATE_MS		((TickType_t)1)
+#define portTICK_PERIOD_MS		portTICK_RATE_MS
+#define configMAX_TASK_NAME_LEN	10
+#define configTICK_RATE_HZ		((TickType_t)1000)
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY	(5 << 5)
+#define configKERNEL_INTERRUPT_PRIORITY		(7 << 5)
+#define pdFALSE					((BaseType_t)0)
+#define pdTRUE					((BaseType_t)1)
+#define pdPASS					pdTRUE
+#define pdFAIL					pdFALSE
+#define errQUEUE_FULL			((BaseType_t)0)
+#define errQUEUE_EMPTY			((BaseType_t)0)
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define taskENTER_CRITICAL_FROM_ISR()	((UBaseType_t)0)
+#define taskEXIT_CRITICAL_FROM_ISR(x)	((void)(x))
+#define taskDISABLE_INTERRUPTS()
+#define taskENABLE_INTERRUPTS()
+#define portYIELD_FROM_ISR(x)	((void)(x))
+
+/* Host tick counter, advanced by the delay stand-ins */
+extern TickType_t HostTickCount;
+
+#endif /* INC_FREERTOS_H */
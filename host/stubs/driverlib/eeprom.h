@@ -0,0 +1,22 @@
+#ifndef __DRIVERLIB_EEPROM_H__
+#define __DRIVERLIB_EEPROM_H__
+
+#include <stdint.h>
+
+#define EEPROM_INIT_OK			0
+#define EEPROM_INIT_ERROR		2
+
+#define EEPROM_RC_WORKING		0x00000001
+#define EEPROM_RC_WKERASE		0x00000004
+#define EEPROM_RC_WKCOPY		0x00000008
+#define EEPROM_RC_NOPERM		0x00000010
+#define EEPROM_RC_WRBUSY		0x00000020
+
+uint32_t EEPROMInit(void);
+uint32_t EEPROMSizeGet(void);
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMProgramNonBlocking(uint32_t ui32Data, uint32_t ui32Address);
+uint32_t EEPROMStatusGet(void);
+
+#endif /* __DRIVERLIB_EEPROM_H__ */
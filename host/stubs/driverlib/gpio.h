@@ -0,0 +1,17 @@
+#ifndef __DRIVERLIB_GPIO_H__
+#define __DRIVERLIB_GPIO_H__
+
+#include <stdint.h>
+
+#define GPIO_PIN_0				0x00000001
+#define GPIO_PIN_1				0x00000002
+#define GPIO_PIN_4				0x00000010
+#define GPIO_PIN_5				0x00000020
+#define GPIO_PIN_6				0x00000040
+#define GPIO_PIN_7				0x00000080
+
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinConfigure(uint32_t ui32PinConfig);
+void GPIOUnlockPin(uint32_t ui32Port, uint8_t ui8Pins);
+
+#endif /* __DRIVERLIB_GPIO_H__ */
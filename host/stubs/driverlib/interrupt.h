@@ -0,0 +1,14 @@
+#ifndef __DRIVERLIB_INTERRUPT_H__
+#define __DRIVERLIB_INTERRUPT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void IntEnable(uint32_t ui32Interrupt);
+void IntDisable(uint32_t ui32Interrupt);
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority);
+void IntPendSet(uint32_t ui32Interrupt);
+bool IntMasterEnable(void);
+bool IntMasterDisable(void);
+
+#endif /* __DRIVERLIB_INTERRUPT_H__ */
@@ -0,0 +1,29 @@
+#ifndef __DRIVERLIB_SYSCTL_H__
+#define __DRIVERLIB_SYSCTL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SYSCTL_PERIPH_GPIOA		0xf0000800
+#define SYSCTL_PERIPH_GPIOB		0xf0000801
+#define SYSCTL_PERIPH_GPIOC		0xf0000802
+#define SYSCTL_PERIPH_GPIOD		0xf0000803
+#define SYSCTL_PERIPH_GPIOE		0xf0000804
+#define SYSCTL_PERIPH_TIMER0	0xf0000400
+#define SYSCTL_PERIPH_TIMER1	0xf0000401
+#define SYSCTL_PERIPH_WTIMER0	0xf0005c00
+#define SYSCTL_PERIPH_UART0		0xf0001800
+#define SYSCTL_PERIPH_UART1		0xf0001801
+#define SYSCTL_PERIPH_UART2		0xf0001802
+#define SYSCTL_PERIPH_UART3		0xf0001803
+#define SYSCTL_PERIPH_UART4		0xf0001804
+#define SYSCTL_PERIPH_UART5		0xf0001805
+#define SYSCTL_PERIPH_UART6		0xf0001806
+#define SYSCTL_PERIPH_UART7		0xf0001807
+#define SYSCTL_PERIPH_EEPROM0	0xf0005800
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral);
+uint32_t SysCtlClockGet(void);
+
+#endif /* __DRIVERLIB_SYSCTL_H__ */
@@ -0,0 +1,4 @@
+#ifndef __DRIVERLIB_SYSTICK_H__
+#define __DRIVERLIB_SYSTICK_H__
+
+#endif /* __DRIVERLIB_SYSTICK_H__ */
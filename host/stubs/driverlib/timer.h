@@ -0,0 +1,23 @@
+#ifndef __DRIVERLIB_TIMER_H__
+#define __DRIVERLIB_TIMER_H__
+
+#include <stdint.h>
+
+#define TIMER_CFG_PERIODIC		0x00000022
+#define TIMER_CFG_SPLIT_PAIR	0x04000000
+#define TIMER_CFG_A_PERIODIC	0x00000022
+#define TIMER_A					0x000000ff
+#define TIMER_TIMA_TIMEOUT		0x00000001
+#define TIMER_UP_LOAD_TIMEOUT	0x00000100
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config);
+void TimerUpdateMode(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Config);
+void TimerPrescaleSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+
+#endif /* __DRIVERLIB_TIMER_H__ */
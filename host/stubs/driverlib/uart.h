@@ -0,0 +1,31 @@
+#ifndef __DRIVERLIB_UART_H__
+#define __DRIVERLIB_UART_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define UART_CONFIG_WLEN_8		0x00000060
+#define UART_CONFIG_STOP_ONE	0x00000000
+#define UART_CONFIG_PAR_NONE	0x00000000
+#define UART_INT_RT				0x040
+#define UART_INT_TX				0x020
+#define UART_INT_RX				0x010
+#define UART_FIFO_TX2_8			0x00000001
+#define UART_FIFO_RX1_8			0x00000000
+
+void UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk, uint32_t ui32Baud, uint32_t ui32Config);
+void UARTFIFOEnable(uint32_t ui32Base);
+void UARTFIFODisable(uint32_t ui32Base);
+void UARTFIFOLevelSet(uint32_t ui32Base, uint32_t ui32TxLevel, uint32_t ui32RxLevel);
+bool UARTCharsAvail(uint32_t ui32Base);
+int32_t UARTCharGet(uint32_t ui32Base);
+int32_t UARTCharGetNonBlocking(uint32_t ui32Base);
+void UARTCharPut(uint32_t ui32Base, unsigned char ucData);
+bool UARTCharPutNonBlocking(uint32_t ui32Base, unsigned char ucData);
+bool UARTSpaceAvail(uint32_t ui32Base);
+bool UARTBusy(uint32_t ui32Base);
+void UARTIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+void UARTIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+uint32_t UARTIntStatus(uint32_t ui32Base, bool bMasked);
+
+#endif /* __DRIVERLIB_UART_H__ */
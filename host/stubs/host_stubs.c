@@ -0,0 +1,632 @@
+/* Host implementations of the FreeRTOS and TivaWare driverlib calls used by main.c.
+ * The scheduler is not emulated: tasks are never started, delays only advance
+ * HostTickCount unless a tool's HostDelayHook waits for real, queues are plain
+ * rings and semaphores never block. UART output is counted per port and optionally forwarded to HostUartTxHook, UART input is
+ * fed with hostUartPushRx. The EEPROM is a RAM array that counts program
+ * cycles per word and can be made to lose power part way through a write. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/gpio.h>
+#include <driverlib/uart.h>
+#include <driverlib/timer.h>
+#include <driverlib/interrupt.h>
+#include <driverlib/eeprom.h>
+
+#include "host_stubs.h"
+
+struct HostTask
+{
+	TaskFunction_t function;
+	UBaseType_t priority;
+	UBaseType_t number;
+	char name[configMAX_TASK_NAME_LEN];
+	struct HostTask *next;
+};
+
+struct HostQueue
+{
+	UBaseType_t length;
+	UBaseType_t itemSize;
+	UBaseType_t head;
+	UBaseType_t count;
+	unsigned char *storage;
+};
+
+TickType_t HostTickCount = 1;
+static struct HostTask *hostTasks = NULL;
+void (*HostQueueSendHook)(QueueHandle_t xQueue, const void *pvItemToQueue) = NULL;
+void (*HostUartTxHook)(uint32_t base, unsigned char data) = NULL;
+unsigned long HostUartTxCount[HOST_UART_PORTS];
+bool HostUartTxFull[HOST_UART_PORTS];
+void (*HostIntPendHook)(uint32_t interrupt) = NULL;
+void (*HostDelayHook)(uint32_t ticks) = NULL;
+unsigned long HostQueueOverflows = 0;
+
+unsigned long HostEepromWrites[HOST_EEPROM_WORDS];
+unsigned long HostEepromReads = 0;
+unsigned long HostEepromPowerFailAfter = 0;
+
+static uint32_t hostEeprom[HOST_EEPROM_WORDS];
+static bool hostEepromErased = false;
+static bool hostEepromOff = false;
+
+static unsigned char hostUartRx[HOST_UART_PORTS][HOST_UART_RX_SIZE];
+static unsigned int hostUartRxHead[HOST_UART_PORTS];
+static unsigned int hostUartRxCount[HOST_UART_PORTS];
+
+static int hostUartPort(uint32_t base)
+{
+	/* UART0 to UART7 are mapped 4 KB apart starting at UART0_BASE */
+	return (int)((base - UART0_BASE) >> 12) % HOST_UART_PORTS;
+}
+
+/* Tasks */
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint16_t usStackDepth, void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+	struct HostTask *task = calloc(1, sizeof(*task));
+	(void)usStackDepth;
+	(void)pvParameters;
+	task->function = pxTaskCode;
+	task->priority = uxPriority;
+	strncpy(task->name, pcName, configMAX_TASK_NAME_LEN - 1);
+	task->next = hostTasks;
+	hostTasks = task;
+	if (pxCreatedTask != NULL) *pxCreatedTask = task;
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+	struct HostTask **link;
+	for (link = &hostTasks; *link != NULL; link = &(*link)->next)
+	{
+		if (*link == xTaskToDelete)
+		{
+			*link = xTaskToDelete->next;
+			break;
+		}
+	}
+	free(xTaskToDelete);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+	HostTickCount += xTicksToDelay;
+	if (HostDelayHook != NULL) HostDelayHook(xTicksToDelay);
+}
+
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+	*pxPreviousWakeTime += xTimeIncrement;
+	if ((TickType_t)(*pxPreviousWakeTime - HostTickCount) < portMAX_DELAY / 2) HostTickCount = *pxPreviousWakeTime;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return HostTickCount;
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+	return HostTickCount;
+}
+
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority)
+{
+	if (xTask != NULL) xTask->priority = uxNewPriority;
+}
+
+void vTaskStartScheduler(void)
+{
+}
+
+void vTaskSuspendAll(void)
+{
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+	return pdFALSE;
+}
+
+/* No task ever runs on the host, so every task is blocked and has no run time */
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize, uint32_t *pulTotalRunTime)
+{
+	struct HostTask *task;
+	UBaseType_t count = 0;
+	for (task = hostTasks; task != NULL && count < uxArraySize; task = task->next)
+	{
+		memset(&pxTaskStatusArray[count], 0, sizeof(pxTaskStatusArray[count]));
+		pxTaskStatusArray[count].xHandle = task;
+		pxTaskStatusArray[count].pcTaskName = task->name;
+		pxTaskStatusArray[count].xTaskNumber = task->number;
+		pxTaskStatusArray[count].eCurrentState = eBlocked;
+		pxTaskStatusArray[count].uxCurrentPriority = task->priority;
+		pxTaskStatusArray[count].uxBasePriority = task->priority;
+		count++;
+	}
+	if (pulTotalRunTime != NULL) *pulTotalRunTime = HostTickCount;
+	return count;
+}
+
+uint32_t ulTaskGetIdleRunTimeCounter(void)
+{
+	return 0;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandle(void)
+{
+	return NULL;
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+	return xTaskToQuery != NULL ? xTaskToQuery->name : "";
+}
+
+void vTaskSetTaskNumber(TaskHandle_t xTask, UBaseType_t uxHandle)
+{
+	if (xTask != NULL) xTask->number = uxHandle;
+}
+
+UBaseType_t uxTaskGetTaskNumber(TaskHandle_t xTask)
+{
+	return xTask != NULL ? xTask->number : 0;
+}
+
+/* Task notifications, one shared counter. The only task that takes them on the
+ * host is the snake tick, which drops any left over when a game starts, so the
+ * ones endGame gives the main menu do no harm */
+static uint32_t hostNotifyValue = 0;
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+	uint32_t value = hostNotifyValue;
+	(void)xTicksToWait;
+	if (xClearCountOnExit) hostNotifyValue = 0;
+	else if (hostNotifyValue > 0) hostNotifyValue--;
+	return value;
+}
+
+uint32_t ulTaskNotifyValueClear(TaskHandle_t xTask, uint32_t ulBitsToClear)
+{
+	uint32_t value = hostNotifyValue;
+	(void)xTask;
+	hostNotifyValue &= ~ulBitsToClear;
+	return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+	(void)xTaskToNotify;
+	hostNotifyValue++;
+	return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	xTaskNotifyGive(xTaskToNotify);
+	if (pxHigherPriorityTaskWoken != NULL) *pxHigherPriorityTaskWoken = pdFALSE;
+}
+
+/* Queues */
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+	struct HostQueue *queue = calloc(1, sizeof(*queue));
+	queue->length = uxQueueLength;
+	queue->itemSize = uxItemSize;
+	queue->storage = calloc(uxQueueLength, uxItemSize > 0 ? uxItemSize : 1);
+	return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+	(void)xTicksToWait;
+	if (HostQueueSendHook != NULL)
+	{
+		HostQueueSendHook(xQueue, pvItemToQueue);
+		return pdPASS;
+	}
+	if (xQueue == NULL) return errQUEUE_FULL;
+	if (xQueue->count == xQueue->length)
+	{
+		HostQueueOverflows++;
+		return errQUEUE_FULL;
+	}
+	if (xQueue->itemSize > 0)
+	{
+		memcpy(xQueue->storage + ((xQueue->head + xQueue->count) % xQueue->length) * xQueue->itemSize, pvItemToQueue, xQueue->itemSize);
+	}
+	xQueue->count++;
+	return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	if (pxHigherPriorityTaskWoken != NULL) *pxHigherPriorityTaskWoken = pdFALSE;
+	return xQueueSend(xQueue, pvItemToQueue, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+	(void)xTicksToWait;
+	if (xQueue == NULL || xQueue->count == 0) return errQUEUE_EMPTY;
+	if (xQueue->itemSize > 0)
+	{
+		memcpy(pvBuffer, xQueue->storage + xQueue->head * xQueue->itemSize, xQueue->itemSize);
+	}
+	xQueue->head = (xQueue->head + 1) % xQueue->length;
+	xQueue->count--;
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+	return xQueue != NULL ? xQueue->count : 0;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t xQueue)
+{
+	return uxQueueMessagesWaiting(xQueue);
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+	return xQueue != NULL ? xQueue->length - xQueue->count : 0;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+	if (xQueue != NULL) xQueue->count = 0;
+	return pdPASS;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+	if (xQueue == NULL) return;
+	free(xQueue->storage);
+	free(xQueue);
+}
+
+/* Semaphores, modelled as queues of zero sized items */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	SemaphoreHandle_t semaphore = xQueueCreate(1, 0);
+	semaphore->count = 1;
+	return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	return xQueueCreate(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+	(void)xBlockTime;
+	if (xSemaphore == NULL || xSemaphore->count == 0) return pdFALSE;
+	xSemaphore->count--;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+	if (xSemaphore == NULL || xSemaphore->count == xSemaphore->length) return pdFALSE;
+	xSemaphore->count++;
+	return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+	vQueueDelete(xSemaphore);
+}
+
+/* Tasks never run, so nobody is holding a lock while it is looked at */
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t xSemaphore)
+{
+	(void)xSemaphore;
+	return NULL;
+}
+
+/* System control and GPIO */
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral)
+{
+	(void)ui32Peripheral;
+}
+
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral)
+{
+	(void)ui32Peripheral;
+	return true;
+}
+
+uint32_t SysCtlClockGet(void)
+{
+	return 16000000;
+}
+
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins)
+{
+	(void)ui32Port;
+	(void)ui8Pins;
+}
+
+void GPIOPinConfigure(uint32_t ui32PinConfig)
+{
+	(void)ui32PinConfig;
+}
+
+void GPIOUnlockPin(uint32_t ui32Port, uint8_t ui8Pins)
+{
+	(void)ui32Port;
+	(void)ui8Pins;
+}
+
+/* Interrupt controller */
+void IntEnable(uint32_t ui32Interrupt)
+{
+	(void)ui32Interrupt;
+}
+
+void IntDisable(uint32_t ui32Interrupt)
+{
+	(void)ui32Interrupt;
+}
+
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority)
+{
+	(void)ui32Interrupt;
+	(void)ui8Priority;
+}
+
+void IntPendSet(uint32_t ui32Interrupt)
+{
+	if (HostIntPendHook != NULL) HostIntPendHook(ui32Interrupt);
+}
+
+bool IntMasterEnable(void)
+{
+	return false;
+}
+
+bool IntMasterDisable(void)
+{
+	return false;
+}
+
+/* Timers, the counters follow HostTickCount at the SysCtlClockGet rate */
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config)
+{
+	(void)ui32Base;
+	(void)ui32Config;
+}
+
+void TimerUpdateMode(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Config)
+{
+	(void)ui32Base;
+	(void)ui32Timer;
+	(void)ui32Config;
+}
+
+void TimerPrescaleSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value)
+{
+	(void)ui32Base;
+	(void)ui32Timer;
+	(void)ui32Value;
+}
+
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value)
+{
+	(void)ui32Base;
+	(void)ui32Timer;
+	(void)ui32Value;
+}
+
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer)
+{
+	(void)ui32Base;
+	(void)ui32Timer;
+	return 0xFFFFFFFF - HostTickCount * (SysCtlClockGet() / 1000);
+}
+
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer)
+{
+	(void)ui32Base;
+	(void)ui32Timer;
+}
+
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer)
+{
+	(void)ui32Base;
+	(void)ui32Timer;
+}
+
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+	(void)ui32Base;
+	(void)ui32IntFlags;
+}
+
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+	(void)ui32Base;
+	(void)ui32IntFlags;
+}
+
+/* UART */
+void UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk, uint32_t ui32Baud, uint32_t ui32Config)
+{
+	(void)ui32Base;
+	(void)ui32UARTClk;
+	(void)ui32Baud;
+	(void)ui32Config;
+}
+
+void UARTFIFOEnable(uint32_t ui32Base)
+{
+	(void)ui32Base;
+}
+
+void UARTFIFODisable(uint32_t ui32Base)
+{
+	(void)ui32Base;
+}
+
+void UARTFIFOLevelSet(uint32_t ui32Base, uint32_t ui32TxLevel, uint32_t ui32RxLevel)
+{
+	(void)ui32Base;
+	(void)ui32TxLevel;
+	(void)ui32RxLevel;
+}
+
+bool UARTCharsAvail(uint32_t ui32Base)
+{
+	return hostUartRxCount[hostUartPort(ui32Base)] > 0;
+}
+
+int32_t UARTCharGetNonBlocking(uint32_t ui32Base)
+{
+	int port = hostUartPort(ui32Base);
+	unsigned char data;
+	if (hostUartRxCount[port] == 0) return -1;
+	data = hostUartRx[port][hostUartRxHead[port]];
+	hostUartRxHead[port] = (hostUartRxHead[port] + 1) % HOST_UART_RX_SIZE;
+	hostUartRxCount[port]--;
+	return data;
+}
+
+int32_t UARTCharGet(uint32_t ui32Base)
+{
+	/* Nothing can arrive while the host is waiting, so an empty port reads as NUL */
+	int32_t data = UARTCharGetNonBlocking(ui32Base);
+	return data < 0 ? 0 : data;
+}
+
+void UARTCharPut(uint32_t ui32Base, unsigned char ucData)
+{
+	HostUartTxCount[hostUartPort(ui32Base)]++;
+	if (HostUartTxHook != NULL) HostUartTxHook(ui32Base, ucData);
+}
+
+bool UARTCharPutNonBlocking(uint32_t ui32Base, unsigned char ucData)
+{
+	UARTCharPut(ui32Base, ucData);
+	return true;
+}
+
+bool UARTSpaceAvail(uint32_t ui32Base)
+{
+	return !HostUartTxFull[hostUartPort(ui32Base)];
+}
+
+bool UARTBusy(uint32_t ui32Base)
+{
+	(void)ui32Base;
+	return false;
+}
+
+void UARTIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+	(void)ui32Base;
+	(void)ui32IntFlags;
+}
+
+void UARTIntClear(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+	(void)ui32Base;
+	(void)ui32IntFlags;
+}
+
+uint32_t UARTIntStatus(uint32_t ui32Base, bool bMasked)
+{
+	(void)bMasked;
+	return UARTCharsAvail(ui32Base) ? UART_INT_RX : 0;
+}
+
+void hostUartPushRx(uint32_t base, const char *data, unsigned int length)
+{
+	int port = hostUartPort(base);
+	unsigned int i;
+	for (i = 0; i < length && hostUartRxCount[port] < HOST_UART_RX_SIZE; i++)
+	{
+		hostUartRx[port][(hostUartRxHead[port] + hostUartRxCount[port]) % HOST_UART_RX_SIZE] = (unsigned char)data[i];
+		hostUartRxCount[port]++;
+	}
+}
+
+/* EEPROM */
+void hostEepromErase(void)
+{
+	memset(hostEeprom, 0xFF, sizeof(hostEeprom));
+	memset(HostEepromWrites, 0, sizeof(HostEepromWrites));
+	HostEepromReads = 0;
+	hostEepromErased = true;
+}
+
+void hostEepromPowerOn(void)
+{
+	HostEepromPowerFailAfter = 0;
+	hostEepromOff = false;
+}
+
+bool hostEepromPoweredOff(void)
+{
+	return hostEepromOff;
+}
+
+uint32_t EEPROMInit(void)
+{
+	if (!hostEepromErased) hostEepromErase();
+	return EEPROM_INIT_OK;
+}
+
+uint32_t EEPROMSizeGet(void)
+{
+	return HOST_EEPROM_SIZE;
+}
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	uint32_t i;
+	for (i = 0; i < ui32Count / 4; i++)
+	{
+		pui32Data[i] = hostEeprom[(ui32Address / 4 + i) % HOST_EEPROM_WORDS];
+		HostEepromReads++;
+	}
+}
+
+uint32_t EEPROMProgramNonBlocking(uint32_t ui32Data, uint32_t ui32Address)
+{
+	uint32_t word = (ui32Address / 4) % HOST_EEPROM_WORDS;
+	if (hostEepromOff) return 0;
+	HostEepromWrites[word]++;
+	if (HostEepromPowerFailAfter != 0 && --HostEepromPowerFailAfter == 0)
+	{
+		/* Power went away with only some of the bits flipped */
+		hostEeprom[word] = (hostEeprom[word] & 0xFFFF0000) | (ui32Data & 0x0000FFFF);
+		hostEepromOff = true;
+		return 0;
+	}
+	hostEeprom[word] = ui32Data;
+	return 0;
+}
+
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	uint32_t i;
+	for (i = 0; i < ui32Count / 4; i++) EEPROMProgramNonBlocking(pui32Data[i], ui32Address + i * 4);
+	return 0;
+}
+
+uint32_t EEPROMStatusGet(void)
+{
+	return 0;
+}
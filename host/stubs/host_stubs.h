@@ -0,0 +1,36 @@
+#ifndef HOST_STUBS_H
+#define HOST_STUBS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOST_UART_PORTS			8
+#define HOST_UART_RX_SIZE		256
+#define HOST_EEPROM_SIZE		2048
+#define HOST_EEPROM_WORDS		(HOST_EEPROM_SIZE / 4)
+
+/* Bytes written through UARTCharPut, indexed by UART number */
+extern unsigned long HostUartTxCount[HOST_UART_PORTS];
+/* Sends rejected because the queue was full and no HostQueueSendHook was set */
+extern unsigned long HostQueueOverflows;
+extern void (*HostUartTxHook)(uint32_t base, unsigned char data);
+/* UARTSpaceAvail reports a full TX FIFO while set, to hold a port back */
+extern bool HostUartTxFull[HOST_UART_PORTS];
+/* Called by IntPendSet, host tools run the handler from here or later */
+extern void (*HostIntPendHook)(uint32_t interrupt);
+/* Called by vTaskDelay after the tick count moved, for tools that run against real time */
+extern void (*HostDelayHook)(uint32_t ticks);
+
+/* Program cycles per EEPROM word and words read since the last hostEepromErase */
+extern unsigned long HostEepromWrites[HOST_EEPROM_WORDS];
+extern unsigned long HostEepromReads;
+/* When non zero, the word program that brings this to zero is torn and every
+ * later one is dropped until hostEepromPowerOn, emulating a reset mid write */
+extern unsigned long HostEepromPowerFailAfter;
+
+void hostUartPushRx(uint32_t base, const char *data, unsigned int length);
+void hostEepromErase(void);
+void hostEepromPowerOn(void);
+bool hostEepromPoweredOff(void);
+
+#endif /* HOST_STUBS_H */
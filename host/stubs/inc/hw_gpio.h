@@ -0,0 +1,4 @@
+#ifndef __HW_GPIO_H__
+#define __HW_GPIO_H__
+
+#endif /* __HW_GPIO_H__ */
@@ -0,0 +1,14 @@
+#ifndef __HW_INTS_H__
+#define __HW_INTS_H__
+
+#define INT_TIMER0A				35
+#define INT_UART0				21
+#define INT_UART1				22
+#define INT_UART2				49
+#define INT_UART3				75
+#define INT_UART4				76
+#define INT_UART5				77
+#define INT_UART6				78
+#define INT_UART7				79
+
+#endif /* __HW_INTS_H__ */
@@ -0,0 +1,21 @@
+#ifndef __HW_MEMMAP_H__
+#define __HW_MEMMAP_H__
+
+#define GPIO_PORTA_BASE			0x40004000
+#define GPIO_PORTB_BASE			0x40005000
+#define GPIO_PORTC_BASE			0x40006000
+#define GPIO_PORTD_BASE			0x40007000
+#define GPIO_PORTE_BASE			0x40024000
+#define TIMER0_BASE				0x40030000
+#define TIMER1_BASE				0x40031000
+#define WTIMER0_BASE			0x40036000
+#define UART0_BASE				0x4000C000
+#define UART1_BASE				0x4000D000
+#define UART2_BASE				0x4000E000
+#define UART3_BASE				0x4000F000
+#define UART4_BASE				0x40010000
+#define UART5_BASE				0x40011000
+#define UART6_BASE				0x40012000
+#define UART7_BASE				0x40013000
+
+#endif /* __HW_MEMMAP_H__ */
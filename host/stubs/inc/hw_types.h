@@ -0,0 +1,8 @@
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+#include <stdint.h>
+
+#define HWREG(x)				(*((volatile uint32_t *)(x)))
+
+#endif /* __HW_TYPES_H__ */
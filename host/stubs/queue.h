@@ -0,0 +1,22 @@
+#ifndef INC_QUEUE_H
+#define INC_QUEUE_H
+
+#include <FreeRTOS.h>
+
+typedef struct HostQueue *QueueHandle_t;
+typedef QueueHandle_t xQueueHandle;
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t xQueue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue);
+BaseType_t xQueueReset(QueueHandle_t xQueue);
+void vQueueDelete(QueueHandle_t xQueue);
+
+/* Called instead of queueing when set, so host tools can consume requests synchronously */
+extern void (*HostQueueSendHook)(QueueHandle_t xQueue, const void *pvItemToQueue);
+
+#endif /* INC_QUEUE_H */
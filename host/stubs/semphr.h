@@ -0,0 +1,17 @@
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include <queue.h>
+#include <task.h>
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef SemaphoreHandle_t xSemaphoreHandle;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore);
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t xSemaphore);
+
+#endif /* SEMAPHORE_H */
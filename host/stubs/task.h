@@ -0,0 +1,54 @@
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include <FreeRTOS.h>
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct HostTask *TaskHandle_t;
+typedef TaskHandle_t xTaskHandle;
+
+typedef enum
+{
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted,
+	eInvalid
+} eTaskState;
+
+typedef struct xTASK_STATUS
+{
+	TaskHandle_t xHandle;
+	const char *pcTaskName;
+	UBaseType_t xTaskNumber;
+	eTaskState eCurrentState;
+	UBaseType_t uxCurrentPriority;
+	UBaseType_t uxBasePriority;
+	uint32_t ulRunTimeCounter;
+	void *pxStackBase;
+	uint16_t usStackHighWaterMark;
+} TaskStatus_t;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint16_t usStackDepth, void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+void vTaskDelay(TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority);
+void vTaskStartScheduler(void);
+void vTaskSuspendAll(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize, uint32_t *pulTotalRunTime);
+uint32_t ulTaskGetIdleRunTimeCounter(void);
+TaskHandle_t xTaskGetIdleTaskHandle(void);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+uint32_t ulTaskNotifyValueClear(TaskHandle_t xTask, uint32_t ulBitsToClear);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xTaskResumeAll(void);
+char *pcTaskGetName(TaskHandle_t xTaskToQuery);
+void vTaskSetTaskNumber(TaskHandle_t xTask, UBaseType_t uxHandle);
+UBaseType_t uxTaskGetTaskNumber(TaskHandle_t xTask);
+
+#endif /* INC_TASK_H */
@@ -0,0 +1,240 @@
+/* Terminal stand-in for the host tools, see terminal.h. */
+
+#include <string.h>
+
+#include "terminal.h"
+
+enum
+{
+	TERMINAL_GROUND,
+	TERMINAL_ESCAPE,
+	TERMINAL_CSI
+};
+
+static void clampCursor(HostTerminalType *terminal)
+{
+	if (terminal->row < 1) terminal->row = 1;
+	if (terminal->row > TERMINAL_ROWS) terminal->row = TERMINAL_ROWS;
+	if (terminal->column < 1) terminal->column = 1;
+	if (terminal->column > TERMINAL_COLUMNS) terminal->column = TERMINAL_COLUMNS;
+}
+
+static void blankCells(HostTerminalType *terminal, HostTerminalCellType *cells, int count)
+{
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		cells[i].glyph = ' ';
+		cells[i].foreground = TERMINAL_DEFAULT_FOREGROUND;
+		cells[i].background = terminal->background;
+	}
+}
+
+static void clearRow(HostTerminalType *terminal, int row, int from)
+{
+	blankCells(terminal, &terminal->cells[row][from], TERMINAL_COLUMNS + 1 - from);
+}
+
+/* Moves the rows of the scroll region up (count > 0) or down, blanking the rows that come in */
+static void scrollRegion(HostTerminalType *terminal, int count)
+{
+	int row;
+	int height = terminal->bottom - terminal->top + 1;
+	if (count > height) count = height;
+	if (-count > height) count = -height;
+	if (count > 0)
+	{
+		for (row = terminal->top; row <= terminal->bottom - count; row++) memcpy(terminal->cells[row], terminal->cells[row + count], sizeof(terminal->cells[row]));
+		for ( ; row <= terminal->bottom; row++) clearRow(terminal, row, 1);
+	}
+	else if (count < 0)
+	{
+		count = -count;
+		for (row = terminal->bottom; row >= terminal->top + count; row--) memcpy(terminal->cells[row], terminal->cells[row - count], sizeof(terminal->cells[row]));
+		for ( ; row >= terminal->top; row--) clearRow(terminal, row, 1);
+	}
+}
+
+static void selectGraphicRendition(HostTerminalType *terminal)
+{
+	int i;
+	int code;
+	if (terminal->parameterCount == 0)
+	{
+		terminal->foreground = TERMINAL_DEFAULT_FOREGROUND;
+		terminal->background = TERMINAL_DEFAULT_BACKGROUND;
+		return;
+	}
+	for (i = 0; i < terminal->parameterCount; i++)
+	{
+		code = terminal->parameters[i];
+		if (code == 0)
+		{
+			terminal->foreground = TERMINAL_DEFAULT_FOREGROUND;
+			terminal->background = TERMINAL_DEFAULT_BACKGROUND;
+		}
+		else if ((code >= 30 && code <= 37) || code == 39 || (code >= 90 && code <= 97)) terminal->foreground = (uint8_t)code;
+		else if ((code >= 40 && code <= 47) || code == 49 || (code >= 100 && code <= 107)) terminal->background = (uint8_t)code;
+	}
+}
+
+static void runControlSequence(HostTerminalType *terminal, char final)
+{
+	int *parameters = terminal->parameters;
+	/* A missing or zero count means one */
+	int count = terminal->parameterCount > 0 && parameters[0] > 0 ? parameters[0] : 1;
+	HostTerminalCellType *line = terminal->cells[terminal->row];
+	int row;
+	if (terminal->privateSequence) return;
+	switch (final)
+	{
+		case 'H':
+			terminal->row = terminal->parameterCount > 0 && parameters[0] > 0 ? parameters[0] : 1;
+			terminal->column = terminal->parameterCount > 1 && parameters[1] > 0 ? parameters[1] : 1;
+			break;
+		case 'A':
+			terminal->row -= count;
+			break;
+		case 'B':
+			terminal->row += count;
+			break;
+		case 'C':
+			terminal->column += count;
+			break;
+		case 'D':
+			terminal->column -= count;
+			break;
+		case 'J':
+			if (terminal->parameterCount > 0 && parameters[0] == 2)
+			{
+				for (row = 1; row <= TERMINAL_ROWS; row++) clearRow(terminal, row, 1);
+			}
+			break;
+		case 'K':
+			clearRow(terminal, terminal->row, terminal->column);
+			break;
+		case 'm':
+			selectGraphicRendition(terminal);
+			break;
+		case 'r':
+			terminal->top = terminal->parameterCount > 0 && parameters[0] > 0 ? parameters[0] : 1;
+			terminal->bottom = terminal->parameterCount > 1 && parameters[1] > 0 ? parameters[1] : TERMINAL_ROWS;
+			terminal->row = 1;
+			terminal->column = 1;
+			break;
+		case 'S':
+			scrollRegion(terminal, count);
+			break;
+		case 'T':
+			scrollRegion(terminal, -count);
+			break;
+		case 'P':
+			if (count > TERMINAL_COLUMNS + 1 - terminal->column) count = TERMINAL_COLUMNS + 1 - terminal->column;
+			memmove(&line[terminal->column], &line[terminal->column + count], (size_t)(TERMINAL_COLUMNS + 1 - terminal->column - count) * sizeof(line[0]));
+			blankCells(terminal, &line[TERMINAL_COLUMNS + 1 - count], count);
+			break;
+		case '@':
+			if (count > TERMINAL_COLUMNS + 1 - terminal->column) count = TERMINAL_COLUMNS + 1 - terminal->column;
+			memmove(&line[terminal->column + count], &line[terminal->column], (size_t)(TERMINAL_COLUMNS + 1 - terminal->column - count) * sizeof(line[0]));
+			blankCells(terminal, &line[terminal->column], count);
+			break;
+	}
+	clampCursor(terminal);
+}
+
+static void putGlyph(HostTerminalType *terminal, uint32_t glyph)
+{
+	HostTerminalCellType *cell = &terminal->cells[terminal->row][terminal->column];
+	cell->glyph = glyph;
+	cell->foreground = terminal->foreground;
+	cell->background = terminal->background;
+	if (terminal->column < TERMINAL_COLUMNS) terminal->column++;
+}
+
+void resetTerminal(HostTerminalType *terminal)
+{
+	int row;
+	memset(terminal, 0, sizeof(*terminal));
+	terminal->foreground = TERMINAL_DEFAULT_FOREGROUND;
+	terminal->background = TERMINAL_DEFAULT_BACKGROUND;
+	for (row = 0; row <= TERMINAL_ROWS; row++) clearRow(terminal, row, 0);
+	terminal->row = 1;
+	terminal->column = 1;
+	terminal->top = 1;
+	terminal->bottom = TERMINAL_ROWS;
+}
+
+void feedTerminal(HostTerminalType *terminal, unsigned char c)
+{
+	switch (terminal->state)
+	{
+		case TERMINAL_ESCAPE:
+			terminal->state = c == '[' ? TERMINAL_CSI : TERMINAL_GROUND;
+			terminal->privateSequence = false;
+			terminal->parameterCount = 0;
+			memset(terminal->parameters, 0, sizeof(terminal->parameters));
+			return;
+		case TERMINAL_CSI:
+			if (c == '?') terminal->privateSequence = true;
+			else if (c >= '0' && c <= '9')
+			{
+				if (terminal->parameterCount == 0) terminal->parameterCount = 1;
+				terminal->parameters[terminal->parameterCount - 1] = terminal->parameters[terminal->parameterCount - 1] * 10 + (c - '0');
+			}
+			else if (c == ';')
+			{
+				if (terminal->parameterCount == 0) terminal->parameterCount = 1;
+				if (terminal->parameterCount < TERMINAL_MAX_PARAMETERS) terminal->parameterCount++;
+			}
+			else if (c >= 0x40 && c <= 0x7E)
+			{
+				runControlSequence(terminal, (char)c);
+				terminal->state = TERMINAL_GROUND;
+			}
+			return;
+	}
+	if (terminal->continuationBytes > 0 && (c & 0xC0) == 0x80)
+	{
+		terminal->glyph = terminal->glyph << 6 | (c & 0x3F);
+		if (--terminal->continuationBytes == 0) putGlyph(terminal, terminal->glyph);
+		return;
+	}
+	terminal->continuationBytes = 0;
+	if (c == '\033') terminal->state = TERMINAL_ESCAPE;
+	else if (c == '\r') terminal->column = 1;
+	else if (c == '\n')
+	{
+		/* A line feed on the bottom row of the scroll region scrolls it */
+		if (terminal->row == terminal->bottom) scrollRegion(terminal, 1);
+		else if (terminal->row < TERMINAL_ROWS) terminal->row++;
+	}
+	else if (c >= 0xF0)
+	{
+		terminal->glyph = c & 0x07;
+		terminal->continuationBytes = 3;
+	}
+	else if (c >= 0xE0)
+	{
+		terminal->glyph = c & 0x0F;
+		terminal->continuationBytes = 2;
+	}
+	else if (c >= 0xC0)
+	{
+		terminal->glyph = c & 0x1F;
+		terminal->continuationBytes = 1;
+	}
+	else if (c >= ' ' && c < 0x7F) putGlyph(terminal, c);
+}
+
+char terminalCell(const HostTerminalType *terminal, int row, int column)
+{
+	if (row < 1 || row > TERMINAL_ROWS || column < 1 || column > TERMINAL_COLUMNS) return ' ';
+	return terminal->cells[row][column].glyph < 0x80 ? (char)terminal->cells[row][column].glyph : '?';
+}
+
+HostTerminalCellType terminalCellAttributes(const HostTerminalType *terminal, int row, int column)
+{
+	HostTerminalCellType blank = {' ', TERMINAL_DEFAULT_FOREGROUND, TERMINAL_DEFAULT_BACKGROUND};
+	if (row < 1 || row > TERMINAL_ROWS || column < 1 || column > TERMINAL_COLUMNS) return blank;
+	return terminal->cells[row][column];
+}
@@ -0,0 +1,49 @@
+#ifndef HOST_TERMINAL_H
+#define HOST_TERMINAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TERMINAL_ROWS			100
+#define TERMINAL_COLUMNS		120
+#define TERMINAL_MAX_PARAMETERS	4
+
+#define TERMINAL_DEFAULT_FOREGROUND	39
+#define TERMINAL_DEFAULT_BACKGROUND	49
+
+/* A character cell, the colours are kept as their SGR codes */
+typedef struct HostTerminalCell
+{
+	uint32_t glyph;
+	uint8_t foreground;
+	uint8_t background;
+} HostTerminalCellType;
+
+/* Just enough of a VT100/xterm to check what the game draws: cursor moves,
+ * erase, scroll regions, SU/SD, character insert/delete, SGR colours and
+ * UTF-8. Erased cells take the current background like xterm. Rows and
+ * columns are 1-based like the escape sequences, anything else is ignored */
+typedef struct HostTerminal
+{
+	HostTerminalCellType cells[TERMINAL_ROWS + 1][TERMINAL_COLUMNS + 1];
+	int row;
+	int column;
+	int top;
+	int bottom;
+	int state;
+	bool privateSequence;
+	int parameters[TERMINAL_MAX_PARAMETERS];
+	int parameterCount;
+	uint8_t foreground;
+	uint8_t background;
+	uint32_t glyph;			/* UTF-8 sequence being decoded */
+	int continuationBytes;
+} HostTerminalType;
+
+void resetTerminal(HostTerminalType *terminal);
+void feedTerminal(HostTerminalType *terminal, unsigned char c);
+/* The glyph of a cell, anything outside ASCII reads as '?' */
+char terminalCell(const HostTerminalType *terminal, int row, int column);
+HostTerminalCellType terminalCellAttributes(const HostTerminalType *terminal, int row, int column);
+
+#endif /* HOST_TERMINAL_H */
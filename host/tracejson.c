@@ -0,0 +1,147 @@
+/* Converts a scheduler trace dump (see dumpTrace in trace.c) into the Chrome
+ * trace event JSON format, which chrome://tracing and ui.perfetto.dev open.
+ *
+ * Every task gets its own track with a slice for each time it ran. RenderQueue
+ * and GameStateLock operations are instant events on the task that did them,
+ * and the queue fill level and the lock state are drawn as counters. The
+ * recording overhead from the dump header is printed to stderr.
+ *
+ * Build and run from the repository root:
+ *   make -C host tracejson
+ *   host/tracejson < dump.txt > trace.json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Matches TraceEventType and TraceTaskType in trace.h */
+#define TRACE_TASK_SWITCHED_IN		0
+#define TRACE_TASK_SWITCHED_OUT		1
+#define TRACE_QUEUE_SEND			2
+#define TRACE_QUEUE_RECEIVE			3
+#define TRACE_QUEUE_BLOCK_SEND		4
+#define TRACE_QUEUE_BLOCK_RECEIVE	5
+#define TRACE_MUTEX_GIVE			6
+#define TRACE_MUTEX_TAKE			7
+#define TRACE_MUTEX_BLOCK			8
+#define TRACE_MAX_TASKS				256
+
+static const char *EventNames[] = {
+	"switched in", "switched out", "RenderQueue send", "RenderQueue receive", "RenderQueue blocked on send",
+	"RenderQueue blocked on receive", "GameStateLock give", "GameStateLock take", "GameStateLock blocked"
+};
+
+char TaskNames[TRACE_MAX_TASKS][32];
+bool TaskRunning[TRACE_MAX_TASKS];
+double TaskStart[TRACE_MAX_TASKS];
+bool FirstEvent = true;
+
+static void beginEvent(void)
+{
+	printf(FirstEvent ? "\n" : ",\n");
+	FirstEvent = false;
+}
+
+static void printTaskName(unsigned int task)
+{
+	if (TaskNames[task][0] != 0) printf("%s", TaskNames[task]);
+	else printf("Task %u", task);
+}
+
+static void endSlice(unsigned int task, double ts)
+{
+	if (!TaskRunning[task]) return;
+	beginEvent();
+	printf("{\"name\":\"");
+	printTaskName(task);
+	printf("\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", task, TaskStart[task], ts - TaskStart[task]);
+	TaskRunning[task] = false;
+}
+
+int main(void)
+{
+	char line[128];
+	char name[32];
+	unsigned long hz = 0;
+	unsigned long records = 0;
+	unsigned long totalRecords = 0;
+	unsigned long cycles = 0;
+	unsigned long maxCycles = 0;
+	unsigned long timestamp;
+	unsigned int event;
+	unsigned int task;
+	unsigned int argument;
+	unsigned int id;
+	uint32_t last = 0;
+	uint64_t now = 0;
+	unsigned long events = 0;
+	double ts = 0;
+	int lockHeld;
+	
+	printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	beginEvent();
+	printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Snake Game\"}}");
+	while (fgets(line, sizeof(line), stdin) != NULL)
+	{
+		if (sscanf(line, "TRACE %lx %lx %lx %lx %lx", &hz, &records, &totalRecords, &cycles, &maxCycles) == 5) continue;
+		if (sscanf(line, "T %x %31[^\r\n]", &id, name) == 2 && id < TRACE_MAX_TASKS)
+		{
+			strcpy(TaskNames[id], name);
+			beginEvent();
+			printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", id, TaskNames[id]);
+			continue;
+		}
+		if (sscanf(line, "E %lx %x %x %x", &timestamp, &event, &task, &argument) != 4 || hz == 0 || task >= TRACE_MAX_TASKS) continue;
+		/* The timestamp timer wraps every 2^32 cycles, the records are in order so the differences are unwrapped */
+		if (events != 0) now += (uint32_t)((uint32_t)timestamp - last);
+		last = (uint32_t)timestamp;
+		ts = (double)now * 1000000.0 / hz;
+		events++;
+		switch (event)
+		{
+			case TRACE_TASK_SWITCHED_IN:
+				TaskRunning[task] = true;
+				TaskStart[task] = ts;
+				break;
+			case TRACE_TASK_SWITCHED_OUT:
+				endSlice(task, ts);
+				break;
+			default:
+				if (event > TRACE_MUTEX_BLOCK) break;
+				beginEvent();
+				printf("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}", EventNames[event], task, ts);
+				if (event == TRACE_QUEUE_SEND || event == TRACE_QUEUE_RECEIVE)
+				{
+					/* The recorded fill level is from before the operation */
+					beginEvent();
+					printf("{\"name\":\"RenderQueue\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"items\":%d}}", ts,
+						event == TRACE_QUEUE_SEND ? (int)argument + 1 : (int)argument - 1);
+				}
+				if (event == TRACE_MUTEX_GIVE || event == TRACE_MUTEX_TAKE)
+				{
+					lockHeld = event == TRACE_MUTEX_TAKE;
+					beginEvent();
+					printf("{\"name\":\"GameStateLock\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"held\":%d}}", ts, lockHeld);
+				}
+				break;
+		}
+	}
+	for (task = 0; task < TRACE_MAX_TASKS; task++) endSlice(task, ts);
+	printf("\n]}\n");
+	
+	if (hz == 0)
+	{
+		fprintf(stderr, "no TRACE header found\n");
+		return 1;
+	}
+	fprintf(stderr, "%lu events over %.3f ms, %lu recorded since boot\n", events, ts / 1000.0, totalRecords);
+	if (totalRecords != 0)
+	{
+		fprintf(stderr, "recording cost %.1f cycles avg, %lu max, %.3f%% of the traced time\n",
+			(double)cycles / totalRecords, maxCycles, ts > 0 ? 100.0 * ((double)cycles / totalRecords) * events / ((double)now) : 0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,180 @@
+/* Host measurement of the scrolling viewport.
+ *
+ * Bot games are played on a world larger than the viewport, once with the
+ * terminal shifting the screen (scroll regions, SU/SD, DCH/ICH) and once with
+ * the viewport redrawn on every camera move. The UART0 output is fed to the
+ * terminal stand-in and the viewport on it is checked against the world after
+ * every tick, then the bytes sent for the ticks that moved the camera are
+ * compared. Camera moves along both axes at once, as after a rewind, are
+ * checked on their own from the middle of the world.
+ *
+ * The world size has to be the same in every file, so it is given on the
+ * command line, see host/Makefile. Build and run from the repository root:
+ *   make -C host viewport
+ *   host/viewport [games]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* main.c is built into this translation unit with its entry point renamed */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "stubs/host_stubs.h"
+#include "hostGame.h"
+#include "terminal.h"
+
+#define VIEWPORT_GAME_TICKS		3000
+
+typedef struct ViewportResult
+{
+	unsigned long ticks;
+	unsigned long moves;
+	unsigned long moveBytes;
+	unsigned long totalBytes;
+	unsigned long mismatches;
+} ViewportResultType;
+
+HostTerminalType Terminal;
+
+static void feedOutput(uint32_t base, unsigned char data)
+{
+	if (base == UART0_BASE) feedTerminal(&Terminal, data);
+}
+
+/* RenderTask is not running, so requests are drawn as soon as they are sent */
+static void renderImmediately(QueueHandle_t queue, const void *item)
+{
+	if (queue == RenderQueue) renderRequest((const RenderRequestType *)item);
+}
+
+/* The viewport occupies terminal rows 2 to VIEWPORT_HEIGHT + 1 and columns 2 to VIEWPORT_WIDTH + 1 */
+static bool viewportMatches(void)
+{
+	int row;
+	int column;
+	for (row = 0; row < VIEWPORT_HEIGHT; row++)
+	{
+		if (terminalCell(&Terminal, row + 2, 1) != '#' || terminalCell(&Terminal, row + 2, VIEWPORT_WIDTH + 2) != '#') return false;
+		for (column = 0; column < VIEWPORT_WIDTH; column++)
+		{
+			if (terminalCell(&Terminal, row + 2, column + 2) != findCellStyle(WorldCells[Camera.y + row][Camera.x + column])->ascii) return false;
+		}
+	}
+	return true;
+}
+
+static void playGame(uint32_t seed, ViewportResultType *result)
+{
+	RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	HostSpawnersType spawners;
+	uint32_t botState = seed * 2654435761u + 1;
+	unsigned long period;
+	unsigned long bytes;
+	unsigned long tick;
+	PointType camera;
+	char key;
+
+	resetTerminal(&Terminal);
+	resetGameState();
+	SnakeSpeed = INITIAL_SNAKE_SPEED;
+	period = (60000 / SnakeSpeed) / portTICK_RATE_MS;
+	seedRandomNumber(seed);
+	resetHostSpawners(&spawners);
+	renderRequest(&gameStartRenderRequest);
+	for (tick = 0; tick < VIEWPORT_GAME_TICKS; tick++)
+	{
+		key = chooseBotKey(&botState);
+		if (key != 0) hostUartPushRx(UART0_BASE, &key, 1);
+		camera = Camera;
+		bytes = HostUartTxCount[0];
+		if (snakeTick() != GAME_RUNNING) break;
+		runHostSpawners(&spawners, period);
+		bytes = HostUartTxCount[0] - bytes;
+		result->ticks++;
+		result->totalBytes += bytes;
+		if (camera.x != Camera.x || camera.y != Camera.y)
+		{
+			result->moves++;
+			result->moveBytes += bytes;
+		}
+		if (!viewportMatches()) result->mismatches++;
+	}
+}
+
+static void printResult(const char *name, const ViewportResultType *result)
+{
+	printf("%-8s ticks=%lu camera_moves=%lu bytes/move=%.1f bytes/tick=%.1f mismatched_ticks=%lu\n", name, result->ticks, result->moves,
+		result->moves ? (double)result->moveBytes / result->moves : 0.0, result->ticks ? (double)result->totalBytes / result->ticks : 0.0, result->mismatches);
+}
+
+/* The head put just past the margin by the given number of cells, the
+ * camera follows it along both axes at once. The world is filled with a
+ * pattern first, so a cell drawn in the wrong column shows */
+static unsigned long checkDiagonalMoves(void)
+{
+	static const int steps[][2] = {{3, 2}, {-2, 4}, {-3, -2}, {2, -4}, {1, 1}};
+	static const char pattern[] = "o+ *x";
+	PointType head;
+	unsigned long mismatches = 0;
+	unsigned int i;
+	int x;
+	int y;
+	for (y = 0; y < ENV_HEIGHT; y++)
+	{
+		for (x = 0; x < ENV_WIDTH; x++) WorldCells[y][x] = pattern[(x * 2 + y) % 5];
+	}
+	ViewportScrolling = true;
+	Camera.x = (ENV_WIDTH - VIEWPORT_WIDTH) / 2;
+	Camera.y = (ENV_HEIGHT - viewportRows()) / 2 & ~1;
+	drawViewport();
+	for (i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+	{
+		head.x = steps[i][0] > 0 ? Camera.x + VIEWPORT_WIDTH - VIEWPORT_MARGIN - 1 + steps[i][0] : Camera.x + VIEWPORT_MARGIN + steps[i][0];
+		head.y = steps[i][1] > 0 ? Camera.y + viewportRows() - VIEWPORT_MARGIN - 1 + steps[i][1] : Camera.y + VIEWPORT_MARGIN + steps[i][1];
+		followWithCamera(head);
+		if (!viewportMatches()) mismatches++;
+	}
+	return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long games = argc > 1 ? strtoul(argv[1], NULL, 0) : 20;
+	ViewportResultType scrolled;
+	ViewportResultType redrawn;
+	unsigned long bytes;
+	unsigned long diagonal;
+	uint32_t seed;
+
+	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	GameStateLock = xSemaphoreCreateMutex();
+	GenerateRandomNumberLock = xSemaphoreCreateMutex();
+	HostQueueSendHook = renderImmediately;
+	HostUartTxHook = feedOutput;
+	printf("world %dx%d viewport %dx%d margin %d\n", ENV_WIDTH, ENV_HEIGHT, VIEWPORT_WIDTH, VIEWPORT_HEIGHT, VIEWPORT_MARGIN);
+
+	memset(&scrolled, 0, sizeof(scrolled));
+	memset(&redrawn, 0, sizeof(redrawn));
+	ViewportScrolling = true;
+	for (seed = 1; seed <= games; seed++) playGame(seed, &scrolled);
+	ViewportScrolling = false;
+	for (seed = 1; seed <= games; seed++) playGame(seed, &redrawn);
+
+	diagonal = checkDiagonalMoves();
+	bytes = HostUartTxCount[0];
+	drawViewport();
+	printf("a full viewport redraw is %lu bytes\n", HostUartTxCount[0] - bytes);
+	printResult("scroll", &scrolled);
+	printResult("redraw", &redrawn);
+	printf("diagonal camera moves mismatched=%lu\n", diagonal);
+	if (scrolled.moves != 0 && redrawn.moves != 0)
+	{
+		printf("scrolling sends %.1f%% of the bytes of a redraw per camera move\n",
+			100.0 * ((double)scrolled.moveBytes / scrolled.moves) / ((double)redrawn.moveBytes / redrawn.moves));
+	}
+	return scrolled.mismatches == 0 && redrawn.mismatches == 0 && diagonal == 0 ? 0 : 1;
+}
@@ -18,66 +18,24 @@
 #include <driverlib/uart.h>
 #include <driverlib/interrupt.h>
 
-/* Game Configuration Parameters */
-#define ENV_WIDTH 				12
-#define ENV_HEIGHT				12
-#define INITIAL_SNAKE_LENGTH	4
-#define MAX_SNAKE_LENGTH 		50
-#define INITIAL_SNAKE_SPEED		60
-#define MAXIMUM_SNAKE_SPEED		135
-#define SPECIAL_POWERUP_PERIOD	5000
-#define SPECIAL_POWERUP_FREQ	10
-#define ENEMY_PERIOD			5000
-#define END_MESSAGE_DELAY		5000
-
-/* Type Definitions */
-typedef struct 
-{
-	int x;
-	int y;
-} PointType;
-
-typedef enum
-{
-	UP,
-	DOWN,
-	RIGHT,
-	LEFT
-} Direction;
-
-typedef struct GameStateType 
-{
-	PointType snakePositions[MAX_SNAKE_LENGTH];
-	int snakeLength;
-	PointType normalPowerUpPosition;
-	PointType specialPowerUpPosition;
-	PointType enemyPosition;
-} GameStateType;
-
-typedef enum
-{
-	MAIN_MENU,
-	START_GAME,
-	SNAKE_POSITION_UPDATE,
-	NORMAL_POWERUP_POSITION_UPDATE,
-	REMOVE_NORMAL_POWERUP,
-	SPECIAL_POWERUP_POSITION_UPDATE,
-	REMOVE_SPECIAL_POWERUP,
-	ENEMY_POSITION_UPDATE,
-	REMOVE_ENEMY,
-	LOSS_MESSAGE,
-	WIN_MESSAGE,
-	SCORE_UPDATE,
-	TIME_UPDATE
-} RenderRequestCategory;
-
-typedef struct RenderRequest
-{
-	RenderRequestCategory category;
-	PointType headPosition;
-	bool removeTail;
-	PointType tailPosition;
-} RenderRequestType;
+#include "game.h"
+#include "gameTick.h"
+#include "cpuStats.h"
+#include "replay.h"
+#include "highScore.h"
+#include "trace.h"
+#include "console.h"
+#include "viewport.h"
+#include "spectator.h"
+#include "palette.h"
+#include "netplay.h"
+#include "shard.h"
+#include "autopilot.h"
+#include "entity.h"
+#include "stress.h"
+#include "profile.h"
+#include "rewind.h"
+#include "geometry.h"
 
 /* Global Variables */
 GameStateType GameState;
@@ -86,22 +44,19 @@ Direction LastDirection = RIGHT;
 bool inGame = false;
 bool wonLast = false;
 int score = 0;
-int time = 0;
+int gameTime = 0;
+unsigned long GameTickIndex = 0;
+int RandomState = 0;
+int SpecialPowerUpPeriod = SPECIAL_POWERUP_PERIOD;
+int EnemyPeriod = ENEMY_PERIOD;
+RenderRequestCategory RenderScreen = MAIN_MENU;
+PointType DrawnHeadPosition = {-1, -1};
+TickPlanType TickPlan;
 
 /* Tasks */
-void MainMenuTask(void *vpParameters);
 xTaskHandle MainMenuTaskHandle;
-void RenderTask(void *vpParameters);
 xTaskHandle RenderTaskHandle;
-void SnakePositionUpdateTask(void *vpParameters);
 xTaskHandle SnakePositionUpdateTaskHandle;
-void NormalPowerUpSpawnTask(void* vpParameters);
-xTaskHandle NormalPowerUpSpawnTaskHandle;
-void SpecialPowerUpSpawnTask(void* vpParameters);
-xTaskHandle SpecialPowerUpSpawnTaskHandle;
-void EnemySpawnTask(void* vpParameters);
-xTaskHandle EnemySpawnTaskHandle;
-void TimeUpdateTask(void* vpParameters);
 xTaskHandle TimeUpdateTaskHandle;
 
 /* Mutexes, Semaphores and Queues */
@@ -110,25 +65,31 @@ xSemaphoreHandle GenerateRandomNumberLock = NULL;
 xSemaphoreHandle NormalPowerUpSemaphore = NULL;
 xQueueHandle RenderQueue = NULL;
 
-/* Util Functions */
-void initializeHardware();
-void resetGameState();
-void clearScreen();
-void moveCursorToPosition(int line, int column);
-void moveCursorToBottom();
-int generateRandomNumber();
-PointType generateRandomPosition();
-
 int main()
 {	
 	/* Creating Tasks */
 	xTaskCreate(MainMenuTask, "Main Menu", 256, NULL, 1, &MainMenuTaskHandle);
 	xTaskCreate(RenderTask,   "Render",    256, NULL, 2, &RenderTaskHandle);
+	xTaskCreate(HighScoreTask, "HighScore",  128, NULL, 1, &HighScoreTaskHandle);
+	xTaskCreate(ConsoleTask,  "Console",   256, NULL, 1, &ConsoleTaskHandle);
+	xTaskCreate(ShardTask,    "Shard",     256, NULL, 4, &ShardTaskHandle);
+	registerTraceTask(MainMenuTaskHandle, TRACE_TASK_MAIN_MENU);
+	registerTraceTask(RenderTaskHandle, TRACE_TASK_RENDER);
+	registerTraceTask(HighScoreTaskHandle, TRACE_TASK_HIGH_SCORE);
+	registerTraceTask(ConsoleTaskHandle, TRACE_TASK_CONSOLE);
+	registerTraceTask(ShardTaskHandle, TRACE_TASK_SHARD);
 	
 	/* Creating Mutexes and Semaphores */
-	RenderQueue = xQueueCreate(1, sizeof(RenderRequestType));
+	RenderQueue = xQueueCreate(RENDER_QUEUE_LENGTH, sizeof(RenderRequestType));
 	
 	initializeHardware();
+	initializeGameTick();
+	initializeHighScores();
+	initializeConsole();
+	initializeSpectators();
+	initializeNetplay();
+	initializeShards();
+	initializeProfile();
 	
 	vTaskStartScheduler();
 	
@@ -137,30 +98,96 @@ int main()
 
 void MainMenuTask(void *vpParameters)
 {
-	const RenderRequestType mainMenuRenderRequest = {MAIN_MENU, false, {0, 0}, false};
-	const RenderRequestType gameStartRenderRequest = {START_GAME, false, {0, 0}, false};
+	const RenderRequestType mainMenuRenderRequest = RENDER_REQUEST(MAIN_MENU);
+	const RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	const RenderRequestType netplayStartRenderRequest = RENDER_REQUEST(NETPLAY_START);
+	int gameSpeed = INITIAL_SNAKE_SPEED;
+	uint32_t seed;
+	char key;
+	registerTraceTask(xTaskGetIdleTaskHandle(), TRACE_TASK_IDLE);
 	for ( ;; )
 	{
-		while(inGame);
+		/* Blocked rather than polling inGame, so the idle task gets the time the game leaves */
+		while (inGame) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 		GameStateLock = xSemaphoreCreateMutex();
 		GenerateRandomNumberLock = xSemaphoreCreateMutex();
 		NormalPowerUpSemaphore = xSemaphoreCreateBinary();
 		xSemaphoreTake(NormalPowerUpSemaphore, 0);
 		
 		xQueueSend(RenderQueue, (const void *)&mainMenuRenderRequest, portMAX_DELAY);
-		while (UARTCharGet(UART0_BASE) != 'e');
+		do
+		{
+			key = waitForMenuKey();
+			if (key == 't')
+			{
+				dumpTrace(UART0_BASE);
+				xQueueSend(RenderQueue, (const void *)&mainMenuRenderRequest, portMAX_DELAY);
+			}
+			/* Both boards press n, the menu comes back when the other one does not answer.
+			 * Not on a sharded world, its columns go on to the other boards instead of wrapping */
+			if (key == 'n' && (ShardCount > 1 || !connectNetplay(&seed))) key = 0;
+		} while (key != 'e' && key != 'n' && !(ShardCount == 1 && ((key == 'r' && isReplayAvailable()) || key == 'p' || key == 'x')));
+		/* The autopilot plays the game and its turns are recorded, a replay of it plays back the record */
+		AutopilotMode = key == 'p';
+		StressMode = key == 'x';
 		resetGameState();
-		if (wonLast) SnakeSpeed = (SnakeSpeed * 3) / 2;
-		else SnakeSpeed = INITIAL_SNAKE_SPEED;
+		resetProfile();
+		if (key == 'n')
+		{
+			/* Not recorded, the game depends on the other board's inputs */
+			SnakeSpeed = NETPLAY_SPEED;
+			resetNetplay(seed, NetplayPlayer);
+			xQueueSend(RenderQueue, (const void *)&netplayStartRenderRequest, portMAX_DELAY);
+			startCpuStatsSession();
+			vTaskPrioritySet(NULL, 5);
+			xTaskCreate(NetplayTask,			 "Netplay",			 256, NULL, 4, &NetplayTaskHandle);
+			xTaskCreate(TimeUpdateTask,		 	 "Time",			 256, NULL, 3, &TimeUpdateTaskHandle);
+			registerTraceTask(NetplayTaskHandle, TRACE_TASK_SNAKE);
+			registerTraceTask(TimeUpdateTaskHandle, TRACE_TASK_TIME);
+			inGame = true;
+			vTaskPrioritySet(NULL,1);
+			continue;
+		}
+		if (key == 'r')
+		{
+			/* A replay runs at the recorded speed and does not count towards the speed progression */
+			startReplay(&seed, &SnakeSpeed);
+		}
+		else if (key == 'x')
+		{
+			/* Not recorded, the ramp sets its own speeds and its synthetic keys are not worth keeping */
+			SnakeSpeed = STRESS_START_SPEED;
+			seed = xTaskGetTickCount();
+			startStress();
+		}
+		else
+		{
+			/* The autopilot plays at the speed the player is at and its games are not counted */
+			if (key != 'p') gameSpeed = nextSnakeSpeed(gameSpeed, wonLast);
+			SnakeSpeed = gameSpeed;
+			seed = xTaskGetTickCount();
+			startRecording(seed, SnakeSpeed);
+			if (key == 'e' && ShardCount == 1) startRewind();
+		}
+		/* Every board of a sharded world plays at the speed of the one where e was pressed */
+		if (ShardCount > 1) startShardGame(&SnakeSpeed);
+		seedRandomNumber(seed);
 		xQueueSend(RenderQueue, (const void *)&gameStartRenderRequest, portMAX_DELAY);
 		
 		xSemaphoreGive(NormalPowerUpSemaphore);
+		startCpuStatsSession();
 		vTaskPrioritySet(NULL, 5);
 		xTaskCreate(SnakePositionUpdateTask, "Snake", 			 256, NULL, 4, &SnakePositionUpdateTaskHandle);
-		xTaskCreate(NormalPowerUpSpawnTask,  "Normal PowerUps",  256, NULL, 3, &NormalPowerUpSpawnTaskHandle);
-		xTaskCreate(SpecialPowerUpSpawnTask, "Special PowerUps", 256, NULL, 3, &SpecialPowerUpSpawnTaskHandle);
-		xTaskCreate(EnemySpawnTask, 		 "Enemy", 			 256, NULL, 3, &EnemySpawnTaskHandle);
+		EntityTaskHandle = NULL;
+		StressInputTaskHandle = NULL;
+		/* A stress run moves every entity itself on each tick */
+		if (StressMode) xTaskCreate(StressInputTask, "Stress", 256, NULL, 3, &StressInputTaskHandle);
+		else if (ReplayMode != REPLAY_PLAYING) xTaskCreate(EntityTask, "Entities", 256, NULL, 3, &EntityTaskHandle);
 		xTaskCreate(TimeUpdateTask,		 	 "Time",			 256, NULL, 3, &TimeUpdateTaskHandle);
+		registerTraceTask(SnakePositionUpdateTaskHandle, TRACE_TASK_SNAKE);
+		registerTraceTask(EntityTaskHandle, TRACE_TASK_ENTITY);
+		registerTraceTask(StressInputTaskHandle, TRACE_TASK_ENTITY);
+		registerTraceTask(TimeUpdateTaskHandle, TRACE_TASK_TIME);
 		inGame = true;
 		vTaskPrioritySet(NULL,1);
 	}
@@ -168,392 +195,344 @@ void MainMenuTask(void *vpParameters)
 
 void RenderTask(void *vpParameters)
 {
-	const char welcomeString[] = "Welcome to Snake Game, Press e to start the game\r\n";
-	const char movekeyInstructionsString[] = "Use WASD keys for movement\r\n";
-	const char symbolInstructionsString[] = "Your snake is o, normal powerups are +, special powerups are *, enemies are x\r\n";
-	const char gameHeader[] = "Score:000  Time:000\r\n";
-	const char lossMessageString[] = "You Lost!";
-	const char winMessageString[] = "You Won!";
 	RenderRequestType currentRequest;
-	int currentScore;
-	int currentTime;
-	int i = 0;
-	int j = 0;
+	uint32_t profileStart;
 	for ( ;; )
 	{
 		xQueueReceive(RenderQueue, (void *)&currentRequest, portMAX_DELAY);
-		switch (currentRequest.category)
-		{
-			case MAIN_MENU:
-				clearScreen();
-				i = 0;
-				while (welcomeString[i] != 0) UARTCharPut(UART0_BASE, welcomeString[i++]);
-				i = 0;
-				while (movekeyInstructionsString[i] != 0) UARTCharPut(UART0_BASE, movekeyInstructionsString[i++]);
-				i = 0;
-				while (symbolInstructionsString[i] != 0) UARTCharPut(UART0_BASE, symbolInstructionsString[i++]);
-				break;
-			case START_GAME:
-				clearScreen();
-				for (i = 0; i < ENV_WIDTH + 2; i++) UARTCharPut(UART0_BASE, '#');
-				UARTCharPut(UART0_BASE, '\r');
-				UARTCharPut(UART0_BASE, '\n');
-				for (i = 0; i < ENV_HEIGHT; i++)
-				{
-					UARTCharPut(UART0_BASE, '#');
-					for (j = 0; j < ENV_WIDTH; j++)
-					{
-						UARTCharPut(UART0_BASE, ' ');
-					}
-					UARTCharPut(UART0_BASE, '#');
-					UARTCharPut(UART0_BASE, '\r');
-					UARTCharPut(UART0_BASE, '\n');
-				}
-				for (i = 0; i < ENV_WIDTH + 2; i++) UARTCharPut(UART0_BASE, '#');
-				UARTCharPut(UART0_BASE, '\r');
-				UARTCharPut(UART0_BASE, '\n');
-				i = 0;
-				while (gameHeader[i] != 0) UARTCharPut(UART0_BASE, gameHeader[i++]);
-				xSemaphoreTake(GameStateLock, portMAX_DELAY);
-				for (i = 0; i < GameState.snakeLength; i++)
-				{
-					moveCursorToPosition(GameState.snakePositions[i].y + 1, GameState.snakePositions[i].x + 1);
-					UARTCharPut(UART0_BASE, 'o');
-				}
-				xSemaphoreGive(GameStateLock);
-				break;
-			case SNAKE_POSITION_UPDATE:
-				moveCursorToPosition(currentRequest.headPosition.y + 1, currentRequest.headPosition.x + 1);
-				UARTCharPut(UART0_BASE, 'o');
-				if (currentRequest.removeTail)
-				{
-					moveCursorToPosition(currentRequest.tailPosition.y + 1, currentRequest.tailPosition.x + 1);
-					UARTCharPut(UART0_BASE, ' ');
-				}
-				moveCursorToBottom();
-				break;
-			case NORMAL_POWERUP_POSITION_UPDATE:
-				moveCursorToPosition(currentRequest.headPosition.y + 1, currentRequest.headPosition.x + 1);
-				UARTCharPut(UART0_BASE, '+');
-				moveCursorToBottom();
-				break;
-			case REMOVE_NORMAL_POWERUP:
-				moveCursorToPosition(currentRequest.headPosition.y + 1, currentRequest.headPosition.x + 1);
-				UARTCharPut(UART0_BASE, ' ');
-				moveCursorToBottom();
-				break;
-			case SPECIAL_POWERUP_POSITION_UPDATE:
-				moveCursorToPosition(currentRequest.headPosition.y + 1, currentRequest.headPosition.x + 1);
-				UARTCharPut(UART0_BASE, '*');
-				moveCursorToBottom();
-				break;
-			case REMOVE_SPECIAL_POWERUP:
-				moveCursorToPosition(currentRequest.headPosition.y + 1, currentRequest.headPosition.x + 1);
-				UARTCharPut(UART0_BASE, ' ');
-				break;
-			case ENEMY_POSITION_UPDATE:
-				moveCursorToPosition(currentRequest.headPosition.y + 1, currentRequest.headPosition.x + 1);
-				UARTCharPut(UART0_BASE, 'x');
-				moveCursorToBottom();
-				break;
-			case REMOVE_ENEMY:
-				moveCursorToPosition(currentRequest.headPosition.y + 1, currentRequest.headPosition.x + 1);
-				UARTCharPut(UART0_BASE, ' ');
-				moveCursorToBottom();
-				break;
-			case LOSS_MESSAGE:
-				clearScreen();
-				i = 0;
-				while (lossMessageString[i] != 0) UARTCharPut(UART0_BASE, lossMessageString[i++]);
-				vTaskDelay(END_MESSAGE_DELAY/portTICK_RATE_MS);
-				break;
-			case WIN_MESSAGE:
-				clearScreen();
-				i = 0;
-				while (winMessageString[i] != 0) UARTCharPut(UART0_BASE, winMessageString[i++]);
-				vTaskDelay(END_MESSAGE_DELAY/portTICK_RATE_MS);
-				break;
-			case SCORE_UPDATE:
-				moveCursorToPosition(ENV_HEIGHT + 2, 6);
-				currentScore = score;
-				UARTCharPut(UART0_BASE, (currentScore/100) + 48);
-				UARTCharPut(UART0_BASE, ((currentScore % 100) / 10) + 48);
-				UARTCharPut(UART0_BASE, (currentScore%10) + 48);
-				moveCursorToBottom();
-				break;
-			case TIME_UPDATE:
-				moveCursorToPosition(ENV_HEIGHT + 2, 16);
-				currentTime = time;
-				UARTCharPut(UART0_BASE, (currentTime/100) + 48);
-				UARTCharPut(UART0_BASE, ((currentTime % 100) / 10) + 48);
-				UARTCharPut(UART0_BASE, (currentTime%10) + 48);
-				moveCursorToBottom();
-				break;
-		}
+		markRenderBusy();
+		sendSpectatorKeyframes();
+		PROFILE_START(profileStart);
+		renderRequest(&currentRequest);
+		PROFILE_END(PROFILE_RENDER + renderCategory(currentRequest), profileStart);
+		flushSpectators();
+		/* The next deadline is measured against the last byte of a tick */
+		if (uxQueueMessagesWaiting(RenderQueue) == 0) markRenderIdle();
 	}
 }
 
-void SnakePositionUpdateTask(void *vpParameters)
+RenderRequestType packRenderRequest(RenderRequestCategory category, PointType head, bool removeTail, PointType tail)
 {
-	bool firstLoop = true;
-	portTickType lastWokenTime;
-	int i;
-	RenderRequestType snakeUpdateRenderRequest = {SNAKE_POSITION_UPDATE, {-1, -1}, true, {-1, -1}};
-	RenderRequestType powerUpRemoveRenderRequest = {REMOVE_NORMAL_POWERUP, {-1, -1}, true, {-1, -1}};
-	RenderRequestType lossMessageRenderRequest = {LOSS_MESSAGE, {-1, -1}, true, {-1, -1}};
-	RenderRequestType winMessageRenderRequest = {WIN_MESSAGE, {-1, -1}, true, {-1, -1}};
-	RenderRequestType updateScoreRenderRequest = {SCORE_UPDATE, {-1, -1}, true, {-1, -1}};
-	PointType newHeadPosition;
-	for ( ;; )
+	RenderRequestType request = (RenderRequestType)category;
+	if (removeTail) request |= RENDER_TAIL_REMOVED;
+	request |= ((uint32_t)(head.y * ENV_WIDTH + head.x) & RENDER_CELL_MASK) << RENDER_HEAD_SHIFT;
+	request |= ((uint32_t)(tail.y * ENV_WIDTH + tail.x) & RENDER_CELL_MASK) << RENDER_TAIL_SHIFT;
+	return request;
+}
+
+RenderRequestCategory renderCategory(RenderRequestType request)
+{
+	return (RenderRequestCategory)(request & (RENDER_TAIL_REMOVED - 1));
+}
+
+PointType renderHead(RenderRequestType request)
+{
+	PointType head;
+	int cell = (int)((request >> RENDER_HEAD_SHIFT) & RENDER_CELL_MASK);
+	head.x = cell % ENV_WIDTH;
+	head.y = cell / ENV_WIDTH;
+	return head;
+}
+
+PointType renderTail(RenderRequestType request)
+{
+	PointType tail;
+	int cell = (int)((request >> RENDER_TAIL_SHIFT) & RENDER_CELL_MASK);
+	tail.x = cell % ENV_WIDTH;
+	tail.y = cell / ENV_WIDTH;
+	return tail;
+}
+
+void renderRequest(const RenderRequestType *request)
+{
+	static const char welcomeString[] = "Welcome to Snake Game, Press e to start the game\r\n";
+	static const char movekeyInstructionsString[] = "Use WASD keys for movement and b to rewind, press r to replay the last game (any key stops it), p to watch the autopilot, x to stress test, t to dump the scheduler trace\r\n";
+	static const char netplayInstructionsString[] = "Press n on two linked boards to play head to head\r\n";
+	static const char symbolInstructionsString[] = "Your snake is o, normal powerups are +, special powerups are *, enemies are x\r\n";
+	static const char highScoresString[] = "High Scores:\r\n";
+	RenderRequestCategory category = renderCategory(*request);
+	PointType head = renderHead(*request);
+	int currentScore;
+	int currentTime;
+	int i = 0;
+	int j = 0;
+	switch (category)
 	{
-		xSemaphoreTake(GameStateLock, portMAX_DELAY);
-		/* Check for Input */
-		if (UARTCharsAvail(UART0_BASE) > 0)
-		{
-			switch(UARTCharGet(UART0_BASE))
+		case MAIN_MENU:
+			RenderScreen = MAIN_MENU;
+			/* Cleared cells take the current background */
+			resetCellColor();
+			clearScreen();
+			i = 0;
+			while (welcomeString[i] != 0) putRenderChar(welcomeString[i++]);
+			i = 0;
+			while (movekeyInstructionsString[i] != 0) putRenderChar(movekeyInstructionsString[i++]);
+			i = 0;
+			while (symbolInstructionsString[i] != 0) putRenderChar(symbolInstructionsString[i++]);
+			i = 0;
+			while (ShardCount == 1 && netplayInstructionsString[i] != 0) putRenderChar(netplayInstructionsString[i++]);
+			if (HighScoreCount == 0) break;
+			i = 0;
+			while (highScoresString[i] != 0) putRenderChar(highScoresString[i++]);
+			for (j = 0; j < HighScoreCount && j < HIGH_SCORE_SHOWN; j++)
 			{
-				case 'a':
-					if (LastDirection == UP || LastDirection == DOWN) LastDirection = LEFT;
-					break;
-				case 's':
-					if (LastDirection== LEFT || LastDirection == RIGHT) LastDirection = DOWN;
-					break;
-				case 'd':
-					if (LastDirection == UP || LastDirection == DOWN) LastDirection = RIGHT;
-					break;
-				case 'w':
-					if (LastDirection == LEFT || LastDirection == RIGHT) LastDirection = UP;
-					break;
-			}	
-		}
-		/* Calculate New Head Position */
-		newHeadPosition = GameState.snakePositions[0];
-		switch (LastDirection)
-		{
-			case UP:
-				newHeadPosition.y--;
-				if (newHeadPosition.y == -1) newHeadPosition.y = ENV_HEIGHT - 1;
-				break;
-			case DOWN:
-				newHeadPosition.y++;
-				if (newHeadPosition.y == ENV_HEIGHT) newHeadPosition.y = 0;
-				break;
-			case LEFT:
-				newHeadPosition.x--;
-				if (newHeadPosition.x == -1) newHeadPosition.x = ENV_WIDTH - 1;
-				break;
-			case RIGHT:
-				newHeadPosition.x++;
-				if (newHeadPosition.x == ENV_WIDTH) newHeadPosition.x = 0;
-				break;
-		}
-		snakeUpdateRenderRequest.headPosition = newHeadPosition;
-		snakeUpdateRenderRequest.removeTail = true;
-		snakeUpdateRenderRequest.tailPosition = GameState.snakePositions[GameState.snakeLength - 1];
-		/* Check for Self-Collision */
-		for (i = 1; i < GameState.snakeLength; i++)
-		{
-			if (newHeadPosition.x == GameState.snakePositions[i].x && newHeadPosition.y == GameState.snakePositions[i].y)
+				currentScore = HighScoreTable[j].score;
+				currentTime = HighScoreTable[j].time;
+				putRenderChar(j + 49);
+				putRenderChar('.');
+				putRenderChar(' ');
+				putRenderChar((currentScore/100) + 48);
+				putRenderChar(((currentScore % 100) / 10) + 48);
+				putRenderChar((currentScore%10) + 48);
+				putRenderChar(' ');
+				putRenderChar(' ');
+				putRenderChar((currentTime/100) + 48);
+				putRenderChar(((currentTime % 100) / 10) + 48);
+				putRenderChar((currentTime%10) + 48);
+				putRenderChar('s');
+				putRenderChar('\r');
+				putRenderChar('\n');
+			}
+			break;
+		case START_GAME:
+			RenderScreen = START_GAME;
+			drawGameFrame();
+			xSemaphoreTake(GameStateLock, portMAX_DELAY);
+			resetViewport(GameState.snakePositions[0]);
+			for (i = 0; i < GameState.snakeLength; i++) drawWorldCell(GameState.snakePositions[i], i == 0 ? '@' : 'o');
+			DrawnHeadPosition = GameState.snakePositions[0];
+			/* On a sharded world the snake may start on another board */
+			if (GameState.snakeLength == 0) DrawnHeadPosition.x = -1;
+			xSemaphoreGive(GameStateLock);
+			break;
+		case SNAKE_POSITION_UPDATE:
+			followWithCamera(head);
+			/* The old head becomes body, only drawn again when the two look
+			 * different and not with the new head as the other half of its pair.
+			 * There is none when the head has just come over from another board */
+			if (DrawnHeadPosition.x >= 0)
 			{
-				vSemaphoreDelete(GameStateLock);
-				vSemaphoreDelete(GenerateRandomNumberLock);
-				vSemaphoreDelete(NormalPowerUpSemaphore);
-				vTaskDelete(NormalPowerUpSpawnTaskHandle);
-				vTaskDelete(SpecialPowerUpSpawnTaskHandle);
-				vTaskDelete(EnemySpawnTaskHandle);
-				vTaskDelete(TimeUpdateTaskHandle);
-				inGame = false;
-				wonLast = false;
-				xQueueSend(RenderQueue, (const void *)&lossMessageRenderRequest, portMAX_DELAY);
-				vTaskDelete(NULL);
+				if (isHeadDistinct() && !isSameCellPair(DrawnHeadPosition, head)) drawWorldCell(DrawnHeadPosition, 'o');
+				else WorldCells[DrawnHeadPosition.y][DrawnHeadPosition.x] = 'o';
 			}
-		}
-		/* Check for enemy Collision */
-		if (newHeadPosition.x == GameState.enemyPosition.x && newHeadPosition.y == GameState.enemyPosition.y)
-		{
-			vSemaphoreDelete(GameStateLock);
-			vSemaphoreDelete(GenerateRandomNumberLock);
-			vSemaphoreDelete(NormalPowerUpSemaphore);
-			vTaskDelete(NormalPowerUpSpawnTaskHandle);
-			vTaskDelete(SpecialPowerUpSpawnTaskHandle);
-			vTaskDelete(EnemySpawnTaskHandle);
-			vTaskDelete(TimeUpdateTaskHandle);
-			inGame = false;
-			wonLast = false;
-			xQueueSend(RenderQueue, (const void *)&lossMessageRenderRequest, portMAX_DELAY);
-			vTaskDelete(NULL);
-		}
-		/* Check for Normal Power Up */
-		if (newHeadPosition.x == GameState.normalPowerUpPosition.x && newHeadPosition.y == GameState.normalPowerUpPosition.y)
-		{
-			GameState.snakeLength++;
-			snakeUpdateRenderRequest.removeTail = false;
-			powerUpRemoveRenderRequest.category = REMOVE_NORMAL_POWERUP;
-			powerUpRemoveRenderRequest.headPosition = GameState.normalPowerUpPosition;
-			GameState.normalPowerUpPosition.x = -1;
-			GameState.normalPowerUpPosition.y = -1;
-			xSemaphoreGive(NormalPowerUpSemaphore);
-			xQueueSend(RenderQueue, (const void *)&powerUpRemoveRenderRequest, portMAX_DELAY);
-			score++;
-			xQueueSend(RenderQueue, (const void *)&updateScoreRenderRequest, portMAX_DELAY);
-		}
-		/* Check for special Power Up */
-		if (newHeadPosition.x == GameState.specialPowerUpPosition.x && newHeadPosition.y == GameState.specialPowerUpPosition.y)
-		{
-			GameState.snakeLength++;
-			snakeUpdateRenderRequest.removeTail = false;
-			powerUpRemoveRenderRequest.category = REMOVE_SPECIAL_POWERUP;
-			powerUpRemoveRenderRequest.headPosition = GameState.specialPowerUpPosition;
-			GameState.specialPowerUpPosition.x = -1;
-			GameState.specialPowerUpPosition.y = -1;
-			xQueueSend(RenderQueue, (const void *)&powerUpRemoveRenderRequest, portMAX_DELAY);
-			score += 5;
-			xQueueSend(RenderQueue, (const void *)&updateScoreRenderRequest, portMAX_DELAY);
-		}
-		/* Check for win */
-		if (GameState.snakeLength == MAX_SNAKE_LENGTH) {
-			vSemaphoreDelete(GameStateLock);
-			vSemaphoreDelete(GenerateRandomNumberLock);
-			vSemaphoreDelete(NormalPowerUpSemaphore);
-			vTaskDelete(NormalPowerUpSpawnTaskHandle);
-			vTaskDelete(SpecialPowerUpSpawnTaskHandle);
-			vTaskDelete(EnemySpawnTaskHandle);
-			vTaskDelete(TimeUpdateTaskHandle);
-			inGame = false;
-			wonLast = true;
-			xQueueSend(RenderQueue, (const void *)&winMessageRenderRequest, portMAX_DELAY);
-			vTaskDelete(NULL);
-		}
-		/* Move Snake */
-		for (i = GameState.snakeLength - 1; i > 0; i--) 
-		{
-			GameState.snakePositions[i] = GameState.snakePositions[i-1];
-		}
-		GameState.snakePositions[0] = newHeadPosition;
-		xQueueSend(RenderQueue, (const void *)&snakeUpdateRenderRequest, portMAX_DELAY);
-		xSemaphoreGive(GameStateLock);
-		if (firstLoop)
-		{
-			lastWokenTime = xTaskGetTickCount();
-			firstLoop = false;
-		}
-		vTaskDelayUntil(&lastWokenTime, (60000/SnakeSpeed) / portTICK_RATE_MS);
+			drawWorldCell(head, '@');
+			DrawnHeadPosition = head;
+			if (*request & RENDER_TAIL_REMOVED)
+			{
+				drawWorldCell(renderTail(*request), ' ');
+			}
+			moveCursorToBottom();
+			break;
+		case NORMAL_POWERUP_POSITION_UPDATE:
+			drawWorldCell(head, '+');
+			moveCursorToBottom();
+			break;
+		case REMOVE_NORMAL_POWERUP:
+			drawWorldCell(head, ' ');
+			moveCursorToBottom();
+			break;
+		case SPECIAL_POWERUP_POSITION_UPDATE:
+			drawWorldCell(head, '*');
+			moveCursorToBottom();
+			break;
+		case REMOVE_SPECIAL_POWERUP:
+			drawWorldCell(head, ' ');
+			break;
+		case ENEMY_POSITION_UPDATE:
+			drawWorldCell(head, 'x');
+			moveCursorToBottom();
+			break;
+		case REMOVE_ENEMY:
+			drawWorldCell(head, ' ');
+			moveCursorToBottom();
+			break;
+		case LOSS_MESSAGE:
+		case WIN_MESSAGE:
+			RenderScreen = category;
+			drawEndMessage(category == WIN_MESSAGE);
+			/* Spectators see the message now rather than after the delay */
+			flushSpectators();
+			vTaskDelay(END_MESSAGE_DELAY/portTICK_RATE_MS);
+			break;
+		case SCORE_UPDATE:
+			moveCursorToPosition(viewportLines() + 2, 6);
+			resetCellColor();
+			currentScore = score;
+			putRenderChar((currentScore/100) + 48);
+			putRenderChar(((currentScore % 100) / 10) + 48);
+			putRenderChar((currentScore%10) + 48);
+			moveCursorToBottom();
+			break;
+		case TIME_UPDATE:
+			moveCursorToPosition(viewportLines() + 2, 16);
+			resetCellColor();
+			currentTime = gameTime;
+			putRenderChar((currentTime/100) + 48);
+			putRenderChar(((currentTime % 100) / 10) + 48);
+			putRenderChar((currentTime%10) + 48);
+			moveCursorToBottom();
+			break;
+		case CPU_LOAD_UPDATE:
+			moveCursorToPosition(viewportLines() + 2, 25);
+			resetCellColor();
+			putRenderChar((cpuLoad/100) + 48);
+			putRenderChar(((cpuLoad % 100) / 10) + 48);
+			putRenderChar((cpuLoad%10) + 48);
+			moveCursorToPosition(viewportLines() + 2, 35);
+			putRenderChar((cpuIdle/100) + 48);
+			putRenderChar(((cpuIdle % 100) / 10) + 48);
+			putRenderChar((cpuIdle%10) + 48);
+			moveCursorToBottom();
+			break;
+		case REPAINT:
+			renderKeyframe();
+			break;
+		case NETPLAY_START:
+			RenderScreen = START_GAME;
+			drawGameFrame();
+			resetNetplayDrawing();
+			drawNetplayState();
+			break;
+		case NETPLAY_FRAME:
+			drawNetplayState();
+			break;
+		case SHARD_HEAD_LEAVE:
+			/* The head went on to the next board, the rest of the snake follows it there */
+			drawWorldCell(head, 'o');
+			DrawnHeadPosition.x = -1;
+			moveCursorToBottom();
+			break;
+		case SHARD_TAIL_REMOVE:
+			/* Only while the cell still shows the snake */
+			if (isShardTrail(head)) drawWorldCell(head, ' ');
+			moveCursorToBottom();
+			break;
+		case REWIND_REDRAW:
+			renderRewind();
+			break;
+		case SPECTATOR_KEYFRAME:
+			/* Only wakes this task, RenderTask sends the keyframes before every request */
+			break;
 	}
 }
-void NormalPowerUpSpawnTask(void* vpParameters)
+
+/* Clears the screen and draws the border and the header with empty cells */
+void drawGameFrame()
 {
-	PointType powerUpPosition;
-	bool freePosition;
-	int i;
-	RenderRequestType powerUpRenderRequest = {NORMAL_POWERUP_POSITION_UPDATE, {-1, -1}, true, {-1, -1}};
-	for ( ;; )
+#if SHOW_CPU_LOAD
+	static const char gameHeader[] = "Score:000  Time:000  CPU:---% Idle:---%\r\n";
+#else
+	static const char gameHeader[] = "Score:000  Time:000\r\n";
+#endif
+	int i = 0;
+	int j = 0;
+	resetCellColor();
+	clearScreen();
+	for (i = 0; i < VIEWPORT_WIDTH + 2; i++) putRenderChar('#');
+	putRenderChar('\r');
+	putRenderChar('\n');
+	for (i = 0; i < viewportLines(); i++)
 	{
-		xSemaphoreTake(NormalPowerUpSemaphore, portMAX_DELAY);
-		xSemaphoreTake(GameStateLock, portMAX_DELAY);
-		
-		do
+		putRenderChar('#');
+		for (j = 0; j < VIEWPORT_WIDTH; j++)
 		{
-			powerUpPosition = generateRandomPosition();
-			freePosition = true;
-			for (i = 0; i < GameState.snakeLength; i++)
-			{
-				if (GameState.snakePositions[i].x == powerUpPosition.x && GameState.snakePositions[i].y == powerUpPosition.y)
-				{
-					freePosition = false;
-					break;
-				}
-			}
-			if (GameState.specialPowerUpPosition.x == powerUpPosition.x && GameState.specialPowerUpPosition.y == powerUpPosition.y) freePosition = false;
-			if (GameState.enemyPosition.x == powerUpPosition.x && GameState.enemyPosition.y == powerUpPosition.y) freePosition = false;
-		} while (freePosition == false);
-		GameState.normalPowerUpPosition = powerUpPosition;
-		powerUpRenderRequest.headPosition = powerUpPosition;
-		xQueueSend(RenderQueue, (const void *)&powerUpRenderRequest, portMAX_DELAY);
-		xSemaphoreGive(GameStateLock);	
+			putRenderChar(' ');
+		}
+		putRenderChar('#');
+		putRenderChar('\r');
+		putRenderChar('\n');
 	}
+	for (i = 0; i < VIEWPORT_WIDTH + 2; i++) putRenderChar('#');
+	putRenderChar('\r');
+	putRenderChar('\n');
+	i = 0;
+	while (gameHeader[i] != 0) putRenderChar(gameHeader[i++]);
 }
-void SpecialPowerUpSpawnTask(void* vpParameters)
+
+void drawEndMessage(bool won)
 {
-	PointType powerUpPosition;
-	bool freePosition;
-	int i;
-	RenderRequestType powerUpRenderRequest = {SPECIAL_POWERUP_POSITION_UPDATE, {-1, -1}, true, {-1, -1}};
-	RenderRequestType powerUpRemoveRenderRequest = {REMOVE_SPECIAL_POWERUP, {-1, -1}, true, {-1, -1}};
-	for ( ;; )
+	static const char lossMessageString[] = "You Lost!";
+	static const char winMessageString[] = "You Won!";
+	const char *message = won ? winMessageString : lossMessageString;
+	resetCellColor();
+	clearScreen();
+	while (*message != 0) putRenderChar(*message++);
+}
+
+/* Redraws the current screen for a terminal that missed everything before it,
+ * or after the palette changed. The board comes from the cells the render task
+ * has drawn rather than from GameState, which can be ahead of requests still
+ * in the queue. The terminal's colour is not known up front and the one the
+ * rest of the output expects is set again at the end */
+void renderKeyframe()
+{
+	const RenderRequestType mainMenuRenderRequest = RENDER_REQUEST(MAIN_MENU);
+	const RenderRequestType scoreRenderRequest = RENDER_REQUEST(SCORE_UPDATE);
+	const RenderRequestType timeRenderRequest = RENDER_REQUEST(TIME_UPDATE);
+#if SHOW_CPU_LOAD
+	const RenderRequestType cpuLoadRenderRequest = RENDER_REQUEST(CPU_LOAD_UPDATE);
+#endif
+	uint8_t foreground = CellColor;
+	uint8_t background = CellBackground;
+	bool colored = PaletteColor || PaletteHalfBlock;
+	if (colored)
 	{
-		xSemaphoreTake(GameStateLock, portMAX_DELAY);
-		if (GameState.specialPowerUpPosition.x >= 0 && GameState.specialPowerUpPosition.y >= 0)
-		{
-			powerUpRemoveRenderRequest.headPosition = GameState.specialPowerUpPosition;
-			GameState.specialPowerUpPosition.x = -1;
-			GameState.specialPowerUpPosition.y = -1;
-			xQueueSend(RenderQueue, (const void *)&powerUpRemoveRenderRequest, portMAX_DELAY);
-		}
-		if (generateRandomNumber() % SPECIAL_POWERUP_FREQ == 0)
-		{
-			do
-			{
-				powerUpPosition = generateRandomPosition();
-				freePosition = true;
-				for (i = 0; i < GameState.snakeLength; i++)
-				{
-					if (GameState.snakePositions[i].x == powerUpPosition.x && GameState.snakePositions[i].y == powerUpPosition.y)
-					{
-						freePosition = false;
-						break;
-					}
-				}
-				if (GameState.normalPowerUpPosition.x == powerUpPosition.x && GameState.normalPowerUpPosition.y == powerUpPosition.y) freePosition = false;
-				if (GameState.enemyPosition.x == powerUpPosition.x && GameState.enemyPosition.y == powerUpPosition.y) freePosition = false;
-			} while (freePosition == false);
-			GameState.specialPowerUpPosition = powerUpPosition;
-			powerUpRenderRequest.headPosition = powerUpPosition;
-			xQueueSend(RenderQueue, (const void *)&powerUpRenderRequest, portMAX_DELAY);
-		}
-		xSemaphoreGive(GameStateLock);
-		vTaskDelay(SPECIAL_POWERUP_PERIOD/portTICK_RATE_MS);
+		CellColor = PALETTE_UNKNOWN;
+		CellBackground = PALETTE_UNKNOWN;
+	}
+	switch (RenderScreen)
+	{
+		case START_GAME:
+			/* Half-block mode shows a different number of rows from an even camera row */
+			Camera = calculateCamera(DrawnHeadPosition, Camera);
+			drawGameFrame();
+			drawViewport();
+			renderRequest(&scoreRenderRequest);
+			renderRequest(&timeRenderRequest);
+#if SHOW_CPU_LOAD
+			/* The header shows dashes until the first sample */
+			if (gameTime >= CPU_LOAD_PERIOD) renderRequest(&cpuLoadRenderRequest);
+#endif
+			break;
+		case LOSS_MESSAGE:
+		case WIN_MESSAGE:
+			drawEndMessage(RenderScreen == WIN_MESSAGE);
+			break;
+		default:
+			renderRequest(&mainMenuRenderRequest);
+			break;
+	}
+	if (!colored) resetCellColor();
+	else if (foreground != CellColor || background != CellBackground)
+	{
+		CellColor = PALETTE_UNKNOWN;
+		CellBackground = PALETTE_UNKNOWN;
+		useCellColors(foreground != PALETTE_UNKNOWN ? foreground : PALETTE_ANY, background != PALETTE_UNKNOWN ? background : PALETTE_ANY);
 	}
 }
-void EnemySpawnTask(void* vpParameters)
+
+void SnakePositionUpdateTask(void *vpParameters)
 {
-	PointType enemyPosition;
-	bool freePosition;
-	int i;
-	RenderRequestType enemyRenderRequest = {ENEMY_POSITION_UPDATE, {-1, -1}, true, {-1, -1}};
-	RenderRequestType enemyRemoveRenderRequest = {REMOVE_ENEMY, {-1, -1}, true, {-1, -1}};
+	bool firstLoop = true;
+	bool missed = false;
+	bool overrun;
+	uint32_t tickStart;
+	GameOutcomeType outcome;
+	startGameTick(SnakeSpeed);
 	for ( ;; )
 	{
+		tickStart = readTimestamp();
+		overrun = updateRenderSlack(firstLoop, tickStart);
 		xSemaphoreTake(GameStateLock, portMAX_DELAY);
-		
-		if (GameState.enemyPosition.x >= 0 && GameState.enemyPosition.y >= 0)
-		{
-			enemyRemoveRenderRequest.headPosition = GameState.enemyPosition;
-			GameState.enemyPosition.x = -1;
-			GameState.enemyPosition.y = -1;
-			xQueueSend(RenderQueue, (const void *)&enemyRemoveRenderRequest, portMAX_DELAY);
-		}
-		do
-		{
-			enemyPosition = generateRandomPosition();
-			freePosition = true;
-			for (i = 0; i < GameState.snakeLength; i++)
-			{
-				if (GameState.snakePositions[i].x == enemyPosition.x && GameState.snakePositions[i].y == enemyPosition.y)
-				{
-					freePosition = false;
-					break;
-				}
-			}
-			if (GameState.normalPowerUpPosition.x == enemyPosition.x && GameState.normalPowerUpPosition.y == enemyPosition.y) freePosition = false;
-			if (GameState.specialPowerUpPosition.x == enemyPosition.x && GameState.enemyPosition.y == enemyPosition.y) freePosition = false;
-		} while (freePosition == false);
-		GameState.enemyPosition = enemyPosition;
-		enemyRenderRequest.headPosition = enemyPosition;
-		xQueueSend(RenderQueue, (const void *)&enemyRenderRequest, portMAX_DELAY);
-		
+		outcome = snakeTick();
+		if (StressMode) outcome = stressTick(outcome, tickStart, missed, overrun, uxQueueMessagesWaiting(RenderQueue));
+		if (outcome != GAME_RUNNING) endGame(outcome == GAME_WON);
+		/* Stage one: the next tick is worked out now, while RenderTask sends this one */
+		planSnakeTick(&TickPlan);
 		xSemaphoreGive(GameStateLock);
-		
-		vTaskDelay(ENEMY_PERIOD/portTICK_RATE_MS);
+		missed = updateTickStats(firstLoop, tickStart, readTimestamp());
+		/* A tick held by the console is not measured against the one before it */
+		firstLoop = waitForGameTick();
 	}
 }
 
@@ -561,12 +540,24 @@ void TimeUpdateTask(void *vpParameters)
 {
 	portTickType lastWokenTime;
 	lastWokenTime = xTaskGetTickCount();
-	RenderRequestType timeUpdateRenderRequest = {TIME_UPDATE, {-1, -1}, true, {-1, -1}};
+	RenderRequestType timeUpdateRenderRequest = RENDER_REQUEST(TIME_UPDATE);
+#if SHOW_CPU_LOAD
+	RenderRequestType cpuLoadRenderRequest = RENDER_REQUEST(CPU_LOAD_UPDATE);
+#endif
 	for ( ;; ) 
 	{
 		vTaskDelayUntil(&lastWokenTime, 1000 / portTICK_RATE_MS);
-		time++;
+		/* The clock stops with the snake when the console pauses the game */
+		if (GameTickPaused) continue;
+		gameTime++;
 		xQueueSend(RenderQueue, (const void *)&timeUpdateRenderRequest, portMAX_DELAY);
+#if SHOW_CPU_LOAD
+		if (gameTime % CPU_LOAD_PERIOD == 0)
+		{
+			sampleCpuLoad();
+			xQueueSend(RenderQueue, (const void *)&cpuLoadRenderRequest, portMAX_DELAY);
+		}
+#endif
 	}
 }
 
@@ -590,6 +581,19 @@ void initializeHardware()
 	UARTCharPut(UART0_BASE, '1');
 }
 
+/* Polled rather than read with UARTCharGet, which spins until a key comes and
+ * leaves the idle task nothing. On a sharded world e pressed on another board
+ * starts the game here too */
+char waitForMenuKey()
+{
+	for ( ;; )
+	{
+		if (UARTCharsAvail(UART0_BASE)) return (char)UARTCharGet(UART0_BASE);
+		if (ShardCount > 1 && ShardStartPending) return 'e';
+		vTaskDelay(MENU_KEY_POLL / portTICK_RATE_MS);
+	}
+}
+
 void resetGameState()
 {
 	int i = 0;
@@ -604,78 +608,86 @@ void resetGameState()
 		GameState.snakePositions[i].y = -1;
 	}
 	GameState.snakeLength = INITIAL_SNAKE_LENGTH;
-	GameState.normalPowerUpPosition.x = -1;
-	GameState.normalPowerUpPosition.y = -1;
-	GameState.specialPowerUpPosition.x = -1;
-	GameState.specialPowerUpPosition.y = -1;
-	GameState.enemyPosition.x = -1;
-	GameState.enemyPosition.y = -1;
+	resetEntities();
+	TickPlan.valid = false;
 	LastDirection = RIGHT;
 	score = 0;
-	time = 0;
+	gameTime = 0;
+	GameTickIndex = 0;
 }
 
 void clearScreen()
 {
-	UARTCharPut(UART0_BASE, '\033');
-	UARTCharPut(UART0_BASE, '[');
-	UARTCharPut(UART0_BASE, '2');
-	UARTCharPut(UART0_BASE, 'J');
-	UARTCharPut(UART0_BASE, '\033');
-	UARTCharPut(UART0_BASE, '[');
-	UARTCharPut(UART0_BASE, 'H');
+	putRenderChar('\033');
+	putRenderChar('[');
+	putRenderChar('2');
+	putRenderChar('J');
+	putRenderChar('\033');
+	putRenderChar('[');
+	putRenderChar('H');
 }
 
 void moveCursorToPosition(int line, int column)
 {
-	UARTCharPut(UART0_BASE, '\033');
-	UARTCharPut(UART0_BASE, '[');
-	UARTCharPut(UART0_BASE, 'H');
-	UARTCharPut(UART0_BASE, '\033');
-	UARTCharPut(UART0_BASE, '[');
+#if GEOMETRY_TABLES
+	putCursorFragment(&CursorLineFragments[line]);
+	putCursorFragment(&CursorColumnFragments[column]);
+#else
+	putRenderChar('\033');
+	putRenderChar('[');
+	putRenderChar('H');
+	putRenderChar('\033');
+	putRenderChar('[');
 	if (line < 10)
 	{
-		UARTCharPut(UART0_BASE, line + 48);
+		putRenderChar(line + 48);
 	}
 	else 
 	{
-		UARTCharPut(UART0_BASE, line/10 + 48);
-		UARTCharPut(UART0_BASE, line%10 + 48);
+		putRenderChar(line/10 + 48);
+		putRenderChar(line%10 + 48);
 	}
-	UARTCharPut(UART0_BASE, 'B');
-	UARTCharPut(UART0_BASE, '\033');
-	UARTCharPut(UART0_BASE, '[');
+	putRenderChar('B');
+	putRenderChar('\033');
+	putRenderChar('[');
 	if (column < 10)
 	{
-		UARTCharPut(UART0_BASE, column + 48);
+		putRenderChar(column + 48);
 	}
 	else 
 	{
-		UARTCharPut(UART0_BASE, column/10 + 48);
-		UARTCharPut(UART0_BASE, column%10 + 48);
+		putRenderChar(column/10 + 48);
+		putRenderChar(column%10 + 48);
 	}
-	UARTCharPut(UART0_BASE, 'C');
+	putRenderChar('C');
+#endif
 }
 
 void moveCursorToBottom()
 {
-	moveCursorToPosition(ENV_HEIGHT + 3, 0);
+	moveCursorToPosition(viewportLines() + 3, 0);
+}
+
+void seedRandomNumber(int seed)
+{
+	/* Zero is the one state xorshift never leaves */
+	RandomState = seed != 0 ? seed : 1;
 }
 
 int generateRandomNumber()
 {
-	static int x = 0;
-	
-	PointType position;
+	int x;
 	
 	xSemaphoreTake(GenerateRandomNumberLock, portMAX_DELAY);
 	
-	if (x == 0) x = xTaskGetTickCount();
+	if (RandomState == 0) seedRandomNumber(xTaskGetTickCount());
+	x = RandomState;
 	
 	x ^= x << 13;
 	x ^= x >> 17;
 	x ^= x << 5;
 	
+	RandomState = x;
 	xSemaphoreGive(GenerateRandomNumberLock);
 	
 	return x;
@@ -684,12 +696,327 @@ int generateRandomNumber()
 PointType generateRandomPosition()
 {
 	PointType position;
-	position.x = generateRandomNumber();
-	position.y = generateRandomNumber();
-	position.x = position.x % ENV_WIDTH;
-	position.y = position.y % ENV_HEIGHT;
-	if (position.x < 0) position.x = position.x + ENV_WIDTH;
-	if (position.y < 0) position.y = position.y + ENV_HEIGHT;
+	/* Reduced in int, the same spawns as before the coordinates got narrower */
+	int x = generateRandomNumber();
+	int y = generateRandomNumber();
+#if GEOMETRY_POW2
+	x = x & (ENV_WIDTH - 1);
+	y = y & (ENV_HEIGHT - 1);
+#else
+	/* A negative remainder has the size added through its sign bits */
+	x = x % ENV_WIDTH;
+	y = y % ENV_HEIGHT;
+	x = x + ((x >> 31) & ENV_WIDTH);
+	y = y + ((y >> 31) & ENV_HEIGHT);
+#endif
+	position.x = x;
+	position.y = y;
 	
 	return position;
-}
\ No newline at end of file
+}
+
+PointType calculateNewHeadPosition(PointType head, Direction direction)
+{
+	/* On a sharded world the columns go on to the neighbouring boards, x wraps by a width of 0 */
+	int width = ENV_WIDTH & -(ShardCount == 1);
+	int x = head.x + DirectionSteps[direction][0];
+	int y = head.y + DirectionSteps[direction][1];
+#if GEOMETRY_POW2
+	head.x = x & ((ENV_WIDTH - 1) | (width - ENV_WIDTH));
+	head.y = y & (ENV_HEIGHT - 1);
+#else
+	head.x = GEOMETRY_WRAP(x, width);
+	head.y = GEOMETRY_WRAP(y, ENV_HEIGHT);
+#endif
+	return head;
+}
+
+bool isSnakeCollision(PointType position)
+{
+	int i;
+	if (ShardCount > 1) return isShardCollision(position);
+	for (i = 1; i < GameState.snakeLength; i++)
+	{
+		if (position.x == GameState.snakePositions[i].x && position.y == GameState.snakePositions[i].y) return true;
+	}
+	return false;
+}
+
+bool isPositionFree(PointType position)
+{
+	int i;
+	for (i = 0; i < GameState.snakeLength; i++)
+	{
+		if (GameState.snakePositions[i].x == position.x && GameState.snakePositions[i].y == position.y) return false;
+	}
+	if (findEntity(position) != ENTITY_NONE) return false;
+	if (ShardCount > 1 && isShardTrail(position)) return false;
+	return true;
+}
+
+GameOutcomeType snakeTick()
+{
+	char key;
+	GameOutcomeType outcome;
+	if (ShardCount > 1) return shardTick();
+	if (ReplayMode == REPLAY_PLAYING)
+	{
+		/* Any key stops a replay */
+		if (UARTCharsAvail(UART0_BASE) > 0)
+		{
+			UARTCharGet(UART0_BASE);
+			return GAME_LOST;
+		}
+		outcome = applyReplayEvents(GameTickIndex);
+		if (outcome != GAME_RUNNING) return outcome;
+	}
+	else if (AutopilotMode) steerAutopilot();
+	else if (StressMode) changeDirection(takeStressKey());
+	else if (UARTCharsAvail(UART0_BASE) > 0)
+	{
+		key = UARTCharGet(UART0_BASE);
+		/* The tick the key is read on shows the game as it was, the snake moves again from the next one */
+		if (key == REWIND_KEY && rewindGame(rewindTicks(REWIND_STEP_SECONDS))) return GAME_RUNNING;
+		changeDirection(key);
+	}
+	return advanceSnake();
+}
+
+/* The snake only turns sideways, a key for the way it is going or the opposite one does nothing */
+Direction turnDirection(Direction direction, char key)
+{
+	switch(key)
+	{
+		case 'a':
+			if (direction == UP || direction == DOWN) return LEFT;
+			break;
+		case 's':
+			if (direction == LEFT || direction == RIGHT) return DOWN;
+			break;
+		case 'd':
+			if (direction == UP || direction == DOWN) return RIGHT;
+			break;
+		case 'w':
+			if (direction == LEFT || direction == RIGHT) return UP;
+			break;
+	}
+	return direction;
+}
+
+void changeDirection(char key)
+{
+	Direction direction = turnDirection(LastDirection, key);
+	if (direction != LastDirection)
+	{
+		LastDirection = direction;
+		recordDirection(direction);
+	}
+}
+
+/* Everything the next tick decides, without changing anything. Called with GameStateLock held */
+void planSnakeTick(TickPlanType *plan)
+{
+	uint32_t profileStart;
+	plan->head = GameState.snakePositions[0];
+	plan->direction = LastDirection;
+	plan->snakeLength = GameState.snakeLength;
+	plan->entityChanges = EntityChanges;
+	PROFILE_START(profileStart);
+	plan->newHead = calculateNewHeadPosition(plan->head, plan->direction);
+	plan->leaves = plan->newHead.x < 0 || plan->newHead.x >= ENV_WIDTH;
+	plan->collision = !plan->leaves && isSnakeCollision(plan->newHead);
+	plan->entity = plan->leaves ? ENTITY_FREE : entityKindAt(plan->newHead);
+	PROFILE_END(PROFILE_SNAKE_COLLISION, profileStart);
+	plan->valid = true;
+}
+
+/* On a sharded world the trails of the other boards change under the plan, it is always worked out again */
+bool isTickPlanCurrent(const TickPlanType *plan)
+{
+	return plan->valid && ShardCount == 1 && plan->direction == LastDirection && plan->entityChanges == EntityChanges &&
+		plan->snakeLength == GameState.snakeLength && plan->head.x == GameState.snakePositions[0].x && plan->head.y == GameState.snakePositions[0].y;
+}
+
+GameOutcomeType advanceSnake()
+{
+	const RenderRequestType updateScoreRenderRequest = RENDER_REQUEST(SCORE_UPDATE);
+	RenderRequestType renderRequest;
+	PointType newHeadPosition;
+	PointType tailPosition = GameState.snakePositions[GameState.snakeLength - 1];
+	bool removeTail = true;
+	uint32_t profileStart;
+	int i;
+	/* Stage two: the plan made after the last tick, or a new one when the key read at the deadline turned the snake */
+	if (!isTickPlanCurrent(&TickPlan)) planSnakeTick(&TickPlan);
+	TickPlan.valid = false;
+	newHeadPosition = TickPlan.newHead;
+	/* Only on a sharded world, the neighbour makes the move */
+	if (TickPlan.leaves)
+	{
+		handOffSnake();
+		return GAME_RUNNING;
+	}
+	/* Check for Self-Collision */
+	if (TickPlan.collision) return GAME_LOST;
+	/* Check for enemy Collision */
+	if (TickPlan.entity == ENTITY_ENEMY) return GAME_LOST;
+	/* Check for Normal Power Up */
+	if (TickPlan.entity == ENTITY_NORMAL_POWERUP)
+	{
+		GameState.snakeLength++;
+		removeTail = false;
+		renderRequest = packRenderRequest(REMOVE_NORMAL_POWERUP, newHeadPosition, false, newHeadPosition);
+		removeEntity(findEntity(newHeadPosition));
+		xSemaphoreGive(NormalPowerUpSemaphore);
+		xQueueSend(RenderQueue, (const void *)&renderRequest, portMAX_DELAY);
+		score++;
+		xQueueSend(RenderQueue, (const void *)&updateScoreRenderRequest, portMAX_DELAY);
+	}
+	/* Check for special Power Up */
+	if (TickPlan.entity == ENTITY_SPECIAL_POWERUP)
+	{
+		GameState.snakeLength++;
+		removeTail = false;
+		renderRequest = packRenderRequest(REMOVE_SPECIAL_POWERUP, newHeadPosition, false, newHeadPosition);
+		removeEntity(findEntity(newHeadPosition));
+		xQueueSend(RenderQueue, (const void *)&renderRequest, portMAX_DELAY);
+		score += 5;
+		xQueueSend(RenderQueue, (const void *)&updateScoreRenderRequest, portMAX_DELAY);
+	}
+	/* Check for win */
+	if (GameState.snakeLength == MAX_SNAKE_LENGTH) return GAME_WON;
+	/* Move Snake */
+	PROFILE_START(profileStart);
+	for (i = GameState.snakeLength - 1; i > 0; i--) 
+	{
+		GameState.snakePositions[i] = GameState.snakePositions[i-1];
+	}
+	PROFILE_END(PROFILE_SNAKE_SHIFT, profileStart);
+	GameState.snakePositions[0] = newHeadPosition;
+	recordRewindTick(TickPlan.direction, removeTail ? ENTITY_FREE : (EntityKind)TickPlan.entity);
+	/* A tail left on another board is cleared there */
+	if (removeTail && (tailPosition.x < 0 || tailPosition.x >= ENV_WIDTH))
+	{
+		sendShardCell(tailPosition);
+		removeTail = false;
+	}
+	renderRequest = packRenderRequest(SNAKE_POSITION_UPDATE, newHeadPosition, removeTail, tailPosition);
+	xQueueSend(RenderQueue, (const void *)&renderRequest, portMAX_DELAY);
+	GameTickIndex++;
+	return GAME_RUNNING;
+}
+
+void spawnNormalPowerUp()
+{
+	placeNormalPowerUp(generateFreePosition());
+}
+
+void cycleSpecialPowerUp()
+{
+	removeSpecialPowerUp();
+	if (generateRandomNumber() % SPECIAL_POWERUP_FREQ == 0) placeSpecialPowerUp(generateFreePosition());
+}
+
+void respawnEnemy()
+{
+	placeEnemy(generateFreePosition());
+}
+
+void placeNormalPowerUp(PointType position)
+{
+	RenderRequestType powerUpRenderRequest = packRenderRequest(NORMAL_POWERUP_POSITION_UPDATE, position, false, position);
+	addEntity(ENTITY_NORMAL_POWERUP, position, ENTITY_NO_EXPIRY);
+	xQueueSend(RenderQueue, (const void *)&powerUpRenderRequest, portMAX_DELAY);
+	recordEvent(REPLAY_EVENT_NORMAL_POWERUP, position);
+	recordRewindPlace(ENTITY_NORMAL_POWERUP, position);
+}
+
+void placeSpecialPowerUp(PointType position)
+{
+	RenderRequestType powerUpRenderRequest = packRenderRequest(SPECIAL_POWERUP_POSITION_UPDATE, position, false, position);
+	/* Taken away again once the entity schedule has given it an expiry and that has come */
+	addEntity(ENTITY_SPECIAL_POWERUP, position, ENTITY_NO_EXPIRY);
+	xQueueSend(RenderQueue, (const void *)&powerUpRenderRequest, portMAX_DELAY);
+	recordEvent(REPLAY_EVENT_SPECIAL_POWERUP, position);
+	recordRewindPlace(ENTITY_SPECIAL_POWERUP, position);
+}
+
+void removeSpecialPowerUp()
+{
+	RenderRequestType powerUpRemoveRenderRequest;
+	EntityIndexType index = findEntityOfKind(ENTITY_SPECIAL_POWERUP);
+	PointType position;
+	if (index != ENTITY_NONE)
+	{
+		position = EntityPool[index].position;
+		powerUpRemoveRenderRequest = packRenderRequest(REMOVE_SPECIAL_POWERUP, position, false, position);
+		removeEntity(index);
+		xQueueSend(RenderQueue, (const void *)&powerUpRemoveRenderRequest, portMAX_DELAY);
+		recordEvent(REPLAY_EVENT_REMOVE_SPECIAL_POWERUP, position);
+		recordRewindRemove(ENTITY_SPECIAL_POWERUP);
+	}
+}
+
+void placeEnemy(PointType position)
+{
+	RenderRequestType enemyRenderRequest = packRenderRequest(ENEMY_POSITION_UPDATE, position, false, position);
+	RenderRequestType enemyRemoveRenderRequest;
+	EntityIndexType index = findEntityOfKind(ENTITY_ENEMY);
+	/* The enemy moves, the one there was is taken away */
+	if (index != ENTITY_NONE)
+	{
+		enemyRemoveRenderRequest = packRenderRequest(REMOVE_ENEMY, EntityPool[index].position, false, EntityPool[index].position);
+		removeEntity(index);
+		xQueueSend(RenderQueue, (const void *)&enemyRemoveRenderRequest, portMAX_DELAY);
+	}
+	addEntity(ENTITY_ENEMY, position, ENTITY_NO_EXPIRY);
+	xQueueSend(RenderQueue, (const void *)&enemyRenderRequest, portMAX_DELAY);
+	recordEvent(REPLAY_EVENT_ENEMY, position);
+	recordRewindPlace(ENTITY_ENEMY, position);
+}
+
+PointType generateFreePosition()
+{
+	PointType position;
+	uint32_t profileStart;
+	PROFILE_START(profileStart);
+	do
+	{
+		position = generateRandomPosition();
+	} while (!isPositionFree(position));
+	PROFILE_END(PROFILE_SPAWN_REJECTION, profileStart);
+	return position;
+}
+
+void endGame(bool won)
+{
+	const RenderRequestType lossMessageRenderRequest = RENDER_REQUEST(LOSS_MESSAGE);
+	const RenderRequestType winMessageRenderRequest = RENDER_REQUEST(WIN_MESSAGE);
+	stopGameTick();
+	endCpuStatsSession();
+	vSemaphoreDelete(GameStateLock);
+	vSemaphoreDelete(GenerateRandomNumberLock);
+	vSemaphoreDelete(NormalPowerUpSemaphore);
+	/* The spawners do not run during a replay, and deleting a NULL handle would delete this task */
+	if (EntityTaskHandle != NULL) vTaskDelete(EntityTaskHandle);
+	if (StressInputTaskHandle != NULL) vTaskDelete(StressInputTaskHandle);
+	vTaskDelete(TimeUpdateTaskHandle);
+	inGame = false;
+	xTaskNotifyGive(MainMenuTaskHandle);
+	/* The other boards of a sharded world end the same way */
+	if (ShardCount > 1 && ShardOwner) endShardGame(won);
+	if (ReplayMode == REPLAY_PLAYING) stopReplay();
+	else
+	{
+		stopRecording(won);
+		stopRewind();
+		if (!AutopilotMode && !StressMode)
+		{
+			wonLast = won;
+			/* Only queued here, the EEPROM is written by the high score task */
+			submitHighScore(score, gameTime, SnakeSpeed, GameState.snakeLength);
+		}
+	}
+	xQueueSend(RenderQueue, (const void *)(won ? &winMessageRenderRequest : &lossMessageRenderRequest), portMAX_DELAY);
+	vTaskDelete(NULL);
+}
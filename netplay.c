@@ -0,0 +1,611 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inc/hw_ints.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/gpio.h>
+#include <driverlib/pin_map.h>
+#include <driverlib/uart.h>
+#include <driverlib/interrupt.h>
+
+#include "netplay.h"
+#include "gameTick.h"
+#include "cpuStats.h"
+#include "viewport.h"
+
+/* Global Variables */
+NetplayStateType NetplayState;			/* After the newest tick, predicted past NetplayRemoteTick */
+NetplayStateType NetplaySnapshots[NETPLAY_ROLLBACK_TICKS];	/* Before each tick, by tick */
+uint8_t NetplayInputs[2][NETPLAY_HISTORY];	/* Direction of each snake on each tick, by tick */
+int NetplayPlayer = 0;					/* The snake this board steers */
+unsigned long NetplayTick = 0;			/* Next tick to simulate */
+unsigned long NetplayRemoteTick = 0;	/* Every remote input before this tick is known */
+unsigned long NetplayAckedTick = 0;		/* The remote has every local input before this tick */
+unsigned long NetplayMispredictedTick = NETPLAY_NO_TICK;
+unsigned long NetplayQuietTicks = 0;
+NetplayStatsType NetplayStats;
+xQueueHandle NetplayRxQueue = NULL;
+xTaskHandle NetplayTaskHandle;
+bool NetplayActive = false;
+uint32_t NetplayNonce = 0;
+uint32_t NetplayRemoteNonce = 0;
+bool NetplayHelloReceived = false;
+bool NetplayHelloSeen = false;			/* The remote has our hello */
+bool NetplayHelloPending = false;		/* The remote is still waiting for one */
+uint8_t NetplayPacket[NETPLAY_PACKET_SIZE];
+int NetplayPacketLength = 0;
+/* Render task side, what it drew last and what it is about to draw */
+NetplayStateType NetplayDrawnState;
+NetplayStateType NetplayFrameState;
+char NetplayCells[ENV_HEIGHT][ENV_WIDTH];
+
+void simulateNetplayTick(unsigned long tick);
+void handleNetplayPacket(const uint8_t *packet);
+void sendNetplayPacket(uint8_t *packet);
+void sendNetplayHello(uint32_t nonce, bool heard);
+uint16_t netplayChecksum(const uint8_t *packet);
+bool expandNetplayTick(uint16_t low, unsigned long *tick);
+uint16_t spawnNetplayPowerUp(NetplayStateType *state);
+void markNetplayCells(const NetplayStateType *state, bool blank);
+void drawNetplayCells(const NetplayStateType *state);
+void lingerNetplay();
+
+/* UART2 on PD6 and PD7, PD7 is an NMI pin and has to be unlocked first */
+void initializeNetplay()
+{
+	NetplayRxQueue = xQueueCreate(NETPLAY_RX_QUEUE_LENGTH, sizeof(uint8_t));
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_GPIOD));
+	GPIOUnlockPin(GPIO_PORTD_BASE, GPIO_PIN_7);
+	GPIOPinTypeUART(GPIO_PORTD_BASE, GPIO_PIN_6 | GPIO_PIN_7);
+	GPIOPinConfigure(GPIO_PD6_U2RX);
+	GPIOPinConfigure(GPIO_PD7_U2TX);
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_UART2);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_UART2));
+	UARTConfigSetExpClk(NETPLAY_UART_BASE, SysCtlClockGet(), NETPLAY_BAUD_RATE, UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
+	/* A whole packet fits in the TX FIFO, so sending one never waits */
+	UARTFIFOEnable(NETPLAY_UART_BASE);
+	UARTFIFOLevelSet(NETPLAY_UART_BASE, UART_FIFO_TX2_8, UART_FIFO_RX1_8);
+	UARTIntEnable(NETPLAY_UART_BASE, UART_INT_RX | UART_INT_RT);
+	IntPrioritySet(INT_UART2, configKERNEL_INTERRUPT_PRIORITY);
+	IntEnable(INT_UART2);
+}
+
+void UART2_Handler(void)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	uint8_t c;
+	UARTIntClear(NETPLAY_UART_BASE, UARTIntStatus(NETPLAY_UART_BASE, true));
+	while (UARTCharsAvail(NETPLAY_UART_BASE))
+	{
+		c = (uint8_t)UARTCharGetNonBlocking(NETPLAY_UART_BASE);
+		/* A dropped byte costs a packet, which is sent again until acknowledged */
+		xQueueSendFromISR(NetplayRxQueue, (const void *)&c, &higherPriorityTaskWoken);
+	}
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+/* Both boards send hellos until each has seen the other's. The higher nonce
+ * steers snake 0 and is the seed of the game */
+bool connectNetplay(uint32_t *seed)
+{
+	portTickType start = xTaskGetTickCount();
+	NetplayNonce = xTaskGetTickCount() * 2654435761u ^ readTimestamp();
+	NetplayActive = false;
+	/* Whatever is left from the last game would pass for an answer */
+	xQueueReset(NetplayRxQueue);
+	NetplayPacketLength = 0;
+	NetplayHelloReceived = false;
+	NetplayHelloSeen = false;
+	while (xTaskGetTickCount() - start < NETPLAY_CONNECT_TIMEOUT / portTICK_RATE_MS)
+	{
+		sendNetplayHello(NetplayNonce, NetplayHelloReceived);
+		vTaskDelay(NETPLAY_HELLO_PERIOD / portTICK_RATE_MS);
+		receiveNetplayPackets();
+		if (!NetplayHelloReceived) continue;
+		if (NetplayRemoteNonce == NetplayNonce)
+		{
+			NetplayNonce = NetplayNonce * 2654435761u ^ readTimestamp();
+			NetplayHelloSeen = false;
+			continue;
+		}
+		if (NetplayHelloSeen)
+		{
+			sendNetplayHello(NetplayNonce, true);
+			NetplayPlayer = NetplayNonce > NetplayRemoteNonce ? 0 : 1;
+			*seed = NetplayNonce > NetplayRemoteNonce ? NetplayNonce : NetplayRemoteNonce;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* The first NETPLAY_INPUT_DELAY ticks have no key behind them on either board, both snakes keep going */
+void resetNetplay(uint32_t seed, int player)
+{
+	unsigned long tick;
+	NetplayPlayer = player;
+	resetNetplayState(&NetplayState, seed);
+	for (tick = 0; tick < NETPLAY_INPUT_DELAY; tick++)
+	{
+		NetplayInputs[0][tick % NETPLAY_HISTORY] = RIGHT;
+		NetplayInputs[1][tick % NETPLAY_HISTORY] = LEFT;
+	}
+	NetplayTick = 0;
+	NetplayRemoteTick = NETPLAY_INPUT_DELAY;
+	NetplayAckedTick = NETPLAY_INPUT_DELAY;
+	NetplayMispredictedTick = NETPLAY_NO_TICK;
+	NetplayQuietTicks = 0;
+	NetplayHelloPending = false;
+	memset(&NetplayStats, 0, sizeof(NetplayStats));
+	NetplayActive = true;
+}
+
+void NetplayTask(void *vpParameters)
+{
+	bool firstLoop = true;
+	uint32_t tickStart;
+	GameOutcomeType outcome;
+	startGameTick(SnakeSpeed);
+	for ( ;; )
+	{
+		tickStart = readTimestamp();
+		xSemaphoreTake(GameStateLock, portMAX_DELAY);
+		outcome = netplayTick();
+		xSemaphoreGive(GameStateLock);
+		if (outcome != GAME_RUNNING) endNetplay(outcome);
+		updateTickStats(firstLoop, tickStart, readTimestamp());
+		firstLoop = waitForGameTick();
+	}
+}
+
+/* One game tick. Remote inputs that came in are checked against what was
+ * predicted for them and the game is resimulated from the first wrong one.
+ * The board only waits when it is NETPLAY_ROLLBACK_TICKS ahead of the remote
+ * inputs, and the end only stands once every remote input before it is known.
+ * Ticks after a predicted end are still counted, a rollback can undo the end */
+GameOutcomeType netplayTick()
+{
+	const RenderRequestType netplayFrameRenderRequest = RENDER_REQUEST(NETPLAY_FRAME);
+	GameOutcomeType outcome = GAME_RUNNING;
+	bool changed = false;
+	receiveNetplayPackets();
+	if (NetplayQuietTicks++ > NETPLAY_TIMEOUT_TICKS) return GAME_LOST;
+	if (NetplayMispredictedTick < NetplayTick)
+	{
+		rollBackNetplay(NetplayMispredictedTick);
+		changed = true;
+	}
+	NetplayMispredictedTick = NETPLAY_NO_TICK;
+	if (NetplayState.over)
+	{
+		if (NetplayRemoteTick >= NetplayState.ticks) outcome = NetplayState.snakes[NetplayPlayer].alive ? GAME_WON : GAME_LOST;
+	}
+	else if (NetplayTick >= NetplayRemoteTick + NETPLAY_ROLLBACK_TICKS) NetplayStats.stalls++;
+	else
+	{
+		scheduleLocalInput(UARTCharsAvail(UART0_BASE) ? (char)UARTCharGet(UART0_BASE) : 0);
+		simulateNetplayTick(NetplayTick++);
+		changed = true;
+	}
+	sendNetplayInputs();
+	if (NetplayHelloPending) sendNetplayHello(NetplayNonce, true);
+	NetplayHelloPending = false;
+	if (changed) xQueueSend(RenderQueue, (const void *)&netplayFrameRenderRequest, portMAX_DELAY);
+	return outcome;
+}
+
+/* The key turns the snake from the direction it will have on the tick before */
+void scheduleLocalInput(char key)
+{
+	unsigned long tick = NetplayTick + NETPLAY_INPUT_DELAY;
+	Direction direction = (Direction)NetplayInputs[NetplayPlayer][(tick - 1) % NETPLAY_HISTORY];
+	NetplayInputs[NetplayPlayer][tick % NETPLAY_HISTORY] = (uint8_t)turnDirection(direction, key);
+}
+
+/* A remote input that is not known yet is predicted to be the last one that is */
+void simulateNetplayTick(unsigned long tick)
+{
+	int remote = 1 - NetplayPlayer;
+	uint8_t directions[2];
+	if (tick >= NetplayRemoteTick)
+	{
+		NetplayInputs[remote][tick % NETPLAY_HISTORY] = NetplayInputs[remote][(NetplayRemoteTick - 1) % NETPLAY_HISTORY];
+		NetplayStats.predictions++;
+	}
+	NetplaySnapshots[tick % NETPLAY_ROLLBACK_TICKS] = NetplayState;
+	directions[0] = NetplayInputs[0][tick % NETPLAY_HISTORY];
+	directions[1] = NetplayInputs[1][tick % NETPLAY_HISTORY];
+	stepNetplayState(&NetplayState, directions);
+}
+
+/* A misprediction is never older than NETPLAY_ROLLBACK_TICKS, the board stops before that */
+void rollBackNetplay(unsigned long tick)
+{
+	unsigned long depth = NetplayTick - tick;
+	NetplayState = NetplaySnapshots[tick % NETPLAY_ROLLBACK_TICKS];
+	for ( ; tick < NetplayTick; tick++) simulateNetplayTick(tick);
+	NetplayStats.rollbacks++;
+	NetplayStats.resimulatedTicks += depth;
+	if (depth > NetplayStats.maxRollback) NetplayStats.maxRollback = depth;
+}
+
+void receiveNetplayPackets()
+{
+	uint8_t c;
+	while (xQueueReceive(NetplayRxQueue, (void *)&c, 0) == pdPASS) receiveNetplayByte(c);
+}
+
+/* Bytes are collected from a sync byte on. When the checksum does not match,
+ * a byte was lost and the search starts again from the next sync byte */
+void receiveNetplayByte(uint8_t c)
+{
+	int skip;
+	if (NetplayPacketLength == 0 && c != NETPLAY_SYNC)
+	{
+		NetplayStats.badBytes++;
+		return;
+	}
+	NetplayPacket[NetplayPacketLength++] = c;
+	if (NetplayPacketLength < NETPLAY_PACKET_SIZE) return;
+	if (netplayChecksum(NetplayPacket) == (NetplayPacket[9] | NetplayPacket[10] << 8))
+	{
+		handleNetplayPacket(NetplayPacket);
+		NetplayPacketLength = 0;
+		return;
+	}
+	for (skip = 1; skip < NETPLAY_PACKET_SIZE && NetplayPacket[skip] != NETPLAY_SYNC; skip++);
+	NetplayStats.badBytes += skip;
+	NetplayPacketLength = NETPLAY_PACKET_SIZE - skip;
+	memmove(NetplayPacket, NetplayPacket + skip, NetplayPacketLength);
+}
+
+void handleNetplayPacket(const uint8_t *packet)
+{
+	int remote = 1 - NetplayPlayer;
+	unsigned long first;
+	unsigned long acked;
+	unsigned long tick;
+	uint16_t directions;
+	uint8_t direction;
+	int count;
+	int i;
+	if (packet[1] == NETPLAY_HELLO)
+	{
+		/* A hello during the game means the remote missed the last one */
+		if (NetplayActive) NetplayHelloPending = true;
+		else if (!NetplayHelloSeen)
+		{
+			NetplayRemoteNonce = packet[2] | packet[3] << 8 | (uint32_t)packet[4] << 16 | (uint32_t)packet[5] << 24;
+			NetplayHelloReceived = true;
+			if (packet[6] != 0 && (packet[7] | packet[8] << 8) == (uint16_t)NetplayNonce) NetplayHelloSeen = true;
+		}
+		return;
+	}
+	count = packet[6];
+	if (packet[1] != NETPLAY_INPUTS || !NetplayActive || count > NETPLAY_PACKET_INPUTS) return;
+	if (!expandNetplayTick(packet[2] | packet[3] << 8, &first) || !expandNetplayTick(packet[4] | packet[5] << 8, &acked)) return;
+	NetplayStats.packetsReceived++;
+	NetplayQuietTicks = 0;
+	if (acked > NetplayAckedTick && acked <= NetplayTick + NETPLAY_INPUT_DELAY) NetplayAckedTick = acked;
+	directions = packet[7] | packet[8] << 8;
+	for (i = 0; i < count; i++)
+	{
+		tick = first + i;
+		/* Inputs are taken in order, a gap is filled by a later packet */
+		if (tick != NetplayRemoteTick) continue;
+		direction = (directions >> (2 * i)) & 3;
+		if (tick < NetplayTick && direction != NetplayInputs[remote][tick % NETPLAY_HISTORY] && tick < NetplayMispredictedTick)
+		{
+			NetplayMispredictedTick = tick;
+		}
+		NetplayInputs[remote][tick % NETPLAY_HISTORY] = direction;
+		NetplayRemoteTick++;
+	}
+}
+
+/* Every local input the remote has not acknowledged, up to NETPLAY_PACKET_INPUTS from the oldest */
+void sendNetplayInputs()
+{
+	uint8_t packet[NETPLAY_PACKET_SIZE];
+	unsigned long first = NetplayAckedTick;
+	unsigned long end = NetplayTick + NETPLAY_INPUT_DELAY;
+	uint16_t directions = 0;
+	int count = end - first < NETPLAY_PACKET_INPUTS ? (int)(end - first) : NETPLAY_PACKET_INPUTS;
+	int i;
+	for (i = 0; i < count; i++) directions |= NetplayInputs[NetplayPlayer][(first + i) % NETPLAY_HISTORY] << (2 * i);
+	packet[1] = NETPLAY_INPUTS;
+	packet[2] = (uint8_t)first;
+	packet[3] = (uint8_t)(first >> 8);
+	packet[4] = (uint8_t)NetplayRemoteTick;
+	packet[5] = (uint8_t)(NetplayRemoteTick >> 8);
+	packet[6] = (uint8_t)count;
+	packet[7] = (uint8_t)directions;
+	packet[8] = (uint8_t)(directions >> 8);
+	sendNetplayPacket(packet);
+}
+
+/* Heard says the echo is the remote's nonce */
+void sendNetplayHello(uint32_t nonce, bool heard)
+{
+	uint8_t packet[NETPLAY_PACKET_SIZE];
+	packet[1] = NETPLAY_HELLO;
+	packet[2] = (uint8_t)nonce;
+	packet[3] = (uint8_t)(nonce >> 8);
+	packet[4] = (uint8_t)(nonce >> 16);
+	packet[5] = (uint8_t)(nonce >> 24);
+	packet[6] = heard;
+	packet[7] = (uint8_t)NetplayRemoteNonce;
+	packet[8] = (uint8_t)(NetplayRemoteNonce >> 8);
+	sendNetplayPacket(packet);
+}
+
+void sendNetplayPacket(uint8_t *packet)
+{
+	uint16_t checksum;
+	int i;
+	packet[0] = NETPLAY_SYNC;
+	checksum = netplayChecksum(packet);
+	packet[9] = (uint8_t)checksum;
+	packet[10] = (uint8_t)(checksum >> 8);
+	for (i = 0; i < NETPLAY_PACKET_SIZE; i++) UARTCharPut(NETPLAY_UART_BASE, packet[i]);
+	NetplayStats.packetsSent++;
+}
+
+uint16_t netplayChecksum(const uint8_t *packet)
+{
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+	int i;
+	for (i = 1; i < 9; i++)
+	{
+		sum1 = (sum1 + packet[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return sum2 << 8 | sum1;
+}
+
+/* The remote is never more than a few ticks away, so the nearest tick with these low bits is the one */
+bool expandNetplayTick(uint16_t low, unsigned long *tick)
+{
+	long expanded = (long)NetplayTick + (int16_t)(low - (uint16_t)NetplayTick);
+	if (expanded < 0) return false;
+	*tick = (unsigned long)expanded;
+	return true;
+}
+
+/* Snake 0 starts in the top half going right, snake 1 in the bottom half going left */
+void resetNetplayState(NetplayStateType *state, uint32_t seed)
+{
+	PointType position;
+	int i;
+	memset(state, 0, sizeof(*state));
+	for (i = 0; i < INITIAL_SNAKE_LENGTH; i++)
+	{
+		position.x = ENV_WIDTH / 2 + 1 - i;
+		position.y = ENV_HEIGHT / 4;
+		state->snakes[0].cells[i] = netplayCell(position);
+		position.x = ENV_WIDTH / 2 - 2 + i;
+		position.y = ENV_HEIGHT - 1 - ENV_HEIGHT / 4;
+		state->snakes[1].cells[i] = netplayCell(position);
+	}
+	for (i = 0; i < 2; i++)
+	{
+		state->snakes[i].length = INITIAL_SNAKE_LENGTH;
+		state->snakes[i].alive = true;
+	}
+	state->random = seed != 0 ? seed : 1;
+	state->powerUp = spawnNetplayPowerUp(state);
+}
+
+/* Both heads move at once. A head that runs into either snake, or into the
+ * other head, dies and the game is over. The first snake to reach
+ * MAX_SNAKE_LENGTH wins */
+void stepNetplayState(NetplayStateType *state, const uint8_t *directions)
+{
+	NetplaySnakeType *snake;
+	uint16_t heads[2];
+	bool ate = false;
+	int i;
+	if (state->over) return;
+	state->ticks++;
+	for (i = 0; i < 2; i++)
+	{
+		snake = &state->snakes[i];
+		heads[i] = netplayCell(calculateNewHeadPosition(netplayPoint(snake->cells[snake->head]), (Direction)directions[i]));
+	}
+	for (i = 0; i < 2; i++)
+	{
+		if (heads[0] == heads[1] || isNetplayCellTaken(state, heads[i])) state->snakes[i].alive = false;
+	}
+	if (!state->snakes[0].alive || !state->snakes[1].alive)
+	{
+		state->over = true;
+		return;
+	}
+	for (i = 0; i < 2; i++)
+	{
+		snake = &state->snakes[i];
+		snake->head = (snake->head + MAX_SNAKE_LENGTH - 1) % MAX_SNAKE_LENGTH;
+		snake->cells[snake->head] = heads[i];
+		if (heads[i] != state->powerUp) continue;
+		snake->length++;
+		snake->score++;
+		ate = true;
+	}
+	if (ate) state->powerUp = spawnNetplayPowerUp(state);
+	for (i = 0; i < 2; i++)
+	{
+		if (state->snakes[i].length == MAX_SNAKE_LENGTH)
+		{
+			state->snakes[1 - i].alive = false;
+			state->over = true;
+		}
+	}
+}
+
+bool isNetplayCellTaken(const NetplayStateType *state, uint16_t cell)
+{
+	const NetplaySnakeType *snake;
+	int i;
+	int j;
+	for (i = 0; i < 2; i++)
+	{
+		snake = &state->snakes[i];
+		for (j = 0; j < snake->length; j++)
+		{
+			if (snake->cells[(snake->head + j) % MAX_SNAKE_LENGTH] == cell) return true;
+		}
+	}
+	return false;
+}
+
+uint16_t spawnNetplayPowerUp(NetplayStateType *state)
+{
+	uint32_t x;
+	uint16_t cell;
+	do
+	{
+		x = state->random;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		state->random = x;
+		cell = (uint16_t)(x % (ENV_WIDTH * ENV_HEIGHT));
+	} while (isNetplayCellTaken(state, cell));
+	return cell;
+}
+
+uint16_t netplayCell(PointType position)
+{
+	return (uint16_t)(position.y * ENV_WIDTH + position.x);
+}
+
+PointType netplayPoint(uint16_t cell)
+{
+	PointType position;
+	position.x = cell % ENV_WIDTH;
+	position.y = cell / ENV_WIDTH;
+	return position;
+}
+
+/* Render task side. The cells of the last frame are blanked and the new
+ * ones written over them in NetplayCells, then only the ones that differ
+ * from the screen are drawn, which also puts right what a rollback changed */
+void drawNetplayState()
+{
+	const RenderRequestType scoreRenderRequest = RENDER_REQUEST(SCORE_UPDATE);
+	const NetplaySnakeType *snake;
+	xSemaphoreTake(GameStateLock, portMAX_DELAY);
+	NetplayFrameState = NetplayState;
+	xSemaphoreGive(GameStateLock);
+	snake = &NetplayFrameState.snakes[NetplayPlayer];
+	followWithCamera(netplayPoint(snake->cells[snake->head]));
+	markNetplayCells(&NetplayDrawnState, true);
+	markNetplayCells(&NetplayFrameState, false);
+	drawNetplayCells(&NetplayDrawnState);
+	drawNetplayCells(&NetplayFrameState);
+	DrawnHeadPosition = netplayPoint(snake->cells[snake->head]);
+	NetplayDrawnState = NetplayFrameState;
+	if (snake->score != score)
+	{
+		score = snake->score;
+		renderRequest(&scoreRenderRequest);
+	}
+	moveCursorToBottom();
+}
+
+/* Called for the start screen, nothing of the game is on it yet */
+void resetNetplayDrawing()
+{
+	const NetplaySnakeType *snake = &NetplayState.snakes[NetplayPlayer];
+	resetViewport(netplayPoint(snake->cells[snake->head]));
+	memset(NetplayCells, ' ', sizeof(NetplayCells));
+	memset(&NetplayDrawnState, 0, sizeof(NetplayDrawnState));
+	NetplayDrawnState.powerUp = NETPLAY_NO_CELL;
+}
+
+/* This board's snake is drawn like the single player one, the other one as O */
+void markNetplayCells(const NetplayStateType *state, bool blank)
+{
+	static const char heads[2] = {'@', 'Q'};
+	static const char bodies[2] = {'o', 'O'};
+	const NetplaySnakeType *snake;
+	PointType position;
+	int i;
+	int j;
+	for (i = 0; i < 2; i++)
+	{
+		snake = &state->snakes[i == 0 ? NetplayPlayer : 1 - NetplayPlayer];
+		for (j = 0; j < snake->length; j++)
+		{
+			position = netplayPoint(snake->cells[(snake->head + j) % MAX_SNAKE_LENGTH]);
+			NetplayCells[position.y][position.x] = blank ? ' ' : j == 0 ? heads[i] : bodies[i];
+		}
+	}
+	if (state->powerUp == NETPLAY_NO_CELL) return;
+	position = netplayPoint(state->powerUp);
+	NetplayCells[position.y][position.x] = blank ? ' ' : '+';
+}
+
+void drawNetplayCells(const NetplayStateType *state)
+{
+	const NetplaySnakeType *snake;
+	PointType position;
+	int i;
+	int j;
+	for (i = 0; i < 2; i++)
+	{
+		snake = &state->snakes[i];
+		for (j = 0; j < snake->length; j++)
+		{
+			position = netplayPoint(snake->cells[(snake->head + j) % MAX_SNAKE_LENGTH]);
+			if (WorldCells[position.y][position.x] != NetplayCells[position.y][position.x]) drawWorldCell(position, NetplayCells[position.y][position.x]);
+		}
+	}
+	if (state->powerUp == NETPLAY_NO_CELL) return;
+	position = netplayPoint(state->powerUp);
+	if (WorldCells[position.y][position.x] != NetplayCells[position.y][position.x]) drawWorldCell(position, NetplayCells[position.y][position.x]);
+}
+
+/* Like endGame, but the board keeps answering for a while so the remote
+ * gets the last inputs and reaches the same end */
+void endNetplay(GameOutcomeType outcome)
+{
+	const RenderRequestType lossMessageRenderRequest = RENDER_REQUEST(LOSS_MESSAGE);
+	const RenderRequestType winMessageRenderRequest = RENDER_REQUEST(WIN_MESSAGE);
+	stopGameTick();
+	endCpuStatsSession();
+	vTaskDelete(TimeUpdateTaskHandle);
+	xQueueSend(RenderQueue, (const void *)(outcome == GAME_WON ? &winMessageRenderRequest : &lossMessageRenderRequest), portMAX_DELAY);
+	lingerNetplay();
+	/* The render task is long done with the last frame, which takes the lock */
+	vSemaphoreDelete(GameStateLock);
+	vSemaphoreDelete(GenerateRandomNumberLock);
+	vSemaphoreDelete(NormalPowerUpSemaphore);
+	NetplayActive = false;
+	inGame = false;
+	xTaskNotifyGive(MainMenuTaskHandle);
+	vTaskDelete(NULL);
+}
+
+void lingerNetplay()
+{
+	int i;
+	for (i = 0; i < NETPLAY_LINGER_TICKS; i++)
+	{
+		receiveNetplayPackets();
+		sendNetplayInputs();
+		if (NetplayHelloPending) sendNetplayHello(NetplayNonce, true);
+		NetplayHelloPending = false;
+		vTaskDelay((60000 / SnakeSpeed) / portTICK_RATE_MS);
+	}
+}
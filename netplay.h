@@ -0,0 +1,113 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include "game.h"
+
+/* Netplay Configuration Parameters */
+#define NETPLAY_UART_BASE		UART2_BASE		/* PD6 RX and PD7 TX, crossed over to the other board */
+#define NETPLAY_BAUD_RATE		115200
+#define NETPLAY_SPEED			INITIAL_SNAKE_SPEED		/* Both boards have to tick at the same rate */
+#define NETPLAY_INPUT_DELAY		1		/* A key read on tick t moves the snake on tick t + NETPLAY_INPUT_DELAY, on both boards */
+#define NETPLAY_ROLLBACK_TICKS	8		/* Snapshots kept, how far a board may run ahead of the remote inputs it has */
+#define NETPLAY_HISTORY			32		/* Ticks of inputs kept, a power of two above 2 * (NETPLAY_ROLLBACK_TICKS + NETPLAY_INPUT_DELAY) */
+#define NETPLAY_PACKET_INPUTS	8		/* Inputs in one packet, every unacknowledged one is sent again */
+#define NETPLAY_RX_QUEUE_LENGTH	64
+#define NETPLAY_CONNECT_TIMEOUT	10000	/* ms the main menu waits for the other board */
+#define NETPLAY_HELLO_PERIOD	100		/* ms */
+#define NETPLAY_TIMEOUT_TICKS	250		/* Ticks without a packet before the link is given up */
+#define NETPLAY_LINGER_TICKS	32		/* Ticks the last packet is still sent after the end, so the remote can confirm it too */
+
+#define NETPLAY_SYNC			0xA5
+#define NETPLAY_PACKET_SIZE		11
+#define NETPLAY_NO_CELL			0xFFFF
+#define NETPLAY_NO_TICK			((unsigned long)-1)
+
+/* Type Definitions */
+/* Packet layout, multi-byte fields little endian:
+ *   0      NETPLAY_SYNC
+ *   1      NetplayPacketType
+ *   2..8   HELLO:  nonce (4), heard (1), low 16 bits of the nonce heard (2)
+ *          INPUTS: first tick (2), acknowledged tick (2), count (1),
+ *                  directions (2 bits each from the first tick)
+ *   9..10  Fletcher-16 of bytes 1 to 8
+ * A hello only counts as seen when it echoes the receiver's current nonce,
+ * so one from a board still finishing the last game does not. Ticks are sent
+ * as their low 16 bits. The acknowledged tick is the first one the sender
+ * has no input for, the receiver sends again from there */
+typedef enum
+{
+	NETPLAY_HELLO,
+	NETPLAY_INPUTS
+} NetplayPacketType;
+
+/* The body is a ring of cells, y * ENV_WIDTH + x, so a move does not shift it */
+typedef struct NetplaySnake
+{
+	uint16_t cells[MAX_SNAKE_LENGTH];
+	uint8_t head;
+	uint8_t length;
+	uint16_t score;
+	bool alive;
+} NetplaySnakeType;
+
+/* Everything one tick depends on, small enough to keep a snapshot per tick.
+ * The power-up comes from the state's own random number, so a resimulated
+ * tick spawns it in the same cell */
+typedef struct NetplayState
+{
+	NetplaySnakeType snakes[2];
+	uint16_t powerUp;
+	uint32_t random;
+	unsigned long ticks;	/* Ticks played, stops at the end, so both boards confirm the same one */
+	bool over;
+} NetplayStateType;
+
+typedef struct NetplayStats
+{
+	unsigned long packetsSent;
+	unsigned long packetsReceived;
+	unsigned long badBytes;			/* Skipped while looking for a packet */
+	unsigned long predictions;		/* Ticks simulated with a predicted remote input */
+	unsigned long rollbacks;
+	unsigned long resimulatedTicks;
+	unsigned long maxRollback;
+	unsigned long stalls;			/* Ticks waited for the remote board */
+} NetplayStatsType;
+
+/* Global Variables */
+extern NetplayStateType NetplayState;
+extern NetplayStateType NetplaySnapshots[NETPLAY_ROLLBACK_TICKS];
+extern uint8_t NetplayInputs[2][NETPLAY_HISTORY];
+extern int NetplayPlayer;
+extern unsigned long NetplayTick;
+extern unsigned long NetplayRemoteTick;
+extern unsigned long NetplayAckedTick;
+extern NetplayStatsType NetplayStats;
+extern xQueueHandle NetplayRxQueue;
+extern bool NetplayActive;
+
+/* Tasks */
+void NetplayTask(void *vpParameters);
+extern xTaskHandle NetplayTaskHandle;
+
+/* Netplay Functions */
+void initializeNetplay();
+bool connectNetplay(uint32_t *seed);
+void resetNetplay(uint32_t seed, int player);
+GameOutcomeType netplayTick();
+void scheduleLocalInput(char key);
+void receiveNetplayPackets();
+void receiveNetplayByte(uint8_t c);
+void sendNetplayInputs();
+void rollBackNetplay(unsigned long tick);
+void stepNetplayState(NetplayStateType *state, const uint8_t *directions);
+void resetNetplayState(NetplayStateType *state, uint32_t seed);
+bool isNetplayCellTaken(const NetplayStateType *state, uint16_t cell);
+uint16_t netplayCell(PointType position);
+PointType netplayPoint(uint16_t cell);
+void resetNetplayDrawing();
+void drawNetplayState();
+void endNetplay(GameOutcomeType outcome);
+void UART2_Handler(void);
+
+#endif /* NETPLAY_H */
@@ -0,0 +1,147 @@
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "palette.h"
+#include "spectator.h"
+
+/* Global Variables */
+const CellStyleType CellStyles[] =
+{
+	{' ', ' ', PALETTE_DEFAULT, NULL},
+	{'#', '#', PALETTE_DEFAULT, NULL},
+	{'@', 'o', 92, "\xE2\x97\x89"},		/* Snake head, bright green U+25C9 */
+	{'o', 'o', 32, "\xE2\x97\x8F"},		/* Snake body, green U+25CF */
+	{'+', '+', 33, "\xE2\x97\x86"},		/* Normal power-up, yellow U+25C6 */
+	{'*', '*', 35, "\xE2\x98\x85"},		/* Special power-up, magenta U+2605 */
+	{'x', 'x', 31, "\xC3\x97"},			/* Enemy, red U+00D7 */
+	{'Q', 'O', 96, "\xE2\x97\x8E"},		/* Other board's snake head, bright cyan U+25CE */
+	{'O', 'O', 36, "\xE2\x97\x8B"},		/* Other board's snake body, cyan U+25CB */
+	{0, '?', PALETTE_DEFAULT, NULL}
+};
+bool PaletteColor = PALETTE_COLOR;
+bool PaletteUnicode = PALETTE_UNICODE;
+bool PaletteHalfBlock = PALETTE_HALF_BLOCK;
+bool PaletteCache = PALETTE_CACHE;
+/* What the render task last told the terminal, a background is kept as the
+ * foreground code of the same colour */
+uint8_t CellColor = PALETTE_DEFAULT;
+uint8_t CellBackground = PALETTE_DEFAULT;
+
+void putGlyph(const char *glyph);
+void putColorParameter(uint8_t code);
+
+const CellStyleType *findCellStyle(char cell)
+{
+	const CellStyleType *style = CellStyles;
+	while (style->cell != 0 && style->cell != cell) style++;
+	return style;
+}
+
+/* The colour is only sent when it changes, so a run of cells in the same
+ * colour costs one sequence. A blank shows no foreground and is drawn in
+ * whatever colour is current. Only half blocks change the background */
+void putCell(char cell)
+{
+	const CellStyleType *style = findCellStyle(cell);
+	if (PaletteColor || PaletteHalfBlock)
+	{
+		useCellColors(cell != ' ' || !PaletteCache ? style->color : PALETTE_ANY, CellBackground != PALETTE_DEFAULT ? PALETTE_DEFAULT : PALETTE_ANY);
+	}
+	if (PaletteUnicode && style->unicode != NULL) putGlyph(style->unicode);
+	else putRenderChar(style->ascii);
+}
+
+/* Two vertically adjacent cells in one character. The upper half block
+ * shows the top cell in the foreground and the bottom one in the background,
+ * the glyph is picked so the background stays the default unless both cells
+ * are taken by different colours */
+void putCellPair(char top, char bottom)
+{
+	const CellStyleType *upper = findCellStyle(top);
+	const CellStyleType *lower = findCellStyle(bottom);
+	if (top == ' ' && bottom == ' ')
+	{
+		useCellColors(PALETTE_ANY, PALETTE_DEFAULT);
+		putRenderChar(' ');
+	}
+	else if (bottom == ' ')
+	{
+		useCellColors(upper->color, PALETTE_DEFAULT);
+		putGlyph("\xE2\x96\x80");		/* Upper half block U+2580 */
+	}
+	else if (top == ' ')
+	{
+		useCellColors(lower->color, PALETTE_DEFAULT);
+		putGlyph("\xE2\x96\x84");		/* Lower half block U+2584 */
+	}
+	else if (upper->color == lower->color)
+	{
+		useCellColors(upper->color, PALETTE_ANY);
+		putGlyph("\xE2\x96\x88");		/* Full block U+2588 */
+	}
+	else if (lower->color != PALETTE_DEFAULT)
+	{
+		useCellColors(upper->color, lower->color);
+		putGlyph("\xE2\x96\x80");
+	}
+	else
+	{
+		/* The default background would show as empty */
+		useCellColors(lower->color, upper->color);
+		putGlyph("\xE2\x96\x84");
+	}
+}
+
+/* ESC [ foreground ; background m with only the parts that change, or ESC [ m
+ * when both end up as the defaults. PALETTE_ANY leaves a part as it is */
+void useCellColors(uint8_t foreground, uint8_t background)
+{
+	bool sendForeground = foreground != PALETTE_ANY && (!PaletteCache || foreground != CellColor);
+	bool sendBackground = background != PALETTE_ANY && (!PaletteCache || background != CellBackground);
+	if (!sendForeground && !sendBackground) return;
+	if (sendForeground) CellColor = foreground;
+	if (sendBackground) CellBackground = background;
+	putRenderChar('\033');
+	putRenderChar('[');
+	if (CellColor != PALETTE_DEFAULT || CellBackground != PALETTE_DEFAULT)
+	{
+		if (sendForeground) putColorParameter(foreground != PALETTE_DEFAULT ? foreground : 39);
+		if (sendForeground && sendBackground) putRenderChar(';');
+		if (sendBackground) putColorParameter(background != PALETTE_DEFAULT ? background + 10 : 49);
+	}
+	putRenderChar('m');
+}
+
+/* Before text, which is always drawn in the default colours. Free in monochrome */
+void resetCellColor()
+{
+	if (CellColor != PALETTE_DEFAULT || CellBackground != PALETTE_DEFAULT) useCellColors(PALETTE_DEFAULT, PALETTE_DEFAULT);
+}
+
+/* Whether the old head has to be drawn again as body when the snake moves */
+bool isHeadDistinct()
+{
+	const CellStyleType *head = findCellStyle('@');
+	const CellStyleType *body = findCellStyle('o');
+	if ((PaletteColor || PaletteHalfBlock) && head->color != body->color) return true;
+	if (PaletteHalfBlock) return false;
+	if (PaletteUnicode) return strcmp(head->unicode, body->unicode) != 0;
+	return head->ascii != body->ascii;
+}
+
+void putGlyph(const char *glyph)
+{
+	while (*glyph != 0) putRenderChar(*glyph++);
+}
+
+void putColorParameter(uint8_t code)
+{
+	if (code >= 100) putRenderChar(code / 100 + 48);
+	putRenderChar(code / 10 % 10 + 48);
+	putRenderChar(code % 10 + 48);
+}
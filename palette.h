@@ -0,0 +1,42 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include "game.h"
+
+/* Palette Configuration Parameters */
+#define PALETTE_COLOR			0		/* Boot with coloured cells, the console can switch it */
+#define PALETTE_UNICODE			0		/* Boot with Unicode glyphs instead of ASCII */
+#define PALETTE_HALF_BLOCK		0		/* Boot with two board rows on every terminal line, drawn in colour with half blocks */
+#define PALETTE_CACHE			1		/* 0: send the colour before every cell, to compare against */
+#define PALETTE_DEFAULT			0		/* SGR 0, default colours */
+#define PALETTE_UNKNOWN			0xFF	/* The terminal's colour is not known, the next one is always sent */
+#define PALETTE_ANY				0xFE	/* Passed for a colour that does not show, the terminal keeps what it has */
+
+/* Type Definitions */
+/* A world cell is kept as a character, this is how each one is drawn */
+typedef struct CellStyle
+{
+	char cell;
+	char ascii;
+	uint8_t color;			/* SGR foreground code */
+	const char *unicode;	/* UTF-8 */
+} CellStyleType;
+
+/* Global Variables */
+extern const CellStyleType CellStyles[];
+extern bool PaletteColor;
+extern bool PaletteUnicode;
+extern bool PaletteHalfBlock;
+extern bool PaletteCache;
+extern uint8_t CellColor;
+extern uint8_t CellBackground;
+
+/* Palette Functions */
+const CellStyleType *findCellStyle(char cell);
+void putCell(char cell);
+void putCellPair(char top, char bottom);
+void useCellColors(uint8_t foreground, uint8_t background);
+void resetCellColor();
+bool isHeadDistinct();
+
+#endif /* PALETTE_H */
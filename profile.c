@@ -0,0 +1,144 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/uart.h>
+
+#include "profile.h"
+
+#if !PROFILE_DWT
+#include <time.h>
+#endif
+
+/* Global Variables */
+ProfileStatsType ProfileStats[PROFILE_ZONES];
+/* One name per ProfileZoneType, in its order */
+const char *const ProfileZoneNames[] =
+{
+	"collision",
+	"shift",
+	"spawn",
+	"r menu",
+	"r start",
+	"r snake",
+	"r normal",
+	"r -normal",
+	"r special",
+	"r -special",
+	"r enemy",
+	"r -enemy",
+	"r loss",
+	"r win",
+	"r score",
+	"r time",
+	"r cpu",
+	"r keyframe",
+	"r repaint",
+	"r netstart",
+	"r netframe",
+	"r leave",
+	"r tail",
+	"r rewind"
+};
+/* Fails to compile, an array of -1 chars, when a zone has been added without a name */
+typedef char ProfileZoneNamesCheck[sizeof(ProfileZoneNames) / sizeof(ProfileZoneNames[0]) == PROFILE_ZONES ? 1 : -1];
+
+void putProfileString(uint32_t uartBase, const char *string);
+void putProfileNumber(uint32_t uartBase, uint32_t value);
+
+/* The cycle counter is off until the trace unit is enabled */
+void initializeProfile()
+{
+#if PROFILE_DWT
+	HWREG(PROFILE_DEMCR) |= PROFILE_DEMCR_TRCENA;
+	HWREG(PROFILE_DWT_CYCCNT) = 0;
+	HWREG(PROFILE_DWT_CTRL) |= PROFILE_DWT_CYCCNTENA;
+#endif
+	resetProfile();
+}
+
+void resetProfile()
+{
+	int i;
+	for (i = 0; i < PROFILE_ZONES; i++)
+	{
+		ProfileStats[i].count = 0;
+		ProfileStats[i].min = 0xFFFFFFFF;
+		ProfileStats[i].max = 0;
+		ProfileStats[i].total = 0;
+	}
+}
+
+/* Zones are only entered with GameStateLock held or from RenderTask, which
+ * has the render zones to itself, so the table needs no locking of its own */
+void addProfileSample(ProfileZoneType zone, uint32_t elapsed)
+{
+	ProfileStatsType *stats = &ProfileStats[zone];
+	stats->count++;
+	stats->total += elapsed;
+	if (elapsed < stats->min) stats->min = elapsed;
+	if (elapsed > stats->max) stats->max = elapsed;
+}
+
+/* Host builds only, the board reads the cycle counter in the macros */
+uint32_t readProfileClock()
+{
+#if PROFILE_DWT
+	return HWREG(PROFILE_DWT_CYCCNT);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)((uint64_t)now.tv_sec * 1000000000u + now.tv_nsec);
+#endif
+}
+
+/* Text dump, numbers are decimal and in PROFILE_UNIT:
+ *   PROFILE <unit>
+ *   <zone> <count> <min> <avg> <max>
+ *   END
+ * Zones that were never entered are left out */
+void dumpProfile(uint32_t uartBase)
+{
+	ProfileStatsType *stats;
+	int i;
+	putProfileString(uartBase, "PROFILE " PROFILE_UNIT "\r\n");
+	for (i = 0; i < PROFILE_ZONES; i++)
+	{
+		stats = &ProfileStats[i];
+		if (stats->count == 0) continue;
+		putProfileString(uartBase, ProfileZoneNames[i]);
+		UARTCharPut(uartBase, ' ');
+		putProfileNumber(uartBase, stats->count);
+		UARTCharPut(uartBase, ' ');
+		putProfileNumber(uartBase, stats->min);
+		UARTCharPut(uartBase, ' ');
+		putProfileNumber(uartBase, (uint32_t)(stats->total / stats->count));
+		UARTCharPut(uartBase, ' ');
+		putProfileNumber(uartBase, stats->max);
+		putProfileString(uartBase, "\r\n");
+	}
+	putProfileString(uartBase, "END\r\n");
+}
+
+void putProfileString(uint32_t uartBase, const char *string)
+{
+	while (*string != 0) UARTCharPut(uartBase, *string++);
+}
+
+void putProfileNumber(uint32_t uartBase, uint32_t value)
+{
+	char digits[10];
+	int count = 0;
+	do
+	{
+		digits[count++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	while (count > 0) UARTCharPut(uartBase, digits[--count]);
+}
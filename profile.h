@@ -0,0 +1,66 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "game.h"
+
+/* Profile Configuration Parameters */
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED			1		/* A load and a few adds per zone, cheap enough to leave on */
+#endif
+/* The Cortex-M4 cycle counter on the board, a nanosecond clock in the host tools */
+#if defined(__ARM_ARCH_7EM__)
+#define PROFILE_DWT				1
+#define PROFILE_UNIT			"cycles"
+#else
+#define PROFILE_DWT				0
+#define PROFILE_UNIT			"ns"
+#endif
+#define PROFILE_DEMCR			0xE000EDFC		/* Debug Exception and Monitor Control */
+#define PROFILE_DEMCR_TRCENA	0x01000000
+#define PROFILE_DWT_CTRL		0xE0001000
+#define PROFILE_DWT_CYCCNTENA	0x00000001
+#define PROFILE_DWT_CYCCNT		0xE0001004
+
+/* Type Definitions */
+/* A zone for every RenderTask case follows PROFILE_RENDER, one per render request category */
+typedef enum
+{
+	PROFILE_SNAKE_COLLISION,
+	PROFILE_SNAKE_SHIFT,
+	PROFILE_SPAWN_REJECTION,
+	PROFILE_RENDER,
+	PROFILE_ZONES = PROFILE_RENDER + REWIND_REDRAW + 1
+} ProfileZoneType;
+
+typedef struct ProfileStats
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+} ProfileStatsType;
+
+/* Profile Macros */
+/* start is a uint32_t local of the caller, a zone is timed from PROFILE_START to PROFILE_END */
+#if PROFILE_ENABLED && PROFILE_DWT
+#define PROFILE_START(start)		((start) = HWREG(PROFILE_DWT_CYCCNT))
+#define PROFILE_END(zone, start)	addProfileSample((zone), HWREG(PROFILE_DWT_CYCCNT) - (start))
+#elif PROFILE_ENABLED
+#define PROFILE_START(start)		((start) = readProfileClock())
+#define PROFILE_END(zone, start)	addProfileSample((zone), readProfileClock() - (start))
+#else
+#define PROFILE_START(start)		((void)(start))
+#define PROFILE_END(zone, start)	((void)(start))
+#endif
+
+/* Global Variables */
+extern ProfileStatsType ProfileStats[PROFILE_ZONES];
+
+/* Profile Functions */
+void initializeProfile();
+void resetProfile();
+void addProfileSample(ProfileZoneType zone, uint32_t elapsed);
+uint32_t readProfileClock();
+void dumpProfile(uint32_t uartBase);
+
+#endif /* PROFILE_H */
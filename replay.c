@@ -0,0 +1,170 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "replay.h"
+
+/* Global Variables */
+InputLogType InputLog;
+ReplayModeType ReplayMode = REPLAY_IDLE;
+unsigned long ReplayLastTick = 0;
+uint16_t ReplayPosition = 0;
+
+void startRecording(uint32_t seed, int speed)
+{
+	InputLog.length = 0;
+	InputLog.truncated = false;
+	InputLog.length = writeVarint(InputLog.data, InputLog.length, REPLAY_LOG_SIZE, seed);
+	InputLog.length = writeVarint(InputLog.data, InputLog.length, REPLAY_LOG_SIZE, (uint32_t)speed);
+	ReplayLastTick = 0;
+	ReplayMode = REPLAY_RECORDING;
+}
+
+/* A log that has no room left for the end is truncated like any other */
+void stopRecording(bool won)
+{
+	PointType end;
+	if (ReplayMode != REPLAY_RECORDING) return;
+	end.x = won ? 1 : 0;
+	end.y = ENV_HEIGHT;
+	recordEvent(REPLAY_EVENT_ENEMY, end);
+	ReplayMode = REPLAY_IDLE;
+}
+
+/* The game being recorded took a turn the log cannot express, a rewind.
+ * Nothing of it is kept, the game goes on unrecorded */
+void discardRecording()
+{
+	if (ReplayMode != REPLAY_RECORDING) return;
+	InputLog.length = 0;
+	ReplayMode = REPLAY_IDLE;
+}
+
+void recordDirection(Direction direction)
+{
+	PointType none = {-1, -1};
+	recordEvent((ReplayEventType)direction, none);
+}
+
+void recordEvent(ReplayEventType type, PointType position)
+{
+	uint16_t length;
+	if (ReplayMode != REPLAY_RECORDING || InputLog.truncated) return;
+	length = writeVarint(InputLog.data, InputLog.length, REPLAY_LOG_SIZE, ((uint32_t)(GameTickIndex - ReplayLastTick) << 3) | type);
+	if (length != 0 && type >= REPLAY_EVENT_NORMAL_POWERUP && type != REPLAY_EVENT_REMOVE_SPECIAL_POWERUP)
+	{
+		length = writeVarint(InputLog.data, length, REPLAY_LOG_SIZE, (uint32_t)(position.y * ENV_WIDTH + position.x));
+	}
+	/* A partial entry is dropped, the log stays valid up to the last complete event */
+	if (length == 0)
+	{
+		InputLog.truncated = true;
+		return;
+	}
+	InputLog.length = length;
+	ReplayLastTick = GameTickIndex;
+}
+
+/* Only a whole game can be played back, a truncated log runs out of inputs part way */
+bool isReplayAvailable()
+{
+	return InputLog.length > 0 && !InputLog.truncated && ReplayMode == REPLAY_IDLE;
+}
+
+bool startReplay(uint32_t *seed, int *speed)
+{
+	uint32_t value;
+	ReplayPosition = readVarint(InputLog.data, InputLog.length, 0, seed);
+	if (ReplayPosition == 0) return false;
+	ReplayPosition = readVarint(InputLog.data, InputLog.length, ReplayPosition, &value);
+	if (ReplayPosition == 0) return false;
+	*speed = (int)value;
+	ReplayLastTick = 0;
+	ReplayMode = REPLAY_PLAYING;
+	return true;
+}
+
+void stopReplay()
+{
+	if (ReplayMode == REPLAY_PLAYING) ReplayMode = REPLAY_IDLE;
+}
+
+/* Returns GAME_RUNNING until the log runs out. The replayed game ends by
+ * itself on the tick the recorded one did, one still going after it ends
+ * the way the recording did */
+GameOutcomeType applyReplayEvents(unsigned long tick)
+{
+	uint32_t entry;
+	uint32_t cell = 0;
+	uint16_t next;
+	ReplayEventType type;
+	PointType position;
+	
+	for ( ;; )
+	{
+		next = readVarint(InputLog.data, InputLog.length, ReplayPosition, &entry);
+		if (next == 0) return GAME_LOST;
+		type = (ReplayEventType)(entry & 0x7);
+		if (type >= REPLAY_EVENT_NORMAL_POWERUP && type != REPLAY_EVENT_REMOVE_SPECIAL_POWERUP)
+		{
+			next = readVarint(InputLog.data, InputLog.length, next, &cell);
+			if (next == 0) return GAME_LOST;
+		}
+		if (type == REPLAY_EVENT_ENEMY && cell >= ENV_WIDTH * ENV_HEIGHT)
+		{
+			if (ReplayLastTick + (entry >> 3) >= tick) return GAME_RUNNING;
+			return cell > ENV_WIDTH * ENV_HEIGHT ? GAME_WON : GAME_LOST;
+		}
+		if (ReplayLastTick + (entry >> 3) != tick) return GAME_RUNNING;
+		ReplayPosition = next;
+		ReplayLastTick = tick;
+		position.x = (int)(cell % ENV_WIDTH);
+		position.y = (int)(cell / ENV_WIDTH);
+		switch (type)
+		{
+			case REPLAY_EVENT_UP:
+			case REPLAY_EVENT_DOWN:
+			case REPLAY_EVENT_RIGHT:
+			case REPLAY_EVENT_LEFT:
+				LastDirection = (Direction)type;
+				break;
+			case REPLAY_EVENT_NORMAL_POWERUP:
+				placeNormalPowerUp(position);
+				break;
+			case REPLAY_EVENT_SPECIAL_POWERUP:
+				placeSpecialPowerUp(position);
+				break;
+			case REPLAY_EVENT_REMOVE_SPECIAL_POWERUP:
+				removeSpecialPowerUp();
+				break;
+			case REPLAY_EVENT_ENEMY:
+				placeEnemy(position);
+				break;
+		}
+	}
+}
+
+/* Returns the new length, or 0 if the value does not fit */
+uint16_t writeVarint(uint8_t *buffer, uint16_t length, uint16_t size, uint32_t value)
+{
+	do
+	{
+		if (length >= size) return 0;
+		buffer[length++] = (uint8_t)((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+		value >>= 7;
+	} while (value != 0);
+	return length;
+}
+
+/* Returns the position after the value, or 0 if the buffer ends inside it */
+uint16_t readVarint(const uint8_t *buffer, uint16_t length, uint16_t position, uint32_t *value)
+{
+	int shift = 0;
+	*value = 0;
+	do
+	{
+		if (position >= length || shift > 28) return 0;
+		*value |= (uint32_t)(buffer[position] & 0x7F) << shift;
+		shift += 7;
+	} while (buffer[position++] & 0x80);
+	return position;
+}
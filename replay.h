@@ -0,0 +1,60 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+
+/* Replay Configuration Parameters */
+#define REPLAY_LOG_SIZE			512
+
+/* Type Definitions */
+/* The direction events share their values with Direction */
+typedef enum
+{
+	REPLAY_EVENT_UP,
+	REPLAY_EVENT_DOWN,
+	REPLAY_EVENT_RIGHT,
+	REPLAY_EVENT_LEFT,
+	REPLAY_EVENT_NORMAL_POWERUP,
+	REPLAY_EVENT_SPECIAL_POWERUP,
+	REPLAY_EVENT_REMOVE_SPECIAL_POWERUP,
+	REPLAY_EVENT_ENEMY
+} ReplayEventType;
+
+typedef enum
+{
+	REPLAY_IDLE,
+	REPLAY_RECORDING,
+	REPLAY_PLAYING
+} ReplayModeType;
+
+/* Log layout, all numbers are LEB128 varints:
+ *   seed, speed, then one entry per event of
+ *   (ticks since the previous event << 3 | ReplayEventType), followed by
+ *   y * ENV_WIDTH + x for the events that place an object.
+ * The last entry is an enemy placed on the row below the board, on the tick
+ * the game ended, in column 1 for a win and 0 for a loss */
+typedef struct InputLog
+{
+	uint8_t data[REPLAY_LOG_SIZE];
+	uint16_t length;
+	bool truncated;
+} InputLogType;
+
+/* Global Variables */
+extern InputLogType InputLog;
+extern ReplayModeType ReplayMode;
+
+/* Replay Functions */
+void startRecording(uint32_t seed, int speed);
+void stopRecording(bool won);
+void discardRecording();
+void recordDirection(Direction direction);
+void recordEvent(ReplayEventType type, PointType position);
+bool isReplayAvailable();
+bool startReplay(uint32_t *seed, int *speed);
+void stopReplay();
+GameOutcomeType applyReplayEvents(unsigned long tick);
+uint16_t writeVarint(uint8_t *buffer, uint16_t length, uint16_t size, uint32_t value);
+uint16_t readVarint(const uint8_t *buffer, uint16_t length, uint16_t position, uint32_t *value);
+
+#endif /* REPLAY_H */
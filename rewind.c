@@ -0,0 +1,254 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rewind.h"
+#include "replay.h"
+#include "viewport.h"
+
+/* Global Variables */
+bool RewindEnabled = false;
+RewindKeyframeType RewindKeyframe;
+uint8_t RewindBuffer[REWIND_BUFFER_SIZE];
+uint16_t RewindTail = 0;		/* Both free running, masked on access */
+uint16_t RewindHead = 0;
+int RewindTicks = 0;
+uint32_t RewindCells[REWIND_CELL_WORDS];		/* Cells RenderTask compares with the screen after a rewind */
+
+void writeRewindByte(uint8_t value);
+void makeRewindRoom(int bytes);
+void dropOldestRewindTick();
+uint16_t applyRewindRecord(uint16_t position, GameStateType *state, PointType *entities, Direction *direction, int *points, bool *tick);
+void markRewindCells();
+bool takeRewindCell(PointType position);
+
+/* Only a game played from the keyboard of a single board can be rewound */
+void startRewind()
+{
+	int i;
+	RewindKeyframe.state = GameState;
+	for (i = 0; i < ENTITY_KINDS; i++) RewindKeyframe.entities[i] = findEntityPosition((EntityKind)i);
+	RewindKeyframe.direction = LastDirection;
+	RewindKeyframe.score = score;
+	RewindTail = 0;
+	RewindHead = 0;
+	RewindTicks = 0;
+	for (i = 0; i < REWIND_CELL_WORDS; i++) RewindCells[i] = 0;
+	RewindEnabled = true;
+}
+
+void stopRewind()
+{
+	RewindEnabled = false;
+}
+
+/* Called at the end of every move with GameStateLock held, like the rest.
+ * The keyframe is moved on past whatever is older than REWIND_SECONDS */
+void recordRewindTick(Direction direction, EntityKind eaten)
+{
+	if (!RewindEnabled) return;
+	makeRewindRoom(1);
+	writeRewindByte(REWIND_RECORD_TICK | ((uint8_t)eaten << 4) | (uint8_t)direction);
+	RewindTicks++;
+	while (RewindTicks > rewindTicks(REWIND_SECONDS)) dropOldestRewindTick();
+}
+
+void recordRewindPlace(EntityKind kind, PointType position)
+{
+	uint16_t cell = (uint16_t)(position.y * ENV_WIDTH + position.x);
+	if (!RewindEnabled) return;
+	makeRewindRoom(2);
+	writeRewindByte(REWIND_RECORD_PLACE | ((uint8_t)kind << 4) | (uint8_t)(cell >> 8));
+	writeRewindByte((uint8_t)cell);
+}
+
+void recordRewindRemove(EntityKind kind)
+{
+	if (!RewindEnabled) return;
+	makeRewindRoom(1);
+	writeRewindByte(REWIND_RECORD_REMOVE | (uint8_t)kind);
+}
+
+/* Takes the game back the given number of ticks, or to the keyframe when
+ * fewer are kept: the keyframe with the records of the ticks that stay
+ * applied over it. The later records are dropped and RenderTask redraws the
+ * cells either the old or the new state has something on. Called by the
+ * snake task with GameStateLock held, false when there is nothing to go back to */
+bool rewindGame(int ticks)
+{
+	const RenderRequestType rewindRenderRequest = RENDER_REQUEST(REWIND_REDRAW);
+	const RenderRequestType updateScoreRenderRequest = RENDER_REQUEST(SCORE_UPDATE);
+	uint16_t position = RewindTail;
+	int keep = RewindTicks - ticks;
+	int applied = 0;
+	PointType entities[ENTITY_KINDS];
+	bool tick;
+	int i;
+	if (!RewindEnabled || RewindTicks == 0) return false;
+	if (keep < 0) keep = 0;
+	markRewindCells();
+	GameState = RewindKeyframe.state;
+	for (i = 0; i < ENTITY_KINDS; i++) entities[i] = RewindKeyframe.entities[i];
+	LastDirection = RewindKeyframe.direction;
+	score = RewindKeyframe.score;
+	while (applied < keep)
+	{
+		position = applyRewindRecord(position, &GameState, entities, &LastDirection, &score, &tick);
+		if (tick) applied++;
+	}
+	RewindHead = position;
+	RewindTicks = keep;
+	/* The entity table is built again from the positions, the entity schedule gives them new expiries */
+	resetEntities();
+	for (i = ENTITY_NORMAL_POWERUP; i < ENTITY_KINDS; i++)
+	{
+		if (entities[i].x >= 0) addEntity((EntityKind)i, entities[i], ENTITY_NO_EXPIRY);
+	}
+	markRewindCells();
+	/* A normal power-up eaten just before the moment gone back to is spawned again, one that is there again is not */
+	if (entities[ENTITY_NORMAL_POWERUP].x >= 0) xSemaphoreTake(NormalPowerUpSemaphore, 0);
+	else xSemaphoreGive(NormalPowerUpSemaphore);
+	TickPlan.valid = false;
+	/* The input log cannot express a rewind, the game is not kept for a replay */
+	discardRecording();
+	xQueueSend(RenderQueue, (const void *)&rewindRenderRequest, portMAX_DELAY);
+	xQueueSend(RenderQueue, (const void *)&updateScoreRenderRequest, portMAX_DELAY);
+	return true;
+}
+
+/* Run by RenderTask for REWIND_REDRAW. Only the marked cells that show
+ * something else than the state are drawn */
+void renderRewind()
+{
+	static const char entityGlyphs[] = {' ', '+', '*', 'x'};
+	PointType position;
+	char c;
+	int cell;
+	int i;
+	xSemaphoreTake(GameStateLock, portMAX_DELAY);
+	/* The snake first, the cells left over have an entity or nothing on them */
+	for (i = 0; i < GameState.snakeLength; i++)
+	{
+		position = GameState.snakePositions[i];
+		if (!takeRewindCell(position)) continue;
+		c = i == 0 ? '@' : 'o';
+		if (WorldCells[position.y][position.x] != c) drawWorldCell(position, c);
+	}
+	for (cell = 0; cell < ENV_WIDTH * ENV_HEIGHT; cell++)
+	{
+		if ((RewindCells[cell >> 5] & (1u << (cell & 31))) == 0) continue;
+		position.x = cell % ENV_WIDTH;
+		position.y = cell / ENV_WIDTH;
+		takeRewindCell(position);
+		c = entityGlyphs[entityKindAt(position)];
+		if (WorldCells[position.y][position.x] != c) drawWorldCell(position, c);
+	}
+	DrawnHeadPosition = GameState.snakePositions[0];
+	followWithCamera(DrawnHeadPosition);
+	xSemaphoreGive(GameStateLock);
+	moveCursorToBottom();
+}
+
+/* Ticks the snake makes in the given time at the current speed, at least one */
+int rewindTicks(int seconds)
+{
+	int ticks = seconds * SnakeSpeed / 60;
+	return ticks > 0 ? ticks : 1;
+}
+
+void writeRewindByte(uint8_t value)
+{
+	RewindBuffer[RewindHead & (REWIND_BUFFER_SIZE - 1)] = value;
+	RewindHead++;
+}
+
+/* A full ring moves the keyframe on early, the window is then shorter than REWIND_SECONDS */
+void makeRewindRoom(int bytes)
+{
+	while (REWIND_BUFFER_SIZE - (uint16_t)(RewindHead - RewindTail) < bytes) dropOldestRewindTick();
+}
+
+/* The oldest tick and the spawns before it go into the keyframe */
+void dropOldestRewindTick()
+{
+	bool tick = false;
+	while (!tick && RewindTail != RewindHead)
+	{
+		RewindTail = applyRewindRecord(RewindTail, &RewindKeyframe.state, RewindKeyframe.entities, &RewindKeyframe.direction, &RewindKeyframe.score, &tick);
+	}
+	if (tick) RewindTicks--;
+}
+
+/* Applies the record at position to a state and its entities, returns where the next one starts */
+uint16_t applyRewindRecord(uint16_t position, GameStateType *state, PointType *entities, Direction *direction, int *points, bool *tick)
+{
+	uint8_t record = RewindBuffer[position++ & (REWIND_BUFFER_SIZE - 1)];
+	EntityKind kind = (EntityKind)((record >> 4) & 3);
+	PointType head = state->snakePositions[0];
+	PointType *entity;
+	uint16_t cell;
+	int i;
+	*tick = false;
+	switch (record & 0xC0)
+	{
+		case REWIND_RECORD_TICK:
+			if (kind != ENTITY_FREE)
+			{
+				entity = &entities[kind];
+				entity->x = -1;
+				entity->y = -1;
+				state->snakeLength++;
+				*points += kind == ENTITY_SPECIAL_POWERUP ? 5 : 1;
+			}
+			*direction = (Direction)(record & 3);
+			for (i = state->snakeLength - 1; i > 0; i--) state->snakePositions[i] = state->snakePositions[i - 1];
+			state->snakePositions[0] = calculateNewHeadPosition(head, *direction);
+			*tick = true;
+			break;
+		case REWIND_RECORD_REMOVE:
+			entity = &entities[record & 3];
+			entity->x = -1;
+			entity->y = -1;
+			break;
+		default:
+			cell = (uint16_t)((record & 0x0F) << 8) | RewindBuffer[position++ & (REWIND_BUFFER_SIZE - 1)];
+			entity = &entities[kind];
+			entity->x = cell % ENV_WIDTH;
+			entity->y = cell / ENV_WIDTH;
+			break;
+	}
+	return position;
+}
+
+/* Every cell with something on it in GameState or the entity table */
+void markRewindCells()
+{
+	int cell;
+	int i;
+	for (i = 0; i < GameState.snakeLength; i++)
+	{
+		cell = GameState.snakePositions[i].y * ENV_WIDTH + GameState.snakePositions[i].x;
+		RewindCells[cell >> 5] |= 1u << (cell & 31);
+	}
+	for (i = 0; i < ENTITY_POOL_SIZE; i++)
+	{
+		if (EntityPool[i].kind == ENTITY_FREE) continue;
+		cell = EntityPool[i].position.y * ENV_WIDTH + EntityPool[i].position.x;
+		RewindCells[cell >> 5] |= 1u << (cell & 31);
+	}
+}
+
+/* Clears the mark of a cell, whether it was set */
+bool takeRewindCell(PointType position)
+{
+	int cell = position.y * ENV_WIDTH + position.x;
+	uint32_t bit = 1u << (cell & 31);
+	bool marked = (RewindCells[cell >> 5] & bit) != 0;
+	RewindCells[cell >> 5] &= ~bit;
+	return marked;
+}
@@ -0,0 +1,56 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "game.h"
+#include "entity.h"
+
+/* Rewind Configuration Parameters */
+#define REWIND_KEY				'b'
+#define REWIND_SECONDS			10		/* Oldest moment a rewind goes back to */
+#define REWIND_STEP_SECONDS		2		/* Taken back by one press of REWIND_KEY */
+#define REWIND_BUFFER_SIZE		512		/* Bytes, a power of two. A tick is a byte, a spawn two */
+#define REWIND_CELL_WORDS		((ENV_WIDTH * ENV_HEIGHT + 31) / 32)
+
+/* Type Definitions */
+/* Record layout, oldest first after the keyframe:
+ *   00ee00dd  a tick moving in Direction dd, eating the EntityKind ee or nothing
+ *   010000kk  the entity of kind kk taken away without being eaten
+ *   10kkcccc cccccccc  the entity of kind kk placed on cell y * ENV_WIDTH + x
+ * The spawns of a tick come before its tick record. The spawners keep one
+ * entity of each kind, so the kind is enough to tell which one went */
+typedef enum
+{
+	REWIND_RECORD_TICK = 0x00,
+	REWIND_RECORD_REMOVE = 0x40,
+	REWIND_RECORD_PLACE = 0x80
+} RewindRecordType;
+
+/* The game as it was before the oldest record, entities[kind] -1, -1 for a kind that was not there */
+typedef struct RewindKeyframe
+{
+	GameStateType state;
+	PointType entities[ENTITY_KINDS];
+	Direction direction;
+	int score;
+} RewindKeyframeType;
+
+/* Global Variables */
+extern bool RewindEnabled;
+extern RewindKeyframeType RewindKeyframe;
+extern uint8_t RewindBuffer[REWIND_BUFFER_SIZE];
+extern uint16_t RewindTail;
+extern uint16_t RewindHead;
+extern int RewindTicks;
+extern uint32_t RewindCells[REWIND_CELL_WORDS];
+
+/* Rewind Functions */
+void startRewind();
+void stopRewind();
+void recordRewindTick(Direction direction, EntityKind eaten);
+void recordRewindPlace(EntityKind kind, PointType position);
+void recordRewindRemove(EntityKind kind);
+int rewindTicks(int seconds);
+bool rewindGame(int ticks);
+void renderRewind();
+
+#endif /* REWIND_H */
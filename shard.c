@@ -0,0 +1,481 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inc/hw_ints.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/gpio.h>
+#include <driverlib/pin_map.h>
+#include <driverlib/uart.h>
+#include <driverlib/interrupt.h>
+
+#include "shard.h"
+#include "gameTick.h"
+#include "viewport.h"
+
+/* Body cells on other boards keep columns down to ENV_WIDTH - SHARD_MAX_COUNT * ENV_WIDTH */
+#if ENV_WIDTH <= 16 && SHARD_MAX_COUNT * ENV_WIDTH > 128
+#error "the columns of a sharded world do not fit in CoordinateType"
+#endif
+
+/* Global Variables */
+int ShardIndex = SHARD_INDEX;
+int ShardCount = SHARD_COUNT;
+bool ShardOwner = true;
+ShardStatsType ShardStats;
+xQueueHandle ShardRxQueue = NULL;
+xQueueHandle ShardInbox = NULL;			/* Messages for the snake task, taken on its next tick */
+xTaskHandle ShardTaskHandle;
+xSemaphoreHandle ShardTxLock = NULL;	/* Forwarding and the snake task share the TX side */
+uint8_t ShardFrame[4 + SHARD_MAX_PAYLOAD + 2];
+int ShardFrameLength = 0;
+uint8_t ShardSequence = SHARD_NO_SEQUENCE;	/* Last handoff sent or taken by this board */
+ShardMessageType ShardHandoff;			/* Sent again until the new owner acknowledges it */
+bool ShardHandoffPending = false;
+int ShardHandoffAge = 0;
+uint32_t ShardHandoffStart = 0;
+volatile bool ShardStartPending = false;
+volatile int ShardStartSpeed = INITIAL_SNAKE_SPEED;
+
+void handleShardFrame(const uint8_t *frame);
+void dropShardBytes(int count);
+bool installShardSnake(const ShardMessageType *message);
+void sendShardAck(uint8_t sequence, uint8_t hops);
+int shardFloor(int x);
+int shardHops(int offset);
+int wrapShardColumn(int x);
+
+/* UART6 on PD4 and PD5, the ring needs one port per board */
+void initializeShards()
+{
+	ShardRxQueue = xQueueCreate(SHARD_RX_QUEUE_LENGTH, sizeof(uint8_t));
+	ShardInbox = xQueueCreate(SHARD_INBOX_LENGTH, sizeof(ShardMessageType));
+	ShardTxLock = xSemaphoreCreateMutex();
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_GPIOD));
+	GPIOPinTypeUART(GPIO_PORTD_BASE, GPIO_PIN_4 | GPIO_PIN_5);
+	GPIOPinConfigure(GPIO_PD4_U6RX);
+	GPIOPinConfigure(GPIO_PD5_U6TX);
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_UART6);
+	while(!SysCtlPeripheralReady(SYSCTL_PERIPH_UART6));
+	UARTConfigSetExpClk(SHARD_UART_BASE, SysCtlClockGet(), SHARD_BAUD_RATE, UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
+	UARTFIFOEnable(SHARD_UART_BASE);
+	UARTFIFOLevelSet(SHARD_UART_BASE, UART_FIFO_TX2_8, UART_FIFO_RX1_8);
+	UARTIntEnable(SHARD_UART_BASE, UART_INT_RX | UART_INT_RT);
+	IntPrioritySet(INT_UART6, configKERNEL_INTERRUPT_PRIORITY);
+	IntEnable(INT_UART6);
+}
+
+void UART6_Handler(void)
+{
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	uint8_t c;
+	UARTIntClear(SHARD_UART_BASE, UARTIntStatus(SHARD_UART_BASE, true));
+	while (UARTCharsAvail(SHARD_UART_BASE))
+	{
+		c = (uint8_t)UARTCharGetNonBlocking(SHARD_UART_BASE);
+		xQueueSendFromISR(ShardRxQueue, (const void *)&c, &higherPriorityTaskWoken);
+	}
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+/* Above the spawners, so messages passing through are not held up by this board's game */
+void ShardTask(void *vpParameters)
+{
+	uint8_t c;
+	for ( ;; )
+	{
+		xQueueReceive(ShardRxQueue, (void *)&c, portMAX_DELAY);
+		receiveShardByte(c);
+	}
+}
+
+/* Called on every board once the menu starts a game. The board where e was
+ * pressed tells the others, which take its speed. The snake starts on board 0 */
+void startShardGame(int *speed)
+{
+	ShardMessageType message;
+	if (!takeShardStart(speed))
+	{
+		message.kind = SHARD_START;
+		message.hops = (uint8_t)(ShardCount - 1);
+		message.length = 2;
+		message.payload[0] = (uint8_t)*speed;
+		message.payload[1] = (uint8_t)(*speed >> 8);
+		sendShardMessage(&message);
+	}
+	xQueueReset(ShardInbox);
+	ShardOwner = ShardIndex == 0;
+	ShardSequence = SHARD_NO_SEQUENCE;
+	ShardHandoffPending = false;
+	if (!ShardOwner) GameState.snakeLength = 0;
+}
+
+bool takeShardStart(int *speed)
+{
+	if (!ShardStartPending) return false;
+	ShardStartPending = false;
+	*speed = ShardStartSpeed;
+	return true;
+}
+
+/* The snake task's tick on a sharded world. A handed off snake makes the
+ * move the old board could not, the rest of the time only the board that
+ * has the snake moves it and the others pass their keys on */
+GameOutcomeType shardTick()
+{
+	const RenderRequestType scoreRenderRequest = RENDER_REQUEST(SCORE_UPDATE);
+	ShardMessageType message;
+	bool installed = false;
+	uint32_t elapsed;
+	while (xQueueReceive(ShardInbox, (void *)&message, 0) == pdPASS)
+	{
+		switch (message.kind)
+		{
+			case SHARD_HANDOFF:
+				if (installShardSnake(&message)) installed = true;
+				break;
+			case SHARD_ACK:
+				if (!ShardHandoffPending || message.payload[0] != ShardHandoff.payload[0]) break;
+				ShardHandoffPending = false;
+				elapsed = readTimestamp() - ShardHandoffStart;
+				ShardStats.totalHandoffTime += elapsed;
+				if (elapsed > ShardStats.maxHandoffTime) ShardStats.maxHandoffTime = elapsed;
+				break;
+			case SHARD_KEY:
+				if (ShardOwner) changeDirection((char)message.payload[0]);
+				break;
+			case SHARD_END:
+				score = message.payload[1] | message.payload[2] << 8;
+				xQueueSend(RenderQueue, (const void *)&scoreRenderRequest, portMAX_DELAY);
+				return message.payload[0] ? GAME_WON : GAME_LOST;
+		}
+	}
+	if (ShardHandoffPending && ++ShardHandoffAge >= SHARD_HANDOFF_RETRY)
+	{
+		ShardHandoffAge = 0;
+		ShardStats.handoffRetries++;
+		sendShardMessage(&ShardHandoff);
+	}
+	if (installed) return advanceSnake();
+	if (!ShardOwner)
+	{
+		if (UARTCharsAvail(UART0_BASE) > 0)
+		{
+			message.kind = SHARD_KEY;
+			message.hops = (uint8_t)(ShardCount - 1);
+			message.length = 1;
+			message.payload[0] = (uint8_t)UARTCharGet(UART0_BASE);
+			sendShardMessage(&message);
+		}
+		return GAME_RUNNING;
+	}
+	if (UARTCharsAvail(UART0_BASE) > 0) changeDirection(UARTCharGet(UART0_BASE));
+	return advanceSnake();
+}
+
+/* The head is about to leave this board. The snake goes to the neighbour as
+ * it is, body as steps from the head, and the neighbour makes the move */
+void handOffSnake()
+{
+	RenderRequestType request;
+	PointType *positions = GameState.snakePositions;
+	uint8_t step;
+	int dx;
+	int dy;
+	int i;
+	ShardSequence = (uint8_t)(ShardSequence + 1);
+	memset(&ShardHandoff, 0, sizeof(ShardHandoff));
+	ShardHandoff.kind = SHARD_HANDOFF;
+	/* Going east the neighbour is the next board, going west it is all the way round */
+	ShardHandoff.hops = (uint8_t)(LastDirection == RIGHT ? shardHops(1) : shardHops(-1));
+	ShardHandoff.payload[0] = ShardSequence;
+	ShardHandoff.payload[1] = (uint8_t)LastDirection;
+	ShardHandoff.payload[2] = (uint8_t)GameState.snakeLength;
+	ShardHandoff.payload[3] = (uint8_t)score;
+	ShardHandoff.payload[4] = (uint8_t)(score >> 8);
+	ShardHandoff.payload[5] = (uint8_t)positions[0].y;
+	for (i = 0; i < GameState.snakeLength - 1; i++)
+	{
+		dx = wrapShardColumn(positions[i + 1].x - positions[i].x);
+		dy = (positions[i + 1].y - positions[i].y + ENV_HEIGHT) % ENV_HEIGHT;
+		if (dx == 1) step = RIGHT;
+		else if (dx != 0) step = LEFT;
+		else if (dy == 1) step = DOWN;
+		else step = UP;
+		ShardHandoff.payload[6 + i / 4] |= step << (2 * (i % 4));
+	}
+	ShardHandoff.length = (uint8_t)(6 + (GameState.snakeLength + 2) / 4);
+	sendShardMessage(&ShardHandoff);
+	ShardHandoffPending = true;
+	ShardHandoffAge = 0;
+	ShardHandoffStart = readTimestamp();
+	ShardStats.handoffsSent++;
+	ShardOwner = false;
+	/* The head stays behind as body */
+	request = packRenderRequest(SHARD_HEAD_LEAVE, positions[0], false, positions[0]);
+	xQueueSend(RenderQueue, (const void *)&request, portMAX_DELAY);
+	GameState.snakeLength = 0;
+}
+
+/* Rebuilt in this board's columns with the head still one step outside.
+ * Body cells on other boards keep their columns from the west or east of
+ * this board, whichever way round the ring is within the world */
+bool installShardSnake(const ShardMessageType *message)
+{
+	const RenderRequestType scoreRenderRequest = RENDER_REQUEST(SCORE_UPDATE);
+	PointType *positions = GameState.snakePositions;
+	Direction direction = (Direction)message->payload[1];
+	uint8_t sequence = message->payload[0];
+	uint8_t back = (uint8_t)(direction == RIGHT ? shardHops(-1) : shardHops(1));
+	int i;
+	if (ShardSequence != SHARD_NO_SEQUENCE && (int8_t)(sequence - ShardSequence) <= 0)
+	{
+		/* The acknowledgement was lost, the snake is already here */
+		sendShardAck(sequence, back);
+		return false;
+	}
+	ShardSequence = sequence;
+	GameState.snakeLength = message->payload[2];
+	score = message->payload[3] | message->payload[4] << 8;
+	positions[0].x = direction == RIGHT ? -1 : ENV_WIDTH;
+	positions[0].y = message->payload[5];
+	for (i = 0; i < GameState.snakeLength - 1; i++)
+	{
+		positions[i + 1] = positions[i];
+		switch ((message->payload[6 + i / 4] >> (2 * (i % 4))) & 3)
+		{
+			case UP:
+				positions[i + 1].y = (positions[i].y + ENV_HEIGHT - 1) % ENV_HEIGHT;
+				break;
+			case DOWN:
+				positions[i + 1].y = (positions[i].y + 1) % ENV_HEIGHT;
+				break;
+			case RIGHT:
+				positions[i + 1].x++;
+				break;
+			case LEFT:
+				positions[i + 1].x--;
+				break;
+		}
+	}
+	for (i = 1; i < GameState.snakeLength; i++) positions[i].x = wrapShardColumn(positions[i].x);
+	LastDirection = direction;
+	ShardOwner = true;
+	ShardHandoffPending = false;
+	ShardStats.handoffsReceived++;
+	sendShardAck(sequence, back);
+	xQueueSend(RenderQueue, (const void *)&scoreRenderRequest, portMAX_DELAY);
+	return true;
+}
+
+/* A tail cell left on another board, or on this one the other way round the ring */
+void sendShardCell(PointType position)
+{
+	RenderRequestType request;
+	ShardMessageType message;
+	int offset = shardFloor(position.x);
+	position.x = position.x - offset * ENV_WIDTH;
+	request = packRenderRequest(SHARD_TAIL_REMOVE, position, false, position);
+	if (shardHops(offset) == 0)
+	{
+		xQueueSend(RenderQueue, (const void *)&request, portMAX_DELAY);
+		return;
+	}
+	message.kind = SHARD_CELL;
+	message.hops = (uint8_t)shardHops(offset);
+	message.length = 2;
+	message.payload[0] = (uint8_t)position.x;
+	message.payload[1] = (uint8_t)position.y;
+	sendShardMessage(&message);
+	ShardStats.cellsSent++;
+}
+
+/* Called from endGame on the board that has the snake, every other board ends too */
+void endShardGame(bool won)
+{
+	ShardMessageType message;
+	message.kind = SHARD_END;
+	message.hops = (uint8_t)(ShardCount - 1);
+	message.length = 3;
+	message.payload[0] = won;
+	message.payload[1] = (uint8_t)score;
+	message.payload[2] = (uint8_t)(score >> 8);
+	sendShardMessage(&message);
+}
+
+/* The board a cell is on, counted east from this one */
+int shardOf(PointType position)
+{
+	return shardHops(shardFloor(position.x));
+}
+
+/* Body left behind by the snake when it was on this board */
+bool isShardTrail(PointType position)
+{
+	return WorldCells[position.y][position.x] == 'o' || WorldCells[position.y][position.x] == '@';
+}
+
+/* Columns compared around the world ring, body cells off this board can be
+ * counted from either side of it */
+bool isShardCollision(PointType position)
+{
+	int x = wrapShardColumn(position.x);
+	int i;
+	for (i = 1; i < GameState.snakeLength; i++)
+	{
+		if (x == wrapShardColumn(GameState.snakePositions[i].x) && position.y == GameState.snakePositions[i].y) return true;
+	}
+	return false;
+}
+
+/* Frames start at a sync byte and are as long as their length byte says.
+ * When the checksum does not match, the bytes after the sync byte are
+ * looked through again for the next frame, in place so a long run of
+ * noise costs no stack */
+void receiveShardByte(uint8_t c)
+{
+	int total;
+	ShardFrame[ShardFrameLength++] = c;
+	while (ShardFrameLength > 0)
+	{
+		if (ShardFrame[0] != SHARD_SYNC)
+		{
+			ShardStats.badBytes++;
+			dropShardBytes(1);
+			continue;
+		}
+		if (ShardFrameLength < 4) return;
+		total = 4 + ShardFrame[3] + 2;
+		if (ShardFrame[3] <= SHARD_MAX_PAYLOAD && ShardFrameLength < total) return;
+		if (ShardFrame[3] <= SHARD_MAX_PAYLOAD && shardChecksum(ShardFrame, total) == (ShardFrame[total - 2] | ShardFrame[total - 1] << 8))
+		{
+			handleShardFrame(ShardFrame);
+			dropShardBytes(total);
+			continue;
+		}
+		/* Not a frame after all, the sync byte was noise */
+		ShardStats.badBytes++;
+		dropShardBytes(1);
+	}
+}
+
+/* Moves what is left after the first count bytes to the front of the frame */
+void dropShardBytes(int count)
+{
+	ShardFrameLength -= count;
+	memmove(ShardFrame, ShardFrame + count, ShardFrameLength);
+}
+
+/* Messages for boards further east go on at once. START and END are for
+ * every board they pass, KEY for the one with the snake */
+void handleShardFrame(const uint8_t *frame)
+{
+	RenderRequestType request;
+	PointType position;
+	ShardMessageType message;
+	message.kind = frame[1];
+	message.hops = frame[2];
+	message.length = frame[3];
+	memcpy(message.payload, frame + 4, message.length);
+	if (message.hops > 1 && !(message.kind == SHARD_KEY && ShardOwner))
+	{
+		message.hops--;
+		sendShardMessage(&message);
+		message.hops++;
+		ShardStats.forwarded++;
+		if (message.kind != SHARD_START && message.kind != SHARD_END) return;
+	}
+	switch (message.kind)
+	{
+		case SHARD_CELL:
+			if (message.payload[0] >= ENV_WIDTH || message.payload[1] >= ENV_HEIGHT) break;
+			position.x = message.payload[0];
+			position.y = message.payload[1];
+			request = packRenderRequest(SHARD_TAIL_REMOVE, position, false, position);
+			xQueueSend(RenderQueue, (const void *)&request, portMAX_DELAY);
+			break;
+		case SHARD_START:
+			if (inGame) break;
+			ShardStartSpeed = message.payload[0] | message.payload[1] << 8;
+			ShardStartPending = true;
+			break;
+		case SHARD_END:
+			if (inGame) xQueueSend(ShardInbox, (const void *)&message, portMAX_DELAY);
+			break;
+		default:
+			xQueueSend(ShardInbox, (const void *)&message, portMAX_DELAY);
+			break;
+	}
+}
+
+void sendShardAck(uint8_t sequence, uint8_t hops)
+{
+	ShardMessageType message;
+	message.kind = SHARD_ACK;
+	message.hops = hops;
+	message.length = 1;
+	message.payload[0] = sequence;
+	sendShardMessage(&message);
+}
+
+void sendShardMessage(const ShardMessageType *message)
+{
+	uint8_t frame[sizeof(ShardFrame)];
+	uint16_t checksum;
+	int total = 4 + message->length + 2;
+	int i;
+	frame[0] = SHARD_SYNC;
+	frame[1] = message->kind;
+	frame[2] = message->hops;
+	frame[3] = message->length;
+	memcpy(frame + 4, message->payload, message->length);
+	checksum = shardChecksum(frame, total);
+	frame[total - 2] = (uint8_t)checksum;
+	frame[total - 1] = (uint8_t)(checksum >> 8);
+	xSemaphoreTake(ShardTxLock, portMAX_DELAY);
+	for (i = 0; i < total; i++) UARTCharPut(SHARD_UART_BASE, frame[i]);
+	xSemaphoreGive(ShardTxLock);
+}
+
+/* Fletcher-16 of everything between the sync byte and the checksum */
+uint16_t shardChecksum(const uint8_t *frame, int length)
+{
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+	int i;
+	for (i = 1; i < length - 2; i++)
+	{
+		sum1 = (sum1 + frame[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return sum2 << 8 | sum1;
+}
+
+/* Boards east of this one a column is on, negative to the west */
+int shardFloor(int x)
+{
+	return x >= 0 ? x / ENV_WIDTH : -((ENV_WIDTH - 1 - x) / ENV_WIDTH);
+}
+
+int shardHops(int offset)
+{
+	return ((offset % ShardCount) + ShardCount) % ShardCount;
+}
+
+/* The one column of the world ring west of this board's east edge, so this
+ * board's own cells are always 0 to ENV_WIDTH - 1 */
+int wrapShardColumn(int x)
+{
+	int width = ShardCount * ENV_WIDTH;
+	while (x >= ENV_WIDTH) x -= width;
+	while (x < ENV_WIDTH - width) x += width;
+	return x;
+}
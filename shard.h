@@ -0,0 +1,106 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "game.h"
+
+/* Shard Configuration Parameters */
+#ifndef SHARD_INDEX
+#define SHARD_INDEX				0		/* Position of this board in the ring, from the west */
+#endif
+#ifndef SHARD_COUNT
+#define SHARD_COUNT				1		/* Boards in the ring, 1 plays the whole world on this board */
+#endif
+#define SHARD_MAX_COUNT			8
+#define SHARD_UART_BASE			UART6_BASE		/* PD4 RX from the west neighbour, PD5 TX to the east one */
+#define SHARD_BAUD_RATE			115200
+#define SHARD_RX_QUEUE_LENGTH	128
+#define SHARD_INBOX_LENGTH		4
+#define SHARD_HANDOFF_RETRY		2		/* Ticks before an unacknowledged handoff is sent again */
+
+#define SHARD_SYNC				0x5A
+#define SHARD_MAX_PAYLOAD		(6 + (MAX_SNAKE_LENGTH + 2) / 4)	/* A handoff of the longest snake, the largest message */
+#define SHARD_NO_SEQUENCE		0xFF
+
+/* The handoff carries the snake length and the frame its payload length in one byte */
+#if MAX_SNAKE_LENGTH > 255
+#error "MAX_SNAKE_LENGTH does not fit in a shard handoff"
+#endif
+
+/* Type Definitions */
+/* Frame layout:
+ *   0      SHARD_SYNC
+ *   1      ShardMessageKind
+ *   2      hops, boards still to pass east, the board that takes it to 1
+ *   3      payload length
+ *   4..    payload
+ *   last 2 Fletcher-16 of everything from byte 1
+ * The boards form a ring over one UART each, TX to the east neighbour's RX,
+ * so a message for the west neighbour goes once around. Payloads:
+ *   HANDOFF  sequence, direction, length, score (2), head y, body as 2 bit
+ *            steps from each segment to the next
+ *   ACK      sequence
+ *   CELL     x, y of a body cell left behind, cleared on the board that has it
+ *   KEY      key, taken by whichever board has the snake
+ *   START    snake speed (2)
+ *   END      won, score (2) */
+typedef enum
+{
+	SHARD_HANDOFF,
+	SHARD_ACK,
+	SHARD_CELL,
+	SHARD_KEY,
+	SHARD_START,
+	SHARD_END
+} ShardMessageKind;
+
+typedef struct ShardMessage
+{
+	uint8_t kind;
+	uint8_t hops;
+	uint8_t length;
+	uint8_t payload[SHARD_MAX_PAYLOAD];
+} ShardMessageType;
+
+typedef struct ShardStats
+{
+	unsigned long handoffsSent;
+	unsigned long handoffsReceived;
+	unsigned long handoffRetries;
+	unsigned long cellsSent;
+	unsigned long forwarded;
+	unsigned long badBytes;
+	uint32_t totalHandoffTime;	/* Handoff to acknowledgement, in readTimestamp cycles */
+	uint32_t maxHandoffTime;
+} ShardStatsType;
+
+/* Global Variables */
+extern int ShardIndex;
+extern int ShardCount;
+extern bool ShardOwner;				/* The snake is on this board */
+extern uint8_t ShardSequence;
+extern volatile bool ShardStartPending;
+extern ShardStatsType ShardStats;
+extern xQueueHandle ShardRxQueue;
+extern xQueueHandle ShardInbox;
+
+/* Tasks */
+void ShardTask(void *vpParameters);
+extern xTaskHandle ShardTaskHandle;
+
+/* Shard Functions */
+void initializeShards();
+void startShardGame(int *speed);
+bool takeShardStart(int *speed);
+GameOutcomeType shardTick();
+void handOffSnake();
+void sendShardCell(PointType position);
+void endShardGame(bool won);
+int shardOf(PointType position);
+bool isShardTrail(PointType position);
+bool isShardCollision(PointType position);
+void receiveShardByte(uint8_t c);
+void sendShardMessage(const ShardMessageType *message);
+uint16_t shardChecksum(const uint8_t *frame, int length);
+void UART6_Handler(void);
+
+#endif /* SHARD_H */
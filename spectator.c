@@ -0,0 +1,317 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <inc/hw_ints.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/sysctl.h>
+#include <driverlib/gpio.h>
+#include <driverlib/pin_map.h>
+#include <driverlib/uart.h>
+#include <driverlib/interrupt.h>
+
+#include "spectator.h"
+
+/* Global Variables */
+const SpectatorPortConfigType SpectatorPortConfigs[] =
+{
+	{UART3_BASE, SYSCTL_PERIPH_UART3, SYSCTL_PERIPH_GPIOC, GPIO_PORTC_BASE, GPIO_PIN_6 | GPIO_PIN_7, GPIO_PC6_U3RX, GPIO_PC7_U3TX, INT_UART3},
+	{UART4_BASE, SYSCTL_PERIPH_UART4, SYSCTL_PERIPH_GPIOC, GPIO_PORTC_BASE, GPIO_PIN_4 | GPIO_PIN_5, GPIO_PC4_U4RX, GPIO_PC5_U4TX, INT_UART4},
+	{UART5_BASE, SYSCTL_PERIPH_UART5, SYSCTL_PERIPH_GPIOE, GPIO_PORTE_BASE, GPIO_PIN_4 | GPIO_PIN_5, GPIO_PE4_U5RX, GPIO_PE5_U5TX, INT_UART5},
+	{UART7_BASE, SYSCTL_PERIPH_UART7, SYSCTL_PERIPH_GPIOE, GPIO_PORTE_BASE, GPIO_PIN_0 | GPIO_PIN_1, GPIO_PE0_U7RX, GPIO_PE1_U7TX, INT_UART7}
+};
+SpectatorPortType SpectatorPorts[SPECTATOR_PORTS];
+SpectatorBlockType SpectatorBlockPool[SPECTATOR_BLOCKS];
+SpectatorBlockType *SpectatorFreeBlocks[SPECTATOR_BLOCKS];
+int SpectatorFreeCount = 0;
+int SpectatorCount = 0;
+unsigned long SpectatorBytesEncoded = 0;
+/* Block the render task is writing, and the port a keyframe is being written for or -1 */
+SpectatorBlockType *SpectatorBlock = NULL;
+int SpectatorKeyframePort = -1;
+
+SpectatorBlockType *allocateSpectatorBlock();
+void releaseSpectatorBlock(SpectatorBlockType *block);
+bool queueSpectatorBlock(int index, SpectatorBlockType *block);
+void dropQueuedSpectatorBlocks(int index);
+
+/* Every port is set up at boot, it only gets output once a key is pressed on it */
+void initializeSpectators()
+{
+	const SpectatorPortConfigType *config;
+	int i;
+	for (i = 0; i < SPECTATOR_BLOCKS; i++) SpectatorFreeBlocks[i] = &SpectatorBlockPool[i];
+	SpectatorFreeCount = SPECTATOR_BLOCKS;
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		config = &SpectatorPortConfigs[i];
+		SysCtlPeripheralEnable(config->gpioPeripheral);
+		while(!SysCtlPeripheralReady(config->gpioPeripheral));
+		GPIOPinTypeUART(config->gpioBase, config->pins);
+		GPIOPinConfigure(config->rxPinConfig);
+		GPIOPinConfigure(config->txPinConfig);
+		SysCtlPeripheralEnable(config->peripheral);
+		while(!SysCtlPeripheralReady(config->peripheral));
+		UARTConfigSetExpClk(config->base, SysCtlClockGet(), SPECTATOR_BAUD_RATE, UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE);
+		/* The TX interrupt comes with 4 bytes left in the FIFO, so it is refilled about every 12 bytes */
+		UARTFIFOLevelSet(config->base, UART_FIFO_TX2_8, UART_FIFO_RX1_8);
+		UARTFIFOEnable(config->base);
+		UARTIntEnable(config->base, UART_INT_RX | UART_INT_RT | UART_INT_TX);
+		IntPrioritySet(config->interrupt, configKERNEL_INTERRUPT_PRIORITY);
+		IntEnable(config->interrupt);
+	}
+}
+
+/* Every byte the render task draws goes through here. The player's terminal
+ * still gets it straight away, spectators get it once the block it lands in
+ * is published. Nothing is buffered while nobody is watching */
+void putRenderChar(char c)
+{
+	if (SpectatorKeyframePort < 0) UARTCharPut(UART0_BASE, c);
+	if (SpectatorCount == 0) return;
+	if (SpectatorBlock == NULL)
+	{
+		SpectatorBlock = allocateSpectatorBlock();
+		if (SpectatorBlock == NULL) return;
+	}
+	SpectatorBlock->data[SpectatorBlock->length++] = c;
+	SpectatorBytesEncoded++;
+	if (SpectatorBlock->length == SPECTATOR_BLOCK_SIZE) flushSpectators();
+}
+
+/* Publishes the block being written. A broadcast block is queued on every
+ * watching port and counted once for each, the bytes are never copied again.
+ * A port that cannot take it has fallen too far behind and is resynchronised */
+void flushSpectators()
+{
+	SpectatorBlockType *block = SpectatorBlock;
+	uint8_t targets = 0;
+	uint8_t references = 0;
+	int i;
+	if (block == NULL) return;
+	SpectatorBlock = NULL;
+	if (SpectatorKeyframePort >= 0)
+	{
+		targets = 1 << SpectatorKeyframePort;
+		references = 1;
+	}
+	else
+	{
+		for (i = 0; i < SPECTATOR_PORTS; i++)
+		{
+			if (SpectatorPorts[i].state != SPECTATOR_WATCHING) continue;
+			targets |= 1 << i;
+			references++;
+		}
+	}
+	/* Counted before it is queued, a port can send it before the others have it */
+	block->references = references + 1;
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		if ((targets & (1 << i)) == 0) continue;
+		if (queueSpectatorBlock(i, block)) continue;
+		requestSpectatorKeyframe(i);
+		SpectatorPorts[i].resyncs++;
+		taskENTER_CRITICAL();
+		releaseSpectatorBlock(block);
+		taskEXIT_CRITICAL();
+	}
+	taskENTER_CRITICAL();
+	releaseSpectatorBlock(block);
+	taskEXIT_CRITICAL();
+}
+
+/* Called by the render task before every request, a keyframe reaches its port
+ * ahead of any later broadcast so the spectator picks up exactly where the
+ * player's terminal is */
+void sendSpectatorKeyframes()
+{
+	SpectatorPortType *port;
+	unsigned long resyncs;
+	int i;
+	for (i = 0; i < SPECTATOR_PORTS; i++)
+	{
+		port = &SpectatorPorts[i];
+		/* Waits for what is still queued, the interrupt wakes this task once it is sent */
+		if (port->state != SPECTATOR_JOINING || port->head != port->tail) continue;
+		resyncs = port->resyncs;
+		SpectatorKeyframePort = i;
+		renderKeyframe();
+		flushSpectators();
+		SpectatorKeyframePort = -1;
+		/* Did not fit in the port queue, tried again on the next request */
+		if (port->resyncs != resyncs) continue;
+		port->state = SPECTATOR_WATCHING;
+		port->keyframes++;
+	}
+}
+
+/* Blocks already queued for the port are dropped, the keyframe replaces them */
+void requestSpectatorKeyframe(int index)
+{
+	SpectatorPortType *port = &SpectatorPorts[index];
+	taskENTER_CRITICAL();
+	if (port->state == SPECTATOR_IDLE) SpectatorCount++;
+	port->state = SPECTATOR_JOINING;
+	dropQueuedSpectatorBlocks(index);
+	taskEXIT_CRITICAL();
+}
+
+/* For tasks other than the render task, which would wait on its own queue */
+void startSpectator(int index)
+{
+	const RenderRequestType keyframeRenderRequest = RENDER_REQUEST(SPECTATOR_KEYFRAME);
+	requestSpectatorKeyframe(index);
+	xQueueSend(RenderQueue, (const void *)&keyframeRenderRequest, 0);
+}
+
+void stopSpectator(int index)
+{
+	SpectatorPortType *port = &SpectatorPorts[index];
+	taskENTER_CRITICAL();
+	if (port->state != SPECTATOR_IDLE) SpectatorCount--;
+	port->state = SPECTATOR_IDLE;
+	dropQueuedSpectatorBlocks(index);
+	taskEXIT_CRITICAL();
+}
+
+/* Shared by the port interrupts: any key joins, or repaints the screen of a
+ * spectator already watching, and the TX FIFO is refilled straight from the
+ * shared blocks. A port waiting for a keyframe wakes the render task once its
+ * queue is empty */
+void serviceSpectatorPort(int index)
+{
+	const SpectatorPortConfigType *config = &SpectatorPortConfigs[index];
+	const RenderRequestType keyframeRenderRequest = RENDER_REQUEST(SPECTATOR_KEYFRAME);
+	SpectatorPortType *port = &SpectatorPorts[index];
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	SpectatorBlockType *block;
+	UBaseType_t interruptStatus;
+	bool wake = false;
+	UARTIntClear(config->base, UARTIntStatus(config->base, true));
+	if (UARTCharsAvail(config->base))
+	{
+		while (UARTCharsAvail(config->base)) UARTCharGetNonBlocking(config->base);
+		if (port->state != SPECTATOR_JOINING)
+		{
+			if (port->state == SPECTATOR_IDLE) SpectatorCount++;
+			port->state = SPECTATOR_JOINING;
+			wake = port->head == port->tail;
+		}
+	}
+	while (port->head != port->tail && UARTSpaceAvail(config->base))
+	{
+		block = port->queue[port->head % SPECTATOR_QUEUE_LENGTH];
+		UARTCharPutNonBlocking(config->base, block->data[port->offset++]);
+		if (port->offset < block->length) continue;
+		port->offset = 0;
+		port->bytesSent += block->length;
+		interruptStatus = taskENTER_CRITICAL_FROM_ISR();
+		releaseSpectatorBlock(block);
+		taskEXIT_CRITICAL_FROM_ISR(interruptStatus);
+		port->head++;
+		if (port->head == port->tail && port->state == SPECTATOR_JOINING) wake = true;
+	}
+	/* Only wakes the render task, when the queue is full it is about to run anyway */
+	if (wake) xQueueSendFromISR(RenderQueue, (const void *)&keyframeRenderRequest, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+#if SPECTATOR_PORTS > 0
+void UART3_Handler(void)
+{
+	serviceSpectatorPort(0);
+}
+#endif
+
+#if SPECTATOR_PORTS > 1
+void UART4_Handler(void)
+{
+	serviceSpectatorPort(1);
+}
+#endif
+
+#if SPECTATOR_PORTS > 2
+void UART5_Handler(void)
+{
+	serviceSpectatorPort(2);
+}
+#endif
+
+#if SPECTATOR_PORTS > 3
+void UART7_Handler(void)
+{
+	serviceSpectatorPort(3);
+}
+#endif
+
+/* When the pool runs dry the port holding the most blocks is resynchronised
+ * until one comes back, the player's terminal never waits for a spectator */
+SpectatorBlockType *allocateSpectatorBlock()
+{
+	SpectatorBlockType *block = NULL;
+	uint8_t queued;
+	uint8_t most;
+	int slowest;
+	int i;
+	for ( ;; )
+	{
+		taskENTER_CRITICAL();
+		if (SpectatorFreeCount > 0) block = SpectatorFreeBlocks[--SpectatorFreeCount];
+		taskEXIT_CRITICAL();
+		if (block != NULL) break;
+		slowest = -1;
+		most = 0;
+		for (i = 0; i < SPECTATOR_PORTS; i++)
+		{
+			/* The head block is never dropped */
+			queued = SpectatorPorts[i].tail - SpectatorPorts[i].head;
+			if (queued > 0) queued--;
+			if (queued > most)
+			{
+				most = queued;
+				slowest = i;
+			}
+		}
+		if (slowest < 0) return NULL;
+		requestSpectatorKeyframe(slowest);
+		SpectatorPorts[slowest].resyncs++;
+	}
+	block->length = 0;
+	return block;
+}
+
+/* Called with interrupts masked */
+void releaseSpectatorBlock(SpectatorBlockType *block)
+{
+	if (--block->references == 0) SpectatorFreeBlocks[SpectatorFreeCount++] = block;
+}
+
+bool queueSpectatorBlock(int index, SpectatorBlockType *block)
+{
+	SpectatorPortType *port = &SpectatorPorts[index];
+	uint8_t tail = port->tail;
+	if ((uint8_t)(tail - port->head) == SPECTATOR_QUEUE_LENGTH) return false;
+	port->queue[tail % SPECTATOR_QUEUE_LENGTH] = block;
+	port->tail = tail + 1;
+	/* An empty queue means the interrupt has stopped, a busy one will come back for this block */
+	if (port->head == tail) IntPendSet(SpectatorPortConfigs[index].interrupt);
+	return true;
+}
+
+/* Called with interrupts masked. The head block is kept, the FIFO may be part
+ * way through it and cutting it could leave the terminal inside an escape
+ * sequence. A port that has stopped sending keeps holding just that block and
+ * gets no keyframe until it moves again */
+void dropQueuedSpectatorBlocks(int index)
+{
+	SpectatorPortType *port = &SpectatorPorts[index];
+	uint8_t first = port->head != port->tail ? port->head + 1 : port->head;
+	uint8_t entry;
+	for (entry = first; entry != port->tail; entry++) releaseSpectatorBlock(port->queue[entry % SPECTATOR_QUEUE_LENGTH]);
+	port->tail = first;
+}
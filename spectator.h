@@ -0,0 +1,73 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include "game.h"
+
+/* Spectator Configuration Parameters */
+#define SPECTATOR_PORTS				4		/* Up to 4, UART3, UART4, UART5 and UART7 in that order */
+#define SPECTATOR_BAUD_RATE			115200
+#define SPECTATOR_BLOCK_SIZE		128		/* Render output is shared between the ports in blocks of this many bytes */
+#define SPECTATOR_BLOCKS			16
+#define SPECTATOR_QUEUE_LENGTH		8		/* Blocks a port may fall behind before it is resynchronised with a keyframe, a power of two */
+
+/* Type Definitions */
+typedef struct SpectatorBlock
+{
+	volatile uint8_t references;	/* Ports that have not sent it yet, back in the pool at zero */
+	uint8_t length;
+	char data[SPECTATOR_BLOCK_SIZE];
+} SpectatorBlockType;
+
+typedef enum
+{
+	SPECTATOR_IDLE,
+	SPECTATOR_JOINING,		/* Waiting for a keyframe, gets no broadcast blocks until then */
+	SPECTATOR_WATCHING
+} SpectatorStateType;
+
+typedef struct SpectatorPortConfig
+{
+	uint32_t base;
+	uint32_t peripheral;
+	uint32_t gpioPeripheral;
+	uint32_t gpioBase;
+	uint8_t pins;
+	uint32_t rxPinConfig;
+	uint32_t txPinConfig;
+	uint32_t interrupt;
+} SpectatorPortConfigType;
+
+typedef struct SpectatorPort
+{
+	volatile SpectatorStateType state;
+	SpectatorBlockType *queue[SPECTATOR_QUEUE_LENGTH];
+	volatile uint8_t head;		/* Advanced by the port interrupt once a block is sent */
+	volatile uint8_t tail;		/* Advanced by the render task */
+	uint8_t offset;				/* Bytes of the head block already in the TX FIFO */
+	unsigned long bytesSent;
+	unsigned long keyframes;
+	unsigned long resyncs;
+} SpectatorPortType;
+
+/* Global Variables */
+extern const SpectatorPortConfigType SpectatorPortConfigs[];
+extern SpectatorPortType SpectatorPorts[SPECTATOR_PORTS];
+extern SpectatorBlockType SpectatorBlockPool[SPECTATOR_BLOCKS];
+extern int SpectatorCount;			/* Ports that are not idle */
+extern unsigned long SpectatorBytesEncoded;
+
+/* Spectator Functions */
+void initializeSpectators();
+void putRenderChar(char c);
+void flushSpectators();
+void sendSpectatorKeyframes();
+void requestSpectatorKeyframe(int index);
+void startSpectator(int index);
+void stopSpectator(int index);
+void serviceSpectatorPort(int index);
+void UART3_Handler(void);
+void UART4_Handler(void);
+void UART5_Handler(void);
+void UART7_Handler(void);
+
+#endif /* SPECTATOR_H */
@@ -0,0 +1,191 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stress.h"
+#include "gameTick.h"
+#include "bitboard.h"
+#include "entity.h"
+
+/* Global Variables */
+bool StressMode = false;
+StressStepType StressSteps[STRESS_STEPS];
+int StressStepCount = 0;
+volatile char StressKey = 0;		/* Stands in for the UART data register, one key until the snake reads it */
+volatile unsigned int StressDroppedInputs = 0;
+
+/* Tasks */
+xTaskHandle StressInputTaskHandle;
+
+void beginStressStep(int speed, uint32_t tickStart);
+
+/* The synthetic player, one key for every move at the speed being tried
+ * whether the snake keeps up or not */
+void StressInputTask(void *vpParameters)
+{
+	portTickType lastWokenTime = xTaskGetTickCount();
+	char key;
+	for ( ;; )
+	{
+		vTaskDelayUntil(&lastWokenTime, (60000 / SnakeSpeed) / portTICK_RATE_MS);
+		xSemaphoreTake(GameStateLock, portMAX_DELAY);
+		key = chooseStressKey();
+		xSemaphoreGive(GameStateLock);
+		postStressKey(key);
+	}
+}
+
+void startStress()
+{
+	int i;
+	for (i = 0; i < STRESS_STEPS; i++) StressSteps[i].speed = 0;
+	StressStepCount = 0;
+	StressKey = 0;
+	StressDroppedInputs = 0;
+}
+
+/* A turn every time, to the other side than the last one when both survive.
+ * The key for going straight on, which changes nothing, when neither does.
+ * Called with GameStateLock held */
+char chooseStressKey()
+{
+	static const char keys[] = {'w', 's', 'd', 'a'};
+	static bool clockwise = false;
+	Direction turns[2];
+	PointType next;
+	int i;
+	if (LastDirection == UP || LastDirection == DOWN)
+	{
+		turns[0] = clockwise ? RIGHT : LEFT;
+		turns[1] = clockwise ? LEFT : RIGHT;
+	}
+	else
+	{
+		turns[0] = clockwise ? DOWN : UP;
+		turns[1] = clockwise ? UP : DOWN;
+	}
+	clockwise = !clockwise;
+	for (i = 0; i < 2; i++)
+	{
+		next = calculateNewHeadPosition(GameState.snakePositions[0], turns[i]);
+		if (isSnakeCollision(next) || entityKindAt(next) == ENTITY_ENEMY) continue;
+		if (!isTrapMove(turns[i])) return keys[turns[i]];
+	}
+	return keys[LastDirection];
+}
+
+/* A key that arrives before the snake read the last one overwrites it, as on the UART without its FIFO */
+void postStressKey(char key)
+{
+	taskENTER_CRITICAL();
+	if (StressKey != 0) StressDroppedInputs++;
+	StressKey = key;
+	taskEXIT_CRITICAL();
+}
+
+char takeStressKey()
+{
+	char key;
+	taskENTER_CRITICAL();
+	key = StressKey;
+	StressKey = 0;
+	taskEXIT_CRITICAL();
+	return key;
+}
+
+/* Every entity moved on every tick, far more render requests than a game sends */
+void churnStressSpawns()
+{
+	if (findEntityOfKind(ENTITY_NORMAL_POWERUP) == ENTITY_NONE) spawnNormalPowerUp();
+	respawnEnemy();
+	removeSpecialPowerUp();
+	placeSpecialPowerUp(generateFreePosition());
+}
+
+/* Called by the snake task after every tick of the ramp with GameStateLock
+ * held. A lost or won game starts over at once and the ramp goes on, the
+ * deadline and the backlog are of the tick before. Returns GAME_WON once the
+ * last step is done */
+GameOutcomeType stressTick(GameOutcomeType outcome, uint32_t tickStart, bool missed, bool overrun, unsigned int backlog)
+{
+	const RenderRequestType gameStartRenderRequest = RENDER_REQUEST(START_GAME);
+	StressStepType *step = &StressSteps[StressStepCount];
+	if (outcome != GAME_RUNNING)
+	{
+		resetGameState();
+		xQueueSend(RenderQueue, (const void *)&gameStartRenderRequest, portMAX_DELAY);
+		step->restarts++;
+	}
+	churnStressSpawns();
+	/* The first tick only marks when the ramp began, every later step begins where the one before ended */
+	if (step->speed == 0)
+	{
+		beginStressStep(SnakeSpeed, tickStart);
+		return GAME_RUNNING;
+	}
+	step->ticks++;
+	if (missed) step->missedDeadlines++;
+	if (overrun) step->renderOverruns++;
+	if (backlog > step->maxBacklog) step->maxBacklog = backlog;
+	if (step->ticks < STRESS_STEP_TICKS) return GAME_RUNNING;
+	step->elapsed = tickStart - step->start;
+	step->droppedInputs = StressDroppedInputs;
+	StressStepCount++;
+	if (StressStepCount == STRESS_STEPS || step->speed == STRESS_MAX_SPEED) return GAME_WON;
+	setGameTickSpeed(nextStressSpeed(step->speed));
+	beginStressStep(SnakeSpeed, tickStart);
+	return GAME_RUNNING;
+}
+
+/* Kept up with: every deadline met, every key read, RenderTask done before each tick */
+bool isStressStepMet(const StressStepType *step)
+{
+	return step->missedDeadlines == 0 && step->renderOverruns == 0 && step->droppedInputs == 0 &&
+		measureStressRate(step) * 100 >= (uint32_t)step->speed * 99;
+}
+
+/* The highest speed before the first step that did not keep up, 0 if the first did not */
+int findStressLimit()
+{
+	int limit = 0;
+	int i;
+	for (i = 0; i < StressStepCount; i++)
+	{
+		if (!isStressStepMet(&StressSteps[i])) break;
+		limit = StressSteps[i].speed;
+	}
+	return limit;
+}
+
+int nextStressSpeed(int speed)
+{
+	speed += speed * STRESS_STEP_PERCENT / 100;
+	return speed > STRESS_MAX_SPEED ? STRESS_MAX_SPEED : speed;
+}
+
+/* Moves per minute the step achieved */
+uint32_t measureStressRate(const StressStepType *step)
+{
+	if (step->elapsed == 0) return 0;
+	return (uint32_t)(((uint64_t)step->ticks * 60000 * TimestampsPerMs) / step->elapsed);
+}
+
+void beginStressStep(int speed, uint32_t tickStart)
+{
+	StressStepType *step = &StressSteps[StressStepCount];
+	step->speed = speed;
+	step->ticks = 0;
+	step->start = tickStart;
+	step->elapsed = 0;
+	step->missedDeadlines = 0;
+	step->renderOverruns = 0;
+	step->maxBacklog = 0;
+	step->droppedInputs = 0;
+	step->restarts = 0;
+	StressDroppedInputs = 0;
+}
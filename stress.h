@@ -0,0 +1,51 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include "game.h"
+
+/* Stress Configuration Parameters */
+#define STRESS_START_SPEED		INITIAL_SNAKE_SPEED
+#define STRESS_MAX_SPEED		6000	/* A move every 10 ms, still whole milliseconds for the synthetic player */
+#define STRESS_STEP_PERCENT		25		/* Speed added at every step, up to STRESS_MAX_SPEED */
+#define STRESS_STEPS			24
+#define STRESS_STEP_TICKS		60
+
+/* Type Definitions */
+/* One speed of the ramp, elapsed in timestamp timer cycles */
+typedef struct StressStep
+{
+	int speed;
+	unsigned int ticks;
+	uint32_t start;
+	uint32_t elapsed;
+	unsigned int missedDeadlines;
+	unsigned int renderOverruns;
+	unsigned int maxBacklog;
+	unsigned int droppedInputs;
+	unsigned int restarts;
+} StressStepType;
+
+/* Global Variables */
+extern bool StressMode;
+extern StressStepType StressSteps[STRESS_STEPS];
+extern int StressStepCount;
+extern volatile char StressKey;
+extern volatile unsigned int StressDroppedInputs;
+
+/* Tasks */
+void StressInputTask(void *vpParameters);
+extern xTaskHandle StressInputTaskHandle;
+
+/* Stress Functions */
+void startStress();
+char chooseStressKey();
+void postStressKey(char key);
+char takeStressKey();
+void churnStressSpawns();
+GameOutcomeType stressTick(GameOutcomeType outcome, uint32_t tickStart, bool missed, bool overrun, unsigned int backlog);
+bool isStressStepMet(const StressStepType *step);
+int findStressLimit();
+int nextStressSpeed(int speed);
+uint32_t measureStressRate(const StressStepType *step);
+
+#endif /* STRESS_H */
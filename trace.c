@@ -0,0 +1,147 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/uart.h>
+
+#include "gameTick.h"
+#include "trace.h"
+
+/* Global Variables */
+TraceRecordType TraceBuffer[TRACE_BUFFER_SIZE];
+volatile uint32_t TraceHead = 0;
+volatile bool TraceFrozen = false;
+uint32_t TraceCycles = 0;
+uint32_t TraceMaxCycles = 0;
+uint8_t TraceCurrentTask = TRACE_TASK_UNKNOWN;
+char TraceTaskNames[TRACE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+
+void recordTrace(uint8_t event, uint16_t argument);
+void putTraceString(uint32_t uartBase, const char *string);
+void putTraceHex(uint32_t uartBase, uint32_t value, int digits);
+
+void registerTraceTask(xTaskHandle task, TraceTaskType id)
+{
+	if (task == NULL || id >= TRACE_MAX_TASKS) return;
+	vTaskSetTaskNumber(task, id);
+	strncpy(TraceTaskNames[id], pcTaskGetName(task), configMAX_TASK_NAME_LEN - 1);
+}
+
+/* Called from the kernel with interrupts masked up to configMAX_SYSCALL_INTERRUPT_PRIORITY,
+ * which covers every other caller, so the ring needs no locking of its own */
+void recordTrace(uint8_t event, uint16_t argument)
+{
+	TraceRecordType *record;
+	uint32_t start;
+	uint32_t cycles;
+	if (TraceFrozen) return;
+	start = readTimestamp();
+	record = &TraceBuffer[TraceHead & (TRACE_BUFFER_SIZE - 1)];
+	record->timestamp = start;
+	record->event = event;
+	record->task = TraceCurrentTask;
+	record->argument = argument;
+	TraceHead++;
+	cycles = readTimestamp() - start;
+	TraceCycles += cycles;
+	if (cycles > TraceMaxCycles) TraceMaxCycles = cycles;
+}
+
+void traceTaskSwitched(uint8_t event, uint32_t taskNumber)
+{
+	if (event == TRACE_TASK_SWITCHED_IN) TraceCurrentTask = (uint8_t)taskNumber;
+	recordTrace(event, 0);
+}
+
+/* Only RenderQueue and GameStateLock are traced, any other queue costs one comparison */
+void traceQueueEvent(uint8_t event, void *queue)
+{
+	if (queue == NULL) return;
+	if (queue == (void *)RenderQueue) recordTrace(event, (uint16_t)uxQueueMessagesWaitingFromISR(RenderQueue));
+	else if (queue == (void *)GameStateLock)
+	{
+		switch (event)
+		{
+			case TRACE_QUEUE_SEND:
+				recordTrace(TRACE_MUTEX_GIVE, 0);
+				break;
+			case TRACE_QUEUE_RECEIVE:
+				recordTrace(TRACE_MUTEX_TAKE, 0);
+				break;
+			case TRACE_QUEUE_BLOCK_RECEIVE:
+				recordTrace(TRACE_MUTEX_BLOCK, 0);
+				break;
+		}
+	}
+}
+
+/* Text dump read by host/tracejson.c:
+ *   TRACE <timestamps per second> <records> <total records> <recording cycles> <max cycles>
+ *   T <task id> <name>
+ *   E <timestamp> <event> <task id> <argument>
+ *   END
+ * Numbers are hex. Recording stops while the dump is written */
+void dumpTrace(uint32_t uartBase)
+{
+	uint32_t head;
+	uint32_t count;
+	uint32_t i;
+	TraceRecordType *record;
+	
+	TraceFrozen = true;
+	head = TraceHead;
+	count = head < TRACE_BUFFER_SIZE ? head : TRACE_BUFFER_SIZE;
+	putTraceString(uartBase, "TRACE ");
+	putTraceHex(uartBase, TimestampsPerMs * 1000, 8);
+	UARTCharPut(uartBase, ' ');
+	putTraceHex(uartBase, count, 4);
+	UARTCharPut(uartBase, ' ');
+	putTraceHex(uartBase, head, 8);
+	UARTCharPut(uartBase, ' ');
+	putTraceHex(uartBase, TraceCycles, 8);
+	UARTCharPut(uartBase, ' ');
+	putTraceHex(uartBase, TraceMaxCycles, 4);
+	putTraceString(uartBase, "\r\n");
+	for (i = 0; i < TRACE_MAX_TASKS; i++)
+	{
+		if (TraceTaskNames[i][0] == 0) continue;
+		putTraceString(uartBase, "T ");
+		putTraceHex(uartBase, i, 2);
+		UARTCharPut(uartBase, ' ');
+		putTraceString(uartBase, TraceTaskNames[i]);
+		putTraceString(uartBase, "\r\n");
+	}
+	for (i = head - count; i != head; i++)
+	{
+		record = &TraceBuffer[i & (TRACE_BUFFER_SIZE - 1)];
+		putTraceString(uartBase, "E ");
+		putTraceHex(uartBase, record->timestamp, 8);
+		UARTCharPut(uartBase, ' ');
+		putTraceHex(uartBase, record->event, 1);
+		UARTCharPut(uartBase, ' ');
+		putTraceHex(uartBase, record->task, 2);
+		UARTCharPut(uartBase, ' ');
+		putTraceHex(uartBase, record->argument, 4);
+		putTraceString(uartBase, "\r\n");
+	}
+	putTraceString(uartBase, "END\r\n");
+	TraceFrozen = false;
+}
+
+void putTraceString(uint32_t uartBase, const char *string)
+{
+	while (*string != 0) UARTCharPut(uartBase, *string++);
+}
+
+void putTraceHex(uint32_t uartBase, uint32_t value, int digits)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+	while (digits-- > 0) UARTCharPut(uartBase, hexDigits[(value >> (digits * 4)) & 0xF]);
+}
@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "game.h"
+
+/* Trace Configuration Parameters */
+/* TRACE_ENABLED is in FreeRTOSConfig.h next to the trace hooks */
+#define TRACE_BUFFER_SIZE		256		/* Records, a power of two */
+#define TRACE_MAX_TASKS			12
+
+/* Type Definitions */
+/* The hooks in FreeRTOSConfig.h pass these as plain numbers */
+typedef enum
+{
+	TRACE_TASK_SWITCHED_IN,
+	TRACE_TASK_SWITCHED_OUT,
+	TRACE_QUEUE_SEND,
+	TRACE_QUEUE_RECEIVE,
+	TRACE_QUEUE_BLOCK_SEND,
+	TRACE_QUEUE_BLOCK_RECEIVE,
+	TRACE_MUTEX_GIVE,
+	TRACE_MUTEX_TAKE,
+	TRACE_MUTEX_BLOCK
+} TraceEventType;
+
+/* Fixed task ids, set as the FreeRTOS task number so records stay readable after a task is deleted */
+typedef enum
+{
+	TRACE_TASK_UNKNOWN,
+	TRACE_TASK_IDLE,
+	TRACE_TASK_MAIN_MENU,
+	TRACE_TASK_RENDER,
+	TRACE_TASK_HIGH_SCORE,
+	TRACE_TASK_SNAKE,
+	TRACE_TASK_ENTITY,
+	TRACE_TASK_TIME,
+	TRACE_TASK_CONSOLE,
+	TRACE_TASK_SHARD
+} TraceTaskType;
+
+/* 8 bytes per record, timestamp in readTimestamp cycles. The argument is the
+ * RenderQueue fill level before the operation for queue events and unused otherwise */
+typedef struct TraceRecord
+{
+	uint32_t timestamp;
+	uint8_t event;
+	uint8_t task;
+	uint16_t argument;
+} TraceRecordType;
+
+/* Global Variables */
+extern TraceRecordType TraceBuffer[TRACE_BUFFER_SIZE];
+extern volatile uint32_t TraceHead;
+extern volatile bool TraceFrozen;
+extern uint32_t TraceCycles;
+extern uint32_t TraceMaxCycles;
+
+/* Trace Functions */
+void registerTraceTask(xTaskHandle task, TraceTaskType id);
+void traceTaskSwitched(uint8_t event, uint32_t taskNumber);
+void traceQueueEvent(uint8_t event, void *queue);
+void dumpTrace(uint32_t uartBase);
+
+#endif /* TRACE_H */
@@ -0,0 +1,246 @@
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define PART_TM4C123GH6PM
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "viewport.h"
+#include "spectator.h"
+#include "palette.h"
+
+/* Global Variables */
+/* What the render task last drew in every world cell, newly exposed cells are drawn from here */
+char WorldCells[ENV_HEIGHT][ENV_WIDTH];
+PointType Camera = {0, 0};
+bool ViewportScrolling = VIEWPORT_USE_SCROLL;
+
+int maximumCameraRow();
+void scrollViewportRows(int delta);
+void scrollViewportColumns(int delta);
+void drawViewportCells(int row, int column, int count);
+void moveCursorToRow(int line);
+void putControlSequence(int parameter, char final);
+
+/* Clears the world and centres the camera on the head without drawing anything */
+void resetViewport(PointType head)
+{
+	memset(WorldCells, ' ', sizeof(WorldCells));
+	Camera.x = head.x - VIEWPORT_WIDTH / 2;
+	Camera.y = head.y - viewportRows() / 2;
+	if (Camera.x < 0) Camera.x = 0;
+	if (Camera.y < 0) Camera.y = 0;
+	if (Camera.x > ENV_WIDTH - VIEWPORT_WIDTH) Camera.x = ENV_WIDTH - VIEWPORT_WIDTH;
+	if (Camera.y > maximumCameraRow()) Camera.y = maximumCameraRow();
+	if (PaletteHalfBlock) Camera.y += Camera.y & 1;
+}
+
+/* In half-block mode a cell shares its character with the other cell of its
+ * row pair, so the pair is drawn again whichever half changed */
+void drawWorldCell(PointType position, char c)
+{
+	int row = position.y - Camera.y;
+	int column = position.x - Camera.x;
+	WorldCells[position.y][position.x] = c;
+	if (!isCellVisible(position)) return;
+	if (PaletteHalfBlock)
+	{
+		row &= ~1;
+		moveCursorToPosition(row / 2 + 1, column + 1);
+		putCellPair(getViewportCell(row, column), getViewportCell(row + 1, column));
+		return;
+	}
+	moveCursorToPosition(row + 1, column + 1);
+	putCell(c);
+}
+
+bool isCellVisible(PointType position)
+{
+	return position.x >= Camera.x && position.x < Camera.x + VIEWPORT_WIDTH && position.y >= Camera.y && position.y < Camera.y + viewportRows();
+}
+
+/* Whether two cells are drawn as the halves of one half-block character */
+bool isSameCellPair(PointType first, PointType second)
+{
+	return PaletteHalfBlock && first.x == second.x && (first.y - Camera.y) / 2 == (second.y - Camera.y) / 2 && isCellVisible(first) && isCellVisible(second);
+}
+
+/* Relative to the camera, a half-block viewport can reach a row past the world */
+char getViewportCell(int row, int column)
+{
+	if (Camera.y + row >= ENV_HEIGHT) return ' ';
+	return WorldCells[Camera.y + row][Camera.x + column];
+}
+
+/* Board rows on the screen, half-block mode shows an even number of them */
+int viewportRows()
+{
+	return PaletteHalfBlock ? (VIEWPORT_HEIGHT + 1) & ~1 : VIEWPORT_HEIGHT;
+}
+
+/* Terminal lines the board takes */
+int viewportLines()
+{
+	return PaletteHalfBlock ? (VIEWPORT_HEIGHT + 1) / 2 : VIEWPORT_HEIGHT;
+}
+
+/* Half-block mode keeps the camera on an even row so the row pairs, and with
+ * them the terminal lines, stay the same while it scrolls */
+int maximumCameraRow()
+{
+	int row = ENV_HEIGHT - viewportRows();
+	if (PaletteHalfBlock) row += row & 1;
+	return row;
+}
+
+/* Moves the camera just enough to keep VIEWPORT_MARGIN cells around the head, without leaving the world */
+PointType calculateCamera(PointType head, PointType camera)
+{
+	int from = camera.y;
+	if (head.x < camera.x + VIEWPORT_MARGIN) camera.x = head.x - VIEWPORT_MARGIN;
+	if (head.x >= camera.x + VIEWPORT_WIDTH - VIEWPORT_MARGIN) camera.x = head.x - VIEWPORT_WIDTH + VIEWPORT_MARGIN + 1;
+	if (head.y < camera.y + VIEWPORT_MARGIN) camera.y = head.y - VIEWPORT_MARGIN;
+	if (head.y >= camera.y + viewportRows() - VIEWPORT_MARGIN) camera.y = head.y - viewportRows() + VIEWPORT_MARGIN + 1;
+	if (camera.x > ENV_WIDTH - VIEWPORT_WIDTH) camera.x = ENV_WIDTH - VIEWPORT_WIDTH;
+	if (camera.y > maximumCameraRow()) camera.y = maximumCameraRow();
+	if (camera.x < 0) camera.x = 0;
+	if (camera.y < 0) camera.y = 0;
+	/* Rounded the way it moved, one more row of margin rather than one less */
+	if (PaletteHalfBlock && (camera.y & 1)) camera.y += camera.y > from ? 1 : -1;
+	return camera;
+}
+
+/* Called before the new head is drawn. The part of the screen that stays
+ * visible is shifted by the terminal, so only the exposed rows or columns go
+ * over the UART. A jump larger than the viewport, like wrapping around the
+ * world, redraws it */
+void followWithCamera(PointType head)
+{
+	PointType camera = calculateCamera(head, Camera);
+	int dx = camera.x - Camera.x;
+	int dy = camera.y - Camera.y;
+	if (dx == 0 && dy == 0) return;
+	Camera = camera;
+	if (!ViewportScrolling || dx >= VIEWPORT_WIDTH || -dx >= VIEWPORT_WIDTH || dy >= viewportRows() || -dy >= viewportRows())
+	{
+		drawViewport();
+		return;
+	}
+	/* The blanks the terminal shifts in take the current background */
+	if (CellBackground != PALETTE_DEFAULT) useCellColors(PALETTE_ANY, PALETTE_DEFAULT);
+	/* The columns are shifted at the old rows, then the rows scroll in and
+	 * are drawn whole at the new camera */
+	if (dx != 0)
+	{
+		Camera.y -= dy;
+		scrollViewportColumns(dx);
+		Camera.y += dy;
+	}
+	if (dy != 0) scrollViewportRows(dy);
+}
+
+/* Rows are separated by CR LF, which is cheaper than positioning the cursor on every row */
+void drawViewport()
+{
+	int line;
+	moveCursorToRow(1);
+	for (line = 0; line < viewportLines(); line++)
+	{
+		putCell('#');
+		drawViewportCells(line, 0, VIEWPORT_WIDTH);
+		putCell('#');
+		putRenderChar('\r');
+		putRenderChar('\n');
+	}
+}
+
+/* DECSTBM limits the scroll to the viewport lines, SU or SD shifts them and
+ * the exposed lines are drawn. The delta is in board rows, always even in
+ * half-block mode */
+void scrollViewportRows(int delta)
+{
+	int lines = viewportLines();
+	int count = delta > 0 ? delta : -delta;
+	int first;
+	int line;
+	if (PaletteHalfBlock) count /= 2;
+	first = delta > 0 ? lines - count : 0;
+	putRenderChar('\033');
+	putRenderChar('[');
+	putRenderChar('2');
+	putRenderChar(';');
+	if (lines + 1 >= 10) putRenderChar((lines + 1) / 10 + 48);
+	putRenderChar((lines + 1) % 10 + 48);
+	putRenderChar('r');
+	putControlSequence(count, delta > 0 ? 'S' : 'T');
+	putControlSequence(-1, 'r');
+	moveCursorToRow(first + 1);
+	for (line = first; line < first + count; line++)
+	{
+		putCell('#');
+		drawViewportCells(line, 0, VIEWPORT_WIDTH);
+		putCell('#');
+		putRenderChar('\r');
+		putRenderChar('\n');
+	}
+}
+
+/* Every row is shifted with DCH or ICH right after the left border, then the
+ * exposed columns and the displaced right border are drawn */
+void scrollViewportColumns(int delta)
+{
+	int count = delta > 0 ? delta : -delta;
+	int line;
+	moveCursorToPosition(1, 1);
+	for (line = 0; line < viewportLines(); line++)
+	{
+		if (delta > 0)
+		{
+			putControlSequence(count, 'P');
+			putControlSequence(VIEWPORT_WIDTH - count, 'C');
+			drawViewportCells(line, VIEWPORT_WIDTH - count, count);
+			putCell('#');
+		}
+		else
+		{
+			putControlSequence(count, '@');
+			drawViewportCells(line, 0, count);
+			putControlSequence(VIEWPORT_WIDTH - count, 'C');
+			putCell('#');
+			putControlSequence(-1, 'K');
+		}
+		putRenderChar('\r');
+		putRenderChar('\n');
+		putControlSequence(-1, 'C');
+	}
+}
+
+void drawViewportCells(int line, int column, int count)
+{
+	const char *cells;
+	if (PaletteHalfBlock)
+	{
+		for ( ; count > 0; count--, column++) putCellPair(getViewportCell(line * 2, column), getViewportCell(line * 2 + 1, column));
+		return;
+	}
+	cells = &WorldCells[Camera.y + line][Camera.x + column];
+	while (count-- > 0) putCell(*cells++);
+}
+
+/* First column of the given line, moveCursorToPosition always moves at least one column */
+void moveCursorToRow(int line)
+{
+	putControlSequence(-1, 'H');
+	putControlSequence(line, 'B');
+}
+
+/* ESC [ parameter final, the parameter is left out when negative */
+void putControlSequence(int parameter, char final)
+{
+	putRenderChar('\033');
+	putRenderChar('[');
+	if (parameter >= 10) putRenderChar(parameter / 10 + 48);
+	if (parameter >= 0) putRenderChar(parameter % 10 + 48);
+	putRenderChar(final);
+}
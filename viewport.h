@@ -0,0 +1,27 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "game.h"
+
+/* Viewport Configuration Parameters */
+#define VIEWPORT_USE_SCROLL		1		/* 1: shift the screen with scroll regions and character insert/delete, 0: redraw the viewport */
+#define VIEWPORT_MARGIN			3		/* Cells kept between the snake head and the viewport edge */
+
+/* Global Variables */
+extern char WorldCells[ENV_HEIGHT][ENV_WIDTH];
+extern PointType Camera;
+extern bool ViewportScrolling;
+
+/* Viewport Functions */
+void resetViewport(PointType head);
+void drawWorldCell(PointType position, char c);
+bool isCellVisible(PointType position);
+bool isSameCellPair(PointType first, PointType second);
+char getViewportCell(int row, int column);
+int viewportRows();
+int viewportLines();
+PointType calculateCamera(PointType head, PointType camera);
+void followWithCamera(PointType head);
+void drawViewport();
+
+#endif /* VIEWPORT_H */